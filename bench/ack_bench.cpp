@@ -0,0 +1,245 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "InFlightTable.h"
+#include "ReceiveWindow.h"
+#include "MessageBuilder.h"
+#include "MessageView.h"
+#include "Event.h"
+#include "Timer.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+// ACKs processed per configuration, enough for a stable reading
+constexpr std::size_t BENCH_TOTAL_ACKS = 2U * 1024U * 1024U;
+
+using Clock = std::chrono::steady_clock;
+
+struct Sent {
+  std::array<std::uint8_t, INFLIGHT_MESSAGE_MAX_LEN> data;
+  std::size_t size;
+  std::uint16_t fullType;
+  std::uint16_t seq;
+  std::uint16_t crc;
+};
+
+// Reliable messages of different sub types, Value first and then Ping
+static std::vector<Sent> makeMessages(std::size_t count)
+{
+  std::vector<Sent> messages(count);
+
+  for (std::size_t i = 0; i < count; i++) {
+    std::uint8_t type = i < MSG_TYPE_MAX ? MessageType::Value : MessageType::Ping;
+    Sent& sent = messages[i];
+
+    MessageBuilder builder(sent.data.data(), sent.data.size());
+    builder.begin(type, static_cast<std::uint8_t>(i % MSG_TYPE_MAX));
+    if (type == MessageType::Value) {
+      builder.setPayload16(static_cast<std::uint16_t>(i));
+    }
+    sent.size = builder.finish(Crc::Mode::Crc16);
+
+    MessageView view(sent.data.data(), sent.size);
+    sent.fullType = view.fullType();
+    sent.seq = view.seq();
+    sent.crc = view.crc();
+  }
+
+  return messages;
+}
+
+// The per type maps and timers the Transmitter used before the in-flight table
+class MapState
+{
+ public:
+  explicit MapState(EventLoop& eventLoop) : eventLoop(eventLoop) {}
+
+  void sent(const Sent& msg, Clock::time_point now)
+  {
+    Stored& stored = resendMessages[msg.fullType];
+    std::copy(msg.data.begin(), msg.data.begin() + msg.size, stored.data.begin());
+    stored.size = msg.size;
+
+    if (!resendTimers[msg.fullType]) {
+      resendTimers[msg.fullType] = std::make_shared<Timer>(eventLoop);
+    }
+    resendTimers[msg.fullType]->start(1000, []() {});
+
+    rtTimers[msg.fullType] = now;
+  }
+
+  int ack(const Sent& msg, Clock::time_point now)
+  {
+    std::uint16_t fullType = msg.fullType;
+    auto stored = resendMessages.find(fullType);
+    if (stored != resendMessages.end() && stored->second.size > 0 &&
+        MessageView(stored->second.data.data(), stored->second.size).crc() != msg.crc) {
+      return 0;
+    }
+
+    if (resendTimers[fullType]) {
+      resendTimers[fullType]->stop();
+    }
+
+    int rtt = 0;
+    auto rtTimer = rtTimers.find(fullType);
+    if (rtTimer != rtTimers.end() && rtTimer->second != Clock::time_point()) {
+      rtt = static_cast<int>((now - rtTimer->second).count() & 0xFF);
+      rtTimer->second = Clock::time_point();
+    }
+
+    if (stored != resendMessages.end()) {
+      stored->second.size = 0;
+    }
+
+    return rtt;
+  }
+
+ private:
+  struct Stored {
+    std::array<std::uint8_t, INFLIGHT_MESSAGE_MAX_LEN> data;
+    std::size_t size;
+  };
+
+  EventLoop& eventLoop;
+  std::map<std::uint16_t, std::shared_ptr<Timer>> resendTimers;
+  std::map<std::uint16_t, Clock::time_point> rtTimers;
+  std::map<std::uint16_t, Stored> resendMessages;
+};
+
+// The in-flight table with one timer and cumulative ACKs, as in the Transmitter
+class TableState
+{
+ public:
+  explicit TableState(EventLoop& eventLoop) : timer(eventLoop.context()), armed(false) {}
+
+  void sent(const Sent& msg, Clock::time_point now)
+  {
+    table.store(MessageView(msg.data.data(), msg.size), now, now + std::chrono::seconds(1));
+
+    Clock::time_point deadline;
+    if (table.nextDeadline(deadline) && (!armed || deadline < armedDeadline)) {
+      armed = true;
+      armedDeadline = deadline;
+      timer.expires_at(deadline);
+      timer.async_wait([](const asio::error_code&) {});
+    }
+  }
+
+  int ack(const Sent& msg, Clock::time_point now)
+  {
+    InFlightTable::Slot* window = table.window(msg.fullType);
+    if (!window) {
+      return 0;
+    }
+
+    int rtt = 0;
+    for (std::size_t i = 0; i < INFLIGHT_WINDOW; i++) {
+      InFlightTable::Slot& slot = window[i];
+      if (slot.size == 0 || !ReceiveWindow::isAcked(slot.seq, msg.seq, 0)) {
+        continue;
+      }
+
+      table.unschedule(slot);
+      rtt = static_cast<int>((now - slot.sent).count() & 0xFF);
+      slot.size = 0;
+    }
+
+    return rtt;
+  }
+
+ private:
+  InFlightTable table;
+  asio::steady_timer timer;
+  bool armed;
+  Clock::time_point armedDeadline;
+};
+
+// Send all messages, then time ACKing them. Returns nanoseconds per ACK.
+template <typename State>
+static double benchmark(EventLoop& eventLoop, const std::vector<Sent>& messages,
+                        std::uint32_t& sink)
+{
+  State state(eventLoop);
+  std::size_t rounds = BENCH_TOTAL_ACKS / messages.size();
+  double seconds = 0;
+
+  for (std::size_t round = 0; round < rounds; round++) {
+    Clock::time_point now = Clock::now();
+    for (const Sent& msg : messages) {
+      state.sent(msg, now);
+    }
+
+    // ACKs arrive in a different order than the messages were sent
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < messages.size(); i++) {
+      const Sent& msg = messages[(i * 7) % messages.size()];
+      sink += state.ack(msg, start);
+    }
+    seconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Run the cancelled timer handlers outside the measurement
+    eventLoop.context().poll();
+  }
+
+  return seconds * 1e9 / (rounds * messages.size());
+}
+
+int main(int argc, char *argv[])
+{
+  // Reliable messages in flight at the same time
+  std::vector<std::size_t> counts = {1, 8, 64, 256, INFLIGHT_STREAMS};
+  if (argc > 1) {
+    counts.clear();
+    for (int i = 1; i < argc; i++) {
+      std::size_t count = std::strtoul(argv[i], nullptr, 0);
+      counts.push_back(count < INFLIGHT_STREAMS ? count : INFLIGHT_STREAMS);
+    }
+  }
+
+  EventLoop eventLoop;
+  std::uint32_t sink = 0;
+
+  std::cout << std::left << std::setw(8) << "state"
+            << std::right << std::setw(10) << "in-flight"
+            << std::setw(14) << "ns/ack" << std::endl;
+
+  for (std::size_t count : counts) {
+    if (count == 0 || count % 7 == 0) {
+      continue; // The ACK order needs a count not divisible by 7
+    }
+
+    std::vector<Sent> messages = makeMessages(count);
+
+    double mapNs = benchmark<MapState>(eventLoop, messages, sink);
+    double tableNs = benchmark<TableState>(eventLoop, messages, sink);
+
+    std::cout << std::left << std::setw(8) << "map"
+              << std::right << std::setw(10) << count
+              << std::setw(14) << std::fixed << std::setprecision(1) << mapNs << std::endl;
+    std::cout << std::left << std::setw(8) << "table"
+              << std::right << std::setw(10) << count
+              << std::setw(14) << std::fixed << std::setprecision(1) << tableNs << std::endl;
+  }
+
+  // Keep the compiler from optimising the loops away
+  return sink == 0xFFFFFFFF ? 1 : 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Crc.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Checksum enough bytes per variant to get a stable reading
+constexpr std::size_t BENCH_TOTAL_BYTES = 256U * 1024U * 1024U;
+
+static double benchmark(Crc::Mode mode, const std::vector<std::uint8_t>& buffer,
+                        std::uint32_t& sink)
+{
+  std::size_t rounds = BENCH_TOTAL_BYTES / buffer.size();
+  if (mode == Crc::Mode::Crc16Bitwise) {
+    rounds /= 8; // The reference implementation is slow, keep runtime sane
+  }
+  if (rounds == 0) {
+    rounds = 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < rounds; i++) {
+    sink += Crc::checksum(mode, buffer.data(), buffer.size());
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(end - start).count();
+  return (rounds * buffer.size()) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+  // Message sizes: value, ACK, RTP video packet, full datagram
+  std::vector<std::size_t> sizes = {8, 10, 506, 4096};
+  if (argc > 1) {
+    sizes.clear();
+    for (int i = 1; i < argc; i++) {
+      sizes.push_back(std::strtoul(argv[i], nullptr, 0));
+    }
+  }
+
+  const Crc::Mode modes[] = {
+    Crc::Mode::Crc16Bitwise,
+    Crc::Mode::Crc16,
+    Crc::Mode::Crc32C,
+  };
+
+  std::uint32_t sink = 0;
+
+  std::cout << std::left << std::setw(16) << "mode"
+            << std::right << std::setw(8) << "size"
+            << std::setw(14) << "MB/s" << std::endl;
+
+  for (std::size_t size : sizes) {
+    if (size == 0) {
+      continue;
+    }
+
+    std::vector<std::uint8_t> buffer(size);
+    for (std::size_t i = 0; i < size; i++) {
+      buffer[i] = static_cast<std::uint8_t>(i * 31 + 7);
+    }
+
+    for (Crc::Mode mode : modes) {
+      double rate = benchmark(mode, buffer, sink);
+      std::cout << std::left << std::setw(16) << Crc::getModeStr(mode)
+                << std::right << std::setw(8) << size
+                << std::setw(14) << std::fixed << std::setprecision(1)
+                << rate / (1024.0 * 1024.0) << std::endl;
+    }
+  }
+
+  // Keep the compiler from optimising the loops away
+  return sink == 0xFFFFFFFF ? 1 : 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,612 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Slave.h"
+#include "Controller.h"
+#include "VideoReceiverGst.h"
+#include "AudioReceiver.h"
+#include "FrameStamp.h"
+#include "Metrics.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+// End to end benchmark of the whole stack on loopback. The slave runs in
+// a child process with videotestsrc and a pseudo terminal in place of the
+// control board's serial port, netrelay in another and the controller
+// headless in this one. Measured are:
+//
+//   - glass-to-glass video latency, from the FrameStamp drawn into the
+//     captured frame to the decoded frame in the controller
+//   - control round trip, from Controller::setSpeedTurn() to the PWM
+//     command written to the control board
+//   - the controller's received and sent bytes and the decoded frame rate
+//   - CPU used by each of the three processes
+//
+// The results are written as JSON, e.g. for tracking across releases:
+//
+//   pleco-bench --duration 30 --up loss=1,delay=20 --output bench.json
+
+#ifndef PLECO_VERSION
+#define PLECO_VERSION "unknown"
+#endif
+
+#ifndef PLECO_BENCH_NETRELAY
+#define PLECO_BENCH_NETRELAY "netrelay"
+#endif
+
+constexpr int BENCH_DURATION_DEFAULT_S = 10;
+constexpr int BENCH_RELAY_START_MS     = 200;
+constexpr int BENCH_CONNECT_MS         = 10000;  // For the first datagram and the first frame each
+constexpr int BENCH_PROBE_MS           = 100;    // Well above the controller's speed/turn throttling
+constexpr int BENCH_FRAME_POLL_MS      = 1;
+constexpr int BENCH_TELEMETRY_MS       = 500;    // Keeps the control board watchdog from reopening the port
+constexpr int BENCH_STALE_FRAME_MS     = 10000;  // Older stamps are misreads
+
+// Speed is alternated between these so that each probe changes the PWM
+constexpr int BENCH_PROBE_SPEED_LOW    = 20;
+constexpr int BENCH_PROBE_SPEED_HIGH   = 40;
+
+constexpr std::uint16_t BENCH_SLAVE_PORT      = 8500;
+constexpr std::uint16_t BENCH_CONTROLLER_PORT = 12347;
+
+using Clock = std::chrono::steady_clock;
+
+// The slave's end of a pseudo terminal stands in for the control board.
+// The commands written to it are timestamped and telemetry is written
+// back like the real board does.
+class FakeControlBoard
+{
+ public:
+  FakeControlBoard() : master(-1), slave(-1), running(false), pending(false), expectedDuty(0), lost(0) {}
+
+  ~FakeControlBoard()
+  {
+    stop();
+    if (slave >= 0) {
+      close(slave);
+    }
+    if (master >= 0) {
+      close(master);
+    }
+  }
+
+  bool open(void)
+  {
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+      std::cerr << "Failed to create a pseudo terminal: " << std::strerror(errno) << std::endl;
+      return false;
+    }
+
+    path = ptsname(master);
+
+    // Keep the slave end open so that the master doesn't hang up before
+    // the slave process opens it, and raw so that nothing is echoed
+    slave = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+      std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << std::endl;
+      return false;
+    }
+
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    return true;
+  }
+
+  const std::string& getPath(void) const { return path; }
+
+  void start(void)
+  {
+    running = true;
+    reader = std::thread([this]() { serve(); });
+  }
+
+  void stop(void)
+  {
+    running = false;
+    if (reader.joinable()) {
+      reader.join();
+    }
+  }
+
+  // Time the next PWM command with the duty on the speed channel. A
+  // previous probe still waiting is counted lost.
+  void probe(std::uint16_t duty)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending) {
+      lost++;
+    }
+    pending = true;
+    expectedDuty = duty;
+    sent = Clock::now();
+  }
+
+  std::vector<double> getRttMs(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rttMs;
+  }
+
+  std::size_t getLost(void)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lost + (pending ? 1 : 0);
+  }
+
+ private:
+  void serve(void)
+  {
+    std::string line;
+    Clock::time_point nextTelemetry = Clock::now();
+
+    while (running) {
+      struct pollfd pfd = { master, POLLIN, 0 };
+      poll(&pfd, 1, BENCH_TELEMETRY_MS / 5);
+
+      char buffer[256];
+      ssize_t len;
+      while ((len = read(master, buffer, sizeof(buffer))) > 0) {
+        Clock::time_point now = Clock::now();
+        for (ssize_t i = 0; i < len; i++) {
+          if (buffer[i] == '\r' || buffer[i] == '\n') {
+            command(line, now);
+            line.clear();
+          } else {
+            line += static_cast<char>(buffer[i]);
+          }
+        }
+      }
+
+      // Battery voltage like the board sends, a full pty buffer is fine
+      if (Clock::now() >= nextTelemetry) {
+        const char telemetry[] = "vlt: 1200\n";
+        ssize_t written = write(master, telemetry, sizeof(telemetry) - 1);
+        (void)written;
+        nextTelemetry += std::chrono::milliseconds(BENCH_TELEMETRY_MS);
+      }
+    }
+  }
+
+  void command(const std::string& cmd, Clock::time_point now)
+  {
+    // pwm_duty <channel> <duty>
+    unsigned int channel, duty;
+    if (std::sscanf(cmd.c_str(), "pwm_duty %u %u", &channel, &duty) != 2 ||
+        channel != CB_PWM::SPEED_LEFT) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending && duty == expectedDuty) {
+      pending = false;
+      rttMs.push_back(std::chrono::duration<double, std::milli>(now - sent).count());
+    }
+  }
+
+  int master;
+  int slave;
+  std::string path;
+  std::thread reader;
+  std::atomic<bool> running;
+
+  std::mutex mutex;
+  bool pending;
+  std::uint16_t expectedDuty;
+  Clock::time_point sent;
+  std::vector<double> rttMs;
+  std::size_t lost;
+};
+
+// The slave as in a live run, in a child process so that its CPU use
+// can be told apart
+static pid_t startSlave(const std::string& tty)
+{
+  pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+  setenv("PLECO_MCU_TTY", tty.c_str(), 1);
+  setenv("PLECO_VIDEO_STAMP", "1", 1);
+
+  Log::setLevel(Log::Level::Warn);
+  Log::init();
+
+  EventLoop eventLoop;
+  eventLoop.configureFromEnvironment();
+
+  Slave slave(eventLoop, 0, nullptr);
+  if (!slave.init()) {
+    _exit(EXIT_FAILURE);
+  }
+  slave.connect("127.0.0.1", BENCH_SLAVE_PORT);
+
+  eventLoop.run();
+  _exit(EXIT_SUCCESS);
+}
+
+static pid_t startRelay(const std::string& path, const std::vector<std::string>& args)
+{
+  pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+  // Standard output is for the results
+  dup2(STDERR_FILENO, STDOUT_FILENO);
+
+  std::vector<char*> argv;
+  argv.push_back(const_cast<char*>(path.c_str()));
+  for (const auto& arg : args) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  execv(path.c_str(), argv.data());
+  std::perror(path.c_str());
+  _exit(EXIT_FAILURE);
+}
+
+static void stopProcess(pid_t pid)
+{
+  if (pid > 0) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+  }
+}
+
+static bool exited(pid_t pid)
+{
+  return waitpid(pid, nullptr, WNOHANG) == pid;
+}
+
+// User and system CPU time of a process in seconds
+static double cpuSeconds(pid_t pid)
+{
+  std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat;
+  std::getline(file, stat);
+
+  // The command may contain spaces, the fields after it don't
+  std::size_t end = stat.rfind(')');
+  if (end == std::string::npos) {
+    return 0;
+  }
+
+  // utime and stime are the 14th and 15th fields, the state is the 3rd
+  std::istringstream fields(stat.substr(end + 1));
+  std::string field;
+  for (int i = 3; i < 14; i++) {
+    fields >> field;
+  }
+
+  unsigned long utime = 0, stime = 0;
+  fields >> utime >> stime;
+
+  return static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+static std::string utcTime(void)
+{
+  std::time_t now = std::time(nullptr);
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  return buffer;
+}
+
+static std::string jsonString(const std::string& str)
+{
+  std::string out = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out + "\"";
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+
+static void writeLatency(std::ostream& out, std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+
+  double mean = 0;
+  for (double value : values) {
+    mean += value;
+  }
+  if (!values.empty()) {
+    mean /= values.size();
+  }
+
+  out << "{\"samples\": " << values.size()
+      << ", \"min\": " << percentile(values, 0)
+      << ", \"mean\": " << mean
+      << ", \"p50\": " << percentile(values, 0.5)
+      << ", \"p90\": " << percentile(values, 0.9)
+      << ", \"p99\": " << percentile(values, 0.99)
+      << ", \"max\": " << percentile(values, 1.0) << "}";
+}
+
+static void usage(const char* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [options]" << std::endl
+            << "  --duration <s>      Measured time after the video is up (default "
+            << BENCH_DURATION_DEFAULT_S << ")" << std::endl
+            << "  --quality <0-3>     Video quality (default 0)" << std::endl
+            << "  --netrelay <path>   The relay to run (default " << PLECO_BENCH_NETRELAY << ")" << std::endl
+            << "  --up <spec>         Impairment towards the controller, see netrelay --help" << std::endl
+            << "  --down <spec>       Impairment towards the slave" << std::endl
+            << "  --output <file>     Write the JSON there instead of standard output" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  int duration = BENCH_DURATION_DEFAULT_S;
+  int quality = 0;
+  std::string relayPath = PLECO_BENCH_NETRELAY;
+  std::string up, down, output;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--duration" && i + 1 < argc) {
+      duration = std::atoi(argv[++i]);
+    } else if (arg == "--quality" && i + 1 < argc) {
+      quality = std::atoi(argv[++i]);
+    } else if (arg == "--netrelay" && i + 1 < argc) {
+      relayPath = argv[++i];
+    } else if (arg == "--up" && i + 1 < argc) {
+      up = argv[++i];
+    } else if (arg == "--down" && i + 1 < argc) {
+      down = argv[++i];
+    } else if (arg == "--output" && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (duration <= 0 || quality < 0 || quality > 3) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // The processes are forked before any threads are started here
+  FakeControlBoard board;
+  if (!board.open()) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> relayArgs;
+  if (!up.empty()) {
+    relayArgs.insert(relayArgs.end(), {"--up", up});
+  }
+  if (!down.empty()) {
+    relayArgs.insert(relayArgs.end(), {"--down", down});
+  }
+
+  pid_t relay = startRelay(relayPath, relayArgs);
+  std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RELAY_START_MS));
+  if (relay < 0 || exited(relay)) {
+    std::cerr << "Failed to start " << relayPath << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  pid_t slave = startSlave(board.getPath());
+  if (slave < 0) {
+    std::cerr << "Failed to start the slave: " << std::strerror(errno) << std::endl;
+    stopProcess(relay);
+    return EXIT_FAILURE;
+  }
+
+  Log::setLevel(Log::Level::Warn);
+  Log::init();
+
+  board.start();
+
+  EventLoop eventLoop;
+  eventLoop.configureFromEnvironment();
+
+  Controller controller(eventLoop, new VideoReceiverGst(), new AudioReceiver());
+  controller.connect("127.0.0.1", BENCH_CONTROLLER_PORT);
+  controller.start();
+
+  Metrics::Counter& rxBytes = Metrics::registry().counter("pleco_rx_bytes_total", "UDP payload bytes received");
+  Metrics::Counter& txBytes = Metrics::registry().counter("pleco_tx_bytes_total", "UDP payload bytes sent");
+  Metrics::Counter& videoBytes = Metrics::registry().counter("pleco_video_received_bytes_total",
+                                                             "Encoded video bytes received");
+
+  auto fail = [&](const std::string& error) {
+    std::cerr << error << std::endl;
+    controller.stop();
+    board.stop();
+    stopProcess(slave);
+    stopProcess(relay);
+    return EXIT_FAILURE;
+  };
+
+  // Wait for the slave's periodic values through the relay
+  Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(BENCH_CONNECT_MS);
+  while (rxBytes.get() == 0) {
+    if (Clock::now() > deadline || exited(slave) || exited(relay)) {
+      return fail("No connection to the slave");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_FRAME_POLL_MS));
+  }
+
+  controller.setVideoSource(1);     // videotestsrc
+  controller.setVideoQuality(quality);
+  controller.setVideo(true);
+
+  // Returns the age of the latest decoded frame if it's a new one
+  std::uint32_t lastStamp = 0;
+  bool haveStamp = false;
+  auto pollFrame = [&](double& latencyMs) {
+    IVideoReceiver::FrameData frame;
+    if (!controller.videoFrameGet(frame)) {
+      return false;
+    }
+
+    std::uint32_t stamp;
+    bool valid = FrameStamp::read(frame.pixels, frame.width, frame.height, frame.stride, 4, stamp);
+    controller.videoFrameRelease(frame);
+
+    if (!valid || (haveStamp && stamp == lastStamp)) {
+      return false;
+    }
+
+    std::uint32_t age = FrameStamp::age(stamp);
+    if (age > BENCH_STALE_FRAME_MS * 1000U) {
+      return false;
+    }
+
+    lastStamp = stamp;
+    haveStamp = true;
+    latencyMs = age / 1000.0;
+    return true;
+  };
+
+  // The measurements start with the first frame
+  deadline = Clock::now() + std::chrono::milliseconds(BENCH_CONNECT_MS);
+  double latencyMs;
+  while (!pollFrame(latencyMs)) {
+    if (Clock::now() > deadline || exited(slave) || exited(relay)) {
+      return fail("No video from the slave");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_FRAME_POLL_MS));
+  }
+
+  pid_t self = getpid();
+  double cpuSlave = cpuSeconds(slave);
+  double cpuRelay = cpuSeconds(relay);
+  double cpuController = cpuSeconds(self);
+  std::uint64_t rxStart = rxBytes.get();
+  std::uint64_t txStart = txBytes.get();
+  std::uint64_t videoStart = videoBytes.get();
+
+  std::vector<double> videoLatencyMs;
+  std::size_t probes = 0;
+
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::seconds(duration);
+  Clock::time_point nextProbe = start;
+
+  while (Clock::now() < end) {
+    if (pollFrame(latencyMs)) {
+      videoLatencyMs.push_back(latencyMs);
+    }
+
+    if (Clock::now() >= nextProbe) {
+      int speed = probes % 2 ? BENCH_PROBE_SPEED_HIGH : BENCH_PROBE_SPEED_LOW;
+      board.probe(static_cast<std::uint16_t>(speed * 100));
+      controller.setSpeedTurn(speed, 0);
+      probes++;
+      nextProbe += std::chrono::milliseconds(BENCH_PROBE_MS);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_FRAME_POLL_MS));
+  }
+
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  cpuSlave = cpuSeconds(slave) - cpuSlave;
+  cpuRelay = cpuSeconds(relay) - cpuRelay;
+  cpuController = cpuSeconds(self) - cpuController;
+  double rxKbps = (rxBytes.get() - rxStart) * 8 / seconds / 1000;
+  double txKbps = (txBytes.get() - txStart) * 8 / seconds / 1000;
+  double videoKbps = (videoBytes.get() - videoStart) * 8 / seconds / 1000;
+
+  // The last probe is given the probe interval to arrive
+  std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_PROBE_MS));
+
+  controller.stop();
+  board.stop();
+  stopProcess(slave);
+  stopProcess(relay);
+
+  std::ofstream file;
+  if (!output.empty()) {
+    file.open(output);
+    if (!file) {
+      std::cerr << "Failed to open " << output << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  out << std::fixed << std::setprecision(3);
+  out << "{" << std::endl
+      << "  \"version\": " << jsonString(PLECO_VERSION) << "," << std::endl
+      << "  \"time\": " << jsonString(utcTime()) << "," << std::endl
+      << "  \"duration_s\": " << seconds << "," << std::endl
+      << "  \"video_quality\": " << quality << "," << std::endl
+      << "  \"impairment\": {\"up\": " << jsonString(up) << ", \"down\": " << jsonString(down) << "}," << std::endl
+      << "  \"video\": {\"frames\": " << videoLatencyMs.size()
+      << ", \"fps\": " << videoLatencyMs.size() / seconds
+      << ", \"latency_ms\": ";
+  writeLatency(out, videoLatencyMs);
+  out << "}," << std::endl
+      << "  \"control\": {\"probes\": " << probes
+      << ", \"lost\": " << board.getLost()
+      << ", \"rtt_ms\": ";
+  writeLatency(out, board.getRttMs());
+  out << "}," << std::endl
+      << "  \"throughput_kbps\": {\"rx\": " << rxKbps
+      << ", \"tx\": " << txKbps
+      << ", \"video\": " << videoKbps << "}," << std::endl
+      << "  \"cpu_percent\": {\"slave\": " << cpuSlave / seconds * 100
+      << ", \"netrelay\": " << cpuRelay / seconds * 100
+      << ", \"controller\": " << cpuController / seconds * 100 << "}" << std::endl
+      << "}" << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
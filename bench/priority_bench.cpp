@@ -0,0 +1,224 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Transmitter.h"
+#include "MessageBuilder.h"
+#include "MessageView.h"
+#include "Event.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Control message latency under video load. A Transmitter sends video
+// frames at the given rate and a SpeedTurn value every few milliseconds,
+// a plain socket receives them, ACKs the values and timestamps them.
+//
+// Loopback never queues in the kernel, so for a bottleneck link shape it,
+// e.g. in a network namespace:
+//
+//   unshare -n sh -c 'ip link set lo up &&
+//     tc qdisc add dev lo root tbf rate 20mbit burst 16kb limit 1mb &&
+//     ./pleco-priority-bench 40000 0 16384'
+
+constexpr int BENCH_RUN_MS         = 3000;
+constexpr int BENCH_SETTLE_MS      = 500;    // Before the run, and for the queues to drain after it
+constexpr int BENCH_FRAME_MS       = 33;
+constexpr int BENCH_PROBE_MS       = 5;
+constexpr int BENCH_VIDEO_DEFAULT  = 40000;  // kbit/s
+constexpr int BENCH_RECEIVE_BUFFER = 4 * 1024 * 1024;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  std::vector<double> latencyMs;
+  std::size_t probes;
+  std::size_t videoBytes;
+  std::uint32_t drops;
+};
+
+// Receives the datagrams, ACKs reliable ones and records probe latencies
+class Receiver
+{
+ public:
+  Receiver(EventLoop& eventLoop, const std::vector<Clock::time_point>& sent, Result& result) :
+    socket(eventLoop.context(), asio::ip::udp::endpoint(asio::ip::address_v4::loopback(), 0)),
+    sent(sent),
+    result(result),
+    seen(sent.size(), false)
+  {
+    // Room for a few video frames so that losses happen on the link only
+    asio::error_code ec;
+    socket.set_option(asio::socket_base::receive_buffer_size(BENCH_RECEIVE_BUFFER), ec);
+    receive();
+  }
+
+  std::uint16_t port(void) const { return socket.local_endpoint().port(); }
+
+ private:
+  void receive(void)
+  {
+    socket.async_receive_from(asio::buffer(buffer), sender,
+                              [this](const asio::error_code& error, std::size_t size) {
+      if (error) {
+        return;
+      }
+      handle(MessageView(buffer.data(), size));
+      receive();
+    });
+  }
+
+  void handle(const MessageView& msg)
+  {
+    if (msg.type() != MessageType::Value) {
+      result.videoBytes += msg.size();
+      return;
+    }
+
+    // ACK every copy, but only the first copy of a probe is timed
+    std::array<std::uint8_t, TX_CONTROL_MAX_LEN> ack;
+    MessageBuilder builder(ack.data(), ack.size());
+    builder.begin(MessageType::Ack);
+    builder.setACK(msg);
+    asio::error_code ec;
+    socket.send_to(asio::buffer(ack.data(), builder.finish(Crc::Mode::Crc16)), sender, 0, ec);
+
+    std::uint16_t probe = msg.getPayload16();
+    if (probe < sent.size() && !seen[probe]) {
+      seen[probe] = true;
+      result.latencyMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sent[probe]).count());
+    }
+  }
+
+  asio::ip::udp::socket socket;
+  asio::ip::udp::endpoint sender;
+  std::array<std::uint8_t, TX_MEDIA_MAX_LEN> buffer;
+  const std::vector<Clock::time_point>& sent;
+  Result& result;
+  std::vector<bool> seen;
+};
+
+static Result benchmark(int videoKbps, std::size_t limit)
+{
+  EventLoop eventLoop;
+  Result result = {};
+  std::vector<Clock::time_point> sent(BENCH_RUN_MS / BENCH_PROBE_MS + 1);
+
+  Receiver receiver(eventLoop, sent, result);
+  Transmitter transmitter(eventLoop, "127.0.0.1", receiver.port());
+  transmitter.setSocketQueueLimit(limit);
+  transmitter.initSocket();
+
+  std::vector<std::uint8_t> frame(static_cast<std::size_t>(videoKbps) * 1000 / 8 * BENCH_FRAME_MS / 1000, 0x55);
+  asio::steady_timer videoTimer(eventLoop.context());
+  asio::steady_timer probeTimer(eventLoop.context());
+  asio::steady_timer stopTimer(eventLoop.context());
+  bool loading = false;
+
+  std::function<void(void)> sendFrame = [&]() {
+    if (!loading) {
+      return;
+    }
+    transmitter.sendVideo(frame.data(), frame.size());
+    videoTimer.expires_at(videoTimer.expiry() + std::chrono::milliseconds(BENCH_FRAME_MS));
+    videoTimer.async_wait([&](const asio::error_code& error) { if (!error) sendFrame(); });
+  };
+
+  std::function<void(void)> sendProbe = [&]() {
+    if (!loading || result.probes == sent.size()) {
+      return;
+    }
+    sent[result.probes] = Clock::now();
+    transmitter.sendValue(MessageSubtype::SpeedTurn, static_cast<std::uint16_t>(result.probes));
+    result.probes++;
+    probeTimer.expires_at(probeTimer.expiry() + std::chrono::milliseconds(BENCH_PROBE_MS));
+    probeTimer.async_wait([&](const asio::error_code& error) { if (!error) sendProbe(); });
+  };
+
+  // Let the video fill the queues before the first probe
+  loading = true;
+  videoTimer.expires_after(std::chrono::milliseconds(0));
+  sendFrame();
+  probeTimer.expires_after(std::chrono::milliseconds(BENCH_SETTLE_MS));
+  probeTimer.async_wait([&](const asio::error_code& error) { if (!error) sendProbe(); });
+
+  stopTimer.expires_after(std::chrono::milliseconds(BENCH_SETTLE_MS + BENCH_RUN_MS));
+  stopTimer.async_wait([&](const asio::error_code&) {
+    loading = false;
+    result.drops = transmitter.getSendQueueDrops();
+
+    // Late probes still count, then give the link time to drain
+    stopTimer.expires_after(std::chrono::milliseconds(BENCH_SETTLE_MS));
+    stopTimer.async_wait([&](const asio::error_code&) { eventLoop.stop(); });
+  });
+
+  eventLoop.run();
+  return result;
+}
+
+static double percentile(std::vector<double>& values, double p)
+{
+  if (values.empty()) {
+    return 0;
+  }
+
+  std::sort(values.begin(), values.end());
+  std::size_t index = static_cast<std::size_t>(p * (values.size() - 1));
+  return values[index];
+}
+
+int main(int argc, char *argv[])
+{
+  // Video load and the socket queue limits to compare, 0 is no limit
+  int videoKbps = argc > 1 ? std::atoi(argv[1]) : BENCH_VIDEO_DEFAULT;
+  std::vector<std::size_t> limits = {0, TX_SOCKET_QUEUE_DEFAULT};
+  if (argc > 2) {
+    limits.clear();
+    for (int i = 2; i < argc; i++) {
+      limits.push_back(std::strtoul(argv[i], nullptr, 0));
+    }
+  }
+
+  std::cout << "video " << videoKbps << " kbit/s, a probe every " << BENCH_PROBE_MS << " ms" << std::endl;
+  std::cout << std::left << std::setw(10) << "limit"
+            << std::right << std::setw(8) << "probes"
+            << std::setw(8) << "lost"
+            << std::setw(10) << "p50 ms"
+            << std::setw(10) << "p99 ms"
+            << std::setw(10) << "max ms"
+            << std::setw(14) << "video kbit/s"
+            << std::setw(8) << "drops" << std::endl;
+
+  for (std::size_t limit : limits) {
+    Result result = benchmark(videoKbps, limit);
+    std::size_t received = result.latencyMs.size();
+
+    std::cout << std::left << std::setw(10) << limit
+              << std::right << std::setw(8) << result.probes
+              << std::setw(8) << result.probes - received
+              << std::fixed << std::setprecision(2)
+              << std::setw(10) << percentile(result.latencyMs, 0.5)
+              << std::setw(10) << percentile(result.latencyMs, 0.99)
+              << std::setw(10) << percentile(result.latencyMs, 1.0)
+              << std::setw(14) << result.videoBytes * 8 / (BENCH_RUN_MS + 2 * BENCH_SETTLE_MS)
+              << std::setw(8) << result.drops << std::endl;
+  }
+
+  return 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
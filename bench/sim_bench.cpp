@@ -0,0 +1,242 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Transmitter.h"
+#include "DatagramLink.h"
+#include "Event.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The Transmitter protocol over an in-memory DatagramLink in virtual
+// time. The slave end sends video, the controller end a SpeedTurn value
+// every few milliseconds, and an hour of an impaired link takes seconds
+// to run. A run depends only on the seed, so the reliability and
+// congestion parameters can be compared on exactly the same losses, e.g.
+//
+//   ./pleco-sim-bench --duration 3600 --up loss=2,delay=30 --down ge=1:20
+
+constexpr int BENCH_DURATION_DEFAULT_S = 600;
+constexpr int BENCH_VIDEO_DEFAULT      = 2000;   // kbit/s
+constexpr int BENCH_FRAME_MS           = 33;
+constexpr int BENCH_PROBE_MS           = 10;
+constexpr int BENCH_DRAIN_MS           = 2000;   // For the late values and resends
+
+using Clock = EventLoop::Clock;
+using WallClock = std::chrono::steady_clock;
+
+struct Result {
+  std::vector<double> latencyMs;
+  std::uint32_t probes;
+  std::uint32_t frames;
+  std::uint32_t framesReceived;
+  std::uint64_t videoBytes;
+  std::uint32_t resent;
+  int srttMs;
+};
+
+static double percentile(std::vector<double>& values, double p)
+{
+  if (values.empty()) {
+    return 0;
+  }
+
+  std::sort(values.begin(), values.end());
+  return values[static_cast<std::size_t>(p * (values.size() - 1))];
+}
+
+static void printLink(const char* name, const DatagramLink::Stats& stats)
+{
+  std::cout << std::left << std::setw(10) << name
+            << std::right << std::setw(12) << stats.received
+            << std::setw(12) << stats.delivered
+            << std::setw(10) << stats.lost
+            << std::setw(10) << stats.queueDrops
+            << std::setw(10) << stats.duplicated
+            << std::setw(10) << stats.reordered << std::endl;
+}
+
+static void usage(const char* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [options]" << std::endl
+            << "  --duration <s>      Simulated time (default " << BENCH_DURATION_DEFAULT_S << ")" << std::endl
+            << "  --video <kbit/s>    Video sent by the slave (default " << BENCH_VIDEO_DEFAULT << ")" << std::endl
+            << "  --up <spec>         Impairment towards the controller, as for netrelay" << std::endl
+            << "  --down <spec>       Impairment towards the slave" << std::endl
+            << "  --seed <n>          Seed of the link impairment (default 1)" << std::endl
+            << "  --real              Run in real time, for comparison" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  int duration = BENCH_DURATION_DEFAULT_S;
+  int videoKbps = BENCH_VIDEO_DEFAULT;
+  std::string up, down;
+  std::uint64_t seed = 1;
+  bool real = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--duration" && i + 1 < argc) {
+      duration = std::atoi(argv[++i]);
+    } else if (arg == "--video" && i + 1 < argc) {
+      videoKbps = std::atoi(argv[++i]);
+    } else if (arg == "--up" && i + 1 < argc) {
+      up = argv[++i];
+    } else if (arg == "--down" && i + 1 < argc) {
+      down = argv[++i];
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--real") {
+      real = true;
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  DatagramLink::Impairment upImpairment, downImpairment;
+  if (duration <= 0 || videoKbps < 0 ||
+      !DatagramLink::parseImpairment(up, upImpairment) ||
+      !DatagramLink::parseImpairment(down, downImpairment)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // The reassembly timeouts of a lossy link would flood the output
+  Log::setLevel(Log::Level::Error);
+  Log::init();
+
+  EventLoop eventLoop(real ? EventLoop::Time::Real : EventLoop::Time::Virtual);
+
+  // The addresses are not used, everything goes over the link
+  Transmitter slave(eventLoop, "127.0.0.1", 0);
+  Transmitter controller(eventLoop, "127.0.0.1", 0);
+  DatagramLink link(eventLoop, slave, controller, seed);
+  link.setImpairment(DatagramLink::Direction::AtoB, upImpairment);
+  link.setImpairment(DatagramLink::Direction::BtoA, downImpairment);
+
+  Result result = {};
+  std::vector<Clock::time_point> sent(65536);
+  bool loading = true;
+
+  slave.setValueCallback([&](std::uint8_t, std::uint16_t value) {
+    result.latencyMs.push_back(std::chrono::duration<double, std::milli>(eventLoop.now() - sent[value]).count());
+  });
+  controller.setVideoCallback([&](PooledBuffer video) {
+    result.framesReceived++;
+    result.videoBytes += video.size();
+  });
+  controller.setResentPacketsCallback([&](std::uint32_t counter) { result.resent = counter; });
+  controller.setRttCallback([&](int, int srttMs, int, int) { result.srttMs = srttMs; });
+
+  slave.initSocket();
+  controller.initSocket();
+  slave.enableAutoPing(true);
+  controller.enableAutoPing(true);
+
+  EventLoop::Strand strand = eventLoop.makeStrand();
+  EventLoop::StrandTimer videoTimer(strand);
+  EventLoop::StrandTimer probeTimer(strand);
+  EventLoop::StrandTimer stopTimer(strand);
+  std::vector<std::uint8_t> frame(static_cast<std::size_t>(videoKbps) * 1000 / 8 * BENCH_FRAME_MS / 1000, 0x55);
+
+  std::function<void(void)> sendFrame = [&]() {
+    if (!loading) {
+      return;
+    }
+    if (!frame.empty()) {
+      slave.sendVideo(frame.data(), frame.size());
+      result.frames++;
+    }
+    videoTimer.expires_at(videoTimer.expiry() + std::chrono::milliseconds(BENCH_FRAME_MS));
+    videoTimer.async_wait([&](const asio::error_code& error) { if (!error) sendFrame(); });
+  };
+
+  std::function<void(void)> sendProbe = [&]() {
+    if (!loading) {
+      return;
+    }
+    std::uint16_t probe = static_cast<std::uint16_t>(result.probes++);
+    sent[probe] = eventLoop.now();
+    controller.sendValue(MessageSubtype::SpeedTurn, probe);
+    probeTimer.expires_at(probeTimer.expiry() + std::chrono::milliseconds(BENCH_PROBE_MS));
+    probeTimer.async_wait([&](const asio::error_code& error) { if (!error) sendProbe(); });
+  };
+
+  asio::post(strand, [&]() {
+    videoTimer.expires_after(std::chrono::milliseconds(0));
+    probeTimer.expires_after(std::chrono::milliseconds(0));
+    sendFrame();
+    sendProbe();
+
+    stopTimer.expires_after(std::chrono::seconds(duration));
+    stopTimer.async_wait([&](const asio::error_code&) {
+      loading = false;
+      stopTimer.expires_after(std::chrono::milliseconds(BENCH_DRAIN_MS));
+      stopTimer.async_wait([&](const asio::error_code&) { eventLoop.stop(); });
+    });
+  });
+
+  WallClock::time_point start = WallClock::now();
+  eventLoop.run();
+  double wall = std::chrono::duration<double>(WallClock::now() - start).count();
+
+  // An unacknowledged value is replaced by a newer one of its type, so
+  // the missed ones were superseded rather than lost
+  std::size_t received = result.latencyMs.size();
+  std::cout << "simulated " << duration << " s in " << std::fixed << std::setprecision(2) << wall
+            << " s, " << std::setprecision(0) << duration / std::max(wall, 0.001) << "x real time" << std::endl;
+  std::cout << std::left << std::setw(10) << ""
+            << std::right << std::setw(12) << "received"
+            << std::setw(12) << "delivered"
+            << std::setw(10) << "lost"
+            << std::setw(10) << "q drops"
+            << std::setw(10) << "dups"
+            << std::setw(10) << "reorder" << std::endl;
+  printLink("up", link.getStats(DatagramLink::Direction::AtoB));
+  printLink("down", link.getStats(DatagramLink::Direction::BtoA));
+
+  std::cout << std::endl
+            << std::left << std::setw(10) << "values"
+            << std::right << std::setw(10) << "sent"
+            << std::setw(10) << "missed"
+            << std::setw(10) << "resent"
+            << std::setw(10) << "p50 ms"
+            << std::setw(10) << "p99 ms"
+            << std::setw(10) << "max ms"
+            << std::setw(10) << "srtt ms" << std::endl;
+  std::cout << std::left << std::setw(10) << ""
+            << std::right << std::setw(10) << result.probes
+            << std::setw(10) << result.probes - received
+            << std::setw(10) << result.resent
+            << std::setprecision(2)
+            << std::setw(10) << percentile(result.latencyMs, 0.5)
+            << std::setw(10) << percentile(result.latencyMs, 0.99)
+            << std::setw(10) << percentile(result.latencyMs, 1.0)
+            << std::setw(10) << result.srttMs << std::endl;
+
+  std::cout << std::endl
+            << "video " << result.framesReceived << "/" << result.frames << " frames, "
+            << std::setprecision(0) << result.videoBytes * 8.0 / 1000 / duration << " kbit/s" << std::endl;
+
+  return 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
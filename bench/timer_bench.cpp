@@ -0,0 +1,136 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Event.h"
+#include "Timer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Timer restarts per configuration, enough for a stable reading
+constexpr std::size_t BENCH_TOTAL_RESTARTS = 1024U * 1024U;
+constexpr int BENCH_TIMEOUT_MS             = 2000;
+
+using Clock = std::chrono::steady_clock;
+
+// The asio timer Timer was built on before the timer wheel
+class AsioTimers
+{
+ public:
+  AsioTimers(EventLoop& eventLoop, std::size_t count)
+  {
+    for (std::size_t i = 0; i < count; i++) {
+      timers.push_back(std::make_unique<asio::steady_timer>(eventLoop.context()));
+    }
+  }
+
+  void restart(std::size_t index)
+  {
+    asio::steady_timer& timer = *timers[index];
+    timer.cancel();
+    timer.expires_after(std::chrono::milliseconds(BENCH_TIMEOUT_MS));
+    timer.async_wait(std::bind(&AsioTimers::timeout, this, std::placeholders::_1));
+  }
+
+ private:
+  void timeout(const asio::error_code&) {}
+
+  std::vector<std::unique_ptr<asio::steady_timer>> timers;
+};
+
+// Timers in the timer wheel, restarted as e.g. a watchdog is
+class WheelTimers
+{
+ public:
+  WheelTimers(EventLoop& eventLoop, std::size_t count)
+  {
+    for (std::size_t i = 0; i < count; i++) {
+      timers.push_back(std::make_unique<Timer>(eventLoop));
+      timers.back()->start(BENCH_TIMEOUT_MS, []() {});
+    }
+  }
+
+  void restart(std::size_t index)
+  {
+    timers[index]->restart();
+  }
+
+ private:
+  std::vector<std::unique_ptr<Timer>> timers;
+};
+
+// Restart the timers round robin. Returns nanoseconds per restart.
+template <typename Timers>
+static double benchmark(EventLoop& eventLoop, std::size_t count)
+{
+  Timers timers(eventLoop, count);
+  for (std::size_t i = 0; i < count; i++) {
+    timers.restart(i);
+  }
+
+  std::size_t rounds = BENCH_TOTAL_RESTARTS / count;
+  double seconds = 0;
+
+  for (std::size_t round = 0; round < rounds; round++) {
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < count; i++) {
+      timers.restart((i * 7) % count);
+    }
+    seconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Run the cancelled handlers outside the measurement
+    eventLoop.context().poll();
+  }
+
+  return seconds * 1e9 / (rounds * count);
+}
+
+int main(int argc, char *argv[])
+{
+  // Timers running at the same time
+  std::vector<std::size_t> counts = {1, 16, 256, 4096, 65536};
+  if (argc > 1) {
+    counts.clear();
+    for (int i = 1; i < argc; i++) {
+      counts.push_back(std::strtoul(argv[i], nullptr, 0));
+    }
+  }
+
+  std::cout << std::left << std::setw(8) << "timer"
+            << std::right << std::setw(10) << "running"
+            << std::setw(16) << "ns/restart" << std::endl;
+
+  for (std::size_t count : counts) {
+    if (count == 0 || count % 7 == 0) {
+      continue; // The restart order needs a count not divisible by 7
+    }
+
+    EventLoop eventLoop;
+    double asioNs = benchmark<AsioTimers>(eventLoop, count);
+    double wheelNs = benchmark<WheelTimers>(eventLoop, count);
+
+    std::cout << std::left << std::setw(8) << "asio"
+              << std::right << std::setw(10) << count
+              << std::setw(16) << std::fixed << std::setprecision(1) << asioNs << std::endl;
+    std::cout << std::left << std::setw(8) << "wheel"
+              << std::right << std::setw(10) << count
+              << std::setw(16) << std::fixed << std::setprecision(1) << wheelNs << std::endl;
+  }
+
+  return 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "BatchSocket.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#define BATCH_SOCKET_MMSG 1
+#else
+#define BATCH_SOCKET_MMSG 0
+#endif
+
+// Kernel limits for one UDP_SEGMENT send
+constexpr std::size_t GSO_MAX_SEGMENTS = 64U;
+constexpr std::size_t GSO_MAX_BYTES    = 65000U;
+
+BatchSocket::BatchSocket(EventLoop::StrandSocket& socket) :
+  socket(socket),
+  gso(false),
+  prefix(nullptr),
+  prefixSize(0)
+{
+}
+
+bool BatchSocket::isSupported(void)
+{
+  return BATCH_SOCKET_MMSG;
+}
+
+void BatchSocket::setPrefix(const std::uint8_t* data, std::size_t size)
+{
+  prefix = data;
+  prefixSize = size;
+}
+
+bool BatchSocket::init(void)
+{
+#if BATCH_SOCKET_MMSG
+  // UDP_SEGMENT can be queried on kernels that support it (4.18+)
+  int value = 0;
+  socklen_t length = sizeof(value);
+  gso = getsockopt(socket.native_handle(), SOL_UDP, UDP_SEGMENT, &value, &length) == 0;
+
+  LOG_INFO(Net) << "Batched socket I/O enabled, GSO " << (gso ? "supported" : "not supported");
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::size_t BatchSocket::receive(PooledBuffer* buffers, asio::ip::udp::endpoint* senders,
+                                 std::size_t count, asio::error_code& ec)
+{
+  ec = asio::error_code();
+
+#if BATCH_SOCKET_MMSG
+  struct mmsghdr messages[BATCH_SOCKET_MAX_DATAGRAMS];
+  struct iovec iov[BATCH_SOCKET_MAX_DATAGRAMS];
+
+  count = std::min(count, BATCH_SOCKET_MAX_DATAGRAMS);
+  std::memset(messages, 0, sizeof(messages[0]) * count);
+
+  for (std::size_t i = 0; i < count; i++) {
+    buffers[i].resize(buffers[i].capacity());
+    iov[i].iov_base = buffers[i].data();
+    iov[i].iov_len = buffers[i].capacity();
+    messages[i].msg_hdr.msg_name = senders[i].data();
+    messages[i].msg_hdr.msg_namelen = senders[i].capacity();
+    messages[i].msg_hdr.msg_iov = &iov[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int received = recvmmsg(socket.native_handle(), messages, count, MSG_DONTWAIT, nullptr);
+
+  if (received < 0) {
+    ec = asio::error_code(errno, asio::error::get_system_category());
+    return 0;
+  }
+
+  for (int i = 0; i < received; i++) {
+    buffers[i].resize(messages[i].msg_len);
+    senders[i].resize(messages[i].msg_hdr.msg_namelen);
+  }
+
+  return received;
+#else
+  (void)buffers;
+  (void)senders;
+  (void)count;
+  ec = asio::error::operation_not_supported;
+  return 0;
+#endif
+}
+
+std::size_t BatchSocket::send(const PooledBuffer* buffers, std::size_t count,
+                              const asio::ip::udp::endpoint& endpoint, asio::error_code& ec)
+{
+  ec = asio::error_code();
+
+#if BATCH_SOCKET_MMSG
+  struct mmsghdr messages[BATCH_SOCKET_MAX_DATAGRAMS];
+  struct iovec iov[2 * BATCH_SOCKET_MAX_DATAGRAMS];
+  union {
+    char data[CMSG_SPACE(sizeof(std::uint16_t))];
+    struct cmsghdr align;
+  } control[BATCH_SOCKET_MAX_DATAGRAMS];
+  std::size_t datagrams[BATCH_SOCKET_MAX_DATAGRAMS];
+
+  count = std::min(count, BATCH_SOCKET_MAX_DATAGRAMS);
+
+  std::size_t index = 0;
+  std::size_t used = 0;
+  std::size_t parts = 0;
+  bool segmented = false;
+
+  while (index < count) {
+    // A run of equal sized datagrams, optionally ending with a shorter
+    // one, goes out as one GSO buffer that the kernel splits
+    std::size_t segment = buffers[index].size();
+    std::size_t run = 1;
+    std::size_t total = prefixSize + segment;
+
+    if (gso) {
+      while (index + run < count && run < GSO_MAX_SEGMENTS) {
+        std::size_t size = buffers[index + run].size();
+        if (size > segment || total + prefixSize + size > GSO_MAX_BYTES) {
+          break;
+        }
+        run++;
+        total += prefixSize + size;
+        if (size < segment) {
+          break;
+        }
+      }
+    }
+
+    // The prefix goes in front of each datagram, also within a GSO buffer
+    std::size_t first = parts;
+    for (std::size_t i = index; i < index + run; i++) {
+      if (prefixSize > 0) {
+        iov[parts].iov_base = const_cast<std::uint8_t*>(prefix);
+        iov[parts].iov_len = prefixSize;
+        parts++;
+      }
+      iov[parts].iov_base = const_cast<std::uint8_t*>(buffers[i].data());
+      iov[parts].iov_len = buffers[i].size();
+      parts++;
+    }
+
+    struct msghdr& header = messages[used].msg_hdr;
+    std::memset(&messages[used], 0, sizeof(messages[used]));
+    header.msg_name = const_cast<struct sockaddr*>(endpoint.data());
+    header.msg_namelen = endpoint.size();
+    header.msg_iov = &iov[first];
+    header.msg_iovlen = parts - first;
+
+    if (run > 1) {
+      header.msg_control = control[used].data;
+      header.msg_controllen = sizeof(control[used].data);
+
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+      std::uint16_t segmentSize = static_cast<std::uint16_t>(prefixSize + segment);
+      std::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+      segmented = true;
+    }
+
+    datagrams[used] = run;
+    used++;
+    index += run;
+  }
+
+  int sent = sendmmsg(socket.native_handle(), messages, used, MSG_DONTWAIT);
+
+  if (sent < 0) {
+    int error = errno;
+
+    // The device may not be able to segment even if the kernel can
+    if (segmented && (error == EIO || error == EINVAL)) {
+      LOG_WARN(Net) << "UDP GSO send failed (" << std::strerror(error) << "), disabling GSO";
+      gso = false;
+      return send(buffers, count, endpoint, ec);
+    }
+
+    ec = asio::error_code(error, asio::error::get_system_category());
+    return 0;
+  }
+
+  std::size_t packets = 0;
+  for (int i = 0; i < sent; i++) {
+    packets += datagrams[i];
+  }
+
+  return packets;
+#else
+  (void)buffers;
+  (void)count;
+  (void)endpoint;
+  ec = asio::error::operation_not_supported;
+  return 0;
+#endif
+}
+
+bool BatchSocket::queuedBytes(std::size_t& bytes) const
+{
+#if defined(__linux__)
+  int value = 0;
+  if (ioctl(socket.native_handle(), SIOCOUTQ, &value) < 0) {
+    return false;
+  }
+
+  bytes = static_cast<std::size_t>(value);
+  return true;
+#else
+  (void)bytes;
+  return false;
+#endif
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
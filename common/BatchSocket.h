@@ -0,0 +1,72 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "BufferPool.h"
+#include "Event.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <asio.hpp>
+
+// Most datagrams moved by one system call
+constexpr std::size_t BATCH_SOCKET_MAX_DATAGRAMS = 32U;
+
+// Sends and receives several datagrams per system call on a non-blocking
+// UDP socket. On Linux this uses recvmmsg() and sendmmsg(), and equal
+// sized datagrams to the same destination are sent as one UDP_SEGMENT
+// (GSO) buffer when the kernel supports it. Elsewhere it isn't supported
+// and the caller should use the asio socket operations.
+class BatchSocket
+{
+ public:
+  explicit BatchSocket(EventLoop::StrandSocket& socket);
+
+  // True if batched I/O is available on this platform
+  static bool isSupported(void);
+
+  // Check the kernel features, call after the socket is opened
+  bool init(void);
+
+  // True if UDP_SEGMENT is used for equal sized datagrams
+  bool gsoEnabled(void) const { return gso; }
+
+  // Bytes sent in front of every datagram, e.g. a relay header. The data
+  // is not copied and must stay valid.
+  void setPrefix(const std::uint8_t* data, std::size_t size);
+
+  // Receive up to count datagrams into buffers without blocking. Each
+  // buffer is resized to the received length and the sender is stored in
+  // senders. Returns the number of datagrams received, 0 with
+  // would_block if nothing was ready.
+  std::size_t receive(PooledBuffer* buffers, asio::ip::udp::endpoint* senders,
+                      std::size_t count, asio::error_code& ec);
+
+  // Send up to count datagrams to the endpoint without blocking. Returns
+  // the number of datagrams sent, 0 with would_block if the socket buffer
+  // is full.
+  std::size_t send(const PooledBuffer* buffers, std::size_t count,
+                   const asio::ip::udp::endpoint& endpoint, asio::error_code& ec);
+
+  // Bytes sent on the socket but not yet transmitted by the kernel
+  // (SIOCOUTQ), including datagrams waiting in the qdisc and the driver.
+  // Returns false if not known on this platform.
+  bool queuedBytes(std::size_t& bytes) const;
+
+ private:
+  EventLoop::StrandSocket& socket;
+  bool gso;
+  const std::uint8_t* prefix;
+  std::size_t prefixSize;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
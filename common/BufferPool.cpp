@@ -0,0 +1,168 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "BufferPool.h"
+
+#include <functional>
+#include <utility>
+
+PooledBuffer::PooledBuffer() :
+  pool(),
+  storage(nullptr),
+  bufferCapacity(0),
+  offset(0),
+  length(0)
+{
+}
+
+PooledBuffer::PooledBuffer(std::shared_ptr<BufferPool> pool, std::uint8_t* storage,
+                           std::size_t capacity, std::size_t size) :
+  pool(std::move(pool)),
+  storage(storage),
+  bufferCapacity(capacity),
+  offset(0),
+  length(size)
+{
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept :
+  pool(std::move(other.pool)),
+  storage(std::exchange(other.storage, nullptr)),
+  bufferCapacity(std::exchange(other.bufferCapacity, 0)),
+  offset(std::exchange(other.offset, 0)),
+  length(std::exchange(other.length, 0))
+{
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+  if (this != &other) {
+    release();
+    pool = std::move(other.pool);
+    storage = std::exchange(other.storage, nullptr);
+    bufferCapacity = std::exchange(other.bufferCapacity, 0);
+    offset = std::exchange(other.offset, 0);
+    length = std::exchange(other.length, 0);
+  }
+  return *this;
+}
+
+PooledBuffer::~PooledBuffer()
+{
+  release();
+}
+
+bool PooledBuffer::resize(std::size_t size)
+{
+  if (size > capacity()) {
+    return false;
+  }
+
+  length = size;
+  return true;
+}
+
+void PooledBuffer::trimFront(std::size_t count)
+{
+  if (count > length) {
+    count = length;
+  }
+
+  offset += count;
+  length -= count;
+}
+
+void PooledBuffer::release(void)
+{
+  if (storage && pool) {
+    pool->release(storage);
+  }
+
+  pool.reset();
+  storage = nullptr;
+  bufferCapacity = 0;
+  offset = 0;
+  length = 0;
+}
+
+BufferPool::BufferPool(std::size_t bufferCount, std::size_t bufferSize) :
+  slotSize(bufferSize),
+  arena(bufferCount * bufferSize),
+  freeList(),
+  hits(0),
+  misses(0)
+{
+  freeList.reserve(bufferCount);
+  for (std::size_t i = 0; i < bufferCount; i++) {
+    freeList.push_back(arena.data() + i * slotSize);
+  }
+}
+
+PooledBuffer BufferPool::acquire(std::size_t size)
+{
+  std::uint8_t* storage = nullptr;
+  std::size_t capacity = slotSize;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size <= slotSize && !freeList.empty()) {
+      storage = freeList.back();
+      freeList.pop_back();
+      hits++;
+    } else {
+      misses++;
+    }
+  }
+
+  // Pool exhausted or buffer too big, use the heap
+  if (!storage) {
+    if (size > capacity) {
+      capacity = size;
+    }
+    storage = new std::uint8_t[capacity];
+  }
+
+  return PooledBuffer(shared_from_this(), storage, capacity, size);
+}
+
+std::size_t BufferPool::available(void)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return freeList.size();
+}
+
+std::uint32_t BufferPool::getHits(void)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return hits;
+}
+
+std::uint32_t BufferPool::getMisses(void)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return misses;
+}
+
+void BufferPool::release(std::uint8_t* storage)
+{
+  // Buffers outside the arena were allocated on a miss. std::less gives a
+  // total order also on pointers into different allocations.
+  if (std::less<const std::uint8_t*>()(storage, arena.data()) ||
+      !std::less<const std::uint8_t*>()(storage, arena.data() + arena.size())) {
+    delete[] storage;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  freeList.push_back(storage);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class BufferPool;
+
+// Move-only handle to a buffer from a BufferPool. The buffer goes back to
+// the pool when the handle is destroyed or released. The handle keeps the
+// pool alive, so it may outlive the owner of the pool (e.g. in a pending
+// asio handler).
+class PooledBuffer {
+ public:
+  PooledBuffer();
+  PooledBuffer(PooledBuffer&& other) noexcept;
+  PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+  PooledBuffer(const PooledBuffer&) = delete;
+  PooledBuffer& operator=(const PooledBuffer&) = delete;
+  ~PooledBuffer();
+
+  std::uint8_t* data(void) { return storage ? storage + offset : nullptr; }
+  const std::uint8_t* data(void) const { return storage ? storage + offset : nullptr; }
+  std::size_t size(void) const { return length; }
+  std::size_t capacity(void) const { return storage ? bufferCapacity - offset : 0; }
+  explicit operator bool() const { return storage != nullptr; }
+
+  // Set the used size, must fit in the capacity
+  bool resize(std::size_t size);
+
+  // Drop bytes from the front without copying, e.g. a message header
+  void trimFront(std::size_t count);
+
+  // Return the buffer to the pool now
+  void release(void);
+
+ private:
+  friend class BufferPool;
+  PooledBuffer(std::shared_ptr<BufferPool> pool, std::uint8_t* storage,
+               std::size_t capacity, std::size_t size);
+
+  std::shared_ptr<BufferPool> pool;
+  std::uint8_t* storage;
+  std::size_t bufferCapacity;
+  std::size_t offset;
+  std::size_t length;
+};
+
+// Fixed number of equally sized buffers allocated once up front. When all
+// buffers are in use, or a larger buffer is requested, acquire() falls back
+// to the heap and counts a miss. Acquire and release are thread safe.
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+ public:
+  BufferPool(std::size_t bufferCount, std::size_t bufferSize);
+
+  // Buffer with at least size bytes, size() is set to size
+  PooledBuffer acquire(std::size_t size);
+
+  std::size_t bufferSize(void) const { return slotSize; }
+  std::size_t available(void);
+  std::uint32_t getHits(void);
+  std::uint32_t getMisses(void);
+
+ private:
+  friend class PooledBuffer;
+  void release(std::uint8_t* storage);
+
+  std::size_t slotSize;
+  std::vector<std::uint8_t> arena;
+  std::vector<std::uint8_t*> freeList;
+  std::mutex mutex;
+  std::uint32_t hits;
+  std::uint32_t misses;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Capture.h"
+#include "Log.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char CAPTURE_MAGIC[8] = { 'P', 'L', 'E', 'C', 'O', 'C', 'A', 'P' };
+
+CaptureWriter::CaptureWriter() :
+  path(),
+  fd(-1),
+  map(nullptr),
+  mapSize(0),
+  used(0),
+  records(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+  close();
+}
+
+bool CaptureWriter::open(const std::string& path, Crc::Mode crcMode)
+{
+  close();
+
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    LOG_ERROR(Net) << "Failed to open capture file " << path << ": " << strerror(errno);
+    return false;
+  }
+
+  this->path = path;
+  used = 0;
+  records = 0;
+
+  if (!grow(CAPTURE_HEADER_LEN)) {
+    close();
+    return false;
+  }
+
+  std::uint8_t* header = map;
+  std::memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+  std::memcpy(header + 8, &CAPTURE_VERSION, sizeof(CAPTURE_VERSION));
+  header[10] = static_cast<std::uint8_t>(crcMode);
+  used = CAPTURE_HEADER_LEN;
+
+  LOG_INFO(Net) << "Capturing datagrams to " << path;
+  return true;
+}
+
+void CaptureWriter::close(void)
+{
+  if (map) {
+    munmap(map, mapSize);
+    map = nullptr;
+  }
+
+  if (fd >= 0) {
+    // Drop the unused tail of the last step
+    if (ftruncate(fd, static_cast<off_t>(used)) < 0) {
+      LOG_WARN(Net) << "Failed to truncate capture file " << path << ": " << strerror(errno);
+    }
+    ::close(fd);
+    fd = -1;
+    LOG_INFO(Net) << "Captured " << records << " datagrams to " << path;
+  }
+
+  mapSize = 0;
+}
+
+bool CaptureWriter::isOpen(void) const
+{
+  return map != nullptr;
+}
+
+std::uint64_t CaptureWriter::getRecords(void) const
+{
+  return records;
+}
+
+bool CaptureWriter::grow(std::size_t needed)
+{
+  std::size_t size = mapSize;
+  while (size < used + needed) {
+    size += CAPTURE_GROW_BYTES;
+  }
+
+  if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+    LOG_ERROR(Net) << "Failed to grow capture file " << path << ": " << strerror(errno);
+    return false;
+  }
+
+  if (map) {
+    munmap(map, mapSize);
+    map = nullptr;
+  }
+
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    LOG_ERROR(Net) << "Failed to map capture file " << path << ": " << strerror(errno);
+    mapSize = 0;
+    return false;
+  }
+
+  map = static_cast<std::uint8_t*>(address);
+  mapSize = size;
+  return true;
+}
+
+void CaptureWriter::append(CaptureDirection direction, const std::uint8_t* data, std::size_t size,
+                           std::chrono::steady_clock::time_point now)
+{
+  if (!map || size > UINT16_MAX) {
+    return;
+  }
+
+  if (used + CAPTURE_RECORD_LEN + size > mapSize && !grow(CAPTURE_RECORD_LEN + size)) {
+    close();
+    return;
+  }
+
+  std::uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    now.time_since_epoch()).count();
+  std::uint16_t length = static_cast<std::uint16_t>(size);
+
+  std::uint8_t* record = map + used;
+  std::memcpy(record, &timestamp, sizeof(timestamp));
+  std::memcpy(record + 8, &length, sizeof(length));
+  record[10] = static_cast<std::uint8_t>(direction);
+  record[11] = 0;
+  std::memcpy(record + CAPTURE_RECORD_LEN, data, size);
+
+  used += CAPTURE_RECORD_LEN + size;
+  records++;
+}
+
+CaptureReader::CaptureReader() :
+  fd(-1),
+  map(nullptr),
+  mapSize(0),
+  offset(0),
+  crcMode(Crc::Mode::Crc16)
+{
+}
+
+CaptureReader::~CaptureReader()
+{
+  close();
+}
+
+bool CaptureReader::open(const std::string& path)
+{
+  close();
+
+  fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR(Main) << "Failed to open capture file " << path << ": " << strerror(errno);
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < CAPTURE_HEADER_LEN) {
+    LOG_ERROR(Main) << "Not a capture file: " << path;
+    close();
+    return false;
+  }
+
+  void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (address == MAP_FAILED) {
+    LOG_ERROR(Main) << "Failed to map capture file " << path << ": " << strerror(errno);
+    close();
+    return false;
+  }
+  map = static_cast<const std::uint8_t*>(address);
+  mapSize = info.st_size;
+
+  std::uint16_t version;
+  std::memcpy(&version, map + 8, sizeof(version));
+  if (std::memcmp(map, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 || version != CAPTURE_VERSION) {
+    LOG_ERROR(Main) << "Not a capture file or unsupported version: " << path;
+    close();
+    return false;
+  }
+
+  crcMode = static_cast<Crc::Mode>(map[10]);
+  offset = CAPTURE_HEADER_LEN;
+
+  // Sequential reading, let the kernel read ahead
+  madvise(const_cast<std::uint8_t*>(map), mapSize, MADV_SEQUENTIAL);
+  return true;
+}
+
+void CaptureReader::close(void)
+{
+  if (map) {
+    munmap(const_cast<std::uint8_t*>(map), mapSize);
+    map = nullptr;
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  mapSize = 0;
+  offset = 0;
+}
+
+Crc::Mode CaptureReader::getCrcMode(void) const
+{
+  return crcMode;
+}
+
+bool CaptureReader::next(Record& record)
+{
+  if (!map || offset + CAPTURE_RECORD_LEN > mapSize) {
+    return false;
+  }
+
+  const std::uint8_t* header = map + offset;
+  std::uint64_t timestamp;
+  std::uint16_t length;
+  std::memcpy(&timestamp, header, sizeof(timestamp));
+  std::memcpy(&length, header + 8, sizeof(length));
+
+  // The zero filled tail of a capture that wasn't closed
+  if (timestamp == 0 && length == 0 && header[10] == 0) {
+    return false;
+  }
+
+  if (offset + CAPTURE_RECORD_LEN + length > mapSize) {
+    LOG_WARN(Main) << "Truncated capture record at offset " << offset;
+    return false;
+  }
+
+  record.timestamp = std::chrono::nanoseconds(timestamp);
+  record.direction = static_cast<CaptureDirection>(header[10]);
+  record.data = header + CAPTURE_RECORD_LEN;
+  record.size = length;
+
+  offset += CAPTURE_RECORD_LEN + length;
+  return true;
+}
+
+void CaptureReader::rewind(void)
+{
+  offset = map ? CAPTURE_HEADER_LEN : 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
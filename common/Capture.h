@@ -0,0 +1,103 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Crc.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Capture file layout, in host byte order:
+//   header:  "PLECOCAP", u16 version, u8 checksum mode, u8 reserved, u32 reserved
+//   records: u64 timestamp (ns, EventLoop clock), u16 length, u8 direction,
+//            u8 reserved, length bytes of the datagram
+// A record header of zeros ends the file, as does the end of the file.
+constexpr std::size_t CAPTURE_HEADER_LEN   = 16;
+constexpr std::size_t CAPTURE_RECORD_LEN   = 12;
+constexpr std::uint16_t CAPTURE_VERSION    = 1;
+constexpr std::size_t CAPTURE_GROW_BYTES   = 4U * 1024U * 1024U;
+
+enum class CaptureDirection : std::uint8_t {
+  Sent = 1,
+  Received = 2,
+};
+
+// Appends datagrams to a memory mapped capture file. The file grows in
+// CAPTURE_GROW_BYTES steps and is truncated to the captured data when
+// closed; after a crash the zero filled tail ends the capture. Not
+// thread safe, the transmitter uses it on its strand only.
+class CaptureWriter
+{
+ public:
+  CaptureWriter();
+  ~CaptureWriter();
+
+  bool open(const std::string& path, Crc::Mode crcMode);
+  void close(void);
+  bool isOpen(void) const;
+
+  // Append one datagram received or sent at now, the time of the
+  // EventLoop so that a capture in virtual time replays at its pace.
+  // Closes the capture if the file can't grow.
+  void append(CaptureDirection direction, const std::uint8_t* data, std::size_t size,
+              std::chrono::steady_clock::time_point now);
+
+  std::uint64_t getRecords(void) const;
+
+ private:
+  bool grow(std::size_t needed);
+
+  std::string path;
+  int fd;
+  std::uint8_t* map;
+  std::size_t mapSize;
+  std::size_t used;
+  std::uint64_t records;
+};
+
+// Reads a capture file written by CaptureWriter
+class CaptureReader
+{
+ public:
+  struct Record {
+    std::chrono::nanoseconds timestamp;
+    CaptureDirection direction;
+    const std::uint8_t* data;
+    std::size_t size;
+  };
+
+  CaptureReader();
+  ~CaptureReader();
+
+  bool open(const std::string& path);
+  void close(void);
+
+  // Checksum mode of the captured connection
+  Crc::Mode getCrcMode(void) const;
+
+  // The next record, false at the end. The data stays valid until closed.
+  bool next(Record& record);
+
+  // Back to the first record
+  void rewind(void);
+
+ private:
+  int fd;
+  const std::uint8_t* map;
+  std::size_t mapSize;
+  std::size_t offset;
+  Crc::Mode crcMode;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
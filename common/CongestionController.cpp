@@ -0,0 +1,130 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "CongestionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+CongestionController::CongestionController() :
+  videoMax(CC_RATE_MAX_BPS),
+  audioEnabled(false),
+  updated(false),
+  rate(CC_RATE_MAX_BPS),
+  lastUpdate(),
+  lastDecrease()
+{
+}
+
+void CongestionController::setVideoMax(int bitsPerSecond)
+{
+  videoMax = std::max(bitsPerSecond, CC_VIDEO_MIN_BPS);
+
+  // Start from the operator's choice until the reports say otherwise
+  if (!updated) {
+    rate = videoMax + getTelemetryRate() + getAudioRate();
+  }
+}
+
+void CongestionController::setAudioEnabled(bool enable)
+{
+  audioEnabled = enable;
+}
+
+void CongestionController::reset(void)
+{
+  updated = false;
+  rate = videoMax + getTelemetryRate() + getAudioRate();
+}
+
+CongestionController::Signal CongestionController::detect(const ReceiverReport& report) const
+{
+  if (report.queueDelayUs > static_cast<std::uint32_t>(CC_HIGH_DELAY_US)) {
+    return Signal::Overuse;
+  }
+
+  if (report.delayTrendUs > CC_OVERUSE_TREND_US &&
+      report.queueDelayUs > static_cast<std::uint32_t>(CC_OVERUSE_DELAY_US)) {
+    return Signal::Overuse;
+  }
+
+  // The queue is draining, wait for it before increasing
+  if (report.delayTrendUs < -CC_OVERUSE_TREND_US) {
+    return Signal::Underuse;
+  }
+
+  return Signal::Normal;
+}
+
+void CongestionController::decrease(double newRate, Clock::time_point now)
+{
+  if (now - lastDecrease < std::chrono::milliseconds(CC_DECREASE_HOLD_MS)) {
+    return;
+  }
+
+  rate = std::min(rate, newRate);
+  lastDecrease = now;
+}
+
+void CongestionController::update(const ReceiverReport& report, Clock::time_point now)
+{
+  double seconds = updated ? std::chrono::duration<double>(now - lastUpdate).count() : 0;
+  seconds = std::min(seconds, 1.0);
+  updated = true;
+  lastUpdate = now;
+
+  // The report covers video only, the other streams are as allocated
+  double received = report.rateBps + getTelemetryRate() + getAudioRate();
+
+  switch (detect(report)) {
+    case Signal::Overuse:
+      decrease(CC_DECREASE * received, now);
+      break;
+    case Signal::Underuse:
+      break;
+    case Signal::Normal:
+      if (report.fractionLost > CC_LOSS_HIGH) {
+        decrease(rate * (1.0 - 0.5 * report.fractionLost / 256.0), now);
+      } else if (report.fractionLost < CC_LOSS_LOW) {
+        // Don't run ahead of what the encoder actually sends
+        double increased = rate * std::pow(CC_INCREASE, seconds);
+        rate = std::max(rate, std::min(increased, CC_HEADROOM * received));
+      }
+      break;
+  }
+
+  // No use going above what all the streams together can send
+  int max = std::min(CC_RATE_MAX_BPS, videoMax + getTelemetryRate() + getAudioRate());
+  rate = std::clamp(rate, static_cast<double>(CC_RATE_MIN_BPS), static_cast<double>(std::max(max, CC_RATE_MIN_BPS)));
+}
+
+int CongestionController::getRate(void) const
+{
+  return static_cast<int>(rate);
+}
+
+int CongestionController::getVideoRate(void) const
+{
+  int video = getRate() - getTelemetryRate() - getAudioRate();
+  return std::clamp(video, CC_VIDEO_MIN_BPS, videoMax);
+}
+
+int CongestionController::getAudioRate(void) const
+{
+  return audioEnabled ? CC_AUDIO_BPS : 0;
+}
+
+int CongestionController::getTelemetryRate(void) const
+{
+  return CC_TELEMETRY_BPS;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "ReceiverReport.h"
+
+#include <chrono>
+#include <cstdint>
+
+// Limits of the total send rate
+constexpr int CC_RATE_MIN_BPS      = 200000;
+constexpr int CC_RATE_MAX_BPS      = 20000000;
+
+// Rate kept for the streams that are not adapted. Audio is Opus at its
+// default 64 kbit/s plus the RTP and UDP headers.
+constexpr int CC_TELEMETRY_BPS     = 32000;
+constexpr int CC_AUDIO_BPS         = 80000;
+constexpr int CC_VIDEO_MIN_BPS     = 128000;
+
+// Delay based overuse detection: the queue grows, or is simply too long
+constexpr int CC_OVERUSE_TREND_US  = 5000;    // Per second
+constexpr int CC_OVERUSE_DELAY_US  = 20000;   // Needed for the trend to count
+constexpr int CC_HIGH_DELAY_US     = 150000;
+
+// Loss based control as in GCC, fractions in 1/256
+constexpr int CC_LOSS_HIGH         = 26;      // 10%
+constexpr int CC_LOSS_LOW          = 5;       // 2%
+
+// Rate changes
+constexpr double CC_DECREASE       = 0.85;    // Of the received rate on overuse
+constexpr double CC_INCREASE       = 1.08;    // Per second while not congested
+constexpr double CC_HEADROOM       = 1.5;     // Most the rate may exceed the received rate
+constexpr int CC_DECREASE_HOLD_MS  = 300;     // Let a decrease take effect before the next
+
+// Delay based congestion control driven by the receiver reports, in the
+// spirit of Google Congestion Control. The rate backs off when the
+// one-way delay grows or there's heavy loss, and grows slowly otherwise.
+// The rate is split between telemetry, audio and video; video gets what
+// is left, up to the bitrate chosen by the operator.
+class CongestionController
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  CongestionController();
+
+  // Highest video bitrate, the one selected by the operator
+  void setVideoMax(int bitsPerSecond);
+
+  // Audio is given its share only when it's sent
+  void setAudioEnabled(bool enable);
+
+  // Update the rate from a receiver report
+  void update(const ReceiverReport& report, Clock::time_point now);
+
+  // Start over, e.g. after the connection was lost
+  void reset(void);
+
+  // Total rate and its split, bits per second
+  int getRate(void) const;
+  int getVideoRate(void) const;
+  int getAudioRate(void) const;
+  int getTelemetryRate(void) const;
+
+ private:
+  enum class Signal {
+    Normal,
+    Overuse,
+    Underuse,
+  };
+
+  Signal detect(const ReceiverReport& report) const;
+  void decrease(double rate, Clock::time_point now);
+
+  int videoMax;
+  bool audioEnabled;
+  bool updated;                   // Reports received since the start or reset
+  double rate;
+  Clock::time_point lastUpdate;
+  Clock::time_point lastDecrease;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
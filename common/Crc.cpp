@@ -0,0 +1,302 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Crc.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC_HW_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CRC_HW_ARM64 1
+#endif
+
+namespace {
+
+constexpr std::uint16_t CRC16_POLY  = 0x1021;       // CCITT, MSB first
+constexpr std::uint32_t CRC32C_POLY = 0x82F63B78;   // Castagnoli, reflected
+
+using Crc16Tables = std::array<std::array<std::uint16_t, 256>, 8>;
+using Crc32Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+// Table k gives the CRC contribution of a byte followed by k zero bytes,
+// which lets the slicing loop process 8 input bytes per iteration.
+constexpr Crc16Tables makeCrc16Tables()
+{
+  Crc16Tables t{};
+  for (std::uint32_t i = 0; i < 256; i++) {
+    std::uint16_t crc = static_cast<std::uint16_t>(i << 8);
+    for (int j = 0; j < 8; j++) {
+      crc = (crc & 0x8000) ? static_cast<std::uint16_t>((crc << 1) ^ CRC16_POLY)
+                           : static_cast<std::uint16_t>(crc << 1);
+    }
+    t[0][i] = crc;
+  }
+  for (std::size_t k = 1; k < 8; k++) {
+    for (std::size_t i = 0; i < 256; i++) {
+      std::uint16_t prev = t[k - 1][i];
+      t[k][i] = static_cast<std::uint16_t>((prev << 8) ^ t[0][prev >> 8]);
+    }
+  }
+  return t;
+}
+
+constexpr Crc32Tables makeCrc32cTables()
+{
+  Crc32Tables t{};
+  for (std::uint32_t i = 0; i < 256; i++) {
+    std::uint32_t crc = i;
+    for (int j = 0; j < 8; j++) {
+      crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : (crc >> 1);
+    }
+    t[0][i] = crc;
+  }
+  for (std::size_t k = 1; k < 8; k++) {
+    for (std::size_t i = 0; i < 256; i++) {
+      std::uint32_t prev = t[k - 1][i];
+      t[k][i] = (prev >> 8) ^ t[0][prev & 0xff];
+    }
+  }
+  return t;
+}
+
+constexpr Crc16Tables crc16Tables = makeCrc16Tables();
+constexpr Crc32Tables crc32cTables = makeCrc32cTables();
+
+#if CRC_HW_X86
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cSse42(std::uint32_t crc, const std::uint8_t* data, std::size_t length)
+{
+  std::uint32_t c = ~crc;
+
+#if defined(__x86_64__)
+  std::uint64_t c64 = c;
+  while (length >= 8) {
+    std::uint64_t v;
+    std::memcpy(&v, data, sizeof(v));
+    c64 = _mm_crc32_u64(c64, v);
+    data += 8;
+    length -= 8;
+  }
+  c = static_cast<std::uint32_t>(c64);
+#endif
+
+  while (length >= 4) {
+    std::uint32_t v;
+    std::memcpy(&v, data, sizeof(v));
+    c = _mm_crc32_u32(c, v);
+    data += 4;
+    length -= 4;
+  }
+
+  while (length--) {
+    c = _mm_crc32_u8(c, *data++);
+  }
+
+  return ~c;
+}
+#endif
+
+#if CRC_HW_ARM64
+std::uint32_t crc32cArm64(std::uint32_t crc, const std::uint8_t* data, std::size_t length)
+{
+  std::uint32_t c = ~crc;
+
+  while (length >= 8) {
+    std::uint64_t v;
+    std::memcpy(&v, data, sizeof(v));
+    c = __crc32cd(c, v);
+    data += 8;
+    length -= 8;
+  }
+
+  while (length--) {
+    c = __crc32cb(c, *data++);
+  }
+
+  return ~c;
+}
+#endif
+
+using Crc32cFunc = std::uint32_t (*)(std::uint32_t, const std::uint8_t*, std::size_t);
+
+// Pick the CRC32C implementation once, based on the CPU we run on
+Crc32cFunc selectCrc32c(void)
+{
+#if CRC_HW_X86
+  if (__builtin_cpu_supports("sse4.2")) {
+    return &crc32cSse42;
+  }
+#elif CRC_HW_ARM64
+  if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+    return &crc32cArm64;
+  }
+#endif
+  return &Crc::crc32cSoftware;
+}
+
+const Crc32cFunc crc32cImpl = selectCrc32c();
+
+std::uint16_t fold32(std::uint32_t crc)
+{
+  return static_cast<std::uint16_t>((crc >> 16) ^ (crc & 0xffff));
+}
+
+} // namespace
+
+std::uint16_t Crc::crc16Bitwise(std::uint16_t crc, const std::uint8_t* data, std::size_t length)
+{
+  for (std::size_t i = 0; i < length; i++) {
+    crc ^= (std::uint16_t)data[i] << 8;
+    for (int j = 0; j < 8; j++) {
+      if (crc & 0x8000) {
+        crc = (crc << 1) ^ CRC16_POLY;
+      } else {
+        crc <<= 1;
+      }
+    }
+  }
+  return crc;
+}
+
+std::uint16_t Crc::crc16(std::uint16_t crc, const std::uint8_t* data, std::size_t length)
+{
+  const auto& t = crc16Tables;
+
+  while (length >= 8) {
+    std::uint16_t a = crc ^ static_cast<std::uint16_t>((data[0] << 8) | data[1]);
+    crc = t[7][a >> 8] ^ t[6][a & 0xff] ^
+          t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]] ^
+          t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += 8;
+    length -= 8;
+  }
+
+  while (length--) {
+    crc = static_cast<std::uint16_t>((crc << 8) ^ t[0][(crc >> 8) ^ *data++]);
+  }
+
+  return crc;
+}
+
+std::uint32_t Crc::crc32cSoftware(std::uint32_t crc, const std::uint8_t* data, std::size_t length)
+{
+  const auto& t = crc32cTables;
+  std::uint32_t c = ~crc;
+
+  while (length >= 8) {
+    std::uint32_t one = c ^ (static_cast<std::uint32_t>(data[0]) |
+                             static_cast<std::uint32_t>(data[1]) << 8 |
+                             static_cast<std::uint32_t>(data[2]) << 16 |
+                             static_cast<std::uint32_t>(data[3]) << 24);
+    c = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^
+        t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+        t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += 8;
+    length -= 8;
+  }
+
+  while (length--) {
+    c = (c >> 8) ^ t[0][(c ^ *data++) & 0xff];
+  }
+
+  return ~c;
+}
+
+std::uint32_t Crc::crc32c(std::uint32_t crc, const std::uint8_t* data, std::size_t length)
+{
+  return crc32cImpl(crc, data, length);
+}
+
+bool Crc::crc32cHardware(void)
+{
+  return crc32cImpl != &Crc::crc32cSoftware;
+}
+
+std::uint16_t Crc::checksum(Mode mode, const std::uint8_t* data, std::size_t length)
+{
+  switch (mode) {
+  case Mode::Crc16Bitwise:
+    return crc16Bitwise(0xFFFF, data, length);
+  case Mode::Crc32C:
+    return fold32(crc32c(0, data, length));
+  case Mode::Crc16:
+  default:
+    return crc16(0xFFFF, data, length);
+  }
+}
+
+std::uint16_t Crc::checksumSkip(Mode mode, const std::uint8_t* data, std::size_t length,
+                                std::size_t skipOffset)
+{
+  static const std::uint8_t zero[2] = {0, 0};
+
+  if (skipOffset + sizeof(zero) > length) {
+    return checksum(mode, data, length);
+  }
+
+  const std::uint8_t* tail = data + skipOffset + sizeof(zero);
+  std::size_t tailLength = length - skipOffset - sizeof(zero);
+
+  switch (mode) {
+  case Mode::Crc16Bitwise: {
+    std::uint16_t crc = crc16Bitwise(0xFFFF, data, skipOffset);
+    crc = crc16Bitwise(crc, zero, sizeof(zero));
+    return crc16Bitwise(crc, tail, tailLength);
+  }
+  case Mode::Crc32C: {
+    std::uint32_t crc = crc32c(0, data, skipOffset);
+    crc = crc32c(crc, zero, sizeof(zero));
+    return fold32(crc32c(crc, tail, tailLength));
+  }
+  case Mode::Crc16:
+  default: {
+    std::uint16_t crc = crc16(0xFFFF, data, skipOffset);
+    crc = crc16(crc, zero, sizeof(zero));
+    return crc16(crc, tail, tailLength);
+  }
+  }
+}
+
+std::string Crc::getModeStr(Mode mode)
+{
+  switch (mode) {
+  case Mode::Crc16Bitwise:
+    return "crc16-bitwise";
+  case Mode::Crc16:
+    return "crc16";
+  case Mode::Crc32C:
+    return crc32cHardware() ? "crc32c-hw" : "crc32c-sw";
+  default:
+    return "UNKNOWN";
+  }
+}
+
+bool Crc::parseMode(const std::string& str, Mode& mode)
+{
+  if (str == "crc16-bitwise") {
+    mode = Mode::Crc16Bitwise;
+  } else if (str == "crc16") {
+    mode = Mode::Crc16;
+  } else if (str == "crc32c") {
+    mode = Mode::Crc32C;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
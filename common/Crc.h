@@ -0,0 +1,50 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace Crc {
+
+  // Checksum used for the 16 bit CRC field of a message. Both ends of a
+  // connection must use the same mode.
+  enum class Mode : std::uint8_t {
+    Crc16Bitwise = 0,   // CRC-16/CCITT, one bit at a time (reference)
+    Crc16,              // CRC-16/CCITT, slicing-by-8 tables (default)
+    Crc32C,             // CRC32C folded to 16 bits, SSE4.2/ARMv8 if available
+  };
+
+  // Incremental primitives. Pass the previous return value as crc to
+  // continue a checksum over several buffers.
+  std::uint16_t crc16Bitwise(std::uint16_t crc, const std::uint8_t* data, std::size_t length);
+  std::uint16_t crc16(std::uint16_t crc, const std::uint8_t* data, std::size_t length);
+  std::uint32_t crc32cSoftware(std::uint32_t crc, const std::uint8_t* data, std::size_t length);
+  std::uint32_t crc32c(std::uint32_t crc, const std::uint8_t* data, std::size_t length);
+
+  // True if crc32c() uses CPU CRC instructions on this machine
+  bool crc32cHardware(void);
+
+  // 16 bit checksum of a whole buffer in the given mode
+  std::uint16_t checksum(Mode mode, const std::uint8_t* data, std::size_t length);
+
+  // 16 bit checksum of a buffer as if the 16 bit field at skipOffset
+  // was zero. Used to verify received messages without modifying them.
+  std::uint16_t checksumSkip(Mode mode, const std::uint8_t* data, std::size_t length,
+                             std::size_t skipOffset);
+
+  std::string getModeStr(Mode mode);
+  bool parseMode(const std::string& str, Mode& mode);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
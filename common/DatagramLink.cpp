@@ -0,0 +1,200 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "DatagramLink.h"
+#include "Transmitter.h"
+
+#include <algorithm>
+
+DatagramLink::DatagramLink(EventLoop& eventLoop, Transmitter& a, Transmitter& b, std::uint64_t seed) :
+  aToB(eventLoop, b, seed * 2),
+  bToA(eventLoop, a, seed * 2 + 1)
+{
+  a.setDatagramSender([this](const std::uint8_t* data, std::size_t size) {
+    aToB.submit(data, size);
+  });
+  b.setDatagramSender([this](const std::uint8_t* data, std::size_t size) {
+    bToA.submit(data, size);
+  });
+}
+
+bool DatagramLink::parseImpairment(const std::string& spec, Impairment& impairment)
+{
+  return impair_parse(&impairment, spec.c_str()) == 0;
+}
+
+void DatagramLink::setImpairment(Direction direction, const Impairment& impairment)
+{
+  path(direction).configure(impairment);
+}
+
+DatagramLink::Stats DatagramLink::getStats(Direction direction) const
+{
+  return path(direction).getStats();
+}
+
+DatagramLink::Path& DatagramLink::path(Direction direction)
+{
+  return direction == Direction::AtoB ? aToB : bToA;
+}
+
+const DatagramLink::Path& DatagramLink::path(Direction direction) const
+{
+  return direction == Direction::AtoB ? aToB : bToA;
+}
+
+DatagramLink::Path::Path(EventLoop& eventLoop, Transmitter& receiver, std::uint64_t seed) :
+  strand(eventLoop.makeStrand()),
+  timer(strand),
+  receiver(receiver),
+  rng(seed),
+  impairment(),
+  geBad(0),
+  linkFree(),
+  sequence(0),
+  waiting(false),
+  stats()
+{
+}
+
+void DatagramLink::Path::submit(const std::uint8_t* data, std::size_t size)
+{
+  std::vector<std::uint8_t> datagram(data, data + size);
+
+  asio::post(strand, [this, datagram = std::move(datagram)]() mutable {
+    impair(std::move(datagram));
+  });
+}
+
+void DatagramLink::Path::configure(const Impairment& impairment)
+{
+  asio::post(strand, [this, impairment]() {
+    this->impairment = impairment;
+    geBad = 0;
+  });
+}
+
+const DatagramLink::Stats& DatagramLink::Path::getStats(void) const
+{
+  return stats;
+}
+
+double DatagramLink::Path::random(void)
+{
+  return std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+}
+
+bool DatagramLink::Path::drop(void)
+{
+  auto draw = [](void* path) { return static_cast<Path*>(path)->random(); };
+  return impair_lose(&impairment, &geBad, draw, this) != 0;
+}
+
+void DatagramLink::Path::impair(std::vector<std::uint8_t> datagram)
+{
+  Clock::time_point now = timer.now();
+  Clock::time_point depart = now;
+
+  stats.received++;
+
+  if (drop()) {
+    stats.lost++;
+    return;
+  }
+
+  // Serialisation at the capped rate, tail drop when the queue is full
+  if (impairment.rate_bps > 0) {
+    Clock::time_point start = std::max(linkFree, now);
+    auto queued = std::chrono::duration_cast<std::chrono::microseconds>(start - now);
+    std::uint64_t backlog = static_cast<std::uint64_t>(queued.count()) * impairment.rate_bps / 8 / 1000000;
+
+    if (backlog + datagram.size() > impairment.queue_bytes) {
+      stats.queueDrops++;
+      return;
+    }
+
+    depart = start + std::chrono::microseconds(datagram.size() * 8 * 1000000 / impairment.rate_bps);
+    linkFree = depart;
+  }
+
+  int copies = 1;
+  if (impairment.dup > 0 && random() < impairment.dup) {
+    stats.duplicated++;
+    copies = 2;
+  }
+
+  for (int i = 0; i < copies; i++) {
+    Clock::time_point due = depart;
+
+    if (impairment.reorder > 0 && random() < impairment.reorder) {
+      // Ahead of the datagrams still in flight
+      stats.reordered++;
+    } else {
+      auto delay = std::chrono::microseconds(impairment.delay_us);
+      if (impairment.jitter_us > 0) {
+        auto jitter = std::chrono::microseconds(impairment.jitter_us);
+        delay += std::chrono::microseconds(static_cast<std::int64_t>(
+          random() * static_cast<double>(2 * jitter.count()))) - jitter;
+      }
+      if (delay.count() > 0) {
+        due += delay;
+      }
+    }
+
+    if (i + 1 < copies) {
+      queue.emplace(Key(due, sequence++), datagram);
+    } else {
+      queue.emplace(Key(due, sequence++), std::move(datagram));
+    }
+  }
+
+  schedule();
+}
+
+void DatagramLink::Path::schedule(void)
+{
+  if (queue.empty()) {
+    return;
+  }
+
+  // A wait already running for an earlier datagram reschedules itself
+  Clock::time_point due = queue.begin()->first.first;
+  if (waiting && timer.expiry() <= due) {
+    return;
+  }
+
+  timer.expires_at(due);
+  waiting = true;
+  timer.async_wait([this](const asio::error_code& error) {
+    if (error == asio::error::operation_aborted) {
+      return;
+    }
+    waiting = false;
+    deliver();
+  });
+}
+
+void DatagramLink::Path::deliver(void)
+{
+  Clock::time_point now = timer.now();
+
+  while (!queue.empty() && queue.begin()->first.first <= now) {
+    const std::vector<std::uint8_t>& datagram = queue.begin()->second;
+    receiver.receiveDatagram(datagram.data(), datagram.size());
+    stats.delivered++;
+    stats.bytes += datagram.size();
+    queue.erase(queue.begin());
+  }
+
+  schedule();
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Event.h"
+#include "impair_config.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Transmitter;
+
+// In-memory link between two Transmitters in place of the UDP sockets
+// and the relay. Each direction applies the impairment model of netrelay,
+// parsed by the shared impair_config code: random and Gilbert-Elliott
+// burst loss, delay with jitter, reordering, duplication and a bandwidth
+// cap with a tail drop queue. On a virtual time EventLoop a run depends
+// only on the seed, and hours of link behaviour take seconds.
+class DatagramLink
+{
+ public:
+  enum class Direction {
+    AtoB,
+    BtoA,
+  };
+
+  // The configuration of netrelay, see netrelay/impair_config.h
+  using Impairment = impair_config_t;
+
+  struct Stats {
+    std::uint64_t received;
+    std::uint64_t delivered;
+    std::uint64_t lost;
+    std::uint64_t queueDrops;
+    std::uint64_t duplicated;
+    std::uint64_t reordered;
+    std::uint64_t bytes;
+  };
+
+  // Takes over sending of both Transmitters, before their initSocket()
+  DatagramLink(EventLoop& eventLoop, Transmitter& a, Transmitter& b, std::uint64_t seed = 1);
+
+  // Parse a configuration as given to netrelay, e.g.
+  // "loss=1,delay=20,jitter=5,rate=4000". Returns false on error.
+  static bool parseImpairment(const std::string& spec, Impairment& impairment);
+
+  void setImpairment(Direction direction, const Impairment& impairment);
+
+  // Read when the loop isn't running
+  Stats getStats(Direction direction) const;
+
+ private:
+  class Path {
+   public:
+    Path(EventLoop& eventLoop, Transmitter& receiver, std::uint64_t seed);
+
+    // Both can be called from any thread
+    void submit(const std::uint8_t* data, std::size_t size);
+    void configure(const Impairment& impairment);
+    const Stats& getStats(void) const;
+
+   private:
+    using Clock = EventLoop::Clock;
+    using Key = std::pair<Clock::time_point, std::uint64_t>;
+
+    void impair(std::vector<std::uint8_t> datagram);
+    double random(void);
+    bool drop(void);
+    void schedule(void);
+    void deliver(void);
+
+    EventLoop::Strand strand;
+    EventLoop::StrandTimer timer;
+    Transmitter& receiver;
+    std::mt19937_64 rng;
+    Impairment impairment;
+    int geBad;
+    Clock::time_point linkFree;
+    std::map<Key, std::vector<std::uint8_t>> queue;
+    std::uint64_t sequence;
+    bool waiting;
+    Stats stats;
+  };
+
+  Path& path(Direction direction);
+  const Path& path(Direction direction) const;
+
+  Path aToB;
+  Path bToA;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
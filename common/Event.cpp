@@ -4,9 +4,198 @@
  */
 
 #include "Event.h"
+#include "Log.h"
+#include "Metrics.h"
+#include "TimerWheel.h"
 
-EventLoop::EventLoop()
-    : work_guard(asio::make_work_guard(io_context))
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+
+// Virtual time starts here rather than at zero, which is "never" to some
+// of the users of the clock
+constexpr std::chrono::hours VIRTUAL_CLOCK_EPOCH(1);
+
+// The clock of a loop in virtual time, kept as a service of its
+// io_context so that the StrandTimers find it from their strand. The
+// waits are kept in the order of their deadlines.
+class VirtualClock : public asio::execution_context::service
+{
+public:
+    static asio::execution_context::id id;
+
+    using Clock = EventLoop::Clock;
+    using Handler = std::function<void(const asio::error_code&)>;
+    using Wait = std::pair<Clock::time_point, std::uint64_t>;
+
+    explicit VirtualClock(asio::execution_context& context)
+        : asio::execution_context::service(context),
+          current(VIRTUAL_CLOCK_EPOCH),
+          sequence(0)
+    {
+    }
+
+    Clock::time_point now(void) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current;
+    }
+
+    void wait(EventLoop::StrandTimer& timer, Handler handler)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (timer.expiryTime > current) {
+                Wait key(timer.expiryTime, sequence++);
+                waits.emplace(key, Pending{ &timer, std::move(handler) });
+                timer.waits.push_back(key);
+                return;
+            }
+        }
+
+        // Due already
+        asio::post(timer.strand, [handler = std::move(handler)]() { handler(asio::error_code()); });
+    }
+
+    std::size_t cancel(EventLoop::StrandTimer& timer)
+    {
+        std::vector<Handler> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Wait& key : timer.waits) {
+                auto it = waits.find(key);
+                if (it != waits.end()) {
+                    cancelled.push_back(std::move(it->second.handler));
+                    waits.erase(it);
+                }
+            }
+            timer.waits.clear();
+        }
+
+        for (Handler& handler : cancelled) {
+            asio::post(timer.strand, [handler = std::move(handler)]() {
+                handler(asio::error::operation_aborted);
+            });
+        }
+        return cancelled.size();
+    }
+
+    // Move the clock to the next deadline and post the waits due then,
+    // false if nothing is waiting
+    bool advance(void)
+    {
+        std::vector<std::pair<EventLoop::Strand, Handler>> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (waits.empty()) {
+                return false;
+            }
+
+            current = waits.begin()->first.first;
+            while (!waits.empty() && waits.begin()->first.first <= current) {
+                auto it = waits.begin();
+                std::vector<Wait>& pending = it->second.timer->waits;
+                pending.erase(std::find(pending.begin(), pending.end(), it->first));
+                due.emplace_back(it->second.timer->strand, std::move(it->second.handler));
+                waits.erase(it);
+            }
+        }
+
+        for (auto& wait : due) {
+            asio::post(wait.first, [handler = std::move(wait.second)]() { handler(asio::error_code()); });
+        }
+        return true;
+    }
+
+private:
+    struct Pending {
+        EventLoop::StrandTimer* timer;
+        Handler handler;
+    };
+
+    void shutdown() override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waits.clear();
+    }
+
+    mutable std::mutex mutex;
+    Clock::time_point current;
+    std::uint64_t sequence;         // Keeps the waits with the same deadline in order
+    std::map<Wait, Pending> waits;
+};
+
+asio::execution_context::id VirtualClock::id;
+
+EventLoop::StrandTimer::StrandTimer(const Strand& strand)
+    : strand(strand),
+      clock(asio::has_service<VirtualClock>(strand.context()) ?
+            &asio::use_service<VirtualClock>(strand.context()) : nullptr),
+      timer(strand),
+      expiryTime(),
+      waits()
+{
+}
+
+EventLoop::StrandTimer::~StrandTimer()
+{
+    cancel();
+}
+
+std::size_t EventLoop::StrandTimer::expires_at(Clock::time_point time)
+{
+    expiryTime = time;
+    if (clock) {
+        return clock->cancel(*this);
+    }
+    return timer.expires_at(time);
+}
+
+std::size_t EventLoop::StrandTimer::expires_after(Clock::duration duration)
+{
+    return expires_at(now() + duration);
+}
+
+EventLoop::Clock::time_point EventLoop::StrandTimer::expiry(void) const
+{
+    return expiryTime;
+}
+
+std::size_t EventLoop::StrandTimer::cancel(void)
+{
+    if (clock) {
+        return clock->cancel(*this);
+    }
+    return timer.cancel();
+}
+
+EventLoop::Clock::time_point EventLoop::StrandTimer::now(void) const
+{
+    return clock ? clock->now() : Clock::now();
+}
+
+bool EventLoop::StrandTimer::isVirtual(void) const
+{
+    return clock != nullptr;
+}
+
+void EventLoop::StrandTimer::waitVirtual(std::function<void(const asio::error_code&)> handler)
+{
+    clock->wait(*this, std::move(handler));
+}
+
+EventLoop::EventLoop(Time time)
+    : work_guard(asio::make_work_guard(io_context)),
+      virtualClock(time == Time::Virtual ? &asio::make_service<VirtualClock>(io_context) : nullptr),
+      timerWheel(std::make_unique<TimerWheel>(io_context)),
+      threadCount(1),
+      cpuAffinity(),
+      threads()
 {
 }
 
@@ -15,16 +204,140 @@ EventLoop::~EventLoop()
     stop();
 }
 
+void EventLoop::setThreads(std::size_t count)
+{
+    threadCount = count > 0 ? count : 1;
+}
+
+std::size_t EventLoop::getThreads(void) const
+{
+    return threadCount;
+}
+
+void EventLoop::setCpuAffinity(const std::vector<int>& cpus)
+{
+    cpuAffinity = cpus;
+}
+
+void EventLoop::configureFromEnvironment(void)
+{
+    const char* envThreads = std::getenv("PLECO_THREADS");
+    if (envThreads) {
+        setThreads(std::strtoul(envThreads, nullptr, 0));
+    }
+
+    const char* envCpus = std::getenv("PLECO_CPUS");
+    if (envCpus) {
+        std::vector<int> cpus;
+        std::istringstream list(envCpus);
+        std::string cpu;
+        while (std::getline(list, cpu, ',')) {
+            if (!cpu.empty()) {
+                cpus.push_back(std::atoi(cpu.c_str()));
+            }
+        }
+        setCpuAffinity(cpus);
+    }
+}
+
+void EventLoop::pinThread(void)
+{
+    if (cpuAffinity.empty()) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpuAffinity) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        LOG_WARN(Main) << "Failed to pin the event loop thread: " << error;
+    }
+}
+
 void EventLoop::run() {
+    if (virtualClock) {
+        runVirtual();
+        return;
+    }
+
+    LOG_INFO(Main) << "Running the event loop on " << threadCount << " thread(s)";
+    Metrics::registry().gauge("pleco_event_loop_threads", "Threads running the event loop")
+        .set(static_cast<std::int64_t>(threadCount));
+
+    // The calling thread is one of the loop threads
+    for (std::size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back([this]() {
+            pinThread();
+            io_context.run();
+        });
+    }
+
     // Start the event processing loop
+    pinThread();
     io_context.run();
+
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
+
+void EventLoop::runVirtual(void)
+{
+    LOG_INFO(Main) << "Running the event loop in virtual time";
+    Metrics::registry().gauge("pleco_event_loop_threads", "Threads running the event loop").set(1);
+
+    // Everything due at this instant runs before the clock moves on
+    while (!io_context.stopped()) {
+        if (io_context.poll() > 0) {
+            continue;
+        }
+
+        if (io_context.stopped()) {
+            break;
+        }
+
+        // Nothing would ever happen again
+        if (!virtualClock->advance()) {
+            LOG_INFO(Main) << "Nothing to wait for in virtual time";
+            break;
+        }
+    }
 }
 
 void EventLoop::stop() {
-    // Stop the event loop
+    // Stop the event loop, all the threads return from run()
     io_context.stop();
 }
 
 asio::io_context& EventLoop::context() {
     return io_context;
 }
+
+EventLoop::Strand EventLoop::makeStrand(void)
+{
+    return asio::make_strand(io_context);
+}
+
+TimerWheel& EventLoop::timers(void)
+{
+    return *timerWheel;
+}
+
+EventLoop::Clock::time_point EventLoop::now(void) const
+{
+    return virtualClock ? virtualClock->now() : Clock::now();
+}
+
+bool EventLoop::isVirtual(void) const
+{
+    return virtualClock != nullptr;
+}
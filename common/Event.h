@@ -7,16 +7,125 @@
 
 #include <asio.hpp>
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TimerWheel;
+class VirtualClock;
+
 class EventLoop {
 public:
-    EventLoop();
+    // Handlers posted to one strand never run concurrently, even when
+    // several threads run the loop
+    using Strand = asio::strand<asio::io_context::executor_type>;
+
+    // I/O objects bound to a strand. Naming the executor type avoids the
+    // allocations of the type erased default executor.
+    using StrandSocket = asio::basic_datagram_socket<asio::ip::udp, Strand>;
+
+    using Clock = std::chrono::steady_clock;
+
+    // In real time the timers wait for the steady clock. In virtual time
+    // the loop runs on the calling thread only and, whenever no handler
+    // is ready, jumps the clock to the next timer deadline. Hours of e.g.
+    // resends over a lossy link then run in moments, and the same way
+    // every time. All I/O must be in memory, see DatagramLink.
+    enum class Time {
+        Real,
+        Virtual,
+    };
+
+    // Timer bound to a strand with the interface of an asio waitable
+    // timer, on the virtual clock if the loop runs in virtual time
+    class StrandTimer {
+    public:
+        explicit StrandTimer(const Strand& strand);
+        ~StrandTimer();
+
+        // Setting the expiry cancels the pending waits
+        std::size_t expires_at(Clock::time_point time);
+        std::size_t expires_after(Clock::duration duration);
+        Clock::time_point expiry(void) const;
+
+        // The handlers of the cancelled waits get operation_aborted
+        std::size_t cancel(void);
+
+        template <typename Handler>
+        void async_wait(Handler&& handler)
+        {
+            if (clock) {
+                waitVirtual(std::forward<Handler>(handler));
+            } else {
+                timer.async_wait(std::forward<Handler>(handler));
+            }
+        }
+
+        // Current time on the clock the timer waits on
+        Clock::time_point now(void) const;
+        bool isVirtual(void) const;
+
+    private:
+        friend class VirtualClock;
+
+        using Wait = std::pair<Clock::time_point, std::uint64_t>;
+
+        void waitVirtual(std::function<void(const asio::error_code&)> handler);
+
+        Strand strand;
+        VirtualClock* clock;
+        asio::basic_waitable_timer<Clock, asio::wait_traits<Clock>, Strand> timer;
+        Clock::time_point expiryTime;
+        std::vector<Wait> waits;        // Pending on the virtual clock
+    };
+
+    explicit EventLoop(Time time = Time::Real);
     ~EventLoop();
 
+    // Number of threads running the handlers, 1 by default. Must be set
+    // before run().
+    void setThreads(std::size_t count);
+    std::size_t getThreads(void) const;
+
+    // CPUs the loop threads may run on, e.g. to keep the control path off
+    // the cores busy with encoding. Empty for no pinning. Must be set
+    // before run().
+    void setCpuAffinity(const std::vector<int>& cpus);
+
+    // Take the above from PLECO_THREADS and PLECO_CPUS (e.g. "2,3")
+    void configureFromEnvironment(void);
+
+    // Run the handlers on the calling thread and the extra threads until
+    // stopped
     void run();
     void stop();
     asio::io_context& context();
 
+    // A new strand on this loop
+    Strand makeStrand(void);
+
+    // The timer service shared by the Timers on this loop
+    TimerWheel& timers(void);
+
+    // The steady clock, or the virtual clock in virtual time
+    Clock::time_point now(void) const;
+    bool isVirtual(void) const;
+
 private:
+    void pinThread(void);
+    void runVirtual(void);
+
     asio::io_context io_context;
     asio::executor_work_guard<asio::io_context::executor_type> work_guard;
+    VirtualClock* virtualClock;     // Owned by io_context, null in real time
+    std::unique_ptr<TimerWheel> timerWheel;
+    std::size_t threadCount;
+    std::vector<int> cpuAffinity;
+    std::vector<std::thread> threads;
 };
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "FrameStamp.h"
+
+#include <chrono>
+
+namespace FrameStamp {
+
+  // 32 stamp bits and 8 check bits in two rows
+  constexpr int STAMP_BITS = 32;
+  constexpr int CHECK_BITS = 8;
+  constexpr int BLOCKS_PER_ROW = 20;
+  constexpr int BLOCK_ROWS = (STAMP_BITS + CHECK_BITS) / BLOCKS_PER_ROW;
+
+  // Video range black and white
+  constexpr std::uint8_t BLACK = 16;
+  constexpr std::uint8_t WHITE = 235;
+  constexpr int THRESHOLD = (BLACK + WHITE) / 2;
+  constexpr int MARGIN = (WHITE - BLACK) / 4;   // Blocks closer to the threshold are misreads
+
+  // Blocks smaller than this don't survive the encoder reliably
+  constexpr int MIN_BLOCK_SIZE = 8;
+
+  // Keeps an all black or white frame from passing the check
+  constexpr std::uint8_t CHECK_SALT = 0x5a;
+
+  static std::uint8_t check(std::uint32_t stamp)
+  {
+    return static_cast<std::uint8_t>((stamp ^ (stamp >> 8) ^ (stamp >> 16) ^ (stamp >> 24)) ^ CHECK_SALT);
+  }
+
+  // Block size in pixels, 0 if the frame is too small
+  static int blockSize(int width, int height)
+  {
+    int size = width / BLOCKS_PER_ROW;
+    if (size < MIN_BLOCK_SIZE || size * BLOCK_ROWS > height) {
+      return 0;
+    }
+    return size;
+  }
+
+  std::uint32_t now(void)
+  {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<std::uint32_t>(us);
+  }
+
+  int rows(int width, int height)
+  {
+    return blockSize(width, height) * BLOCK_ROWS;
+  }
+
+  bool write(std::uint8_t* luma, int width, int height, int stride, std::uint32_t stamp)
+  {
+    int size = blockSize(width, height);
+    if (size == 0) {
+      return false;
+    }
+
+    std::uint64_t bits = (static_cast<std::uint64_t>(check(stamp)) << STAMP_BITS) | stamp;
+
+    for (int bit = 0; bit < STAMP_BITS + CHECK_BITS; bit++) {
+      std::uint8_t value = (bits >> bit) & 1 ? WHITE : BLACK;
+      int x0 = (bit % BLOCKS_PER_ROW) * size;
+      int y0 = (bit / BLOCKS_PER_ROW) * size;
+
+      for (int y = y0; y < y0 + size; y++) {
+        std::uint8_t* row = luma + y * stride + x0;
+        for (int x = 0; x < size; x++) {
+          row[x] = value;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool read(const std::uint8_t* pixels, int width, int height, int stride,
+            int bytesPerPixel, std::uint32_t& stamp)
+  {
+    int size = blockSize(width, height);
+    if (size == 0 || !pixels) {
+      return false;
+    }
+
+    // Average the middle of each block, away from the ringing at the edges
+    int inset = size / 4;
+    int samples = (size - 2 * inset) * (size - 2 * inset);
+
+    std::uint64_t bits = 0;
+    for (int bit = 0; bit < STAMP_BITS + CHECK_BITS; bit++) {
+      int x0 = (bit % BLOCKS_PER_ROW) * size + inset;
+      int y0 = (bit / BLOCKS_PER_ROW) * size + inset;
+
+      int sum = 0;
+      for (int y = y0; y < y0 + size - 2 * inset; y++) {
+        const std::uint8_t* row = pixels + y * stride + x0 * bytesPerPixel;
+        for (int x = 0; x < size - 2 * inset; x++) {
+          sum += row[x * bytesPerPixel];
+        }
+      }
+
+      int level = sum / samples;
+      if (level > THRESHOLD + MARGIN) {
+        bits |= static_cast<std::uint64_t>(1) << bit;
+      } else if (level >= THRESHOLD - MARGIN) {
+        return false;
+      }
+    }
+
+    std::uint32_t value = static_cast<std::uint32_t>(bits);
+    if (static_cast<std::uint8_t>(bits >> STAMP_BITS) != check(value)) {
+      return false;
+    }
+
+    stamp = value;
+    return true;
+  }
+
+  std::uint32_t age(std::uint32_t stamp)
+  {
+    return now() - stamp;
+  }
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
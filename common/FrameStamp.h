@@ -0,0 +1,47 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// A time stamp drawn into the top of a video frame as two rows of black
+// and white blocks, so that it survives encoding and decoding and the
+// glass-to-glass latency can be measured from the decoded frame.
+//
+// The stamp holds the low 32 bits of the steady clock in microseconds and
+// an 8 bit check. The block size follows the frame width, 20 blocks per
+// row, e.g. 16x16 pixels in a 320x240 frame.
+namespace FrameStamp {
+
+  // Current steady clock in microseconds, as stamped
+  std::uint32_t now(void);
+
+  // Rows at the top of the frame taken by the stamp, 0 if the frame is
+  // too small to hold it
+  int rows(int width, int height);
+
+  // Draw the stamp into an 8 bit luma plane. Returns false if the frame
+  // is too small to hold it. The chroma of the rows should be made
+  // neutral for the stamp to read as black and white.
+  bool write(std::uint8_t* luma, int width, int height, int stride, std::uint32_t stamp);
+
+  // Read the stamp from decoded pixels, bytesPerPixel apart with the
+  // brightness in the first byte (e.g. 4 for RGBA, 1 for luma). Returns
+  // false if no valid stamp is found.
+  bool read(const std::uint8_t* pixels, int width, int height, int stride,
+            int bytesPerPixel, std::uint32_t& stamp);
+
+  // Microseconds from the stamp to now, correct over the 32 bit wrap
+  std::uint32_t age(std::uint32_t stamp);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "HighResTimer.h"
+#include "Log.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+static timespec toTimespec(std::chrono::microseconds interval)
+{
+  timespec time;
+  time.tv_sec = static_cast<time_t>(interval.count() / 1000000);
+  time.tv_nsec = static_cast<long>(interval.count() % 1000000 * 1000);
+  return time;
+}
+#endif
+
+HighResTimer::HighResTimer(const EventLoop::Strand& strand) :
+#ifdef __linux__
+  descriptor(strand),
+#endif
+  fallback(strand),
+  callback(),
+  interval(0),
+  repeat(false),
+  running(false),
+  waiting(false)
+{
+#ifdef __linux__
+  // The timerfd runs in real time only
+  if (fallback.isVirtual()) {
+    return;
+  }
+
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0) {
+    LOG_WARN(Main) << "Failed to create a timerfd, using an asio timer: " << strerror(errno);
+    return;
+  }
+
+  asio::error_code ec;
+  descriptor.assign(fd, ec);
+  if (ec) {
+    LOG_WARN(Main) << "Failed to assign the timerfd, using an asio timer: " << ec.message();
+    close(fd);
+  }
+#endif
+}
+
+HighResTimer::~HighResTimer()
+{
+  stop();
+}
+
+void HighResTimer::start(std::chrono::microseconds interval, Callback callback, bool repeat)
+{
+  this->callback = std::move(callback);
+  this->interval = interval;
+  this->repeat = repeat;
+  restart();
+}
+
+void HighResTimer::restart(void)
+{
+  running = true;
+  arm();
+}
+
+void HighResTimer::stop(void)
+{
+  running = false;
+
+#ifdef __linux__
+  if (descriptor.is_open()) {
+    itimerspec spec = {};
+    timerfd_settime(descriptor.native_handle(), 0, &spec, nullptr);
+    return;
+  }
+#endif
+
+  fallback.cancel();
+}
+
+bool HighResTimer::isActive(void) const
+{
+  return running;
+}
+
+void HighResTimer::arm(void)
+{
+#ifdef __linux__
+  if (descriptor.is_open()) {
+    // A zero value would disarm the timer
+    std::chrono::microseconds value = std::max(interval, std::chrono::microseconds(1));
+
+    itimerspec spec = {};
+    spec.it_value = toTimespec(value);
+    if (repeat) {
+      spec.it_interval = toTimespec(value);
+    }
+
+    if (timerfd_settime(descriptor.native_handle(), 0, &spec, nullptr) < 0) {
+      LOG_ERROR(Main) << "Failed to arm the timerfd: " << strerror(errno);
+      running = false;
+      return;
+    }
+
+    // One wait is kept pending while armed, re-arming doesn't need another
+    if (!waiting) {
+      wait();
+    }
+    return;
+  }
+#endif
+
+  fallback.expires_after(interval);
+  fallback.async_wait([this](const asio::error_code& error) {
+    if (!error) {
+      expired();
+    }
+  });
+}
+
+void HighResTimer::wait(void)
+{
+#ifdef __linux__
+  waiting = true;
+  descriptor.async_wait(asio::posix::descriptor_base::wait_read, [this](const asio::error_code& error) {
+    // Closed, the timer is gone
+    if (error) {
+      return;
+    }
+    waiting = false;
+    expired();
+  });
+#endif
+}
+
+void HighResTimer::expired(void)
+{
+#ifdef __linux__
+  if (descriptor.is_open()) {
+    // Nothing to read if stopped or re-armed since it became readable
+    std::uint64_t expirations;
+    if (read(descriptor.native_handle(), &expirations, sizeof(expirations)) < 0) {
+      if (running) {
+        wait();
+      }
+      return;
+    }
+
+    if (!running) {
+      return;
+    }
+
+    if (repeat) {
+      wait();
+    } else {
+      running = false;
+    }
+
+    if (callback) {
+      callback();
+    }
+    return;
+  }
+#endif
+
+  if (!running) {
+    return;
+  }
+
+  if (repeat) {
+    arm();
+  } else {
+    running = false;
+  }
+
+  if (callback) {
+    callback();
+  }
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Event.h"
+
+#include <chrono>
+#include <functional>
+
+// Timer for sub-millisecond deadlines that the timer wheel would round
+// up. On Linux each timer is a timerfd, armed with one system call and
+// with repeats kept by the kernel so that they don't drift. Elsewhere, and
+// in virtual time, a StrandTimer is used. Used on its strand only.
+class HighResTimer
+{
+ public:
+  using Callback = std::function<void(void)>;
+
+  explicit HighResTimer(const EventLoop::Strand& strand);
+  ~HighResTimer();
+
+  void start(std::chrono::microseconds interval, Callback callback, bool repeat);
+  void restart(void);
+  void stop(void);
+  bool isActive(void) const;
+
+ private:
+  void arm(void);
+  void wait(void);
+  void expired(void);
+
+#ifdef __linux__
+  asio::posix::basic_stream_descriptor<EventLoop::Strand> descriptor;
+#endif
+  EventLoop::StrandTimer fallback;
+  Callback callback;
+  std::chrono::microseconds interval;
+  bool repeat;
+  bool running;
+  bool waiting;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "InFlightTable.h"
+
+#include <algorithm>
+
+InFlightTable::InFlightTable() :
+  slots(),
+  head(NONE),
+  tail(NONE),
+  count(0)
+{
+  clear();
+}
+
+void InFlightTable::clear(void)
+{
+  for (std::size_t type = 0; type < MSG_TYPE_MAX; type++) {
+    std::uint8_t index = MessageSchema::reliableIndex(type);
+    if (index == MessageSchema::NOT_RELIABLE) {
+      continue;
+    }
+
+    for (std::size_t subType = 0; subType < MSG_TYPE_MAX; subType++) {
+      for (std::size_t i = 0; i < INFLIGHT_WINDOW; i++) {
+        Slot& slot = slots[(index * MSG_TYPE_MAX + subType) * INFLIGHT_WINDOW + i];
+        slot.fullType = static_cast<std::uint16_t>((type << 8) | subType);
+        slot.seq = 0;
+        slot.size = 0;
+        slot.sent = Clock::time_point();
+        slot.resent = false;
+        slot.resendsQueued = 0;
+        slot.deadline = Clock::time_point();
+        slot.prev = NONE;
+        slot.next = NONE;
+        slot.scheduled = false;
+      }
+    }
+  }
+
+  head = NONE;
+  tail = NONE;
+  count = 0;
+}
+
+InFlightTable::Slot* InFlightTable::store(const MessageView& msg, Clock::time_point now,
+                                          Clock::time_point deadline)
+{
+  Slot* slot = window(msg.fullType());
+  if (!slot || msg.size() > INFLIGHT_MESSAGE_MAX_LEN) {
+    return nullptr;
+  }
+  slot += msg.seq() % INFLIGHT_WINDOW;
+
+  // A queued resend of a message already ACKed, or of an older message
+  // than the one now in the slot. Storing it would start a new resend
+  // cycle, take an RTT sample from the resend or lose the newer message.
+  bool older = static_cast<std::int16_t>(msg.seq() - slot->seq) < 0;
+  if (slot->seq == msg.seq() ? slot->size == 0 && slot->resendsQueued > 0 :
+      older && (slot->size > 0 || slot->resendsQueued > 0)) {
+    if (slot->resendsQueued > 0) {
+      slot->resendsQueued--;
+    }
+    return slot;
+  }
+  if (slot->seq == msg.seq() && slot->resendsQueued > 0) {
+    slot->resendsQueued--;
+  }
+
+  // A resend is the same message again, anything else is a new one
+  if (slot->size == 0 || slot->seq != msg.seq()) {
+    slot->resent = false;
+  }
+
+  std::copy(msg.data(), msg.data() + msg.size(), slot->data.begin());
+  slot->seq = msg.seq();
+  slot->size = static_cast<std::uint8_t>(msg.size());
+  slot->sent = now;
+  schedule(*slot, deadline);
+
+  return slot;
+}
+
+void InFlightTable::schedule(Slot& slot, Clock::time_point deadline)
+{
+  unschedule(slot);
+
+  slot.deadline = deadline;
+  slot.scheduled = true;
+  count++;
+
+  // Deadlines mostly grow, so search for the place from the tail
+  std::uint16_t after = tail;
+  while (after != NONE && slots[after].deadline > deadline) {
+    after = slots[after].prev;
+  }
+
+  std::uint16_t index = indexOf(slot);
+  slot.prev = after;
+  slot.next = after == NONE ? head : slots[after].next;
+
+  if (slot.prev == NONE) {
+    head = index;
+  } else {
+    slots[slot.prev].next = index;
+  }
+
+  if (slot.next == NONE) {
+    tail = index;
+  } else {
+    slots[slot.next].prev = index;
+  }
+}
+
+void InFlightTable::unschedule(Slot& slot)
+{
+  if (!slot.scheduled) {
+    return;
+  }
+
+  if (slot.prev == NONE) {
+    head = slot.next;
+  } else {
+    slots[slot.prev].next = slot.next;
+  }
+
+  if (slot.next == NONE) {
+    tail = slot.prev;
+  } else {
+    slots[slot.next].prev = slot.prev;
+  }
+
+  slot.prev = NONE;
+  slot.next = NONE;
+  slot.scheduled = false;
+  count--;
+}
+
+bool InFlightTable::nextDeadline(Clock::time_point& deadline) const
+{
+  if (head == NONE) {
+    return false;
+  }
+
+  deadline = slots[head].deadline;
+  return true;
+}
+
+InFlightTable::Slot* InFlightTable::popExpired(Clock::time_point now)
+{
+  if (head == NONE || slots[head].deadline > now) {
+    return nullptr;
+  }
+
+  Slot& slot = slots[head];
+  unschedule(slot);
+  return &slot;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
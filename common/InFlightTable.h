@@ -0,0 +1,123 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "MessageSchema.h"
+#include "MessageView.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Reliable messages are short and of fixed length
+constexpr std::size_t INFLIGHT_MESSAGE_MAX_LEN = 16U;
+
+// A stream is a reliable type and sub type, each with its own sequence
+// numbers. Up to this many messages of a stream wait for an ACK at a
+// time, sending more overwrites the oldest.
+constexpr std::size_t INFLIGHT_STREAMS = MessageSchema::reliableCount() * MSG_TYPE_MAX;
+constexpr std::size_t INFLIGHT_WINDOW  = 8U;
+constexpr std::size_t INFLIGHT_SLOTS   = INFLIGHT_STREAMS * INFLIGHT_WINDOW;
+
+static_assert(MessageSchema::maxFixedLength() <= INFLIGHT_MESSAGE_MAX_LEN,
+              "In-flight slots too small for reliable messages");
+static_assert(INFLIGHT_SLOTS < 0xFFFF, "In-flight slot index must fit in 16 bits");
+
+// Reliable messages waiting for an ACK. The slots are in one flat array
+// indexed by the reliable type and sub type and the sequence number
+// within the stream's window, so a lookup is two array reads. Each slot
+// holds a copy of a sent message, the send time for RTT and the resend
+// deadline. Slots with a deadline are linked in deadline order so one
+// timer can serve all of them.
+class InFlightTable
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Slot {
+    std::uint16_t fullType;
+    std::uint16_t seq;
+    std::uint8_t size;                    // 0 if not waiting for an ACK
+    std::array<std::uint8_t, INFLIGHT_MESSAGE_MAX_LEN> data;
+    Clock::time_point sent;               // Cleared once the RTT is measured
+    bool resent;                          // No RTT sample from a resent message
+    std::uint8_t resendsQueued;           // Resends waiting in the send queue
+    Clock::time_point deadline;           // Resend time if scheduled
+    std::uint16_t prev;                   // Deadline list links
+    std::uint16_t next;
+    bool scheduled;
+  };
+
+  InFlightTable();
+
+  // The INFLIGHT_WINDOW slots of a reliable full type, nullptr if the
+  // type is not reliable
+  Slot* window(std::uint16_t fullType)
+  {
+    std::uint8_t index = MessageSchema::reliableIndex(fullType >> 8);
+    if (index == MessageSchema::NOT_RELIABLE) {
+      return nullptr;
+    }
+    return &slots[(index * MSG_TYPE_MAX + (fullType & 0xFF)) * INFLIGHT_WINDOW];
+  }
+
+  // Slot of a message waiting for an ACK, nullptr if there's none
+  Slot* find(std::uint16_t fullType, std::uint16_t seq)
+  {
+    Slot* slot = window(fullType);
+    if (!slot) {
+      return nullptr;
+    }
+    slot += seq % INFLIGHT_WINDOW;
+    return slot->size > 0 && slot->seq == seq ? slot : nullptr;
+  }
+
+  // Keep a copy of a sent message and schedule its resend. Sending the
+  // stored message again keeps it marked as resent. A message a window
+  // newer replaces the unacknowledged one in its slot. A queued resend
+  // is not stored again if its ACK came before it was sent, or if a
+  // newer message took its slot meanwhile. Returns nullptr if the
+  // message is not reliable or too long.
+  Slot* store(const MessageView& msg, Clock::time_point now, Clock::time_point deadline);
+
+  // Set or clear the resend deadline of a slot
+  void schedule(Slot& slot, Clock::time_point deadline);
+  void unschedule(Slot& slot);
+
+  // Earliest resend deadline, false if nothing is scheduled
+  bool nextDeadline(Clock::time_point& deadline) const;
+
+  // Unschedule and return the first slot due at now, nullptr if none
+  Slot* popExpired(Clock::time_point now);
+
+  // Slots with a resend scheduled
+  std::size_t scheduledCount(void) const { return count; }
+
+  // Forget everything
+  void clear(void);
+
+ private:
+  static constexpr std::uint16_t NONE = 0xFFFF;
+
+  std::uint16_t indexOf(const Slot& slot) const
+  {
+    return static_cast<std::uint16_t>(&slot - slots.data());
+  }
+
+  std::array<Slot, INFLIGHT_SLOTS> slots;
+  std::uint16_t head;
+  std::uint16_t tail;
+  std::size_t count;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,354 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Log.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Log {
+
+  std::atomic<std::uint8_t> moduleLevels[static_cast<std::size_t>(Module::Count)] = {
+    { static_cast<std::uint8_t>(Level::Info) },
+    { static_cast<std::uint8_t>(Level::Info) },
+    { static_cast<std::uint8_t>(Level::Info) },
+    { static_cast<std::uint8_t>(Level::Info) },
+    { static_cast<std::uint8_t>(Level::Info) },
+    { static_cast<std::uint8_t>(Level::Info) },
+    { static_cast<std::uint8_t>(Level::Info) },
+  };
+
+  static_assert((RING_SLOTS & (RING_SLOTS - 1)) == 0, "Log ring size must be a power of two");
+
+  namespace {
+
+    constexpr int WRITER_IDLE_MS = 2;
+
+    const char* levelNames[] = { "trace", "debug", "info", "warn", "error", "off" };
+    const char* moduleNames[] = { "main", "net", "msg", "video", "audio", "hw", "ui" };
+
+    static_assert(sizeof(moduleNames) / sizeof(moduleNames[0]) == static_cast<std::size_t>(Module::Count),
+                  "Every log module needs a name");
+
+    // Bounded multi-producer queue, the sequence number of each slot tells
+    // whether it's free for the producers or ready for the writer
+    struct Slot {
+      std::atomic<std::size_t> sequence;
+      std::int64_t timeUs;
+      Level level;
+      Module module;
+      std::uint16_t length;
+      char text[LINE_MAX_LEN];
+    };
+
+    struct Ring {
+      std::array<Slot, RING_SLOTS> slots;
+      alignas(64) std::atomic<std::size_t> enqueuePos;
+      alignas(64) std::size_t dequeuePos;
+      std::atomic<std::uint64_t> dropped;
+      std::atomic<std::size_t> written;
+    };
+
+    Ring ring;
+
+    std::once_flag startOnce;
+    std::mutex writerMutex;
+    std::thread writer;
+    std::atomic<bool> running(false);
+    std::atomic<bool> stopped(false);
+
+    std::int64_t nowUs(void)
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void format(std::string& out, std::int64_t timeUs, Level level, Module module,
+                const char* text, std::size_t length)
+    {
+      std::time_t seconds = timeUs / 1000000;
+      struct tm tm;
+      localtime_r(&seconds, &tm);
+
+      char prefix[64];
+      int n = std::snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %-5s %-5s ",
+                            tm.tm_hour, tm.tm_min, tm.tm_sec, (int)((timeUs / 1000) % 1000),
+                            levelNames[static_cast<int>(level)], moduleNames[static_cast<int>(module)]);
+      out.append(prefix, n > 0 ? n : 0);
+      out.append(text, length);
+      out.push_back('\n');
+    }
+
+    void writeNow(Level level, Module module, const char* text, std::size_t length)
+    {
+      std::string line;
+      format(line, nowUs(), level, module, text, length);
+      std::fwrite(line.data(), 1, line.size(), level >= Level::Warn ? stderr : stdout);
+    }
+
+    bool push(Level level, Module module, const char* text, std::size_t length)
+    {
+      std::size_t pos = ring.enqueuePos.load(std::memory_order_relaxed);
+      Slot* slot;
+
+      for (;;) {
+        slot = &ring.slots[pos & (RING_SLOTS - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+        if (diff == 0) {
+          if (ring.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if (diff < 0) {
+          // Full, the writer is behind
+          ring.dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        } else {
+          pos = ring.enqueuePos.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->timeUs = nowUs();
+      slot->level = level;
+      slot->module = module;
+      slot->length = static_cast<std::uint16_t>(length);
+      std::memcpy(slot->text, text, length);
+      slot->sequence.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Write out everything queued, returns the number of lines written
+    std::size_t drain(void)
+    {
+      std::string out;
+      std::string err;
+      std::size_t count = 0;
+
+      for (;;) {
+        Slot& slot = ring.slots[ring.dequeuePos & (RING_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != ring.dequeuePos + 1) {
+          break;
+        }
+
+        format(slot.level >= Level::Warn ? err : out,
+               slot.timeUs, slot.level, slot.module, slot.text, slot.length);
+
+        slot.sequence.store(ring.dequeuePos + RING_SLOTS, std::memory_order_release);
+        ring.dequeuePos++;
+        count++;
+      }
+
+      if (!out.empty()) {
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+      }
+
+      if (!err.empty()) {
+        std::fwrite(err.data(), 1, err.size(), stderr);
+      }
+
+      ring.written.fetch_add(count, std::memory_order_release);
+      return count;
+    }
+
+    void writerLoop(void)
+    {
+      std::uint64_t reportedDrops = 0;
+
+      while (running.load(std::memory_order_acquire)) {
+        if (drain() == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_IDLE_MS));
+        }
+
+        std::uint64_t dropped = ring.dropped.load(std::memory_order_relaxed);
+        if (dropped != reportedDrops) {
+          char text[64];
+          int n = std::snprintf(text, sizeof(text), "%llu log lines dropped",
+                                (unsigned long long)(dropped - reportedDrops));
+          writeNow(Level::Warn, Module::Main, text, n);
+          reportedDrops = dropped;
+        }
+      }
+
+      drain();
+    }
+
+    void start(void)
+    {
+      std::call_once(startOnce, []() {
+        for (std::size_t i = 0; i < RING_SLOTS; i++) {
+          ring.slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        ring.enqueuePos.store(0, std::memory_order_relaxed);
+        ring.dequeuePos = 0;
+
+        running = true;
+        writer = std::thread(writerLoop);
+        std::atexit(shutdown);
+      });
+    }
+  }
+
+  void init(void)
+  {
+    const char* spec = std::getenv("PLECO_LOG");
+    if (spec && !configure(spec)) {
+      LOG_WARN(Main) << "Invalid PLECO_LOG: " << spec;
+    }
+
+    start();
+  }
+
+  void shutdown(void)
+  {
+    std::lock_guard<std::mutex> lock(writerMutex);
+
+    if (stopped.exchange(true)) {
+      return;
+    }
+
+    running = false;
+    if (writer.joinable()) {
+      writer.join();
+    }
+  }
+
+  void flush(void)
+  {
+    std::size_t queued = ring.enqueuePos.load(std::memory_order_acquire);
+
+    while (running.load(std::memory_order_acquire) &&
+           ring.written.load(std::memory_order_acquire) < queued) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_IDLE_MS));
+    }
+  }
+
+  void setLevel(Level level)
+  {
+    for (auto& moduleLevel : moduleLevels) {
+      moduleLevel.store(static_cast<std::uint8_t>(level), std::memory_order_relaxed);
+    }
+  }
+
+  void setLevel(Module module, Level level)
+  {
+    moduleLevels[static_cast<std::size_t>(module)].store(static_cast<std::uint8_t>(level),
+                                                         std::memory_order_relaxed);
+  }
+
+  bool configure(const char* spec)
+  {
+    bool ok = true;
+    std::string items(spec);
+    std::size_t begin = 0;
+
+    while (begin <= items.size()) {
+      std::size_t end = items.find(',', begin);
+      if (end == std::string::npos) {
+        end = items.size();
+      }
+
+      std::string item = items.substr(begin, end - begin);
+      begin = end + 1;
+      if (item.empty()) {
+        continue;
+      }
+
+      // "module=level" or just "level" for all modules
+      std::string moduleName;
+      std::string levelName = item;
+      std::size_t eq = item.find('=');
+      if (eq != std::string::npos) {
+        moduleName = item.substr(0, eq);
+        levelName = item.substr(eq + 1);
+      }
+
+      int level = -1;
+      for (int i = 0; i <= static_cast<int>(Level::Off); i++) {
+        if (levelName == levelNames[i]) {
+          level = i;
+        }
+      }
+
+      if (level < 0) {
+        ok = false;
+        continue;
+      }
+
+      if (moduleName.empty()) {
+        setLevel(static_cast<Level>(level));
+        continue;
+      }
+
+      bool found = false;
+      for (std::size_t i = 0; i < static_cast<std::size_t>(Module::Count); i++) {
+        if (moduleName == moduleNames[i]) {
+          setLevel(static_cast<Module>(i), static_cast<Level>(level));
+          found = true;
+        }
+      }
+      ok = ok && found;
+    }
+
+    return ok;
+  }
+
+  const char* getLevelStr(Level level)
+  {
+    return level <= Level::Off ? levelNames[static_cast<int>(level)] : "unknown";
+  }
+
+  const char* getModuleStr(Module module)
+  {
+    return module < Module::Count ? moduleNames[static_cast<int>(module)] : "unknown";
+  }
+
+  std::uint64_t getDropped(void)
+  {
+    return ring.dropped.load(std::memory_order_relaxed);
+  }
+
+  Line::Buffer::Buffer()
+  {
+    setp(text, text + LINE_MAX_LEN);
+  }
+
+  Line::Line(Level level, Module module) :
+    level(level),
+    module(module),
+    buffer(),
+    out(&buffer)
+  {
+  }
+
+  Line::~Line()
+  {
+    start();
+
+    if (stopped.load(std::memory_order_acquire)) {
+      writeNow(level, module, buffer.data(), buffer.size());
+      return;
+    }
+
+    push(level, module, buffer.data(), buffer.size());
+  }
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
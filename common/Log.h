@@ -0,0 +1,139 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+
+// Log statements below this level are compiled out (0 = trace ... 4 = error)
+#ifndef PLECO_LOG_LEVEL
+#define PLECO_LOG_LEVEL 0
+#endif
+
+// Asynchronous logging. A log line is formatted into a fixed buffer by the
+// calling thread, queued into a lock-free ring and written to stdout
+// (stderr for warnings and errors) by a background thread. If the ring is
+// full the line is dropped and counted instead of blocking the caller.
+//
+// Usage: LOG_INFO(Net) << "Sending ping";
+//
+// The runtime level is set per module, e.g. PLECO_LOG="info,net=debug".
+namespace Log {
+
+  enum class Level : std::uint8_t {
+    Trace = 0,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off,
+  };
+
+  enum class Module : std::uint8_t {
+    Main = 0,     // Application setup and main loops
+    Net,          // Transmitter and networking
+    Msg,          // Message parsing and building
+    Video,
+    Audio,
+    Hw,           // Hardware, camera and control board
+    Ui,           // User interface and joystick
+    Count,
+  };
+
+  constexpr std::size_t LINE_MAX_LEN = 256U;   // Longer lines are truncated
+  constexpr std::size_t RING_SLOTS   = 1024U;  // Must be a power of two
+
+  // Runtime level of each module, read without locking
+  extern std::atomic<std::uint8_t> moduleLevels[static_cast<std::size_t>(Module::Count)];
+
+  inline bool enabled(Level level, Module module)
+  {
+    return static_cast<std::uint8_t>(level) >=
+      moduleLevels[static_cast<std::size_t>(module)].load(std::memory_order_relaxed);
+  }
+
+  constexpr Level COMPILED_LEVEL = static_cast<Level>(PLECO_LOG_LEVEL);
+
+  // Whether statements of the level are compiled in at all
+  constexpr bool compiled(Level level)
+  {
+    return level >= COMPILED_LEVEL;
+  }
+
+  // Start the writer thread and apply the PLECO_LOG environment variable
+  void init(void);
+
+  // Write out the queued lines and stop the writer thread. Lines logged
+  // after this are written synchronously.
+  void shutdown(void);
+
+  // Wait until the lines queued so far are written
+  void flush(void);
+
+  void setLevel(Level level);
+  void setLevel(Module module, Level level);
+
+  // Parse "level" or "module=level" items separated by commas
+  bool configure(const char* spec);
+
+  const char* getLevelStr(Level level);
+  const char* getModuleStr(Module module);
+
+  // Lines dropped because the ring was full
+  std::uint64_t getDropped(void);
+
+  // One log line, queued when destroyed. Use the LOG_* macros instead.
+  class Line {
+   public:
+    Line(Level level, Module module);
+    ~Line();
+
+    Line(const Line&) = delete;
+    Line& operator=(const Line&) = delete;
+
+    std::ostream& stream(void) { return out; }
+
+   private:
+    // Formats into the fixed array, never allocates
+    class Buffer : public std::streambuf {
+     public:
+      Buffer();
+      std::size_t size(void) const { return pptr() - pbase(); }
+      const char* data(void) const { return pbase(); }
+
+     private:
+      char text[LINE_MAX_LEN];
+    };
+
+    Level level;
+    Module module;
+    Buffer buffer;
+    std::ostream out;
+  };
+}
+
+#define PLECO_LOG(level, module)                                                        \
+  if (!Log::compiled(Log::Level::level) ||                                               \
+      !Log::enabled(Log::Level::level, Log::Module::module)) {                          \
+  } else                                                                                \
+    Log::Line(Log::Level::level, Log::Module::module).stream()
+
+#define LOG_TRACE(module) PLECO_LOG(Trace, module)
+#define LOG_DEBUG(module) PLECO_LOG(Debug, module)
+#define LOG_INFO(module)  PLECO_LOG(Info, module)
+#define LOG_WARN(module)  PLECO_LOG(Warn, module)
+#define LOG_ERROR(module) PLECO_LOG(Error, module)
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -5,15 +5,16 @@
 
 #pragma once
 
-#include <vector>
 #include <cstdint>
-#include <string>
+#include <cstddef>
 
 
 constexpr std::size_t MSG_DEBUG_MAX_LEN = 256U;      // Max length of debug messages
 
 constexpr std::size_t MSG_HP_TYPE_LIMIT = 64U;       // Highest low-priority type
 
+constexpr std::size_t MSG_BATCH_ITEM_MAX_LEN = 255U; // Max length of a message inside a Batch
+
 constexpr std::size_t MSG_TYPE_SUBTYPE_MAX = 65536;
 constexpr std::size_t MSG_TYPE_MAX         = 256;
 
@@ -27,6 +28,10 @@ namespace MessageType {
   constexpr std::uint8_t Audio           = 67U;
   constexpr std::uint8_t Debug           = 68U;
   constexpr std::uint8_t PeriodicValue   = 69U;
+  constexpr std::uint8_t Batch           = 70U;  // Several small messages in one datagram
+  constexpr std::uint8_t Fragment        = 71U;  // Part of a message too big for one datagram
+  constexpr std::uint8_t VideoParity     = 72U;  // XOR parity over a group of video messages
+  constexpr std::uint8_t ReceiverReport  = 73U;  // Loss and delay of the received video
   constexpr std::uint8_t Ack             = 255U;
 }
 
@@ -49,6 +54,9 @@ namespace MessageSubtype {
   constexpr std::uint16_t CPUUsage          = 14U;
   constexpr std::uint16_t VideoQuality      = 15U;
   constexpr std::uint16_t Uptime            = 16U;
+  constexpr std::uint16_t PacerQueue        = 17U;
+  constexpr std::uint16_t PacerDelay        = 18U;
+  constexpr std::uint16_t VideoBitrate      = 19U;
 }
 
 namespace MessageOffset {
@@ -59,50 +67,27 @@ namespace MessageOffset {
   constexpr std::size_t Payload        = 6;   // start of payload
   constexpr std::size_t AckedType      = 6;   // Acked 8 bit type
   constexpr std::size_t AckedSubtype   = 7;   // Acked 8 bit sub type
-  constexpr std::size_t AckedCRC       = 8;   // Acked 16 bit CRC
+  constexpr std::size_t AckedSeq       = 8;   // 16 bit cumulative sequence number of the acked stream
+  constexpr std::size_t AckedSack      = 10;  // 16 bit bitmap of the messages received after it
+  constexpr std::size_t FragmentId     = 6;   // 16 bit id of the fragmented message
+  constexpr std::size_t FragmentIndex  = 8;   // 8 bit index of this fragment
+  constexpr std::size_t FragmentCount  = 9;   // 8 bit number of fragments
+  constexpr std::size_t FragmentTotal  = 10;  // 32 bit length of the whole message
+  constexpr std::size_t FragmentData   = 14;  // start of the fragment data
+  constexpr std::size_t ParityFirstSeq = 6;   // 16 bit sequence number of the first protected message
+  constexpr std::size_t ParityCount    = 8;   // 8 bit number of protected messages
+  constexpr std::size_t ParityLength   = 9;   // 16 bit XOR of the protected message lengths
+  constexpr std::size_t ParityData     = 11;  // start of the XOR of the protected messages
+  constexpr std::size_t ReportHighestSeq   = 6;   // 16 bit highest RTP sequence number received
+  constexpr std::size_t ReportFractionLost = 8;   // 8 bit fraction lost since the last report, in 1/256
+  constexpr std::size_t ReportJitter       = 9;   // 32 bit interarrival jitter in microseconds
+  constexpr std::size_t ReportQueueDelay   = 13;  // 32 bit one-way delay above the recent minimum, microseconds
+  constexpr std::size_t ReportDelayTrend   = 17;  // 32 bit signed one-way delay change, microseconds per second
+  constexpr std::size_t ReportRate         = 21;  // 32 bit received bits per second
+  constexpr std::size_t ReportEnd          = 25;
 }
 
 
-
-class Message {
- public:
-  Message(const std::vector<std::uint8_t>& data);
-  Message(std::uint8_t type, std::uint8_t subType = 0);
-  ~Message();
-
-  void setACK(Message &msg);
-  std::uint8_t getAckedType(void);
-  std::uint8_t getAckedSubType(void);
-  std::uint16_t getAckedFullType(void);
-  std::uint16_t getAckedCRC(void);
-  std::uint8_t type(void);
-  std::uint8_t subType(void);
-  std::uint16_t fullType(void);
-  bool isValid(void);
-  bool isHighPriority(void);
-
-  std::vector<std::uint8_t>* data(void);
-  void setCRC(void);
-  bool validateCRC(void);
-  bool matchCRC(std::uint16_t test);
-  void setSeq(std::uint16_t seq);
-
-  void setPayload16(std::uint16_t value);
-  std::uint16_t getPayload16();
-
-  static std::string getTypeStr(std::uint16_t type);
-  static std::string getSubTypeStr(std::uint16_t type);
-
- private:
-  std::size_t length(void);
-  std::size_t length(std::uint8_t type);
-  std::uint16_t getCRC(void);
-  void setUint16(std::size_t index, std::uint16_t value);
-  std::uint16_t getUint16(std::size_t index);
-
-  std::vector<std::uint8_t> bytearray;
-};
-
 /* Emacs indentatation information
    Local Variables:
    indent-tabs-mode:nil
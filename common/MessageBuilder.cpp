@@ -0,0 +1,217 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MessageBuilder.h"
+#include "MessageSchema.h"
+#include "Log.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <random>
+
+// Next sequence number of each full type. Messages may be built on any
+// thread, so they are atomic.
+static std::array<std::atomic<std::uint16_t>, MSG_TYPE_SUBTYPE_MAX> seqs;
+
+// Sequence numbers start from random values so that the messages of a
+// restarted peer are unlikely to look like late copies of the old ones
+static bool initSeqs(void)
+{
+  std::random_device device;
+  std::mt19937 generator(device());
+  std::uniform_int_distribution<unsigned int> distribution(0, 0xFFFF);
+
+  for (auto& seq : seqs) {
+    seq.store(static_cast<std::uint16_t>(distribution(generator)), std::memory_order_relaxed);
+  }
+  return true;
+}
+
+static const bool seqsInitialized = initSeqs();
+
+MessageBuilder::MessageBuilder(std::uint8_t* storage, std::size_t capacity) :
+  buffer(storage),
+  capacity(capacity),
+  length(0)
+{
+}
+
+MessageBuilder::MessageBuilder(std::uint8_t* storage, std::size_t capacity, std::size_t size) :
+  buffer(storage),
+  capacity(capacity),
+  length(size <= capacity ? size : 0)
+{
+}
+
+bool MessageBuilder::begin(std::uint8_t type, std::uint8_t subType)
+{
+  const MessageSchema::TypeInfo& info = MessageSchema::type(type);
+  std::size_t minLength = info.length;
+
+  // Must be a known type with space at least for the mandatory data
+  if (info.payload == MessageSchema::Payload::Unknown || minLength > capacity) {
+    LOG_ERROR(Msg) << __func__ << ": Cannot build message of type "
+                   << MessageSchema::typeStr(type) << " into " << capacity << " bytes";
+    length = 0;
+    return false;
+  }
+
+  length = minLength;
+  std::memset(buffer, 0, length);
+
+  buffer[MessageOffset::Type] = type;
+  buffer[MessageOffset::Subtype] = subType;
+
+  std::uint16_t fullType = (static_cast<std::uint16_t>(type) << 8) | subType;
+  setSeq(seqs[fullType].fetch_add(1, std::memory_order_relaxed));
+
+  return true;
+}
+
+void MessageBuilder::setSeq(std::uint16_t seq)
+{
+  if (length < MessageOffset::Payload) {
+    return;
+  }
+
+  setUint16(MessageOffset::Sequence, seq);
+}
+
+bool MessageBuilder::setPayload16(std::uint16_t value)
+{
+  if (length < MessageOffset::Payload ||
+      MessageSchema::type(buffer[MessageOffset::Type]).payload != MessageSchema::Payload::Value16) {
+    return false;
+  }
+
+  setUint16(MessageOffset::Payload, value);
+  return true;
+}
+
+bool MessageBuilder::append(const std::uint8_t* data, std::size_t size)
+{
+  if (length < MessageOffset::Payload || length + size > capacity ||
+      MessageSchema::type(buffer[MessageOffset::Type]).payload != MessageSchema::Payload::Bytes) {
+    return false;
+  }
+
+  std::memcpy(buffer + length, data, size);
+  length += size;
+  return true;
+}
+
+bool MessageBuilder::appendMessage(const MessageView& msg)
+{
+  if (length < MessageOffset::Payload || buffer[MessageOffset::Type] != MessageType::Batch ||
+      msg.size() == 0 || msg.size() > MSG_BATCH_ITEM_MAX_LEN || length + 1 + msg.size() > capacity) {
+    return false;
+  }
+
+  buffer[length] = static_cast<std::uint8_t>(msg.size());
+  std::memcpy(buffer + length + 1, msg.data(), msg.size());
+  length += 1 + msg.size();
+  return true;
+}
+
+bool MessageBuilder::setACK(std::uint16_t fullType, std::uint16_t cumulative, std::uint16_t sack)
+{
+  if (length < MessageSchema::type(MessageType::Ack).length) {
+    LOG_ERROR(Msg) << "Buffer too small for ACK message";
+    return false;
+  }
+
+  buffer[MessageOffset::Type] = MessageType::Ack;
+
+  // Set the type and possible subtype we are acking
+  buffer[MessageOffset::AckedType] = static_cast<std::uint8_t>(fullType >> 8);
+  buffer[MessageOffset::AckedSubtype] = static_cast<std::uint8_t>(fullType & 0xFF);
+
+  setUint16(MessageOffset::AckedSeq, cumulative);
+  setUint16(MessageOffset::AckedSack, sack);
+
+  return true;
+}
+
+bool MessageBuilder::setACK(const MessageView& incoming)
+{
+  return setACK(incoming.fullType(), incoming.seq(), 0);
+}
+
+bool MessageBuilder::setFragment(std::uint16_t id, std::uint8_t index, std::uint8_t count, std::uint32_t total)
+{
+  if (length < MessageOffset::FragmentData || buffer[MessageOffset::Type] != MessageType::Fragment) {
+    LOG_ERROR(Msg) << "Buffer is not a fragment message";
+    return false;
+  }
+
+  setUint16(MessageOffset::FragmentId, id);
+  buffer[MessageOffset::FragmentIndex] = index;
+  buffer[MessageOffset::FragmentCount] = count;
+  setUint32(MessageOffset::FragmentTotal, total);
+
+  return true;
+}
+
+bool MessageBuilder::setParity(std::uint16_t firstSeq, std::uint8_t count, std::uint16_t lengthXor)
+{
+  if (length < MessageOffset::ParityData || buffer[MessageOffset::Type] != MessageType::VideoParity) {
+    LOG_ERROR(Msg) << "Buffer is not a parity message";
+    return false;
+  }
+
+  setUint16(MessageOffset::ParityFirstSeq, firstSeq);
+  buffer[MessageOffset::ParityCount] = count;
+  setUint16(MessageOffset::ParityLength, lengthXor);
+
+  return true;
+}
+
+bool MessageBuilder::setReceiverReport(const ReceiverReport& report)
+{
+  if (length < MessageOffset::ReportEnd || buffer[MessageOffset::Type] != MessageType::ReceiverReport) {
+    LOG_ERROR(Msg) << "Buffer is not a receiver report message";
+    return false;
+  }
+
+  setUint16(MessageOffset::ReportHighestSeq, report.highestSeq);
+  buffer[MessageOffset::ReportFractionLost] = report.fractionLost;
+  setUint32(MessageOffset::ReportJitter, report.jitterUs);
+  setUint32(MessageOffset::ReportQueueDelay, report.queueDelayUs);
+  setUint32(MessageOffset::ReportDelayTrend, static_cast<std::uint32_t>(report.delayTrendUs));
+  setUint32(MessageOffset::ReportRate, report.rateBps);
+
+  return true;
+}
+
+std::size_t MessageBuilder::finish(Crc::Mode mode)
+{
+  if (length < MessageOffset::Payload) {
+    return 0;
+  }
+
+  setUint16(MessageOffset::CRC, Crc::checksumSkip(mode, buffer, length, MessageOffset::CRC));
+  return length;
+}
+
+void MessageBuilder::setUint16(std::size_t index, std::uint16_t value)
+{
+  buffer[index + 0] = (std::uint8_t)((value & 0xff00) >> 8);
+  buffer[index + 1] = (std::uint8_t)((value & 0x00ff) >> 0);
+}
+
+void MessageBuilder::setUint32(std::size_t index, std::uint32_t value)
+{
+  setUint16(index + 0, (std::uint16_t)(value >> 16));
+  setUint16(index + 2, (std::uint16_t)(value & 0xffff));
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Message.h"
+#include "MessageView.h"
+#include "Crc.h"
+#include "ReceiverReport.h"
+
+#include <cstdint>
+#include <cstddef>
+
+// Writes a message following the MessageOffset layout into storage
+// provided by the caller. Never allocates. All setters return false if
+// the storage is too small.
+class MessageBuilder {
+ public:
+  MessageBuilder(std::uint8_t* storage, std::size_t capacity);
+
+  // Continue a message of size bytes already built into storage
+  MessageBuilder(std::uint8_t* storage, std::size_t capacity, std::size_t size);
+
+  // Start a new message: zeroes the mandatory part and sets the type,
+  // sub type and the next sequence number for the full type.
+  bool begin(std::uint8_t type, std::uint8_t subType = 0);
+
+  void setSeq(std::uint16_t seq);
+  bool setPayload16(std::uint16_t value);
+  bool append(const std::uint8_t* data, std::size_t size);
+
+  // Add a complete message to a Batch message, prefixed with its 8 bit length
+  bool appendMessage(const MessageView& msg);
+
+  // Fill in an ACK of a stream up to a sequence number and the SACK
+  // bitmap of the messages received after it (begin(MessageType::Ack) first)
+  bool setACK(std::uint16_t fullType, std::uint16_t cumulative, std::uint16_t sack);
+
+  // Fill in an ACK of the stream up to the incoming message
+  bool setACK(const MessageView& incoming);
+
+  // Fill in the fragment header (begin(MessageType::Fragment) first), then append the data
+  bool setFragment(std::uint16_t id, std::uint8_t index, std::uint8_t count, std::uint32_t total);
+
+  // Fill in the parity header (begin(MessageType::VideoParity) first), then append the parity
+  bool setParity(std::uint16_t firstSeq, std::uint8_t count, std::uint16_t lengthXor);
+
+  // Fill in a receiver report (begin(MessageType::ReceiverReport) first)
+  bool setReceiverReport(const ReceiverReport& report);
+
+  // Calculate the CRC, returns the final message length
+  std::size_t finish(Crc::Mode mode = Crc::Mode::Crc16);
+
+  std::uint8_t* data(void) { return buffer; }
+  std::size_t size(void) const { return length; }
+
+ private:
+  void setUint16(std::size_t index, std::uint16_t value);
+  void setUint32(std::size_t index, std::uint32_t value);
+
+  std::uint8_t* buffer;
+  std::size_t capacity;
+  std::size_t length;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
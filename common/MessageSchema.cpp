@@ -0,0 +1,32 @@
+/*
+ * Copyright 2015-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MessageSchema.h"
+
+std::string MessageSchema::typeStr(std::uint16_t type)
+{
+  if (type < MSG_TYPE_MAX && MessageSchema::type(type).name) {
+    return MessageSchema::type(type).name;
+  }
+
+  return "UNKNOWN(" + std::to_string(type) + ")";
+}
+
+std::string MessageSchema::subTypeStr(std::uint16_t subType)
+{
+  if (subType < MSG_TYPE_MAX && MessageSchema::subType(subType).name) {
+    return MessageSchema::subType(subType).name;
+  }
+
+  return "UNKNOWN(" + std::to_string(subType) + ")";
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Message.h"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Compile-time description of every message type and sub type.
+// MessageView and MessageBuilder look up lengths, names, reliability and
+// priority here by array indexing instead of switch statements. A new sub
+// type is one line in the tables below. A new type is one line here and
+// its handler in Transmitter, which fails to compile without it.
+namespace MessageSchema {
+
+  // Payload layout after the common header
+  enum class Payload : std::uint8_t {
+    Unknown = 0,  // Not a valid type on the wire
+    None,         // No payload
+    Value16,      // 16 bit value
+    Bytes,        // Arbitrary length payload (after a fixed part, if any)
+    Ack,          // Acked type + sub type + cumulative sequence number + SACK bitmap
+  };
+
+  // Send priority class, Control is the most urgent
+  enum class Class : std::uint8_t {
+    Control = 0,
+    Telemetry,
+    Audio,
+    Video,
+  };
+
+  struct TypeInfo {
+    const char* name;       // nullptr if the type is unknown
+    std::uint8_t length;    // Fixed length, or minimum length for Bytes
+    Payload payload;
+    bool reliable;          // ACKed by the receiver and resent until ACKed
+    Class priority;
+  };
+
+  // Reliable index of a type that is not reliable
+  constexpr std::uint8_t NOT_RELIABLE = 0xFF;
+
+  // A sub type is the value a Value or PeriodicValue message carries,
+  // it takes the length, reliability and priority of that type
+  struct SubtypeInfo {
+    const char* name;       // nullptr if the sub type is unknown
+    std::uint8_t type;      // Value for commands, PeriodicValue for telemetry
+  };
+
+  namespace detail {
+
+    struct TypeEntry {
+      std::uint8_t type;
+      TypeInfo info;
+    };
+
+    struct SubtypeEntry {
+      std::uint16_t subType;
+      SubtypeInfo info;
+    };
+
+    constexpr std::uint8_t HEADER = MessageOffset::Payload;
+
+    constexpr TypeEntry typeEntries[] = {
+      { MessageType::None,           { "NONE",            0,           Payload::Unknown, false, Class::Control   } },
+      { MessageType::Ping,           { "PING",            HEADER + 0,  Payload::None,    true,  Class::Control   } },
+      { MessageType::Value,          { "VALUE",           HEADER + 2,  Payload::Value16, true,  Class::Control   } },
+      { MessageType::Stats,          { "STATS",           0,           Payload::Unknown, false, Class::Telemetry } },
+      { MessageType::Video,          { "VIDEO",           HEADER + 0,  Payload::Bytes,   false, Class::Video     } },
+      { MessageType::Audio,          { "AUDIO",           HEADER + 0,  Payload::Bytes,   false, Class::Audio     } },
+      { MessageType::Debug,          { "DEBUG",           HEADER + 0,  Payload::Bytes,   false, Class::Telemetry } },
+      { MessageType::PeriodicValue,  { "PERIODIC_VALUE",  HEADER + 2,  Payload::Value16, false, Class::Telemetry } },
+      { MessageType::Batch,          { "BATCH",           HEADER + 0,  Payload::Bytes,   false, Class::Telemetry } },
+      { MessageType::Fragment,       { "FRAGMENT",        HEADER + 8,  Payload::Bytes,   false, Class::Video     } },
+      { MessageType::VideoParity,    { "VIDEO_PARITY",    HEADER + 5,  Payload::Bytes,   false, Class::Video     } },
+      { MessageType::ReceiverReport, { "RECEIVER_REPORT", HEADER + 19, Payload::Bytes,   false, Class::Telemetry } },
+      { MessageType::Ack,            { "ACK",             HEADER + 6,  Payload::Ack,     false, Class::Control   } },
+    };
+
+    constexpr SubtypeEntry subtypeEntries[] = {
+      { MessageSubtype::None,           { "NONE",            MessageType::None          } },
+      { MessageSubtype::EnableLED,      { "ENABLE_LED",      MessageType::Value         } },
+      { MessageSubtype::EnableVideo,    { "ENABLED_VIDEO",   MessageType::Value         } },
+      { MessageSubtype::EnableAudio,    { "ENABLED_AUDIO",   MessageType::Value         } },
+      { MessageSubtype::VideoSource,    { "VIDEO_SOURCE",    MessageType::Value         } },
+      { MessageSubtype::CameraXY,       { "CAMERA_XY",       MessageType::Value         } },
+      { MessageSubtype::CameraZoom,     { "CAMERA_ZOOM",     MessageType::Value         } },
+      { MessageSubtype::CameraFocus,    { "CAMERA_FOCUS",    MessageType::Value         } },
+      { MessageSubtype::SpeedTurn,      { "SPEED_TURN",      MessageType::Value         } },
+      { MessageSubtype::BatteryCurrent, { "BATTERY_CURRENT", MessageType::PeriodicValue } },
+      { MessageSubtype::BatteryVoltage, { "BATTERY_VOLTAGE", MessageType::PeriodicValue } },
+      { MessageSubtype::Distance,       { "DISTANCE",        MessageType::PeriodicValue } },
+      { MessageSubtype::Temperature,    { "TEMPERATURE",     MessageType::PeriodicValue } },
+      { MessageSubtype::SignalStrength, { "SIGNAL_STRENGTH", MessageType::PeriodicValue } },
+      { MessageSubtype::CPUUsage,       { "CPU_USAGE",       MessageType::PeriodicValue } },
+      { MessageSubtype::VideoQuality,   { "VIDEO_QUALITY",   MessageType::Value         } },
+      { MessageSubtype::Uptime,         { "UPTIME",          MessageType::PeriodicValue } },
+      { MessageSubtype::PacerQueue,     { "PACER_QUEUE",     MessageType::PeriodicValue } },
+      { MessageSubtype::PacerDelay,     { "PACER_DELAY",     MessageType::PeriodicValue } },
+      { MessageSubtype::VideoBitrate,   { "VIDEO_BITRATE",   MessageType::PeriodicValue } },
+    };
+
+    constexpr std::array<TypeInfo, MSG_TYPE_MAX> makeTypes()
+    {
+      std::array<TypeInfo, MSG_TYPE_MAX> types{};
+      for (auto& info : types) {
+        info = { nullptr, 0, Payload::Unknown, false, Class::Telemetry };
+      }
+      for (const auto& entry : typeEntries) {
+        types[entry.type] = entry.info;
+      }
+      return types;
+    }
+
+    constexpr std::array<SubtypeInfo, MSG_TYPE_MAX> makeSubtypes()
+    {
+      std::array<SubtypeInfo, MSG_TYPE_MAX> subtypes{};
+      for (const auto& entry : subtypeEntries) {
+        subtypes[entry.subType] = entry.info;
+      }
+      return subtypes;
+    }
+
+    // Reliable types numbered 0..n-1 in type order, for dense per type tables
+    constexpr std::array<std::uint8_t, MSG_TYPE_MAX> makeReliableIndexes()
+    {
+      std::array<std::uint8_t, MSG_TYPE_MAX> indexes{};
+      std::array<TypeInfo, MSG_TYPE_MAX> types = makeTypes();
+      std::uint8_t next = 0;
+      for (std::size_t type = 0; type < MSG_TYPE_MAX; type++) {
+        indexes[type] = types[type].reliable ? next++ : NOT_RELIABLE;
+      }
+      return indexes;
+    }
+
+    // The wire convention is that types below MSG_HP_TYPE_LIMIT are ACKed
+    constexpr bool reliabilityMatchesTypeLimit()
+    {
+      for (const auto& entry : typeEntries) {
+        if (entry.info.payload != Payload::Unknown &&
+            entry.info.reliable != (entry.type < MSG_HP_TYPE_LIMIT)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Sub types travel in an 8 bit field
+    constexpr bool subtypesFitWire()
+    {
+      for (const auto& entry : subtypeEntries) {
+        if (entry.subType >= MSG_TYPE_MAX) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Every sub type is a command or telemetry value
+    constexpr bool subtypesHaveValueType()
+    {
+      for (const auto& entry : subtypeEntries) {
+        if (entry.subType != MessageSubtype::None &&
+            entry.info.type != MessageType::Value && entry.info.type != MessageType::PeriodicValue) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  static_assert(detail::reliabilityMatchesTypeLimit(),
+                "Reliable message types must be below MSG_HP_TYPE_LIMIT");
+  static_assert(detail::subtypesFitWire(), "Message sub types must fit in 8 bits");
+  static_assert(detail::subtypesHaveValueType(),
+                "Message sub types must be sent in Value or PeriodicValue messages");
+
+  inline constexpr std::array<TypeInfo, MSG_TYPE_MAX> types = detail::makeTypes();
+  inline constexpr std::array<SubtypeInfo, MSG_TYPE_MAX> subtypes = detail::makeSubtypes();
+  inline constexpr std::array<std::uint8_t, MSG_TYPE_MAX> reliableIndexes = detail::makeReliableIndexes();
+
+  constexpr const TypeInfo& type(std::uint8_t type)
+  {
+    return types[type];
+  }
+
+  constexpr const SubtypeInfo& subType(std::uint8_t subType)
+  {
+    return subtypes[subType];
+  }
+
+  // Index of a reliable type among the reliable types, NOT_RELIABLE otherwise
+  constexpr std::uint8_t reliableIndex(std::uint8_t type)
+  {
+    return reliableIndexes[type];
+  }
+
+  constexpr std::size_t reliableCount()
+  {
+    std::size_t count = 0;
+    for (const auto& info : types) {
+      if (info.reliable) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  // Longest message that is not of arbitrary length
+  constexpr std::size_t maxFixedLength()
+  {
+    std::size_t max = 0;
+    for (const auto& info : types) {
+      if (info.payload != Payload::Bytes && info.length > max) {
+        max = info.length;
+      }
+    }
+    return max;
+  }
+
+  // Name of a type or sub type for logging, UNKNOWN(n) if not in the tables
+  std::string typeStr(std::uint16_t type);
+  std::string subTypeStr(std::uint16_t subType);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MessageView.h"
+#include "MessageSchema.h"
+#include "Log.h"
+
+
+MessageView::MessageView(const std::uint8_t* data, std::size_t size) :
+  buffer(data),
+  length(size)
+{
+}
+
+std::uint8_t MessageView::type(void) const
+{
+  return length > MessageOffset::Type ? buffer[MessageOffset::Type] : MessageType::None;
+}
+
+std::uint8_t MessageView::subType(void) const
+{
+  return length > MessageOffset::Subtype ? buffer[MessageOffset::Subtype] : MessageSubtype::None;
+}
+
+std::uint16_t MessageView::fullType(void) const
+{
+  std::uint16_t fulltype = type();
+  fulltype <<= 8;
+  fulltype += subType();
+
+  return fulltype;
+}
+
+std::uint16_t MessageView::seq(void) const
+{
+  return getUint16(MessageOffset::Sequence);
+}
+
+std::uint16_t MessageView::crc(void) const
+{
+  return getUint16(MessageOffset::CRC);
+}
+
+bool MessageView::isValid(Crc::Mode mode) const
+{
+  // Size must be at least big enough to hold mandatory headers before payload
+  if (length < MessageOffset::Payload) {
+    LOG_ERROR(Msg) << "Invalid message length: " << length << ", discarding";
+    return false;
+  }
+
+  // Type must be known and size at least the minimum size for the type
+  const MessageSchema::TypeInfo& info = MessageSchema::type(type());
+  if (info.payload == MessageSchema::Payload::Unknown || length < info.length) {
+    LOG_ERROR(Msg) << "Invalid message length (" << length << ") for type "
+                   << MessageSchema::typeStr(type()) << ", discarding";
+    return false;
+  }
+
+  // CRC inside the message must match the CRC calculated without it
+  std::uint16_t calculated = Crc::checksumSkip(mode, buffer, length, MessageOffset::CRC);
+  if (calculated != crc()) {
+    LOG_DEBUG(Msg) << __func__ << ": Embedded CRC: 0x" << std::hex << crc()
+                   << ", calculated CRC: 0x" << calculated;
+    return false;
+  }
+
+  return true;
+}
+
+bool MessageView::isHighPriority(void) const
+{
+  // High priority messages are ACKed and resent (type < MSG_HP_TYPE_LIMIT)
+  return MessageSchema::type(type()).reliable;
+}
+
+const std::uint8_t* MessageView::payload(void) const
+{
+  return buffer + MessageOffset::Payload;
+}
+
+std::size_t MessageView::payloadSize(void) const
+{
+  return length > MessageOffset::Payload ? length - MessageOffset::Payload : 0;
+}
+
+std::uint16_t MessageView::getPayload16(void) const
+{
+  return getUint16(MessageOffset::Payload);
+}
+
+std::uint8_t MessageView::getAckedType(void) const
+{
+  // Return none as the type if the packet is not an ACK or is too short
+  if (type() != MessageType::Ack || length < MessageSchema::type(MessageType::Ack).length) {
+    return MessageType::None;
+  }
+
+  return buffer[MessageOffset::AckedType];
+}
+
+std::uint8_t MessageView::getAckedSubType(void) const
+{
+  // Return none as the sub type if the packet is not an ACK or is too short
+  if (type() != MessageType::Ack || length < MessageSchema::type(MessageType::Ack).length) {
+    return MessageSubtype::None;
+  }
+
+  return buffer[MessageOffset::AckedSubtype];
+}
+
+std::uint16_t MessageView::getAckedFullType(void) const
+{
+  std::uint16_t type = getAckedType();
+  type <<= 8;
+  type += getAckedSubType();
+
+  return type;
+}
+
+std::uint16_t MessageView::getAckedSeq(void) const
+{
+  return getUint16(MessageOffset::AckedSeq);
+}
+
+std::uint16_t MessageView::getAckedSack(void) const
+{
+  return getUint16(MessageOffset::AckedSack);
+}
+
+std::uint16_t MessageView::getFragmentId(void) const
+{
+  return type() == MessageType::Fragment ? getUint16(MessageOffset::FragmentId) : 0;
+}
+
+std::uint8_t MessageView::getFragmentIndex(void) const
+{
+  return type() == MessageType::Fragment && length > MessageOffset::FragmentIndex ?
+    buffer[MessageOffset::FragmentIndex] : 0;
+}
+
+std::uint8_t MessageView::getFragmentCount(void) const
+{
+  return type() == MessageType::Fragment && length > MessageOffset::FragmentCount ?
+    buffer[MessageOffset::FragmentCount] : 0;
+}
+
+std::uint32_t MessageView::getFragmentTotal(void) const
+{
+  if (type() != MessageType::Fragment) {
+    return 0;
+  }
+
+  return (((std::uint32_t)getUint16(MessageOffset::FragmentTotal)) << 16) +
+    getUint16(MessageOffset::FragmentTotal + 2);
+}
+
+const std::uint8_t* MessageView::fragmentData(void) const
+{
+  return buffer + MessageOffset::FragmentData;
+}
+
+std::size_t MessageView::fragmentSize(void) const
+{
+  return type() == MessageType::Fragment && length > MessageOffset::FragmentData ?
+    length - MessageOffset::FragmentData : 0;
+}
+
+std::uint16_t MessageView::getParityFirstSeq(void) const
+{
+  return type() == MessageType::VideoParity ? getUint16(MessageOffset::ParityFirstSeq) : 0;
+}
+
+std::uint8_t MessageView::getParityCount(void) const
+{
+  return type() == MessageType::VideoParity && length > MessageOffset::ParityCount ?
+    buffer[MessageOffset::ParityCount] : 0;
+}
+
+std::uint16_t MessageView::getParityLength(void) const
+{
+  return type() == MessageType::VideoParity ? getUint16(MessageOffset::ParityLength) : 0;
+}
+
+const std::uint8_t* MessageView::parityData(void) const
+{
+  return buffer + MessageOffset::ParityData;
+}
+
+std::size_t MessageView::paritySize(void) const
+{
+  return type() == MessageType::VideoParity && length > MessageOffset::ParityData ?
+    length - MessageOffset::ParityData : 0;
+}
+
+bool MessageView::getReceiverReport(ReceiverReport& report) const
+{
+  if (type() != MessageType::ReceiverReport || length < MessageOffset::ReportEnd) {
+    return false;
+  }
+
+  report.highestSeq = getUint16(MessageOffset::ReportHighestSeq);
+  report.fractionLost = buffer[MessageOffset::ReportFractionLost];
+  report.jitterUs = getUint32(MessageOffset::ReportJitter);
+  report.queueDelayUs = getUint32(MessageOffset::ReportQueueDelay);
+  report.delayTrendUs = static_cast<std::int32_t>(getUint32(MessageOffset::ReportDelayTrend));
+  report.rateBps = getUint32(MessageOffset::ReportRate);
+
+  return true;
+}
+
+bool MessageView::nextBatched(std::size_t& offset, MessageView& item) const
+{
+  if (type() != MessageType::Batch) {
+    return false;
+  }
+
+  // Each message is prefixed with its 8 bit length
+  std::size_t pos = MessageOffset::Payload + offset;
+  if (pos >= length || buffer[pos] == 0 || pos + 1 + buffer[pos] > length) {
+    return false;
+  }
+
+  item = MessageView(buffer + pos + 1, buffer[pos]);
+  offset += 1 + buffer[pos];
+  return true;
+}
+
+std::uint16_t MessageView::getUint16(std::size_t index) const
+{
+  if (index + 1 >= length) {
+    return 0;
+  }
+
+  return (((std::uint16_t)buffer[index]) << 8) + buffer[index + 1];
+}
+
+std::uint32_t MessageView::getUint32(std::size_t index) const
+{
+  return (((std::uint32_t)getUint16(index)) << 16) + getUint16(index + 2);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
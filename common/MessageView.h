@@ -0,0 +1,79 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Message.h"
+#include "Crc.h"
+#include "ReceiverReport.h"
+
+#include <cstdint>
+#include <cstddef>
+
+// Read-only view of a message stored elsewhere, e.g. a datagram in the
+// receive buffer. Follows the MessageOffset layout, never copies or
+// allocates. The viewed data must outlive the view.
+class MessageView {
+ public:
+  MessageView(const std::uint8_t* data, std::size_t size);
+
+  const std::uint8_t* data(void) const { return buffer; }
+  std::size_t size(void) const { return length; }
+
+  std::uint8_t type(void) const;
+  std::uint8_t subType(void) const;
+  std::uint16_t fullType(void) const;
+  std::uint16_t seq(void) const;
+  std::uint16_t crc(void) const;
+  bool isValid(Crc::Mode mode = Crc::Mode::Crc16) const;
+  bool isHighPriority(void) const;
+
+  const std::uint8_t* payload(void) const;
+  std::size_t payloadSize(void) const;
+  std::uint16_t getPayload16(void) const;
+
+  std::uint8_t getAckedType(void) const;
+  std::uint8_t getAckedSubType(void) const;
+  std::uint16_t getAckedFullType(void) const;
+  std::uint16_t getAckedSeq(void) const;
+  std::uint16_t getAckedSack(void) const;
+
+  // Fragment header, zero if the message is not a fragment
+  std::uint16_t getFragmentId(void) const;
+  std::uint8_t getFragmentIndex(void) const;
+  std::uint8_t getFragmentCount(void) const;
+  std::uint32_t getFragmentTotal(void) const;
+  const std::uint8_t* fragmentData(void) const;
+  std::size_t fragmentSize(void) const;
+
+  // Parity header, zero if the message is not a parity message
+  std::uint16_t getParityFirstSeq(void) const;
+  std::uint8_t getParityCount(void) const;
+  std::uint16_t getParityLength(void) const;
+  const std::uint8_t* parityData(void) const;
+  std::size_t paritySize(void) const;
+
+  // Receiver report fields, false if the message is not a receiver report
+  bool getReceiverReport(ReceiverReport& report) const;
+
+  // Iterate the messages packed in a Batch message. Start with offset 0,
+  // returns false when there are no more complete messages.
+  bool nextBatched(std::size_t& offset, MessageView& item) const;
+
+ private:
+  std::uint16_t getUint16(std::size_t index) const;
+  std::uint32_t getUint32(std::size_t index) const;
+
+  const std::uint8_t* buffer;
+  std::size_t length;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Metrics.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace Metrics {
+
+  // Quantiles exported for each histogram
+  static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+  Counter::Counter() :
+    count(0)
+  {
+  }
+
+  Gauge::Gauge() :
+    current(0)
+  {
+  }
+
+  Histogram::Histogram() :
+    buckets(),
+    count(0),
+    sum(0),
+    max(0)
+  {
+    for (auto& bucket : buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  std::size_t Histogram::bucketIndex(std::uint64_t value)
+  {
+    // The values below the first power of two are exact
+    if (value < HISTOGRAM_SUBS) {
+      return static_cast<std::size_t>(value);
+    }
+
+    unsigned exponent = 63 - __builtin_clzll(value);
+    if (exponent >= HISTOGRAM_MAX_BITS) {
+      return HISTOGRAM_BUCKETS - 1;
+    }
+
+    std::size_t sub = (value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUBS - 1);
+    return HISTOGRAM_SUBS * (exponent - HISTOGRAM_SUB_BITS + 1) + sub;
+  }
+
+  std::uint64_t Histogram::bucketValue(std::size_t index)
+  {
+    if (index < HISTOGRAM_SUBS) {
+      return index;
+    }
+
+    // The middle of the bucket's range
+    unsigned exponent = static_cast<unsigned>(index / HISTOGRAM_SUBS) + HISTOGRAM_SUB_BITS - 1;
+    std::uint64_t sub = index % HISTOGRAM_SUBS;
+    std::uint64_t width = 1ULL << (exponent - HISTOGRAM_SUB_BITS);
+    return (1ULL << exponent) + sub * width + width / 2;
+  }
+
+  void Histogram::record(std::uint64_t value)
+  {
+    buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t previous = max.load(std::memory_order_relaxed);
+    while (value > previous &&
+           !max.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::uint64_t Histogram::getCount(void) const
+  {
+    return count.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t Histogram::getSum(void) const
+  {
+    return sum.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t Histogram::getMax(void) const
+  {
+    return max.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t Histogram::quantile(double fraction) const
+  {
+    // The buckets are summed, not count, as they may be updated meanwhile
+    std::uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+      total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+      return 0;
+    }
+
+    std::uint64_t rank = static_cast<std::uint64_t>(fraction * total);
+    if (rank >= total) {
+      rank = total - 1;
+    }
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+      seen += buckets[i].load(std::memory_order_relaxed);
+      if (seen > rank) {
+        return std::min(bucketValue(i), getMax());
+      }
+    }
+
+    return getMax();
+  }
+
+  Registry::Registry() :
+    mutex(),
+    families()
+  {
+  }
+
+  Registry::~Registry()
+  {
+  }
+
+  Registry::Metric& Registry::find(const std::string& name, const std::string& help,
+                                   const std::string& labels, Kind kind)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Family* family = nullptr;
+    for (auto& existing : families) {
+      if (existing->name == name) {
+        family = existing.get();
+        break;
+      }
+    }
+
+    if (!family) {
+      families.push_back(std::make_unique<Family>());
+      family = families.back().get();
+      family->name = name;
+      family->help = help;
+      family->kind = kind;
+    }
+
+    Metric* metric = nullptr;
+    for (auto& existing : family->metrics) {
+      if (existing->labels == labels) {
+        metric = existing.get();
+        break;
+      }
+    }
+
+    if (!metric) {
+      family->metrics.push_back(std::make_unique<Metric>());
+      metric = family->metrics.back().get();
+      metric->labels = labels;
+    }
+
+    // Only the kind registered first is exported, but the caller asking
+    // for another kind still gets a valid metric
+    if (kind != family->kind) {
+      LOG_WARN(Main) << "Metric " << name << " registered as a different type";
+    }
+
+    for (Kind create : { family->kind, kind }) {
+      switch (create) {
+      case Kind::Counter:
+        if (!metric->counter) {
+          metric->counter = std::make_unique<Counter>();
+        }
+        break;
+      case Kind::Gauge:
+        if (!metric->gauge) {
+          metric->gauge = std::make_unique<Gauge>();
+        }
+        break;
+      case Kind::Histogram:
+        if (!metric->histogram) {
+          metric->histogram = std::make_unique<Histogram>();
+        }
+        break;
+      }
+    }
+
+    return *metric;
+  }
+
+  Counter& Registry::counter(const std::string& name, const std::string& help, const std::string& labels)
+  {
+    return *find(name, help, labels, Kind::Counter).counter;
+  }
+
+  Gauge& Registry::gauge(const std::string& name, const std::string& help, const std::string& labels)
+  {
+    return *find(name, help, labels, Kind::Gauge).gauge;
+  }
+
+  Histogram& Registry::histogram(const std::string& name, const std::string& help, const std::string& labels)
+  {
+    return *find(name, help, labels, Kind::Histogram).histogram;
+  }
+
+  // name{labels,extra}
+  static std::string series(const std::string& name, const std::string& labels, const std::string& extra = "")
+  {
+    std::string joined = labels;
+    if (!extra.empty()) {
+      if (!joined.empty()) {
+        joined += ",";
+      }
+      joined += extra;
+    }
+
+    if (joined.empty()) {
+      return name;
+    }
+    return name + "{" + joined + "}";
+  }
+
+  std::string Registry::format(void) const
+  {
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto& family : families) {
+      out << "# HELP " << family->name << " " << family->help << "\n";
+
+      switch (family->kind) {
+      case Kind::Counter:
+        out << "# TYPE " << family->name << " counter\n";
+        for (const auto& metric : family->metrics) {
+          out << series(family->name, metric->labels) << " " << metric->counter->get() << "\n";
+        }
+        break;
+      case Kind::Gauge:
+        out << "# TYPE " << family->name << " gauge\n";
+        for (const auto& metric : family->metrics) {
+          out << series(family->name, metric->labels) << " " << metric->gauge->get() << "\n";
+        }
+        break;
+      case Kind::Histogram:
+        // The quantiles are computed here, hence a summary
+        out << "# TYPE " << family->name << " summary\n";
+        for (const auto& metric : family->metrics) {
+          const Histogram& histogram = *metric->histogram;
+          for (double q : QUANTILES) {
+            std::ostringstream quantile;
+            quantile << "quantile=\"" << q << "\"";
+            out << series(family->name, metric->labels, quantile.str()) << " "
+                << histogram.quantile(q) << "\n";
+          }
+          out << series(family->name + "_sum", metric->labels) << " " << histogram.getSum() << "\n";
+          out << series(family->name + "_count", metric->labels) << " " << histogram.getCount() << "\n";
+        }
+        break;
+      }
+    }
+
+    return out.str();
+  }
+
+  Registry& registry(void)
+  {
+    static Registry instance;
+    return instance;
+  }
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process wide metrics. The components register their metrics once and
+// keep the returned references, updating them is a relaxed atomic
+// operation. A snapshot is formatted in the Prometheus text format.
+namespace Metrics {
+
+  // Histogram buckets: 16 linear sub buckets per power of two keep the
+  // relative error below 1/16, as in HdrHistogram, up to 2^40.
+  constexpr unsigned HISTOGRAM_SUB_BITS   = 4;
+  constexpr std::size_t HISTOGRAM_SUBS    = 1U << HISTOGRAM_SUB_BITS;
+  constexpr unsigned HISTOGRAM_MAX_BITS   = 40;
+  constexpr std::size_t HISTOGRAM_BUCKETS = HISTOGRAM_SUBS * (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1);
+
+  // Monotonically increasing count
+  class Counter
+  {
+   public:
+    Counter();
+
+    void add(std::uint64_t value = 1)
+    {
+      count.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t get(void) const
+    {
+      return count.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<std::uint64_t> count;
+  };
+
+  // Value that goes up and down
+  class Gauge
+  {
+   public:
+    Gauge();
+
+    void set(std::int64_t value)
+    {
+      current.store(value, std::memory_order_relaxed);
+    }
+
+    void add(std::int64_t value)
+    {
+      current.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    std::int64_t get(void) const
+    {
+      return current.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<std::int64_t> current;
+  };
+
+  // Distribution of e.g. latencies in microseconds, exported as quantiles
+  class Histogram
+  {
+   public:
+    Histogram();
+
+    void record(std::uint64_t value);
+
+    std::uint64_t getCount(void) const;
+    std::uint64_t getSum(void) const;
+    std::uint64_t getMax(void) const;
+
+    // Value below which the given fraction of the recorded values are
+    std::uint64_t quantile(double fraction) const;
+
+   private:
+    static std::size_t bucketIndex(std::uint64_t value);
+    static std::uint64_t bucketValue(std::size_t index);
+
+    std::array<std::atomic<std::uint64_t>, HISTOGRAM_BUCKETS> buckets;
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max;
+  };
+
+  class Registry
+  {
+   public:
+    Registry();
+    ~Registry();
+
+    // The metric with the given name and labels, created on first use.
+    // Labels are in the Prometheus form, e.g. type="Value". The returned
+    // references stay valid for the life of the process.
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // All the metrics in the Prometheus text exposition format
+    std::string format(void) const;
+
+   private:
+    enum class Kind {
+      Counter,
+      Gauge,
+      Histogram,
+    };
+
+    struct Metric {
+      std::string labels;
+      std::unique_ptr<Counter> counter;
+      std::unique_ptr<Gauge> gauge;
+      std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family {
+      std::string name;
+      std::string help;
+      Kind kind;
+      std::vector<std::unique_ptr<Metric>> metrics;
+    };
+
+    Metric& find(const std::string& name, const std::string& help, const std::string& labels, Kind kind);
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Family>> families;
+  };
+
+  // The registry of this process
+  Registry& registry(void);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
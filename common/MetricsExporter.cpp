@@ -0,0 +1,180 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MetricsExporter.h"
+#include "Metrics.h"
+#include "Log.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <unistd.h>
+
+// How long to wait for a request before sending the plain snapshot
+constexpr int METRICS_REQUEST_TIMEOUT_MS = 200;
+constexpr std::size_t METRICS_REQUEST_MAX_LEN = 512;
+
+// One scrape, alive until the reply has been written
+class MetricsSession : public std::enable_shared_from_this<MetricsSession>
+{
+ public:
+  MetricsSession(const EventLoop::Strand& strand) :
+    socket(strand),
+    timer(strand),
+    request(),
+    reply(),
+    replied(false)
+  {
+  }
+
+  MetricsExporter::Socket& getSocket(void)
+  {
+    return socket;
+  }
+
+  void start(void)
+  {
+    auto self = shared_from_this();
+
+    // Clients that send nothing get the snapshot after a while
+    timer.expires_after(std::chrono::milliseconds(METRICS_REQUEST_TIMEOUT_MS));
+    timer.async_wait([self](const asio::error_code& error) {
+      if (!error) {
+        self->respond(0);
+      }
+    });
+
+    socket.async_read_some(asio::buffer(request), [self](const asio::error_code&, std::size_t length) {
+      self->respond(length);
+    });
+  }
+
+ private:
+  void respond(std::size_t length)
+  {
+    if (replied) {
+      return;
+    }
+    replied = true;
+    timer.cancel();
+
+    std::string body = Metrics::registry().format();
+    std::string received(request.data(), length);
+    if (received.compare(0, 4, "GET ") == 0) {
+      reply = "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n" + body;
+    } else {
+      reply = std::move(body);
+    }
+
+    auto self = shared_from_this();
+    asio::async_write(socket, asio::buffer(reply), [self](const asio::error_code&, std::size_t) {
+      asio::error_code ec;
+      self->socket.shutdown(asio::socket_base::shutdown_both, ec);
+      self->socket.close(ec);
+    });
+  }
+
+  MetricsExporter::Socket socket;
+  EventLoop::StrandTimer timer;
+  std::array<char, METRICS_REQUEST_MAX_LEN> request;
+  std::string reply;
+  bool replied;
+};
+
+MetricsExporter::MetricsExporter(EventLoop& eventLoop, const std::string& path) :
+  eventLoop(eventLoop),
+  path(path),
+  strand(eventLoop.makeStrand()),
+  acceptor(strand)
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+  if (acceptor.is_open()) {
+    asio::error_code ec;
+    acceptor.close(ec);
+    unlink(path.c_str());
+  }
+}
+
+bool MetricsExporter::start(void)
+{
+  asio::error_code ec;
+  asio::local::stream_protocol::endpoint endpoint(path);
+
+  // A socket file left behind by a previous run would fail the bind, but
+  // one another process still listens on is not taken over
+  Socket probe(strand);
+  probe.connect(endpoint, ec);
+  if (!ec) {
+    LOG_ERROR(Main) << "Metrics socket " << path << " is in use by another process";
+    return false;
+  }
+  if (ec == asio::error::connection_refused) {
+    unlink(path.c_str());
+  } else if (ec.value() != ENOENT) {
+    LOG_ERROR(Main) << "Failed to check the metrics socket " << path << ": " << ec.message();
+    return false;
+  }
+
+  ec.clear();
+  acceptor.open(endpoint.protocol(), ec);
+  if (!ec) {
+    acceptor.bind(endpoint, ec);
+  }
+  if (!ec) {
+    acceptor.listen(asio::socket_base::max_listen_connections, ec);
+  }
+  if (ec) {
+    LOG_ERROR(Main) << "Failed to listen for metrics on " << path << ": " << ec.message();
+    acceptor.close(ec);
+    return false;
+  }
+
+  LOG_INFO(Main) << "Exporting metrics on " << path;
+  asio::post(strand, [this]() { accept(); });
+  return true;
+}
+
+std::string MetricsExporter::pathFromEnvironment(const std::string& defaultPath)
+{
+  const char* env = std::getenv("PLECO_METRICS_SOCKET");
+  if (env) {
+    return env;
+  }
+  return defaultPath;
+}
+
+void MetricsExporter::accept(void)
+{
+  auto session = std::make_shared<MetricsSession>(eventLoop.makeStrand());
+  acceptor.async_accept(session->getSocket(), [this, session](const asio::error_code& error) {
+    if (error == asio::error::operation_aborted) {
+      return;
+    }
+
+    if (error) {
+      LOG_WARN(Main) << "Failed to accept a metrics client: " << error.message();
+    } else {
+      session->start();
+    }
+
+    accept();
+  });
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Event.h"
+
+#include <string>
+
+// Serves the metrics registry on a local Unix socket. A client connecting
+// gets a snapshot in the Prometheus text format and the connection is
+// closed. A client sending an HTTP GET first, e.g.
+// "curl --unix-socket /tmp/pleco-slave.sock http://localhost/metrics",
+// gets the snapshot with an HTTP header.
+class MetricsExporter
+{
+ public:
+  using Acceptor = asio::basic_socket_acceptor<asio::local::stream_protocol, EventLoop::Strand>;
+  using Socket = asio::basic_stream_socket<asio::local::stream_protocol, EventLoop::Strand>;
+
+  MetricsExporter(EventLoop& eventLoop, const std::string& path);
+  ~MetricsExporter();
+
+  // Start listening, replacing a socket left behind by an earlier run
+  bool start(void);
+
+  // The socket path from PLECO_METRICS_SOCKET, or the given default.
+  // Empty if set empty to disable the exporter.
+  static std::string pathFromEnvironment(const std::string& defaultPath);
+
+ private:
+  void accept(void);
+
+  EventLoop& eventLoop;
+  std::string path;
+  EventLoop::Strand strand;
+  Acceptor acceptor;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ReceiveWindow.h"
+
+ReceiveWindow::ReceiveWindow() :
+  streams()
+{
+  clear();
+}
+
+void ReceiveWindow::clear(void)
+{
+  for (Stream& stream : streams) {
+    stream.started = false;
+    stream.highest = 0;
+    stream.cumulative = 0;
+    stream.sack = 0;
+  }
+}
+
+std::size_t ReceiveWindow::streamIndex(std::uint16_t fullType)
+{
+  std::uint8_t index = MessageSchema::reliableIndex(fullType >> 8);
+  if (index == MessageSchema::NOT_RELIABLE) {
+    return INFLIGHT_STREAMS;
+  }
+  return index * MSG_TYPE_MAX + (fullType & 0xFF);
+}
+
+void ReceiveWindow::advance(Stream& stream, std::uint16_t count)
+{
+  stream.cumulative += count;
+  stream.sack = count < RX_SACK_BITS ? static_cast<std::uint16_t>(stream.sack >> count) : 0;
+
+  // Fold in the messages already received right after the new point
+  while (stream.sack & 1) {
+    stream.cumulative++;
+    stream.sack >>= 1;
+  }
+}
+
+bool ReceiveWindow::receive(std::uint16_t fullType, std::uint16_t seq)
+{
+  std::size_t index = streamIndex(fullType);
+  if (index == INFLIGHT_STREAMS) {
+    return true;
+  }
+  Stream* stream = &streams[index];
+
+  std::int16_t ahead = static_cast<std::int16_t>(seq - stream->highest);
+
+  if (!stream->started || ahead < -RX_RESYNC_DISTANCE) {
+    stream->started = true;
+    stream->highest = seq;
+    stream->cumulative = seq;
+    stream->sack = 0;
+    return true;
+  }
+
+  // Already received, or given up on
+  std::int16_t offset = static_cast<std::int16_t>(seq - stream->cumulative);
+  if (offset <= 0) {
+    return false;
+  }
+
+  if (ahead > 0) {
+    stream->highest = seq;
+
+    // The peer no longer resends messages a window behind the newest
+    std::int16_t behind = static_cast<std::int16_t>(seq - stream->cumulative - INFLIGHT_WINDOW);
+    if (behind > 0) {
+      advance(*stream, static_cast<std::uint16_t>(behind));
+      offset = static_cast<std::int16_t>(seq - stream->cumulative);
+    }
+  }
+
+  if (offset == 1) {
+    advance(*stream, 1);
+  } else if (static_cast<std::size_t>(offset) <= RX_SACK_BITS) {
+    stream->sack |= static_cast<std::uint16_t>(1U << (offset - 1));
+  }
+
+  return ahead > 0;
+}
+
+bool ReceiveWindow::ack(std::uint16_t fullType, std::uint16_t& cumulative, std::uint16_t& sack) const
+{
+  std::size_t index = streamIndex(fullType);
+  if (index == INFLIGHT_STREAMS || !streams[index].started) {
+    return false;
+  }
+
+  cumulative = streams[index].cumulative;
+  sack = streams[index].sack;
+  return true;
+}
+
+bool ReceiveWindow::isAcked(std::uint16_t seq, std::uint16_t cumulative, std::uint16_t sack)
+{
+  std::int16_t offset = static_cast<std::int16_t>(seq - cumulative);
+  if (offset <= 0) {
+    return true;
+  }
+
+  return static_cast<std::size_t>(offset) <= RX_SACK_BITS && (sack & (1U << (offset - 1)));
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "InFlightTable.h"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// Messages after the cumulative ACK point reported in the SACK bitmap
+constexpr std::size_t RX_SACK_BITS = 16U;
+
+// A message this much older than the newest one received means the peer
+// started over with new sequence numbers
+constexpr std::int16_t RX_RESYNC_DISTANCE = 64;
+
+static_assert(INFLIGHT_WINDOW <= RX_SACK_BITS, "SACK bitmap must cover the send window");
+static_assert(static_cast<std::size_t>(RX_RESYNC_DISTANCE) > INFLIGHT_WINDOW,
+              "Resends must not look like a restarted peer");
+
+// Sequence numbers of the received reliable messages per stream, for the
+// ACKs. An ACK carries a cumulative sequence number, up to which all
+// messages of the stream were received, and a bitmap of the messages
+// received after it: bit i is message cumulative + 1 + i.
+//
+// The peer keeps resending only the last INFLIGHT_WINDOW messages of a
+// stream, so older gaps are given up on and the cumulative point moves
+// past them.
+class ReceiveWindow
+{
+ public:
+  ReceiveWindow();
+
+  // Account a received reliable message. Returns true if it's the newest
+  // of its stream so far, false for a late or duplicate copy that should
+  // not override the newer state.
+  bool receive(std::uint16_t fullType, std::uint16_t seq);
+
+  // Cumulative sequence number and SACK bitmap to send in an ACK, false
+  // if nothing of the stream was received
+  bool ack(std::uint16_t fullType, std::uint16_t& cumulative, std::uint16_t& sack) const;
+
+  // Forget everything, e.g. when the peer may have restarted
+  void clear(void);
+
+  // Whether an ACK covers the message
+  static bool isAcked(std::uint16_t seq, std::uint16_t cumulative, std::uint16_t sack);
+
+ private:
+  struct Stream {
+    bool started;
+    std::uint16_t highest;      // Newest message received
+    std::uint16_t cumulative;   // All up to this received or given up on
+    std::uint16_t sack;
+  };
+
+  // Stream of a reliable full type, INFLIGHT_STREAMS if not reliable
+  static std::size_t streamIndex(std::uint16_t fullType);
+
+  void advance(Stream& stream, std::uint16_t count);
+
+  std::array<Stream, INFLIGHT_STREAMS> streams;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ReceiverReport.h"
+
+#include <algorithm>
+#include <limits>
+
+// Fixed part of an RTP header
+constexpr std::size_t RTP_HEADER_LEN = 12U;
+constexpr std::uint8_t RTP_VERSION   = 2U;
+
+constexpr std::int64_t NO_DELAY = std::numeric_limits<std::int64_t>::max();
+
+RtpReceiveStats::RtpReceiveStats(std::uint32_t clockRate) :
+  clockRate(clockRate),
+  start(),
+  started(false),
+  maxSeq(0),
+  cycles(0),
+  reportedExtSeq(0),
+  received(0),
+  receivedBytes(0),
+  reportTime(),
+  lastArrival(),
+  lastTimestamp(0),
+  timestamp(0),
+  lastTransit(0),
+  jitter(0),
+  frameTimestamp(0),
+  frameDelayUs(0),
+  frameArrival(),
+  smoothedDelayUs(0),
+  trendTime(),
+  trendDelay(),
+  trendCount(0),
+  trendNext(0),
+  minDelayUs(),
+  minDelayNext(0),
+  reportMinDelayUs(NO_DELAY)
+{
+  minDelayUs.fill(NO_DELAY);
+}
+
+bool RtpReceiveStats::packet(const std::uint8_t* data, std::size_t size, Clock::time_point now)
+{
+  if (size < RTP_HEADER_LEN || (data[0] >> 6) != RTP_VERSION) {
+    return false;
+  }
+
+  std::uint16_t seq = static_cast<std::uint16_t>((data[2] << 8) | data[3]);
+  std::uint32_t ts = (static_cast<std::uint32_t>(data[4]) << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+
+  if (started && jumped(seq, ts, now)) {
+    *this = RtpReceiveStats(clockRate);
+  }
+
+  bool first = !started;
+  if (first) {
+    started = true;
+    start = now;
+    reportTime = now;
+    maxSeq = seq;
+    reportedExtSeq = static_cast<std::uint32_t>(seq) - 1;
+    lastTimestamp = ts;
+  } else {
+    // A newer sequence number, counting the wraps
+    std::uint16_t delta = static_cast<std::uint16_t>(seq - maxSeq);
+    if (delta != 0 && delta < 0x8000) {
+      if (seq < maxSeq) {
+        cycles += 0x10000;
+      }
+      maxSeq = seq;
+    }
+
+    timestamp += static_cast<std::int32_t>(ts - lastTimestamp);
+    lastTimestamp = ts;
+  }
+
+  received++;
+  receivedBytes += static_cast<std::uint32_t>(size);
+  lastArrival = now;
+
+  // Interarrival jitter in RTP clock units (RFC 3550, 6.4.1)
+  std::int64_t arrivalUs = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+  std::int64_t transit = arrivalUs * clockRate / 1000000 - timestamp;
+  if (first) {
+    lastTransit = transit;
+  }
+  std::int64_t d = transit > lastTransit ? transit - lastTransit : lastTransit - transit;
+  lastTransit = transit;
+  jitter += (d - jitter) / 16.0;
+
+  // The last packet of a frame gives the delay of the frame. Late packets
+  // of older frames are ignored.
+  std::int64_t delayUs = arrivalUs - timestamp * 1000000 / clockRate;
+  if (timestamp > frameTimestamp) {
+    if (frameArrival != Clock::time_point()) {
+      frameDelay(frameDelayUs, frameArrival);
+    }
+    frameTimestamp = timestamp;
+  }
+  if (timestamp == frameTimestamp) {
+    frameDelayUs = delayUs;
+    frameArrival = now;
+  }
+
+  return true;
+}
+
+bool RtpReceiveStats::jumped(std::uint16_t seq, std::uint32_t ts, Clock::time_point now) const
+{
+  // Far from the highest sequence number in either direction
+  std::uint16_t delta = static_cast<std::uint16_t>(seq - maxSeq);
+  if (delta >= RR_MAX_DROPOUT && delta < 0x10000 - RR_MAX_MISORDER) {
+    return true;
+  }
+
+  // Within a stream the timestamps advance with the arrival times, apart
+  // from jitter. Arrivals late after a stall only fall behind.
+  std::int64_t advanceUs = static_cast<std::int64_t>(static_cast<std::int32_t>(ts - lastTimestamp)) *
+    1000000 / clockRate;
+  std::int64_t elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(now - lastArrival).count();
+  return advanceUs - elapsedUs > RR_MAX_AHEAD_US;
+}
+
+void RtpReceiveStats::frameDelay(std::int64_t delayUs, Clock::time_point arrival)
+{
+  // Smooth the delay before fitting the trend
+  if (trendCount == 0) {
+    smoothedDelayUs = static_cast<double>(delayUs);
+  } else {
+    smoothedDelayUs = 0.9 * smoothedDelayUs + 0.1 * delayUs;
+  }
+
+  trendTime[trendNext] = std::chrono::duration<double>(arrival - start).count();
+  trendDelay[trendNext] = smoothedDelayUs;
+  trendNext = (trendNext + 1) % RR_TREND_FRAMES;
+  trendCount = std::min(trendCount + 1, RR_TREND_FRAMES);
+
+  reportMinDelayUs = std::min(reportMinDelayUs, delayUs);
+}
+
+bool RtpReceiveStats::report(ReceiverReport& report, Clock::time_point now)
+{
+  if (!started || received == 0) {
+    reportTime = now;
+    return false;
+  }
+
+  // Loss since the previous report, duplicates may make it negative
+  std::uint32_t extSeq = cycles + maxSeq;
+  std::uint32_t expected = extSeq - reportedExtSeq;
+  std::uint32_t lost = expected > received ? expected - received : 0;
+  reportedExtSeq = extSeq;
+
+  report.highestSeq = maxSeq;
+  report.fractionLost = static_cast<std::uint8_t>(expected > 0 ? std::min<std::uint64_t>(255, lost * 256ULL / expected) : 0);
+  report.jitterUs = static_cast<std::uint32_t>(jitter * 1000000 / clockRate);
+
+  // Queuing delay above the lowest delay seen within the window
+  minDelayUs[minDelayNext] = reportMinDelayUs;
+  minDelayNext = (minDelayNext + 1) % RR_MIN_DELAY_REPORTS;
+  reportMinDelayUs = NO_DELAY;
+
+  std::int64_t minDelay = *std::min_element(minDelayUs.begin(), minDelayUs.end());
+  report.queueDelayUs = 0;
+  if (trendCount > 0 && minDelay != NO_DELAY && smoothedDelayUs > minDelay) {
+    report.queueDelayUs = static_cast<std::uint32_t>(smoothedDelayUs - minDelay);
+  }
+
+  // Least squares slope of the smoothed delay over the recent frames
+  report.delayTrendUs = 0;
+  if (trendCount >= 2) {
+    double meanTime = 0;
+    double meanDelay = 0;
+    for (std::size_t i = 0; i < trendCount; i++) {
+      meanTime += trendTime[i];
+      meanDelay += trendDelay[i];
+    }
+    meanTime /= trendCount;
+    meanDelay /= trendCount;
+
+    double numerator = 0;
+    double denominator = 0;
+    for (std::size_t i = 0; i < trendCount; i++) {
+      numerator += (trendTime[i] - meanTime) * (trendDelay[i] - meanDelay);
+      denominator += (trendTime[i] - meanTime) * (trendTime[i] - meanTime);
+    }
+    if (denominator > 0) {
+      report.delayTrendUs = static_cast<std::int32_t>(numerator / denominator);
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(now - reportTime).count();
+  report.rateBps = seconds > 0 ? static_cast<std::uint32_t>(receivedBytes * 8 / seconds) : 0;
+
+  received = 0;
+  receivedBytes = 0;
+  reportTime = now;
+
+  return true;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Receiver reports are sent this often while video is received
+constexpr int RR_INTERVAL_MS = 100;
+
+// RTP clock of H.264 video
+constexpr std::uint32_t RR_VIDEO_CLOCK_RATE = 90000U;
+
+// Frames in the one-way delay trend, as in the trendline filter of GCC
+constexpr std::size_t RR_TREND_FRAMES = 20U;
+
+// Reports over which the lowest one-way delay is searched. The minimum
+// is the delay of an empty queue, the window lets it follow clock drift.
+constexpr std::size_t RR_MIN_DELAY_REPORTS = 100U;
+
+// A jump of the sequence numbers beyond these starts the statistics
+// over, as in RFC 3550 A.1
+constexpr std::uint16_t RR_MAX_DROPOUT  = 3000U;
+constexpr std::uint16_t RR_MAX_MISORDER = 100U;
+
+// Timestamps running ahead of the arrival times by more than this also
+// start the statistics over
+constexpr std::int64_t RR_MAX_AHEAD_US = 250000;
+
+// How the controller sees the video stream of the slave
+struct ReceiverReport {
+  std::uint16_t highestSeq;     // Highest RTP sequence number received
+  std::uint8_t fractionLost;    // Lost since the last report, in 1/256
+  std::uint32_t jitterUs;       // Interarrival jitter as in RFC 3550
+  std::uint32_t queueDelayUs;   // One-way delay above the recent minimum
+  std::int32_t delayTrendUs;    // One-way delay change per second
+  std::uint32_t rateBps;        // Received bits per second
+};
+
+// Loss, jitter and one-way delay of a received RTP stream. The delay is
+// relative as the clocks of the ends are not synchronised: the arrival
+// time minus the RTP timestamp of the last packet of each frame.
+//
+// The keyframe netrelay replays to a joining controller comes with the
+// sequence numbers and timestamps it was sent with, seconds before the
+// live packets. So does the stream of a restarted sender. The jump to
+// the live packets starts the statistics over, otherwise the gap would
+// count as loss and the age of the old packets as queuing delay.
+class RtpReceiveStats
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit RtpReceiveStats(std::uint32_t clockRate = RR_VIDEO_CLOCK_RATE);
+
+  // Account a received packet, false if it's not RTP
+  bool packet(const std::uint8_t* data, std::size_t size, Clock::time_point now);
+
+  // Fill in a report on the packets since the previous report, false if
+  // nothing was received
+  bool report(ReceiverReport& report, Clock::time_point now);
+
+ private:
+  bool jumped(std::uint16_t seq, std::uint32_t ts, Clock::time_point now) const;
+  void frameDelay(std::int64_t delayUs, Clock::time_point arrival);
+
+  std::uint32_t clockRate;
+  Clock::time_point start;
+
+  // Sequence numbers
+  bool started;
+  std::uint16_t maxSeq;
+  std::uint32_t cycles;
+  std::uint32_t reportedExtSeq;   // Highest extended sequence number in the previous report
+  std::uint32_t received;         // Packets since the previous report
+  std::uint32_t receivedBytes;
+  Clock::time_point reportTime;
+  Clock::time_point lastArrival;
+
+  // Jitter in RTP clock units
+  std::uint32_t lastTimestamp;
+  std::int64_t timestamp;         // Unwrapped
+  std::int64_t lastTransit;
+  double jitter;
+
+  // Relative one-way delay of the current frame and the trend over frames
+  std::int64_t frameTimestamp;
+  std::int64_t frameDelayUs;
+  Clock::time_point frameArrival;
+  double smoothedDelayUs;
+  std::array<double, RR_TREND_FRAMES> trendTime;
+  std::array<double, RR_TREND_FRAMES> trendDelay;
+  std::size_t trendCount;
+  std::size_t trendNext;
+
+  // Lowest delay in each of the recent reports
+  std::array<std::int64_t, RR_MIN_DELAY_REPORTS> minDelayUs;
+  std::size_t minDelayNext;
+  std::int64_t reportMinDelayUs;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
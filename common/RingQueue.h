@@ -0,0 +1,72 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+// First in, first out queue of fixed capacity that never allocates. The
+// items from the front up to the end of the array are contiguous and can
+// be handed out as one block, e.g. to a batched send.
+template <typename T, std::size_t N>
+class RingQueue
+{
+ public:
+  RingQueue() : items(), head(0), count(0) {}
+
+  bool empty(void) const { return count == 0; }
+  bool full(void) const { return count == N; }
+  std::size_t size(void) const { return count; }
+  static constexpr std::size_t capacity(void) { return N; }
+
+  T& front(void) { return items[head]; }
+  const T& front(void) const { return items[head]; }
+
+  // Add an item to the back, false if the queue is full
+  bool push(T&& item)
+  {
+    if (count == N) {
+      return false;
+    }
+
+    items[(head + count) % N] = std::move(item);
+    count++;
+    return true;
+  }
+
+  // Remove up to n items from the front
+  void pop(std::size_t n = 1)
+  {
+    n = std::min(n, count);
+    for (std::size_t i = 0; i < n; i++) {
+      items[head] = T();
+      head = (head + 1) % N;
+    }
+    count -= n;
+  }
+
+  // Items from the front that follow each other in memory
+  T* contiguous(std::size_t& n)
+  {
+    n = std::min(count, N - head);
+    return &items[head];
+  }
+
+ private:
+  std::array<T, N> items;
+  std::size_t head;
+  std::size_t count;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "RttEstimator.h"
+
+#include <algorithm>
+
+RttEstimator::RttEstimator() :
+  valid(false),
+  srttUs(0),
+  rttVarUs(0),
+  rtoUs(RTT_RTO_INITIAL_MS * 1000)
+{
+}
+
+void RttEstimator::sample(std::chrono::microseconds rtt)
+{
+  std::int64_t r = std::max<std::int64_t>(rtt.count(), 0);
+
+  if (!valid) {
+    // First measurement
+    srttUs = r;
+    rttVarUs = r / 2;
+    valid = true;
+  } else {
+    // RTTVAR first as it uses the old SRTT, alpha = 1/8 and beta = 1/4
+    std::int64_t delta = srttUs > r ? srttUs - r : r - srttUs;
+    rttVarUs = rttVarUs - rttVarUs / 4 + delta / 4;
+    srttUs = srttUs - srttUs / 8 + r / 8;
+  }
+
+  updateRto();
+}
+
+void RttEstimator::backoff(void)
+{
+  rtoUs = std::min<std::int64_t>(rtoUs * 2, RTT_RTO_MAX_MS * 1000);
+}
+
+void RttEstimator::reset(void)
+{
+  valid = false;
+  srttUs = 0;
+  rttVarUs = 0;
+  rtoUs = RTT_RTO_INITIAL_MS * 1000;
+}
+
+int RttEstimator::getSrttMs(void) const
+{
+  return static_cast<int>((srttUs + 500) / 1000);
+}
+
+int RttEstimator::getRttVarMs(void) const
+{
+  return static_cast<int>((rttVarUs + 500) / 1000);
+}
+
+int RttEstimator::getRtoMs(void) const
+{
+  return static_cast<int>((rtoUs + 500) / 1000);
+}
+
+void RttEstimator::updateRto(void)
+{
+  std::int64_t rto = srttUs + std::max<std::int64_t>(RTT_GRANULARITY_MS * 1000, 4 * rttVarUs);
+  rtoUs = std::clamp<std::int64_t>(rto, RTT_RTO_MIN_MS * 1000, RTT_RTO_MAX_MS * 1000);
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Resend timeout limits. The minimum is well below TCP's one second since
+// the control link is latency sensitive and resends are cheap.
+constexpr int RTT_RTO_INITIAL_MS = 1000;
+constexpr int RTT_RTO_MIN_MS     = 50;
+constexpr int RTT_RTO_MAX_MS     = 2000;
+constexpr int RTT_GRANULARITY_MS = 5;     // Timer granularity G of RFC 6298
+
+// Round trip time estimator as in RFC 6298. Samples must only come from
+// messages that were not resent (Karn's rule), otherwise it's not known
+// which transmission the ACK is for.
+class RttEstimator
+{
+ public:
+  RttEstimator();
+
+  // Add a round trip time measured from a message sent once
+  void sample(std::chrono::microseconds rtt);
+
+  // Double the resend timeout after a resend, up to the maximum. The
+  // next valid sample recomputes it.
+  void backoff(void);
+
+  // Forget the samples, e.g. when the connection is lost
+  void reset(void);
+
+  bool hasSample(void) const { return valid; }
+
+  int getSrttMs(void) const;
+  int getRttVarMs(void) const;
+  int getRtoMs(void) const;
+  std::chrono::milliseconds rto(void) const { return std::chrono::milliseconds(getRtoMs()); }
+
+ private:
+  void updateRto(void);
+
+  bool valid;
+  std::int64_t srttUs;
+  std::int64_t rttVarUs;
+  std::int64_t rtoUs;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
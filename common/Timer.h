@@ -6,17 +6,41 @@
 #pragma once
 
 #include "Event.h"
+#include "TimerWheel.h"
+#include "HighResTimer.h"
 #include <functional>
 #include <chrono>
-#include <asio.hpp>
 #include <memory>
 
-// Simple timer class to replace QTimer
-class Timer : public std::enable_shared_from_this<Timer> {
+// Simple timer class to replace QTimer. The timers live in the event
+// loop's timer wheel with a millisecond resolution, so starting and
+// restarting them is cheap. Timers created with Resolution::Microsecond
+// use a timer of their own for sub-millisecond deadlines.
+class Timer {
 public:
-  // Takes EventLoop reference for access to io_context
-  Timer(EventLoop& eventLoop)
-    : timer(eventLoop.context()), running(false), repeat(false), interval(0) {}
+  enum class Resolution {
+    Millisecond,
+    Microsecond,
+  };
+
+  // Takes EventLoop reference for access to the timer wheel. The
+  // callbacks run on a strand of their own.
+  Timer(EventLoop& eventLoop, Resolution resolution = Resolution::Millisecond)
+    : Timer(eventLoop, eventLoop.makeStrand(), resolution) {}
+
+  // Runs the callback on the given strand, serialised with the other
+  // handlers of its owner. The timer is to be used on that strand.
+  Timer(EventLoop& eventLoop, const EventLoop::Strand& strand,
+        Resolution resolution = Resolution::Millisecond)
+    : wheel(eventLoop.timers()),
+      entry(),
+      highRes() {
+    if (resolution == Resolution::Microsecond) {
+      highRes = std::make_unique<HighResTimer>(strand);
+    } else {
+      entry = std::make_shared<TimerWheel::Entry>(wheel, strand);
+    }
+  }
 
   // Add a destructor that cancels any pending operations
   ~Timer() {
@@ -26,52 +50,45 @@ public:
   // Start the timer with given milliseconds
   // If repeat is true, timer will restart automatically
   void start(int milliseconds, std::function<void()> callback, bool repeat = false) {
-    stop();  // Cancel any pending operations
+    start(std::chrono::milliseconds(milliseconds), std::move(callback), repeat);
+  }
 
-    running = true;
-    this->repeat = repeat;
-    this->callback = callback;
-    this->interval = milliseconds;
+  void start(std::chrono::microseconds interval, std::function<void()> callback, bool repeat = false) {
+    if (highRes) {
+      highRes->start(interval, std::move(callback), repeat);
+    } else {
+      wheel.start(*entry, interval, std::move(callback), repeat);
+    }
+  }
 
-    // Set up a one-shot timer
-    timer.expires_after(std::chrono::milliseconds(milliseconds));
-    timer.async_wait(std::bind(&Timer::handle_timeout, this,
-                               std::placeholders::_1));
+  // Start again with the previous interval and callback, e.g. to push
+  // back a timeout. Doesn't allocate.
+  void restart() {
+    if (highRes) {
+      highRes->restart();
+    } else {
+      wheel.restart(*entry);
+    }
   }
 
   // Stop the timer
   void stop() {
-    running = false;
-    timer.cancel();
+    if (highRes) {
+      highRes->stop();
+    } else {
+      wheel.stop(*entry);
+    }
   }
 
   // Check if timer is active
   bool isActive() const {
-    return running;
+    return highRes ? highRes->isActive() : wheel.isActive(*entry);
   }
 
 private:
-  // Private method to handle timeouts
-  void handle_timeout(const asio::error_code& error) {
-    if (!error && running) {
-      if (callback) callback();
-
-      if (repeat && running) {
-        // Start a new timer instead of recursive call
-        timer.expires_after(std::chrono::milliseconds(interval));
-        timer.async_wait(std::bind(&Timer::handle_timeout, this,
-                                   std::placeholders::_1));
-      } else {
-        running = false;
-      }
-    }
-  }
-
-  asio::steady_timer timer;
-  std::function<void()> callback;
-  bool running;
-  bool repeat;
-  int interval;
+  TimerWheel& wheel;
+  std::shared_ptr<TimerWheel::Entry> entry;
+  std::unique_ptr<HighResTimer> highRes;
 };
 
 /* Emacs indentatation information
@@ -80,4 +97,4 @@ private:
    tab-width:2
    c-basic-offset:2
    End:
-*/
\ No newline at end of file
+*/
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+constexpr std::uint64_t SLOT_MASK = TIMER_WHEEL_SLOTS - 1;
+
+// Distance from the bit "from" to the next set bit, going round, or -1
+static int nextBit(std::uint64_t bits, unsigned from)
+{
+  if (from != 0) {
+    bits = (bits >> from) | (bits << (64 - from));
+  }
+  if (bits == 0) {
+    return -1;
+  }
+  return __builtin_ctzll(bits);
+}
+
+TimerWheel::Entry::Entry(TimerWheel& wheel, const EventLoop::Strand& strand) :
+  wheel(wheel),
+  strand(strand),
+  callback(),
+  interval(0),
+  due(),
+  repeat(false),
+  active(false),
+  generation(0),
+  expires(0),
+  bucket(0),
+  linked(false),
+  prev(nullptr),
+  next(nullptr)
+{
+}
+
+void TimerWheel::Entry::fire(std::uint32_t firedGeneration)
+{
+  {
+    std::lock_guard<std::mutex> lock(wheel.mutex);
+
+    // Stopped or restarted after expiring
+    if (!active || generation != firedGeneration) {
+      return;
+    }
+
+    if (repeat) {
+      // From the previous deadline so that the period doesn't drift,
+      // unless the loop has fallen behind by a whole period
+      Clock::time_point now = wheel.driver.now();
+      Clock::time_point next = due + interval;
+      wheel.schedule(*this, now, next > now ? next : now + interval);
+    } else {
+      active = false;
+    }
+  }
+
+  // The callback may start or stop the timer
+  if (callback) {
+    callback();
+  }
+}
+
+TimerWheel::TimerWheel(asio::io_context& context) :
+  mutex(),
+  epoch(),
+  current(0),
+  count(0),
+  buckets(),
+  occupied(),
+  strand(asio::make_strand(context)),
+  driver(strand),
+  driverArmed(false),
+  driverTick(0),
+  wakePending(false),
+  metricTimers(Metrics::registry().gauge("pleco_timers", "Timers running")),
+  metricLag(Metrics::registry().histogram("pleco_timer_lag_us", "How late the timer wheel woke up"))
+{
+  buckets.fill(nullptr);
+  occupied.fill(0);
+
+  // On the loop's clock, which may be virtual
+  epoch = driver.now();
+}
+
+TimerWheel::~TimerWheel()
+{
+  // The owners outlive the wheel only if they are never used again
+  std::lock_guard<std::mutex> lock(mutex);
+  for (Entry* head : buckets) {
+    for (Entry* entry = head; entry; entry = entry->next) {
+      entry->linked = false;
+      entry->active = false;
+    }
+  }
+  metricTimers.add(-static_cast<std::int64_t>(count));
+}
+
+void TimerWheel::start(Entry& entry, Clock::duration interval, Entry::Callback callback, bool repeat)
+{
+  // The callback is only used on the entry's strand, like this
+  entry.callback = std::move(callback);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  entry.interval = interval;
+  entry.repeat = repeat;
+  entry.active = true;
+  entry.generation++;
+
+  Clock::time_point now = driver.now();
+  schedule(entry, now, now + entry.interval);
+}
+
+void TimerWheel::restart(Entry& entry)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  entry.active = true;
+  entry.generation++;
+
+  Clock::time_point now = driver.now();
+  schedule(entry, now, now + entry.interval);
+}
+
+void TimerWheel::stop(Entry& entry)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (entry.linked) {
+    unlink(entry);
+  }
+  entry.active = false;
+  entry.generation++;
+}
+
+bool TimerWheel::isActive(const Entry& entry) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return entry.active;
+}
+
+std::size_t TimerWheel::size(void) const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return count;
+}
+
+std::uint64_t TimerWheel::toTicks(Clock::time_point time, bool roundUp) const
+{
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time - epoch).count();
+  if (elapsed < 0) {
+    return 0;
+  }
+  if (roundUp) {
+    elapsed += TIMER_WHEEL_TICK_US - 1;
+  }
+  return static_cast<std::uint64_t>(elapsed) / TIMER_WHEEL_TICK_US;
+}
+
+void TimerWheel::schedule(Entry& entry, Clock::time_point now, Clock::time_point due)
+{
+  if (entry.linked) {
+    unlink(entry);
+  }
+
+  // An empty wheel has nothing to catch up with
+  if (count == 0) {
+    current = std::max(current, toTicks(now, false));
+  }
+
+  entry.due = due;
+  entry.expires = std::max(toTicks(due, true), current);
+  link(entry);
+
+  // Wake earlier only if this is the first timer due, a restarted timer
+  // usually is not
+  if (!driverArmed || entry.expires < driverTick) {
+    requestWake();
+  }
+}
+
+void TimerWheel::link(Entry& entry)
+{
+  // The lowest level whose range covers the expiry time
+  std::size_t level = 0;
+  std::size_t slot = 0;
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    unsigned shift = TIMER_WHEEL_SLOT_BITS * level;
+    if ((entry.expires >> shift) - (current >> shift) < TIMER_WHEEL_SLOTS) {
+      slot = (entry.expires >> shift) & SLOT_MASK;
+      break;
+    }
+  }
+
+  // Beyond the wheel, park in the furthest slot of the last level
+  if (level == TIMER_WHEEL_LEVELS) {
+    level = TIMER_WHEEL_LEVELS - 1;
+    unsigned shift = TIMER_WHEEL_SLOT_BITS * level;
+    slot = ((current >> shift) + SLOT_MASK) & SLOT_MASK;
+  }
+
+  entry.bucket = level * TIMER_WHEEL_SLOTS + slot;
+  entry.prev = nullptr;
+  entry.next = buckets[entry.bucket];
+  if (entry.next) {
+    entry.next->prev = &entry;
+  }
+  buckets[entry.bucket] = &entry;
+  occupied[level] |= 1ULL << slot;
+  entry.linked = true;
+  count++;
+  metricTimers.add(1);
+}
+
+void TimerWheel::unlink(Entry& entry)
+{
+  if (entry.prev) {
+    entry.prev->next = entry.next;
+  } else {
+    buckets[entry.bucket] = entry.next;
+  }
+  if (entry.next) {
+    entry.next->prev = entry.prev;
+  }
+
+  if (!buckets[entry.bucket]) {
+    occupied[entry.bucket / TIMER_WHEEL_SLOTS] &= ~(1ULL << (entry.bucket % TIMER_WHEEL_SLOTS));
+  }
+
+  entry.prev = nullptr;
+  entry.next = nullptr;
+  entry.linked = false;
+  count--;
+  metricTimers.add(-1);
+}
+
+void TimerWheel::cascade(std::size_t level)
+{
+  // Move the timers of the current slot one level down, or further
+  std::size_t slot = (current >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK;
+  Entry* entry = buckets[level * TIMER_WHEEL_SLOTS + slot];
+  while (entry) {
+    Entry* next = entry->next;
+    unlink(*entry);
+    link(*entry);
+    entry = next;
+  }
+}
+
+void TimerWheel::advance(std::uint64_t until)
+{
+  while (current <= until) {
+    if (count == 0) {
+      current = until + 1;
+      break;
+    }
+
+    // Entering a new round of the lower level, refill it from above
+    if ((current & SLOT_MASK) == 0) {
+      std::size_t levels = 1;
+      while (levels < TIMER_WHEEL_LEVELS &&
+             ((current >> (TIMER_WHEEL_SLOT_BITS * levels)) & SLOT_MASK) == 0) {
+        levels++;
+      }
+      for (std::size_t level = std::min(levels, TIMER_WHEEL_LEVELS - 1); level >= 1; level--) {
+        cascade(level);
+      }
+    }
+
+    Entry* entry = buckets[current & SLOT_MASK];
+    while (entry) {
+      Entry* next = entry->next;
+      unlink(*entry);
+      asio::post(entry->strand, [expired = entry->shared_from_this(), generation = entry->generation]() {
+        expired->fire(generation);
+      });
+      entry = next;
+    }
+
+    current++;
+  }
+}
+
+bool TimerWheel::nextTick(std::uint64_t& tick) const
+{
+  if (count == 0) {
+    return false;
+  }
+
+  bool found = false;
+  int distance = nextBit(occupied[0], current & SLOT_MASK);
+  if (distance >= 0) {
+    tick = current + distance;
+    found = true;
+  }
+
+  // The higher levels are due when their slot is cascaded
+  for (std::size_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+    unsigned shift = TIMER_WHEEL_SLOT_BITS * level;
+    std::uint64_t position = (current >> shift) + 1;
+    distance = nextBit(occupied[level], position & SLOT_MASK);
+    if (distance >= 0) {
+      std::uint64_t cascadeTick = (position + distance) << shift;
+      if (!found || cascadeTick < tick) {
+        tick = cascadeTick;
+        found = true;
+      }
+    }
+  }
+
+  return found;
+}
+
+void TimerWheel::requestWake(void)
+{
+  if (wakePending) {
+    return;
+  }
+
+  // The driver timer is used on the wheel's strand only
+  wakePending = true;
+  asio::post(strand, [this]() { arm(); });
+}
+
+void TimerWheel::arm(void)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  wakePending = false;
+
+  std::uint64_t tick;
+  if (!nextTick(tick)) {
+    if (driverArmed) {
+      driver.cancel();
+      driverArmed = false;
+    }
+    return;
+  }
+
+  if (driverArmed && tick == driverTick) {
+    return;
+  }
+
+  driverArmed = true;
+  driverTick = tick;
+  driver.expires_at(epoch + std::chrono::microseconds(tick * TIMER_WHEEL_TICK_US));
+  driver.async_wait([this](const asio::error_code& error) {
+    if (!error) {
+      expire();
+    }
+  });
+}
+
+void TimerWheel::expire(void)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    driverArmed = false;
+
+    // Late wakeups are also handlers queued behind a busy loop
+    Clock::time_point now = driver.now();
+    auto lag = now - (epoch + std::chrono::microseconds(driverTick * TIMER_WHEEL_TICK_US));
+    metricLag.record(static_cast<std::uint64_t>(
+      std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(lag).count())));
+
+    advance(toTicks(now, false));
+  }
+
+  arm();
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
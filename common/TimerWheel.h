@@ -0,0 +1,122 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "Event.h"
+#include "Metrics.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Resolution of the wheel and its size: 64 slots per level, the levels
+// together span 64^4 ticks (about 4.6 hours). Longer timers go round the
+// last level again.
+constexpr int TIMER_WHEEL_TICK_US        = 1000;
+constexpr unsigned TIMER_WHEEL_SLOT_BITS = 6;
+constexpr std::size_t TIMER_WHEEL_SLOTS  = 1U << TIMER_WHEEL_SLOT_BITS;
+constexpr std::size_t TIMER_WHEEL_LEVELS = 4;
+
+// Hierarchical timing wheel as described by Varghese and Lauck. The
+// timers are kept in intrusive lists, one per slot, so starting,
+// stopping and restarting a timer is O(1) and allocates nothing. A single
+// asio timer wakes the wheel when the next occupied slot is due, and the
+// expired callbacks are posted to the strands of their owners.
+class TimerWheel
+{
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // One timer in the wheel. The owner keeps it alive, as does a posted
+  // callback until it has run.
+  class Entry : public std::enable_shared_from_this<Entry>
+  {
+   public:
+    using Callback = std::function<void(void)>;
+
+    Entry(TimerWheel& wheel, const EventLoop::Strand& strand);
+
+   private:
+    friend class TimerWheel;
+
+    void fire(std::uint32_t firedGeneration);
+
+    TimerWheel& wheel;
+    EventLoop::Strand strand;
+
+    // Used on the owner's strand only
+    Callback callback;
+
+    // Guarded by the wheel's mutex
+    Clock::duration interval;
+    Clock::time_point due;
+    bool repeat;
+    bool active;
+    std::uint32_t generation;     // Changed on every start and stop
+    std::uint64_t expires;        // Tick
+    std::size_t bucket;
+    bool linked;
+    Entry* prev;
+    Entry* next;
+  };
+
+  explicit TimerWheel(asio::io_context& context);
+  ~TimerWheel();
+
+  // Call the callback on the entry's strand after the interval, and
+  // then every interval if repeat is set. Restarts a running timer.
+  void start(Entry& entry, Clock::duration interval, Entry::Callback callback, bool repeat);
+
+  // Start again with the previous interval and callback
+  void restart(Entry& entry);
+
+  void stop(Entry& entry);
+  bool isActive(const Entry& entry) const;
+
+  // Timers in the wheel
+  std::size_t size(void) const;
+
+ private:
+  std::uint64_t toTicks(Clock::time_point time, bool roundUp) const;
+  void schedule(Entry& entry, Clock::time_point now, Clock::time_point due);
+  void link(Entry& entry);
+  void unlink(Entry& entry);
+  void cascade(std::size_t level);
+  void advance(std::uint64_t until);
+  bool nextTick(std::uint64_t& tick) const;
+  void requestWake(void);
+  void arm(void);
+  void expire(void);
+
+  mutable std::mutex mutex;
+  Clock::time_point epoch;
+  std::uint64_t current;          // Next tick to process
+  std::size_t count;
+  std::array<Entry*, TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS> buckets;
+  std::array<std::uint64_t, TIMER_WHEEL_LEVELS> occupied;
+
+  // Wakes the wheel, used on its strand only
+  EventLoop::Strand strand;
+  EventLoop::StrandTimer driver;
+  bool driverArmed;
+  std::uint64_t driverTick;
+  bool wakePending;
+
+  Metrics::Gauge& metricTimers;
+  Metrics::Histogram& metricLag;
+};
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -5,45 +5,152 @@
 
 #include "Transmitter.h"
 #include "Message.h"
+#include "Log.h"
 
-#include <iostream>
 #include <iomanip>
+#include <algorithm>
 
-#define RESEND_TIMEOUT_DEFAULT 1000
 
 
 
+constexpr Transmitter::MessageHandlers Transmitter::makeMessageHandlers(void)
+{
+  MessageHandlers handlers{};
+
+  handlers[MessageType::Ack]            = &Transmitter::handleACK;
+  handlers[MessageType::Ping]           = &Transmitter::handlePing;
+  handlers[MessageType::Video]          = &Transmitter::handleVideo;
+  handlers[MessageType::Audio]          = &Transmitter::handleAudio;
+  handlers[MessageType::Debug]          = &Transmitter::handleDebug;
+  handlers[MessageType::Value]          = &Transmitter::handleValue;
+  handlers[MessageType::PeriodicValue]  = &Transmitter::handlePeriodicValue;
+  handlers[MessageType::Batch]          = &Transmitter::handleBatch;
+  handlers[MessageType::Fragment]       = &Transmitter::handleFragment;
+  handlers[MessageType::VideoParity]    = &Transmitter::handleVideoParity;
+  handlers[MessageType::ReceiverReport] = &Transmitter::handleReceiverReport;
+
+  return handlers;
+}
+
+constexpr bool Transmitter::handlesSchemaTypes(const MessageHandlers& handlers)
+{
+  for (std::size_t type = 0; type < MSG_TYPE_MAX; type++) {
+    bool known = MessageSchema::type(static_cast<std::uint8_t>(type)).payload != MessageSchema::Payload::Unknown;
+    if (known != (handlers[type] != nullptr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const Transmitter::MessageHandlers Transmitter::messageHandlers = Transmitter::makeMessageHandlers();
+
 Transmitter::Transmitter(EventLoop& eventLoop, const std::string& host, uint16_t port):
   eventLoop(eventLoop),
-  socket(eventLoop.context()),
-  receiveBuffer(4096),
+  strand(eventLoop.makeStrand()),
+  socket(strand),
+  controlPool(std::make_shared<BufferPool>(TX_CONTROL_SLOTS, TX_CONTROL_MAX_LEN)),
+  mediaPool(std::make_shared<BufferPool>(TX_MEDIA_SLOTS, TX_MEDIA_MAX_LEN)),
+  receiveBuffers(),
+  receiveSenders(),
+  batchSocket(socket),
+  batchIo(BatchSocket::isSupported()),
+  sendFlushPending(false),
+  sendQueues(),
+  sendQueueDrops(0),
+  sendInProgress(false),
+  socketQueueLimit(TX_SOCKET_QUEUE_DEFAULT),
+  socketPollTimer(strand),
+  socketPollArmed(false),
+  relaySession(0),
+  relayHeader(),
+  pacerRate(0),
+  pacerTokens(TX_PACER_BURST),
+  pacerRefill(),
+  pacerTimer(strand),
+  pacerTimerArmed(false),
+  pacerQueue(),
+  pacerDrops(0),
+  pacerDelayMax(0),
+  parseBuffer(nullptr),
   relayHost(host),
   relayPort(port),
-  resendTimeoutMs(RESEND_TIMEOUT_DEFAULT),
+  rttEstimator(),
   resendCounter(0),
+  crcMode(Crc::Mode::Crc16),
+  coalesce(false),
+  coalesceWindow(0),
+  batchTimer(eventLoop, strand, Timer::Resolution::Microsecond),
+  batchBuffer(),
+  fragmentSize(TX_FRAGMENT_SIZE_DEFAULT),
+  nextFragmentId(0),
+  reassembly(),
+  reassemblyTimeouts(0),
+  fecGroupSize(0),
+  fecGroupCount(0),
+  fecFirstSeq(0),
+  fecLengthXor(0),
+  fecParityLength(0),
+  fecParity(),
+  fecPool(),
+  fecHistory(),
+  fecSynced(false),
+  fecNextSeq(0),
+  fecHighestSeq(0),
+  fecHolding(false),
+  fecRecovered(0),
+  fecUnrecoverable(0),
+  inFlight(),
+  receiveWindow(),
+  resendTimer(strand),
+  resendTimerArmed(false),
+  resendTimerDeadline(),
   connectionStatus(CONNECTION_STATUS_LOST),
   payloadSent(0),
   payloadRecv(0),
   totalSent(0),
   totalRecv(0),
-  running(true)
+  ioReceiveCalls(0),
+  ioReceivePackets(0),
+  ioSendCalls(0),
+  ioSendPackets(0),
+  running(true),
+  capture(),
+  offline(false),
+  datagramSender(),
+  metricSent(),
+  metricReceived(),
+  metricResent(),
+  metricSentBytes(Metrics::registry().counter("pleco_tx_bytes_total", "UDP payload bytes sent")),
+  metricReceivedBytes(Metrics::registry().counter("pleco_rx_bytes_total", "UDP payload bytes received")),
+  metricSendQueueDrops(Metrics::registry().counter("pleco_send_queue_drops_total",
+                                                   "Datagrams dropped as the send queue was full")),
+  metricPacerDrops(Metrics::registry().counter("pleco_pacer_drops_total",
+                                               "Media dropped by the pacer, queue full or too late")),
+  metricAckLatency(Metrics::registry().histogram("pleco_ack_latency_us",
+                                                 "Time from sending a reliable message to its ACK"))
 {
-  std::cout << "Transmitter initializing with host: " << host << ", port: " << port << std::endl;
+  LOG_INFO(Net) << "Transmitter initializing with host: " << host << ", port: " << port;
 
 
-  // Set message handlers
-  messageHandlers[MessageType::Ack]            = &Transmitter::handleACK;
-  messageHandlers[MessageType::Ping]           = &Transmitter::handlePing;
-  messageHandlers[MessageType::Video]          = &Transmitter::handleVideo;
-  messageHandlers[MessageType::Audio]          = &Transmitter::handleAudio;
-  messageHandlers[MessageType::Debug]          = &Transmitter::handleDebug;
-  messageHandlers[MessageType::Value]          = &Transmitter::handleValue;
-  messageHandlers[MessageType::PeriodicValue]  = &Transmitter::handlePeriodicValue;
+  static_assert(handlesSchemaTypes(makeMessageHandlers()),
+                "Every message type known by MessageSchema must have a handler");
+
+  // Registered up front so that counting is just an increment
+  for (std::size_t type = 0; type < MSG_TYPE_MAX; type++) {
+    const char* name = MessageSchema::type(type).name;
+    std::string labels = std::string("type=\"") + (name ? name : "unknown") + "\"";
+    metricSent[type] = &Metrics::registry().counter("pleco_messages_sent_total", "Messages sent", labels);
+    metricReceived[type] = &Metrics::registry().counter("pleco_messages_received_total",
+                                                        "Valid messages received", labels);
+    metricResent[type] = &Metrics::registry().counter("pleco_messages_resent_total",
+                                                      "Reliable messages resent", labels);
+  }
 }
 
 Transmitter::~Transmitter()
 {
-  std::cout << "Transmitter destructor" << std::endl;
+  LOG_INFO(Net) << "Transmitter destructor";
 
   // Stop receiving data
   running = false;
@@ -52,61 +159,106 @@ Transmitter::~Transmitter()
   if (connectionTimeoutTimer) connectionTimeoutTimer->stop();
   if (autoPing) autoPing->stop();
   if (rateTimer) rateTimer->stop();
+  batchTimer.stop();
+  pacerTimer.cancel();
+  socketPollTimer.cancel();
 
-  // Stop any resend timers
-  for (auto& [key, timer] : resendTimers) {
-    if (timer) timer->stop();
-  }
-
-  // Clear all maps in one go
-  rtTimers.clear();
-  resendTimers.clear();
-  resendMessages.clear();
+  // Stop resending
+  resendTimer.cancel();
+  inFlight.clear();
+  receiveWindow.clear();
 
   // Reset shared_ptr members
   connectionTimeoutTimer.reset();
   autoPing.reset();
   rateTimer.reset();
+}
 
-  // Clean up the message handlers
-  for (std::size_t i = 0; i < MSG_TYPE_MAX; i++) {
-    messageHandlers[i] = nullptr;
-  }
+EventLoop::Strand& Transmitter::getStrand(void)
+{
+  return strand;
 }
 
 void Transmitter::initSocket()
 {
-  std::cout << "Initializing socket" << std::endl;
+  if (!datagramSender && !openSocket()) {
+    return;
+  }
+
+  // Start RX/TX rate timer
+  rateTimer = std::make_shared<Timer>(eventLoop, strand);
+  rateTime = eventLoop.now();
+  rateTimer->start(1000, [this]() { updateRate(); }, true);
+}
+
+bool Transmitter::openSocket(void)
+{
+  LOG_INFO(Net) << "Initializing socket";
 
   asio::error_code ec;
   // NOLINTNEXTLINE(bugprone-unused-return-value)
   socket.open(asio::ip::udp::v4(), ec);
   if (ec) {
-    std::cerr << "Failed to open socket: " << ec.message() << std::endl;
-    return;
+    LOG_ERROR(Net) << "Failed to open socket: " << ec.message();
+    return false;
   }
 
   // NOLINTNEXTLINE(bugprone-unused-return-value)
   socket.bind(asio::ip::udp::endpoint(asio::ip::address_v4::any(), 0), ec);
   if (ec) {
-    std::cerr << "Failed to bind socket: " << ec.message() << std::endl;
-    return;
+    LOG_ERROR(Net) << "Failed to bind socket: " << ec.message();
+    return false;
   }
 
   // Get the local endpoint
   asio::ip::udp::endpoint local_endpoint = socket.local_endpoint(ec);
   if (!ec) {
-    std::cout << "Local address: " << local_endpoint.address().to_string() << std::endl;
-    std::cout << "Local port: " << local_endpoint.port() << std::endl;
+    LOG_INFO(Net) << "Local address: " << local_endpoint.address().to_string();
+    LOG_INFO(Net) << "Local port: " << local_endpoint.port();
   }
 
-  // Start async read operation
-  readPendingDatagrams();
+  // Fall back to one datagram per call if batching is not available
+  if (batchIo && !batchSocket.init()) {
+    batchIo = false;
+  }
 
-  // Start RX/TX rate timer
-  rateTimer = std::make_shared<Timer>(eventLoop);
-  rateTime = std::chrono::steady_clock::now();
-  rateTimer->start(1000, [this]() { updateRate(); }, true);
+  // Start async read operation, offline the datagrams are replayed instead
+  if (!offline) {
+    readPendingDatagrams();
+  }
+
+  return true;
+}
+
+bool Transmitter::startCapture(const std::string& path)
+{
+  return capture.open(path, crcMode);
+}
+
+void Transmitter::stopCapture(void)
+{
+  capture.close();
+}
+
+void Transmitter::setOffline(bool enable)
+{
+  LOG_INFO(Net) << "Offline: " << (enable ? "yes" : "no");
+  offline = enable;
+}
+
+void Transmitter::receiveDatagram(const std::uint8_t* data, std::size_t size)
+{
+  PooledBuffer buffer = mediaPool->acquire(size);
+  std::copy(data, data + size, buffer.data());
+
+  asio::post(strand, [this, buffer = std::move(buffer)]() mutable {
+    processDatagram(buffer);
+  });
+}
+
+void Transmitter::setDatagramSender(DatagramSender sender)
+{
+  datagramSender = std::move(sender);
 }
 
 void Transmitter::enableAutoPing(bool enable)
@@ -125,12 +277,117 @@ void Transmitter::enableAutoPing(bool enable)
     return;
   }
 
-  autoPing = std::make_shared<Timer>(eventLoop);
+  autoPing = std::make_shared<Timer>(eventLoop, strand);
 
   // Send ping every second (sending a high priority package restarts the timer)
   autoPing->start(1000, [this]() { sendPing(); }, true);
 }
 
+void Transmitter::setCrcMode(Crc::Mode mode)
+{
+  LOG_INFO(Net) << "Using checksum: " << Crc::getModeStr(mode);
+  crcMode = mode;
+}
+
+void Transmitter::setBatchedIo(bool enable)
+{
+  if (enable && !BatchSocket::isSupported()) {
+    LOG_WARN(Net) << "Batched socket I/O not supported on this platform";
+    enable = false;
+  }
+
+  batchIo = enable;
+}
+
+void Transmitter::setRelaySession(std::uint32_t session)
+{
+  LOG_INFO(Net) << "Relay session: " << session;
+  relaySession = session;
+
+  for (std::size_t i = 0; i < 4; i++) {
+    relayHeader[i] = static_cast<std::uint8_t>(TX_RELAY_MAGIC >> (24 - 8 * i));
+    relayHeader[4 + i] = static_cast<std::uint8_t>(session >> (24 - 8 * i));
+  }
+
+  batchSocket.setPrefix(relayHeader.data(), session != 0 ? TX_RELAY_HEADER_LEN : 0);
+}
+
+void Transmitter::setCoalescing(bool enable, int windowUs)
+{
+  LOG_INFO(Net) << "Coalescing small messages: " << (enable ? "enabled" : "disabled")
+                << ", window: " << windowUs << " us";
+
+  coalesce = enable;
+  coalesceWindow = std::chrono::microseconds(windowUs > 0 ? windowUs : 0);
+
+  if (!coalesce) {
+    flushBatch();
+  }
+}
+
+void Transmitter::setSocketQueueLimit(std::size_t bytes)
+{
+  LOG_INFO(Net) << "Socket send queue limit: " << bytes << " bytes";
+  socketQueueLimit = bytes;
+}
+
+void Transmitter::setFragmentSize(std::size_t size)
+{
+  // Each fragment must carry some data and fit in the receive buffer
+  if (size <= MessageOffset::FragmentData || size > TX_MEDIA_MAX_LEN) {
+    LOG_ERROR(Net) << "Invalid fragment size: " << size;
+    return;
+  }
+
+  fragmentSize = size;
+}
+
+void Transmitter::setVideoFec(std::size_t groupSize)
+{
+  if (groupSize > TX_FEC_MAX_GROUP) {
+    LOG_WARN(Net) << "Video FEC group too big: " << groupSize << ", using " << TX_FEC_MAX_GROUP;
+    groupSize = TX_FEC_MAX_GROUP;
+  }
+
+  LOG_INFO(Net) << "Video FEC group size: " << groupSize;
+
+  // A single message would just be sent twice
+  fecGroupSize = groupSize > 1 ? groupSize : 0;
+  fecGroupCount = 0;
+}
+
+void Transmitter::setPacingRate(int bitsPerSecond)
+{
+  LOG_INFO(Net) << "Pacing video: " << (bitsPerSecond > 0 ? std::to_string(bitsPerSecond) + " bit/s" : "disabled");
+
+  if (bitsPerSecond <= 0) {
+    pacerRate = 0;
+    pacerTimer.cancel();
+    pacerTimerArmed = false;
+
+    // Send whatever is still waiting
+    while (!pacerQueue.empty()) {
+      transmitBuffer(std::move(pacerQueue.front().buffer));
+      pacerQueue.pop();
+    }
+    return;
+  }
+
+  // Start with a full bucket
+  if (pacerRate == 0) {
+    pacerTokens = TX_PACER_BURST;
+    pacerRefill = eventLoop.now();
+  }
+
+  pacerRate = bitsPerSecond / 8.0;
+
+  // Recalculate the wait with the new rate
+  if (pacerTimerArmed) {
+    pacerTimer.cancel();
+    drainPacer();
+  }
+}
+
 void Transmitter::setRttCallback(RttCallback callback)
 {
   onRtt = callback;
@@ -181,151 +438,637 @@ void Transmitter::setConnectionStatusCallback(ConnectionStatusCallback callback)
   onConnectionStatus = callback;
 }
 
-void Transmitter::sendPing()
+void Transmitter::setPoolStatsCallback(PoolStatsCallback callback)
 {
-  std::cout << "Sending ping" << std::endl;
+  onPoolStats = callback;
+}
 
-  auto msg = new Message(MessageType::Ping);
-  sendMessage(msg);
+void Transmitter::setFecStatsCallback(FecStatsCallback callback)
+{
+  onFecStats = callback;
 }
 
-void Transmitter::sendVideo(std::vector<std::uint8_t>* video)
+void Transmitter::setIoStatsCallback(IoStatsCallback callback)
 {
-  std::cout << "Sending video" << std::endl;
+  onIoStats = callback;
+}
 
-  auto msg = new Message(MessageType::Video);
+void Transmitter::setPacerStatsCallback(PacerStatsCallback callback)
+{
+  onPacerStats = callback;
+}
 
-  // Append media payload
-  msg->data()->insert(msg->data()->end(), video->begin(), video->end());
+void Transmitter::setReceiverReportCallback(ReceiverReportCallback callback)
+{
+  onReceiverReport = callback;
+}
 
-  // Clean up input data
-  delete video;
+std::uint32_t Transmitter::getPoolHits(void) const
+{
+  return controlPool->getHits() + mediaPool->getHits();
+}
 
-  sendMessage(msg);
+std::uint32_t Transmitter::getPoolMisses(void) const
+{
+  return controlPool->getMisses() + mediaPool->getMisses();
 }
 
-void Transmitter::sendAudio(std::vector<std::uint8_t>* audio)
+std::uint32_t Transmitter::getReassemblyTimeouts(void) const
 {
-  std::cout << "Sending audio" << std::endl;
+  return reassemblyTimeouts;
+}
 
-  auto msg = new Message(MessageType::Audio);
+std::uint32_t Transmitter::getFecRecovered(void) const
+{
+  return fecRecovered;
+}
 
-  // Append media payload
-  msg->data()->insert(msg->data()->end(), audio->begin(), audio->end());
+std::uint32_t Transmitter::getFecUnrecoverable(void) const
+{
+  return fecUnrecoverable;
+}
 
-  // Clean up input data
-  delete audio;
+std::size_t Transmitter::getSendQueueDepth(void) const
+{
+  std::size_t depth = 0;
+  for (const auto& queue : sendQueues) {
+    depth += queue.size();
+  }
+  return depth;
+}
 
-  sendMessage(msg);
+std::uint32_t Transmitter::getSendQueueDrops(void) const
+{
+  return sendQueueDrops;
 }
 
-void Transmitter::sendDebug(std::string* debug)
+std::size_t Transmitter::getPacerQueueDepth(void) const
 {
-  std::cout << "Sending debug message" << std::endl;
+  return pacerQueue.size();
+}
 
-  auto msg = new Message(MessageType::Debug);
+int Transmitter::getPacerDelayMs(void) const
+{
+  if (pacerQueue.empty()) {
+    return 0;
+  }
+
+  auto waited = eventLoop.now() - pacerQueue.front().queued;
+  return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(waited).count());
+}
+
+void Transmitter::sendPing()
+{
+  LOG_DEBUG(Net) << "Sending ping";
+
+  PooledBuffer buffer = controlPool->acquire(TX_CONTROL_MAX_LEN);
+
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(MessageType::Ping);
+  buffer.resize(builder.finish(crcMode));
+
+  enqueue(std::move(buffer), true);
+}
+
+void Transmitter::sendVideo(const std::uint8_t* video, std::size_t size)
+{
+  LOG_DEBUG(Net) << "Sending video";
+
+  sendMedia(MessageType::Video, video, size);
+}
+
+void Transmitter::sendAudio(const std::uint8_t* audio, std::size_t size)
+{
+  LOG_DEBUG(Net) << "Sending audio";
+
+  sendMedia(MessageType::Audio, audio, size);
+}
+
+void Transmitter::sendDebug(std::string* debug)
+{
+  LOG_DEBUG(Net) << "Sending debug message";
 
   // Truncate if necessary
   if (debug->length() > MSG_DEBUG_MAX_LEN) {
     debug->resize(MSG_DEBUG_MAX_LEN);
   }
 
-  // Append debug payload (convert std::string to bytes)
-  msg->data()->insert(msg->data()->end(), debug->begin(), debug->end());
+  sendMedia(MessageType::Debug, reinterpret_cast<const std::uint8_t*>(debug->data()), debug->length());
 
   // Clean up input data
   delete debug;
+}
+
+void Transmitter::sendMedia(std::uint8_t type, const std::uint8_t* payload, std::size_t size)
+{
+  // Build the message straight into a pooled buffer, the payload is copied once
+  PooledBuffer buffer = mediaPool->acquire(MessageOffset::Payload + size);
+
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(type);
+  builder.append(payload, size);
+  buffer.resize(builder.finish(crcMode));
+
+  enqueue(std::move(buffer), false);
+}
+
+void Transmitter::enqueue(PooledBuffer buffer, bool control)
+{
+  if (strand.running_in_this_thread()) {
+    if (control) {
+      queueControl(std::move(buffer));
+    } else {
+      queueMedia(std::move(buffer));
+    }
+    return;
+  }
+
+  // Called from another thread, the message is ready and only queued on the strand
+  asio::post(strand, [this, buffer = std::move(buffer), control]() mutable {
+    enqueue(std::move(buffer), control);
+  });
+}
+
+void Transmitter::queueMedia(PooledBuffer buffer)
+{
+  std::uint8_t type = MessageView(buffer.data(), buffer.size()).type();
+
+  if (buffer.size() > fragmentSize) {
+    // Fragmented messages are not protected, close the current parity group
+    if (type == MessageType::Video && fecGroupCount > 0) {
+      sendVideoParity();
+    }
+    sendFragments(std::move(buffer));
+    return;
+  }
+
+  if (type == MessageType::Video && fecGroupSize > 0) {
+    fecAddVideo(MessageView(buffer.data(), buffer.size()));
+    sendBuffer(std::move(buffer));
+
+    if (fecGroupCount == fecGroupSize) {
+      sendVideoParity();
+    }
+    return;
+  }
 
-  sendMessage(msg);
+  sendBuffer(std::move(buffer));
+}
+
+void Transmitter::sendFragments(PooledBuffer message)
+{
+  // All fragments but the last carry the same amount of data
+  std::size_t slice = fragmentSize - MessageOffset::FragmentData;
+  std::size_t count = (message.size() + slice - 1) / slice;
+
+  if (count > TX_FRAGMENT_MAX_COUNT || message.size() > TX_REASSEMBLY_MAX_LEN) {
+    LOG_WARN(Net) << "Message too long to fragment (" << message.size() << " bytes), dropping";
+    return;
+  }
+
+  std::uint16_t id = nextFragmentId++;
+
+  for (std::size_t index = 0; index < count; index++) {
+    std::size_t offset = index * slice;
+    std::size_t size = std::min(slice, message.size() - offset);
+
+    PooledBuffer fragment = mediaPool->acquire(MessageOffset::FragmentData + size);
+
+    MessageBuilder builder(fragment.data(), fragment.capacity());
+    builder.begin(MessageType::Fragment);
+    builder.setFragment(id, index, count, message.size());
+    builder.append(message.data() + offset, size);
+    fragment.resize(builder.finish(crcMode));
+
+    sendBuffer(std::move(fragment));
+  }
 }
 
 void Transmitter::sendValue(std::uint8_t subType, std::uint16_t value)
 {
-  std::cout << "Sending value: type=" << Message::getSubTypeStr(subType)
-            << ", value=" << value << std::endl;
+  LOG_DEBUG(Net) << "Sending value: type=" << MessageSchema::subTypeStr(subType)
+                 << ", value=" << value;
+
+  PooledBuffer buffer = controlPool->acquire(TX_CONTROL_MAX_LEN);
 
-  auto msg = new Message(MessageType::Value, subType);
-  msg->setPayload16(value);
-  sendMessage(msg);
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(MessageType::Value, subType);
+  builder.setPayload16(value);
+  buffer.resize(builder.finish(crcMode));
+
+  enqueue(std::move(buffer), true);
 }
 
 void Transmitter::sendPeriodicValue(std::uint8_t subType, std::uint16_t value)
 {
-  std::cout << "Sending periodic value: type=" << Message::getSubTypeStr(subType)
-            << ", value=" << value << std::endl;
+  LOG_DEBUG(Net) << "Sending periodic value: type=" << MessageSchema::subTypeStr(subType)
+                 << ", value=" << value;
+
+  PooledBuffer buffer = controlPool->acquire(TX_CONTROL_MAX_LEN);
 
-  auto msg = new Message(MessageType::PeriodicValue, subType);
-  msg->setPayload16(value);
-  sendMessage(msg);
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(MessageType::PeriodicValue, subType);
+  builder.setPayload16(value);
+  buffer.resize(builder.finish(crcMode));
+
+  enqueue(std::move(buffer), true);
 }
 
-void Transmitter::sendMessage(Message* msg)
+void Transmitter::sendReceiverReport(const ReceiverReport& report)
 {
-  msg->setCRC();
+  LOG_DEBUG(Net) << "Sending receiver report: lost=" << static_cast<int>(report.fractionLost)
+                 << "/256, delay=" << report.queueDelayUs << " us, trend=" << report.delayTrendUs << " us/s";
+
+  PooledBuffer buffer = mediaPool->acquire(MessageOffset::ReportEnd);
 
-  printData(msg->data());
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(MessageType::ReceiverReport);
+  builder.setReceiverReport(report);
+  buffer.resize(builder.finish(crcMode));
 
+  enqueue(std::move(buffer), true);
+}
+
+bool Transmitter::resolveRemote()
+{
   // Resolve the remote endpoint if needed
-  if (remote_endpoint.address().is_unspecified()) {
-    asio::ip::udp::resolver resolver(eventLoop.context());
-    asio::error_code ec;
-    auto endpoints = resolver.resolve(asio::ip::udp::v4(), relayHost, std::to_string(relayPort), ec);
-    if (ec) {
-      std::cerr << "Failed to resolve remote endpoint: " << ec.message() << std::endl;
-      delete msg;
-      return;
+  if (!remote_endpoint.address().is_unspecified()) {
+    return true;
+  }
+
+  asio::ip::udp::resolver resolver(eventLoop.context());
+  asio::error_code ec;
+  auto endpoints = resolver.resolve(asio::ip::udp::v4(), relayHost, std::to_string(relayPort), ec);
+  if (ec) {
+    LOG_ERROR(Net) << "Failed to resolve remote endpoint: " << ec.message();
+    return false;
+  }
+  remote_endpoint = *endpoints.begin();
+
+  return true;
+}
+
+void Transmitter::sendBuffer(PooledBuffer buffer)
+{
+  // Video goes through the pacer, everything else is sent right away
+  if (pacerRate > 0 && buffer.size() > 0 &&
+      MessageSchema::type(MessageView(buffer.data(), buffer.size()).type()).priority == MessageSchema::Class::Video) {
+    queuePaced(std::move(buffer));
+    return;
+  }
+
+  transmitBuffer(std::move(buffer));
+}
+
+void Transmitter::transmitBuffer(PooledBuffer buffer)
+{
+  if (offline || buffer.size() == 0 || (!datagramSender && !resolveRemote())) {
+    return;
+  }
+
+  printData(buffer.data(), buffer.size());
+
+  // Coalesced messages are mostly control messages, send them as such
+  MessageView msg(buffer.data(), buffer.size());
+  MessageSchema::Class priority = msg.type() == MessageType::Batch ?
+    MessageSchema::Class::Control : MessageSchema::type(msg.type()).priority;
+
+  if (!sendQueues[static_cast<std::size_t>(priority)].push(std::move(buffer))) {
+    LOG_DEBUG(Net) << "Send queue full, dropping " << MessageSchema::typeStr(msg.type());
+    sendQueueDrops++;
+    metricSendQueueDrops.add();
+    return;
+  }
+
+  // Send everything queued in this event loop turn with as few calls as possible
+  if (!sendFlushPending) {
+    sendFlushPending = true;
+    asio::post(strand, [this]() { flushSends(); });
+  }
+}
+
+void Transmitter::flushSends()
+{
+  sendFlushPending = false;
+
+  if (datagramSender) {
+    flushToSender();
+    return;
+  }
+
+  // Without batching one datagram is sent at a time and the next one is
+  // picked when it completes
+  if (sendInProgress) {
+    return;
+  }
+
+  // Data already in the socket buffer, everything goes if it's not known
+  std::size_t queued = 0;
+  bool limited = socketQueueLimit > 0 && batchSocket.queuedBytes(queued);
+
+  for (std::size_t priority = 0; priority < TX_SEND_CLASSES; priority++) {
+    RingQueue<PooledBuffer, TX_SEND_QUEUE>& queue = sendQueues[priority];
+    bool control = priority == static_cast<std::size_t>(MessageSchema::Class::Control);
+
+    while (!queue.empty()) {
+      std::size_t available = 0;
+      PooledBuffer* buffers = queue.contiguous(available);
+
+      // Datagrams that fit within the limit, control messages always fit
+      std::size_t count = 0;
+      while (count < available &&
+             (control || !limited || queued == 0 || queued + buffers[count].size() <= socketQueueLimit)) {
+        queued += buffers[count].size();
+        count++;
+      }
+
+      if (count == 0) {
+        // Lower classes wait until the socket buffer drains
+        pollSocketQueue();
+        return;
+      }
+
+      if (!batchIo) {
+        PooledBuffer buffer = std::move(queue.front());
+        queue.pop();
+
+        ioSendCalls++;
+        ioSendPackets++;
+        sendInProgress = true;
+
+        // Send the datagram straight from the pooled buffer, the handler
+        // owns the buffer and returns it to the pool on completion
+        std::array<asio::const_buffer, 2> datagram = {
+          asio::const_buffer(relayHeader.data(), relaySession != 0 ? TX_RELAY_HEADER_LEN : 0),
+          asio::const_buffer(buffer.data(), buffer.size()),
+        };
+        socket.async_send_to(
+          datagram,
+          remote_endpoint,
+          [this, buffer = std::move(buffer)](const asio::error_code& error, std::size_t) {
+            if (error == asio::error::operation_aborted) {
+              return;
+            }
+
+            sendInProgress = false;
+            if (error) {
+              LOG_ERROR(Net) << "Failed to send datagram: " << error.message();
+            } else {
+              datagramSent(buffer.data(), buffer.size());
+            }
+            flushSends();
+          });
+        return;
+      }
+
+      asio::error_code ec;
+      std::size_t sent = batchSocket.send(buffers, count, remote_endpoint, ec);
+      ioSendCalls++;
+      ioSendPackets += sent;
+
+      if (ec == asio::error::would_block) {
+        // Continue when there's room in the socket send buffer
+        sendFlushPending = true;
+        socket.async_wait(EventLoop::StrandSocket::wait_write, [this](const asio::error_code& error) {
+          if (error != asio::error::operation_aborted) {
+            flushSends();
+          }
+        });
+        return;
+      }
+
+      if (ec) {
+        // Drop the datagram that failed and try the rest
+        LOG_ERROR(Net) << "Failed to send datagram: " << ec.message();
+        queue.pop();
+        continue;
+      }
+
+      for (std::size_t i = 0; i < sent; i++) {
+        datagramSent(buffers[i].data(), buffers[i].size());
+      }
+
+      // Sent buffers return to the pool
+      queue.pop(sent);
+    }
+  }
+}
+
+void Transmitter::flushToSender(void)
+{
+  // Nothing to wait for, everything goes in the order of the classes
+  for (RingQueue<PooledBuffer, TX_SEND_QUEUE>& queue : sendQueues) {
+    while (!queue.empty()) {
+      PooledBuffer buffer = std::move(queue.front());
+      queue.pop();
+
+      ioSendCalls++;
+      ioSendPackets++;
+      datagramSender(buffer.data(), buffer.size());
+      datagramSent(buffer.data(), buffer.size());
     }
-    remote_endpoint = *endpoints.begin();
+  }
+}
+
+void Transmitter::datagramSent(const std::uint8_t* data, std::size_t size)
+{
+  payloadSent += size;
+  totalSent += size + 28; // UDP + IPv4 headers
+  metricSentBytes.add(size);
+  capture.append(CaptureDirection::Sent, data, size, eventLoop.now());
+  messageSent(MessageView(data, size));
+}
+
+void Transmitter::pollSocketQueue(void)
+{
+  if (socketPollArmed) {
+    return;
+  }
+
+  // SIOCOUTQ has no notification, check again shortly
+  socketPollArmed = true;
+  socketPollTimer.expires_after(std::chrono::microseconds(TX_SOCKET_POLL_US));
+  socketPollTimer.async_wait([this](const asio::error_code& error) {
+    if (!error) {
+      socketPollArmed = false;
+      flushSends();
+    }
+  });
+}
+
+void Transmitter::queuePaced(PooledBuffer buffer)
+{
+  std::size_t size = buffer.size();
+  if (!pacerQueue.push({ std::move(buffer), eventLoop.now() })) {
+    LOG_DEBUG(Net) << "Pacer queue full, dropping " << size << " bytes";
+    pacerDrops++;
+    metricPacerDrops.add();
+    return;
+  }
+
+  // Send at once if there are tokens, otherwise the timer is already waiting
+  if (!pacerTimerArmed) {
+    drainPacer();
+  }
+}
+
+void Transmitter::drainPacer(void)
+{
+  pacerTimerArmed = false;
+
+  auto now = eventLoop.now();
+
+  // Add the tokens earned since the last refill, the bucket holds a small burst
+  double elapsed = std::chrono::duration<double>(now - pacerRefill).count();
+  pacerRefill = now;
+  pacerTokens = std::min(pacerTokens + elapsed * pacerRate, static_cast<double>(TX_PACER_BURST));
+
+  // A datagram may take the bucket into debt so that datagrams larger
+  // than the bucket are still sent
+  while (!pacerQueue.empty() && pacerTokens > 0) {
+    PacedBuffer& entry = pacerQueue.front();
+    auto delay = now - entry.queued;
+
+    if (delay > std::chrono::milliseconds(TX_PACER_MAX_DELAY_MS)) {
+      // Late video is no better than lost video
+      pacerDrops++;
+      metricPacerDrops.add();
+    } else {
+      pacerDelayMax = std::max(pacerDelayMax, delay);
+      pacerTokens -= entry.buffer.size();
+      transmitBuffer(std::move(entry.buffer));
+    }
+
+    pacerQueue.pop();
+  }
+
+  if (pacerQueue.empty()) {
+    return;
+  }
+
+  // Continue once the debt is paid
+  auto wait = std::chrono::microseconds(static_cast<std::int64_t>(-pacerTokens * 1e6 / pacerRate) + 1);
+  pacerTimerArmed = true;
+  pacerTimer.expires_at(now + wait);
+  pacerTimer.async_wait([this](const asio::error_code& error) {
+    if (!error) {
+      drainPacer();
+    }
+  });
+}
+
+void Transmitter::queueControl(PooledBuffer buffer)
+{
+  if (!coalesce || buffer.size() == 0 || buffer.size() > MSG_BATCH_ITEM_MAX_LEN) {
+    sendBuffer(std::move(buffer));
+    return;
+  }
+
+  // Send the pending batch first if this message doesn't fit
+  if (batchBuffer && batchBuffer.size() + 1 + buffer.size() > TX_BATCH_MAX_LEN) {
+    flushBatch();
+  }
+
+  // Start a new batch and schedule sending it
+  if (!batchBuffer) {
+    batchBuffer = mediaPool->acquire(TX_BATCH_MAX_LEN);
+
+    MessageBuilder builder(batchBuffer.data(), TX_BATCH_MAX_LEN);
+    builder.begin(MessageType::Batch);
+    batchBuffer.resize(builder.size());
+
+    if (coalesceWindow.count() == 0) {
+      // After the handlers already ready to run in this event loop turn
+      asio::post(strand, [this]() { flushBatch(); });
+    } else {
+      // The window is typically well below a millisecond
+      batchTimer.start(coalesceWindow, [this]() { flushBatch(); });
+    }
+  }
+
+  MessageBuilder builder(batchBuffer.data(), TX_BATCH_MAX_LEN, batchBuffer.size());
+  builder.appendMessage(MessageView(buffer.data(), buffer.size()));
+  batchBuffer.resize(builder.size());
+}
+
+void Transmitter::flushBatch()
+{
+  if (!batchBuffer) {
+    return;
+  }
+
+  batchTimer.stop();
+
+  PooledBuffer batch = std::move(batchBuffer);
+  MessageView view(batch.data(), batch.size());
+
+  // Count the packed messages, a single one is sent without the batch header
+  std::size_t offset = 0;
+  std::size_t count = 0;
+  MessageView item(nullptr, 0);
+  while (view.nextBatched(offset, item)) {
+    count++;
+  }
+
+  if (count == 0) {
+    return;
+  }
+
+  if (count == 1) {
+    batch.trimFront(MessageOffset::Payload + 1);
+  } else {
+    MessageBuilder builder(batch.data(), TX_BATCH_MAX_LEN, batch.size());
+    batch.resize(builder.finish(crcMode));
+  }
+
+  sendBuffer(std::move(batch));
+}
+
+void Transmitter::messageSent(const MessageView& msg)
+{
+  metricSent[msg.type()]->add();
+
+  // Coalesced messages are processed one by one
+  if (msg.type() == MessageType::Batch) {
+    std::size_t offset = 0;
+    MessageView item(nullptr, 0);
+    while (msg.nextBatched(offset, item)) {
+      messageSent(item);
+    }
+    return;
+  }
+
+  // Reset auto ping timer if sending a control packet (unless sending a ping)
+  if (autoPing && MessageSchema::type(msg.type()).priority == MessageSchema::Class::Control &&
+      msg.type() != MessageType::Ping) {
+    autoPing->restart();
+  }
+
+  // If not a high priority package, all is done
+  if (!msg.isHighPriority()) {
+    return;
+  }
+
+  // Start connection timeout timer
+  startConnectionTimeout();
+
+  // Store a copy of the message until it's acked, (re)start the round
+  // trip time and schedule the resend
+  auto now = eventLoop.now();
+  if (!inFlight.store(msg, now, now + rttEstimator.rto())) {
+    LOG_ERROR(Net) << "High priority message too long to store for resend: " << msg.size();
+    return;
   }
 
-  // Send the datagram
-  socket.async_send_to(
-    asio::buffer(*msg->data()),
-    remote_endpoint,
-    [this, msg](const asio::error_code& error, std::size_t bytes_transferred) {
-      if (error) {
-        std::cerr << "Failed to send datagram: " << error.message() << std::endl;
-      } else {
-        payloadSent += bytes_transferred;
-        totalSent += bytes_transferred + 28; // UDP + IPv4 headers
-
-        // Reset auto ping timer if sending High Prio (or ack) packet (unless sending a ping)
-        if (autoPing && (msg->isHighPriority() || msg->type() == MessageType::Ack) && msg->type() != MessageType::Ping) {
-          autoPing->start(1000, [this]() { sendPing(); }, true);
-        }
-
-        // If not a high priority package, all is done
-        if (!msg->isHighPriority()) {
-          delete msg;
-          return;
-        }
-
-        // Start connection timeout timer
-        startConnectionTimeout();
-
-        // Store pointer to message until it's acked
-        std::uint16_t fullType = msg->fullType();
-        resendMessages[fullType].reset(msg);
-
-        // Start high priority package resend
-        startResendTimer(msg);
-
-        // Start (or restart) round trip timer
-        startRTTimer(msg);
-      }
-    });
+  armResendTimer();
 }
 
-void Transmitter::resendMessage(Message* msg)
+void Transmitter::resendMessage(const InFlightTable::Slot& slot)
 {
-  std::uint16_t fullType = msg->fullType();
-
-  if (!resendMessages[fullType]) {
-    std::cerr << "Warning: No message to resend for type " << fullType << std::endl;
-    return;
-  }
+  LOG_DEBUG(Net) << "Resending " << MessageSchema::typeStr(slot.fullType >> 8) << " " << slot.seq;
 
   resendCounter++;
+  metricResent[slot.fullType >> 8]->add();
   if (onResentPackets) {
     onResentPackets(resendCounter);
   }
@@ -337,35 +1080,61 @@ void Transmitter::resendMessage(Message* msg)
     }
   }
 
-  // Create a copy of the message and send it
-  Message* resendMsg = new Message(*msg->data());
-  sendMessage(resendMsg);
+  // Send a copy of the stored message, the stored one may be replaced while sending
+  PooledBuffer buffer = controlPool->acquire(slot.size);
+  std::copy(slot.data.begin(), slot.data.begin() + slot.size, buffer.data());
+
+  queueControl(std::move(buffer));
 }
 
-void Transmitter::startResendTimer(Message* msg)
+void Transmitter::armResendTimer(void)
 {
-  std::uint16_t fullType = msg->fullType();
+  std::chrono::steady_clock::time_point deadline;
+  if (!inFlight.nextDeadline(deadline)) {
+    return;
+  }
 
-  // Create a new timer if needed
-  if (!resendTimers[fullType]) {
-    resendTimers[fullType] = std::make_shared<Timer>(eventLoop);
-  } else {
-    resendTimers[fullType]->stop();
+  // The timer may fire early if the first message was ACKed, it's then
+  // armed again for the next deadline
+  if (resendTimerArmed && resendTimerDeadline <= deadline) {
+    return;
   }
 
-  // Start the timer with reference to the stored message
-  resendTimers[fullType]->start(resendTimeoutMs, [this, msg]() {
-    resendMessage(msg);
+  resendTimerArmed = true;
+  resendTimerDeadline = deadline;
+  resendTimer.expires_at(deadline);
+  resendTimer.async_wait([this](const asio::error_code& error) {
+    if (error == asio::error::operation_aborted) {
+      return;
+    }
+    resendTimerArmed = false;
+    resendExpired();
   });
 }
 
-void Transmitter::startRTTimer(Message* msg)
+void Transmitter::resendExpired(void)
 {
-  std::uint16_t fullType = msg->fullType();
+  auto now = eventLoop.now();
+
+  // Resent messages are scheduled again once sent
+  bool expired = false;
+  while (InFlightTable::Slot* slot = inFlight.popExpired(now)) {
+    slot->resent = true;
+    slot->resendsQueued++;
+    resendMessage(*slot);
+    expired = true;
+  }
 
-  // Start or restart the round-trip timer
-  rtTimers[fullType] = std::make_shared<std::chrono::steady_clock::time_point>(
-    std::chrono::steady_clock::now());
+  // Back off once per timeout, not per message
+  if (expired) {
+    rttEstimator.backoff();
+
+    if (onResendTimeout) {
+      onResendTimeout(rttEstimator.getRtoMs());
+    }
+  }
+
+  armResendTimer();
 }
 
 void Transmitter::startConnectionTimeout()
@@ -373,20 +1142,18 @@ void Transmitter::startConnectionTimeout()
 
   // create timer only once
   if (!connectionTimeoutTimer) {
-    std::cout << "Creating connection timeout timer" << std::endl;
-    connectionTimeoutTimer = std::make_shared<Timer>(eventLoop);
+    LOG_INFO(Net) << "Creating connection timeout timer";
+    connectionTimeoutTimer = std::make_shared<Timer>(eventLoop, strand);
   }
 
   // Start the connection timeout timer
-  int timeout = 4 * resendTimeoutMs;
+  int timeout = 4 * rttEstimator.getRtoMs();
   if (timeout < 2000) {
     timeout = 2000;
   }
 
   // only start it if it's not already running
   if (!connectionTimeoutTimer->isActive()) {
-    int timeout = 4 * resendTimeoutMs;
-    if (timeout < 2000) timeout = 2000;
     connectionTimeoutTimer->start(timeout, [this]() {
       connectionTimeout();
     });
@@ -395,40 +1162,52 @@ void Transmitter::startConnectionTimeout()
 
 void Transmitter::readPendingDatagrams()
 {
-  // No need to create a new buffer each time
-  socket.async_receive_from(
-    asio::buffer(receiveBuffer),
-    remote_endpoint,
-    [this](const asio::error_code& error, std::size_t bytes_transferred) {
-      std::cout << "Datagram received with bytes_transferred: " << bytes_transferred << std::endl;
+  if (batchIo) {
+    // Wait until readable and then drain a batch of datagrams at once
+    socket.async_wait(EventLoop::StrandSocket::wait_read, [this](const asio::error_code& error) {
       if (!running) {
-        std::cout << "Shutting down, stopping read" << std::endl;
+        LOG_INFO(Net) << "Shutting down, stopping read";
         return; // Exit if we're shutting down
       }
 
       if (!error) {
-        std::cout << "Received datagram with " << bytes_transferred << " bytes" << std::endl;
+        receiveBatch();
+      } else if (error != asio::error::operation_aborted) {
+        LOG_ERROR(Net) << "Error waiting for datagrams: " << error.message();
+      }
 
-        if (bytes_transferred == 0) {
-          std::cerr << "Warning: Received zero-byte UDP packet!" << std::endl;
-          // Continue reading but don't process this data
-          readPendingDatagrams();
-          return;
-        }
+      // Continue reading
+      if (running) {
+        readPendingDatagrams();
+      }
+    });
+    return;
+  }
 
-        // Create a new vector with just the received data
-        std::vector<std::uint8_t> messageData(receiveBuffer.begin(), receiveBuffer.begin() + bytes_transferred);
+  // Keep using the same buffer unless a handler took it over
+  PooledBuffer& receiveBuffer = receiveBuffers[0];
+  if (!receiveBuffer) {
+    receiveBuffer = mediaPool->acquire(TX_MEDIA_MAX_LEN);
+  }
 
-        payloadRecv += bytes_transferred;
-        totalRecv += bytes_transferred + 28; // UDP + IPv4 headers
+  socket.async_receive_from(
+    asio::buffer(receiveBuffer.data(), receiveBuffer.capacity()),
+    remote_endpoint,
+    [this](const asio::error_code& error, std::size_t bytes_transferred) {
+      LOG_DEBUG(Net) << "Datagram received with bytes_transferred: " << bytes_transferred;
+      if (!running) {
+        LOG_INFO(Net) << "Shutting down, stopping read";
+        return; // Exit if we're shutting down
+      }
 
-        std::cout << "Sender: " << remote_endpoint.address().to_string()
-                  << ", port: " << remote_endpoint.port() << std::endl;
+      if (!error) {
+        ioReceiveCalls++;
+        ioReceivePackets++;
 
-        printData(&messageData);
-        parseData(&messageData);
+        receiveBuffers[0].resize(bytes_transferred);
+        processDatagram(receiveBuffers[0]);
       } else if (error != asio::error::operation_aborted) {
-        std::cerr << "Error receiving datagram: " << error.message() << std::endl;
+        LOG_ERROR(Net) << "Error receiving datagram: " << error.message();
       }
 
       // Continue reading
@@ -438,53 +1217,109 @@ void Transmitter::readPendingDatagrams()
     });
 }
 
+void Transmitter::receiveBatch()
+{
+  // Replace the buffers taken over by the handlers
+  for (auto& buffer : receiveBuffers) {
+    if (!buffer) {
+      buffer = mediaPool->acquire(TX_MEDIA_MAX_LEN);
+    }
+  }
+
+  asio::error_code ec;
+  std::size_t count = batchSocket.receive(receiveBuffers.data(), receiveSenders.data(),
+                                          receiveBuffers.size(), ec);
+  ioReceiveCalls++;
+  ioReceivePackets += count;
+
+  if (ec) {
+    if (ec != asio::error::would_block) {
+      LOG_ERROR(Net) << "Error receiving datagrams: " << ec.message();
+    }
+    return;
+  }
+
+  LOG_DEBUG(Net) << "Received " << count << " datagrams";
+
+  for (std::size_t i = 0; i < count; i++) {
+    remote_endpoint = receiveSenders[i];
+    processDatagram(receiveBuffers[i]);
+  }
+}
+
+void Transmitter::processDatagram(PooledBuffer& buffer)
+{
+  std::size_t size = buffer.size();
+
+  LOG_DEBUG(Net) << "Received datagram with " << size << " bytes";
+
+  if (size == 0) {
+    LOG_WARN(Net) << "Received zero-byte UDP packet!";
+    return;
+  }
+
+  payloadRecv += size;
+  totalRecv += size + 28; // UDP + IPv4 headers
+  metricReceivedBytes.add(size);
+  capture.append(CaptureDirection::Received, buffer.data(), size, eventLoop.now());
+
+  LOG_DEBUG(Net) << "Sender: " << remote_endpoint.address().to_string()
+                 << ", port: " << remote_endpoint.port();
+
+  // Parse the datagram in place, handlers may take over the buffer
+  printData(buffer.data(), size);
+  parseBuffer = &buffer;
+  parseData(buffer.data(), size);
+  parseBuffer = nullptr;
+}
+
 void Transmitter::printError(int error)
 {
-  std::cerr << "Socket error (" << error << ")" << std::endl;
+  LOG_ERROR(Net) << "Socket error (" << error << ")";
 }
 
-void Transmitter::printData(std::vector<std::uint8_t>* data)
+void Transmitter::printData(const std::uint8_t* data, std::size_t size)
 {
-  std::cout << "Data length: " << data->size() << std::endl;
+  LOG_DEBUG(Net) << "Data length: " << size;
 
-  if (data->size() > 32) {
-    std::cout << "Big packet (video?), not printing content" << std::endl;
-  } else {
+  if (size > 32) {
+    LOG_DEBUG(Net) << "Big packet (video?), not printing content";
+  } else if (Log::compiled(Log::Level::Debug) && Log::enabled(Log::Level::Debug, Log::Module::Net)) {
     // Print in hex format
-    std::cout << "Data: ";
-    for (auto byte : *data) {
-      std::cout << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<int>(byte) << " ";
+    Log::Line line(Log::Level::Debug, Log::Module::Net);
+    line.stream() << "Data: " << std::hex << std::setfill('0');
+    for (std::size_t i = 0; i < size; i++) {
+      line.stream() << std::setw(2) << static_cast<int>(data[i]) << " ";
     }
-    std::cout << std::dec << std::endl;
   }
 }
 
-void Transmitter::parseData(std::vector<std::uint8_t>* data)
+void Transmitter::parseData(const std::uint8_t* data, std::size_t size)
 {
-  std::cout << "Parsing received data" << std::endl;
+  LOG_DEBUG(Net) << "Parsing received data";
 
-    // Don't try to create a Message if we have no data
-    if (data->empty()) {
-        std::cerr << "Received empty packet, ignoring" << std::endl;
+    // Don't try to parse a message if we have no data
+    if (size == 0) {
+        LOG_WARN(Net) << "Received empty packet, ignoring";
         return;
     }
 
     // Check if we have the minimum required data size
-    if (data->size() < MessageOffset::Payload) {
-        std::cerr << "Received packet too small (" << data->size() << " bytes), ignoring" << std::endl;
+    if (size < MessageOffset::Payload) {
+        LOG_WARN(Net) << "Received packet too small (" << size << " bytes), ignoring";
         return;
     }
 
-  Message msg(*data);
+  MessageView msg(data, size);
 
   // isValid() also checks that the packet is exactly as long as expected
-  if (!msg.isValid()) {
-    std::cerr << "Package not valid, ignoring" << std::endl;
+  if (!msg.isValid(crcMode)) {
+    LOG_WARN(Net) << "Package not valid, ignoring";
     return;
   }
 
-  std::cout << "Received message type: " << Message::getTypeStr(msg.type()) << std::endl;
+  LOG_DEBUG(Net) << "Received message type: " << MessageSchema::typeStr(msg.type());
+  metricReceived[msg.type()]->add();
 
   // New data -> connection ok
   if (connectionStatus != CONNECTION_STATUS_OK) {
@@ -499,9 +1334,16 @@ void Transmitter::parseData(std::vector<std::uint8_t>* data)
     connectionTimeoutTimer->stop();
   }
 
-  // Check whether to ACK the packet
+  // ACK every copy of a reliable message, but handle only the newest of
+  // each stream so that a late resend doesn't override newer state
   if (msg.isHighPriority()) {
-    sendACK(msg);
+    bool newest = receiveWindow.receive(msg.fullType(), msg.seq());
+    sendACK(msg.fullType());
+
+    if (!newest) {
+      LOG_DEBUG(Net) << "Late or duplicate " << MessageSchema::typeStr(msg.type()) << " " << msg.seq() << ", ignoring";
+      return;
+    }
   }
 
   // Handle different message types in different methods
@@ -509,142 +1351,152 @@ void Transmitter::parseData(std::vector<std::uint8_t>* data)
     messageHandler func = messageHandlers[msg.type()];
     (this->*func)(msg);
   } else {
-    std::cerr << "No message handler for type "
-              << Message::getTypeStr(msg.type()) << ", ignoring" << std::endl;
+    LOG_WARN(Net) << "No message handler for type "
+                  << MessageSchema::typeStr(msg.type()) << ", ignoring";
   }
 }
 
-void Transmitter::sendACK(Message &incoming)
+void Transmitter::sendACK(std::uint16_t fullType)
 {
-  std::cout << "Sending ACK" << std::endl;
+  std::uint16_t cumulative;
+  std::uint16_t sack;
+  if (!receiveWindow.ack(fullType, cumulative, sack)) {
+    return;
+  }
 
-  auto msg = new Message(MessageType::Ack);
+  LOG_DEBUG(Net) << "Sending ACK up to " << cumulative << ", SACK " << std::hex << sack << std::dec;
 
-  // Sets CRC as well
-  msg->setACK(incoming);
+  PooledBuffer buffer = controlPool->acquire(TX_CONTROL_MAX_LEN);
 
-  sendMessage(msg);
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(MessageType::Ack);
+  builder.setACK(fullType, cumulative, sack);
+  buffer.resize(builder.finish(crcMode));
+
+  queueControl(std::move(buffer));
 }
 
-void Transmitter::handleACK(Message &msg)
+void Transmitter::handleACK(const MessageView &msg)
 {
-  std::cout << "Handling ACK" << std::endl;
+  LOG_DEBUG(Net) << "Handling ACK";
 
   std::uint16_t ackedFullType = msg.getAckedFullType();
-  std::uint16_t ackedCRC = msg.getAckedCRC();
+  std::uint16_t cumulative = msg.getAckedSeq();
+  std::uint16_t sack = msg.getAckedSack();
 
-  // If the ack is not for the latest msg, ignore it
-  if (resendMessages[ackedFullType] &&
-      !resendMessages[ackedFullType]->matchCRC(ackedCRC)) {
-    // We got ack, just not for the latest package. Restart timer to avoid continuous resends.
-    if (resendTimers[ackedFullType]) {
-      resendTimers[ackedFullType]->start(resendTimeoutMs, [this, msg = resendMessages[ackedFullType].get()]() {
-        resendMessage(msg);
-      });
-    }
-    std::cout << "Acked CRC does not match for type: " << ackedFullType << std::endl;
+  InFlightTable::Slot* window = inFlight.window(ackedFullType);
+  if (!window) {
+    LOG_ERROR(Net) << "ACK for a type that is not reliable: " << ackedFullType;
     return;
   }
 
-  // Stop resend timer
-  if (resendTimers[ackedFullType]) {
-    resendTimers[ackedFullType]->stop();
-    resendTimers[ackedFullType].reset();
-  } else {
-    std::cerr << "No Resend timer running for type " << ackedFullType << std::endl;
-  }
-
-  // Process RTT and adjust resend timeout
-  if (rtTimers[ackedFullType]) {
-    auto now = std::chrono::steady_clock::now();
-    auto start = *rtTimers[ackedFullType];
-    int rttMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
-
-    // Emit RTT callback
-    if (onRtt) {
-      onRtt(rttMs);
+  // Stop resending all the messages of the stream the ACK covers, the
+  // timer is armed again for the next deadline when it fires. The most
+  // recently sent of them gives the RTT sample.
+  auto now = eventLoop.now();
+  InFlightTable::Slot* newest = nullptr;
+  bool acked = false;
+  for (std::size_t i = 0; i < INFLIGHT_WINDOW; i++) {
+    InFlightTable::Slot& slot = window[i];
+    if (slot.size == 0 || !ReceiveWindow::isAcked(slot.seq, cumulative, sack)) {
+      continue;
     }
 
-    // Adjust resend timeout but keep it always > 20ms.
-    // If the doubled round trip time is less than current timeout, decrease resendTimeoutMs by 10%.
-    // if the doubled round trip time is greater that current resendTimeoutMs, increase resendTimeoutMs to 2x rtt
-    if (2 * rttMs < resendTimeoutMs) {
-      resendTimeoutMs -= (int)(0.1 * resendTimeoutMs);
-    } else {
-      resendTimeoutMs = 2 * rttMs;
-    }
+    inFlight.unschedule(slot);
+    slot.size = 0;
+    acked = true;
 
-    if (resendTimeoutMs < 20) {
-      resendTimeoutMs = 20;
+    if (!newest || slot.sent > newest->sent) {
+      newest = &slot;
     }
+  }
 
-    // Emit timeout callback
-    if (onResendTimeout) {
-      onResendTimeout(resendTimeoutMs);
-    }
+  if (!acked) {
+    LOG_DEBUG(Net) << "Duplicate ACK for type " << ackedFullType << " up to " << cumulative;
+    return;
+  }
 
-    std::cout << "New resend timeout: " << resendTimeoutMs << std::endl;
+  // Karn's rule: the ACK may be for any of the transmissions of a resent message
+  if (newest->resent) {
+    LOG_DEBUG(Net) << "ACK for a resent message of type " << ackedFullType << ", no RTT sample";
+    return;
+  }
 
-    rtTimers[ackedFullType].reset();
-  } else {
-    std::cerr << "No RT timer running for type " << ackedFullType << std::endl;
+  // Process RTT and adjust resend timeout
+  auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - newest->sent);
+  rttEstimator.sample(rtt);
+  metricAckLatency.record(static_cast<std::uint64_t>(rtt.count()));
+
+  // Emit RTT callback
+  if (onRtt) {
+    onRtt(static_cast<int>(rtt.count() / 1000), rttEstimator.getSrttMs(),
+          rttEstimator.getRttVarMs(), rttEstimator.getRtoMs());
   }
 
-  // Delete the message waiting for resend
-  if (resendMessages[ackedFullType]) {
-    resendMessages[ackedFullType].reset();
+  // Emit timeout callback
+  if (onResendTimeout) {
+    onResendTimeout(rttEstimator.getRtoMs());
   }
+
+  LOG_DEBUG(Net) << "New resend timeout: " << rttEstimator.getRtoMs()
+                 << " (SRTT " << rttEstimator.getSrttMs()
+                 << ", RTTVAR " << rttEstimator.getRttVarMs() << ")";
 }
 
-void Transmitter::handlePing(Message &)
+void Transmitter::handlePing(const MessageView &)
 {
-  std::cout << "Handling ping" << std::endl;
+  LOG_DEBUG(Net) << "Handling ping";
   // We don't do anything with ping (ACKing it is enough).
   // This handler is here to avoid missing handler warning.
 }
 
-void Transmitter::handleVideo(Message &msg)
+void Transmitter::handleVideo(const MessageView &msg)
 {
-  std::cout << "Handling video" << std::endl;
+  LOG_DEBUG(Net) << "Handling video";
 
-  // Copy the data and remove header to get the actual video payload
-  auto* data = new std::vector<std::uint8_t>(*msg.data());
-  data->erase(data->begin(), data->begin() + MessageOffset::Payload);
+  // With FEC the messages are passed on in order, possibly after recovery
+  if (fecPool) {
+    fecReceiveVideo(msg);
+    return;
+  }
 
   // Send the received video payload to the application via callback
   if (onVideo) {
-    onVideo(data);
-  } else {
-    delete data; // Clean up if no callback
+    onVideo(takePayload(msg));
   }
 }
 
-void Transmitter::handleAudio(Message &msg)
+void Transmitter::handleAudio(const MessageView &msg)
 {
-  std::cout << "Handling audio" << std::endl;
-
-  // Copy the data and remove header to get the actual audio payload
-  auto* data = new std::vector<std::uint8_t>(*msg.data());
-  data->erase(data->begin(), data->begin() + MessageOffset::Payload);
+  LOG_DEBUG(Net) << "Handling audio";
 
   // Send the received audio payload to the application via callback
   if (onAudio) {
-    onAudio(data);
-  } else {
-    delete data; // Clean up if no callback
+    onAudio(takePayload(msg));
   }
 }
 
-void Transmitter::handleDebug(Message &msg)
+PooledBuffer Transmitter::takePayload(const MessageView& msg)
 {
-  std::cout << "Handling debug" << std::endl;
+  // Hand over the buffer being parsed without copying if it only holds this message
+  if (parseBuffer && *parseBuffer && msg.data() == parseBuffer->data() && msg.size() == parseBuffer->size()) {
+    PooledBuffer payload = std::move(*parseBuffer);
+    payload.trimFront(MessageOffset::Payload);
+    return payload;
+  }
+
+  // Otherwise copy the payload without the header
+  PooledBuffer payload = mediaPool->acquire(msg.payloadSize());
+  std::copy(msg.payload(), msg.payload() + msg.payloadSize(), payload.data());
+  return payload;
+}
 
-  // Extract debug payload
-  std::vector<std::uint8_t> data(*msg.data());
-  data.erase(data.begin(), data.begin() + MessageOffset::Payload);
+void Transmitter::handleDebug(const MessageView &msg)
+{
+  LOG_DEBUG(Net) << "Handling debug";
 
-  // Convert to string
-  auto* debug = new std::string(data.begin(), data.end());
+  // Convert the debug payload to string
+  auto* debug = new std::string(msg.payload(), msg.payload() + msg.payloadSize());
 
   // Send the received debug message to the application via callback
   if (onDebug) {
@@ -654,36 +1506,409 @@ void Transmitter::handleDebug(Message &msg)
   }
 }
 
-void Transmitter::handleValue(Message &msg)
+void Transmitter::handleValue(const MessageView &msg)
 {
-  std::cout << "Handling value" << std::endl;
+  LOG_DEBUG(Net) << "Handling value";
 
   std::uint8_t type = msg.subType();
   std::uint16_t val = msg.getPayload16();
 
+  if (MessageSchema::subType(type).type != MessageType::Value) {
+    LOG_WARN(Net) << "Unexpected value " << MessageSchema::subTypeStr(type) << ", ignoring";
+    return;
+  }
+
   // Emit the callback with value
   if (onValue) {
     onValue(type, val);
   }
 }
 
-void Transmitter::handlePeriodicValue(Message &msg)
+void Transmitter::handlePeriodicValue(const MessageView &msg)
 {
-  std::cout << "Handling periodic value" << std::endl;
+  LOG_DEBUG(Net) << "Handling periodic value";
 
   std::uint8_t type = msg.subType();
   std::uint16_t val = msg.getPayload16();
 
+  if (MessageSchema::subType(type).type != MessageType::PeriodicValue) {
+    LOG_WARN(Net) << "Unexpected periodic value " << MessageSchema::subTypeStr(type) << ", ignoring";
+    return;
+  }
+
   // Emit the callback with periodic value
   if (onPeriodicValue) {
     onPeriodicValue(type, val);
   }
 }
 
+void Transmitter::handleReceiverReport(const MessageView &msg)
+{
+  LOG_DEBUG(Net) << "Handling receiver report";
+
+  ReceiverReport report;
+  if (!msg.getReceiverReport(report)) {
+    LOG_WARN(Net) << "Invalid receiver report";
+    return;
+  }
+
+  // Emit the callback with the report
+  if (onReceiverReport) {
+    onReceiverReport(report);
+  }
+}
+
+void Transmitter::handleBatch(const MessageView &msg)
+{
+  LOG_DEBUG(Net) << "Handling batch";
+
+  // Parse each packed message as if it was received alone
+  std::size_t offset = 0;
+  MessageView item(nullptr, 0);
+  while (msg.nextBatched(offset, item)) {
+    if (item.type() == MessageType::Batch) {
+      LOG_WARN(Net) << "Nested batch message, ignoring";
+      continue;
+    }
+    parseData(item.data(), item.size());
+  }
+}
+
+void Transmitter::handleFragment(const MessageView &msg)
+{
+  LOG_DEBUG(Net) << "Handling fragment";
+
+  std::uint16_t id = msg.getFragmentId();
+  std::uint8_t index = msg.getFragmentIndex();
+  std::uint8_t count = msg.getFragmentCount();
+  std::uint32_t total = msg.getFragmentTotal();
+  std::size_t size = msg.fragmentSize();
+
+  // All fragments but the last carry the same amount of data
+  std::size_t offset = (index == count - 1) ? total - size : index * size;
+
+  if (index >= count || size == 0 || total > TX_REASSEMBLY_MAX_LEN ||
+      size > total || offset + size > total) {
+    LOG_WARN(Net) << "Invalid fragment " << (int)index << "/" << (int)count
+                  << " of " << total << " bytes, ignoring";
+    return;
+  }
+
+  expireReassembly();
+
+  Reassembly* slot = findReassembly(id, count, total);
+  if (slot->fragments.test(index)) {
+    LOG_DEBUG(Net) << "Duplicate fragment " << (int)index << " of message " << id;
+    return;
+  }
+
+  std::copy(msg.fragmentData(), msg.fragmentData() + size, slot->buffer.data() + offset);
+  slot->fragments.set(index);
+  slot->received++;
+
+  if (slot->received < slot->count) {
+    return;
+  }
+
+  // Complete, parse the reassembled message as if it was received in one datagram
+  PooledBuffer message = std::move(slot->buffer);
+  slot->inUse = false;
+
+  MessageView whole(message.data(), message.size());
+  if (whole.type() == MessageType::Fragment) {
+    LOG_WARN(Net) << "Nested fragment message, ignoring";
+    return;
+  }
+
+  PooledBuffer* previous = parseBuffer;
+  parseBuffer = &message;
+  parseData(message.data(), message.size());
+  parseBuffer = previous;
+}
+
+Transmitter::Reassembly* Transmitter::findReassembly(std::uint16_t id, std::uint8_t count, std::uint32_t total)
+{
+  for (auto& slot : reassembly) {
+    if (slot.inUse && slot.id == id && slot.count == count && slot.total == total) {
+      return &slot;
+    }
+  }
+
+  // Take a free slot, or drop the oldest incomplete message
+  Reassembly* oldest = &reassembly[0];
+  for (auto& slot : reassembly) {
+    if (!slot.inUse) {
+      oldest = &slot;
+      break;
+    }
+    if (slot.started < oldest->started) {
+      oldest = &slot;
+    }
+  }
+
+  if (oldest->inUse) {
+    LOG_WARN(Net) << "Dropping incomplete message " << oldest->id << " ("
+                  << (int)oldest->received << "/" << (int)oldest->count << " fragments)";
+    reassemblyTimeouts++;
+  }
+
+  oldest->inUse = true;
+  oldest->id = id;
+  oldest->count = count;
+  oldest->received = 0;
+  oldest->total = total;
+  oldest->fragments.reset();
+  oldest->started = eventLoop.now();
+  oldest->buffer = mediaPool->acquire(total);
+
+  return oldest;
+}
+
+void Transmitter::expireReassembly(void)
+{
+  auto now = eventLoop.now();
+
+  for (auto& slot : reassembly) {
+    if (slot.inUse && now - slot.started > std::chrono::milliseconds(TX_REASSEMBLY_TIMEOUT_MS)) {
+      LOG_WARN(Net) << "Reassembly timeout for message " << slot.id << " ("
+                    << (int)slot.received << "/" << (int)slot.count << " fragments)";
+      slot.inUse = false;
+      slot.buffer.release();
+      reassemblyTimeouts++;
+    }
+  }
+}
+
+void Transmitter::fecAddVideo(const MessageView& msg)
+{
+  // XOR the whole message, including the header, into the parity
+  if (fecGroupCount == 0) {
+    fecFirstSeq = msg.seq();
+    fecLengthXor = 0;
+    fecParityLength = 0;
+  }
+
+  for (std::size_t i = 0; i < msg.size(); i++) {
+    fecParity[i] = (i < fecParityLength ? fecParity[i] : 0) ^ msg.data()[i];
+  }
+
+  fecParityLength = std::max(fecParityLength, msg.size());
+  fecLengthXor ^= static_cast<std::uint16_t>(msg.size());
+  fecGroupCount++;
+}
+
+void Transmitter::sendVideoParity(void)
+{
+  PooledBuffer buffer = mediaPool->acquire(MessageOffset::ParityData + fecParityLength);
+
+  MessageBuilder builder(buffer.data(), buffer.capacity());
+  builder.begin(MessageType::VideoParity);
+  builder.setParity(fecFirstSeq, fecGroupCount, fecLengthXor);
+  builder.append(fecParity.data(), fecParityLength);
+  buffer.resize(builder.finish(crcMode));
+
+  fecGroupCount = 0;
+
+  sendBuffer(std::move(buffer));
+}
+
+void Transmitter::handleVideoParity(const MessageView &msg)
+{
+  LOG_DEBUG(Net) << "Handling video parity";
+
+  // The remote end uses FEC, start keeping the received video messages
+  if (!fecPool) {
+    LOG_INFO(Net) << "Video FEC enabled by the remote end";
+    fecPool = std::make_shared<BufferPool>(TX_FEC_HISTORY + 1, TX_MEDIA_MAX_LEN);
+    return;
+  }
+
+  if (!fecSynced) {
+    return;
+  }
+
+  std::uint16_t first = msg.getParityFirstSeq();
+  std::uint8_t count = msg.getParityCount();
+  std::uint16_t length = msg.getParityLength();
+
+  if (count == 0 || count > TX_FEC_MAX_GROUP) {
+    LOG_WARN(Net) << "Invalid video parity for " << (int)count << " messages, ignoring";
+    return;
+  }
+
+  // Find the lost messages, the ones already given up on are not needed anymore
+  std::size_t missing = 0;
+  std::size_t needed = 0;
+  std::uint16_t lost = 0;
+  for (std::uint16_t i = 0; i < count; i++) {
+    std::uint16_t seq = first + i;
+    FecEntry* entry = fecFind(seq);
+    if (entry) {
+      length ^= static_cast<std::uint16_t>(entry->message.size());
+      continue;
+    }
+    missing++;
+    if (static_cast<std::int16_t>(seq - fecNextSeq) >= 0) {
+      needed++;
+      lost = seq;
+    }
+  }
+
+  if (needed == 0) {
+    return;
+  }
+
+  if (missing > 1 || length < MessageOffset::Payload || length > msg.paritySize()) {
+    LOG_WARN(Net) << "Cannot recover " << needed << " lost video messages";
+    fecUnrecoverable += needed;
+    fecGiveUp(first + count);
+    return;
+  }
+
+  // XOR of the parity and the other messages of the group is the lost message
+  PooledBuffer recovered = fecPool->acquire(length);
+  std::copy(msg.parityData(), msg.parityData() + length, recovered.data());
+  for (std::uint16_t i = 0; i < count; i++) {
+    FecEntry* entry = fecFind(first + i);
+    if (!entry) {
+      continue;
+    }
+    std::size_t size = std::min<std::size_t>(length, entry->message.size());
+    for (std::size_t j = 0; j < size; j++) {
+      recovered.data()[j] ^= entry->message.data()[j];
+    }
+  }
+
+  MessageView view(recovered.data(), recovered.size());
+  if (view.type() != MessageType::Video || view.seq() != lost || !view.isValid(crcMode)) {
+    LOG_ERROR(Net) << "Recovered video message not valid";
+    fecUnrecoverable++;
+    fecGiveUp(first + count);
+    return;
+  }
+
+  LOG_INFO(Net) << "Recovered lost video message " << lost;
+  fecRecovered++;
+
+  // Handle as if it was received
+  PooledBuffer* previous = parseBuffer;
+  parseBuffer = &recovered;
+  fecReceiveVideo(view);
+  parseBuffer = previous;
+}
+
+void Transmitter::fecReceiveVideo(const MessageView& msg)
+{
+  std::uint16_t seq = msg.seq();
+
+  if (!fecSynced) {
+    fecSynced = true;
+    fecNextSeq = seq;
+    fecHighestSeq = seq;
+  }
+
+  std::int16_t ahead = static_cast<std::int16_t>(seq - fecNextSeq);
+
+  // Already passed on, or given up on and now too late
+  if (ahead < 0 || fecFind(seq)) {
+    LOG_DEBUG(Net) << "Late or duplicate video message " << seq << ", ignoring";
+    return;
+  }
+
+  // Too far ahead to wait for the missing ones, start over
+  if (ahead >= static_cast<std::int16_t>(TX_FEC_HISTORY)) {
+    LOG_WARN(Net) << "Video messages " << fecNextSeq << " - " << seq << " lost";
+    fecGiveUp(seq);
+  }
+
+  // Keep a copy for recovering other messages of the group
+  FecEntry& entry = fecHistory[seq % TX_FEC_HISTORY];
+  entry.message.release();
+  entry.seq = seq;
+  entry.message = fecPool->acquire(msg.size());
+  std::copy(msg.data(), msg.data() + msg.size(), entry.message.data());
+
+  if (static_cast<std::int16_t>(seq - fecHighestSeq) > 0) {
+    fecHighestSeq = seq;
+  }
+
+  // The common case, pass on without waiting
+  if (seq == fecNextSeq && !fecHolding) {
+    fecNextSeq++;
+    if (onVideo) {
+      onVideo(takePayload(msg));
+    }
+    return;
+  }
+
+  fecDeliverInOrder();
+  fecCheckHold();
+}
+
+void Transmitter::fecDeliverInOrder(void)
+{
+  // Pass on the messages up to the first missing one
+  FecEntry* entry;
+  while ((entry = fecFind(fecNextSeq)) != nullptr) {
+    fecNextSeq++;
+    if (onVideo) {
+      MessageView view(entry->message.data(), entry->message.size());
+      PooledBuffer payload = mediaPool->acquire(view.payloadSize());
+      std::copy(view.payload(), view.payload() + view.payloadSize(), payload.data());
+      onVideo(std::move(payload));
+    }
+  }
+
+  // Hold the later ones while waiting for the missing message
+  bool holding = static_cast<std::int16_t>(fecHighestSeq - fecNextSeq) > 0;
+  if (holding && !fecHolding) {
+    fecHoldStart = eventLoop.now();
+  }
+  fecHolding = holding;
+}
+
+void Transmitter::fecGiveUp(std::uint16_t untilSeq)
+{
+  // Skip the missing messages before untilSeq, pass on the ones received
+  while (static_cast<std::int16_t>(untilSeq - fecNextSeq) > 0) {
+    if (fecFind(fecNextSeq)) {
+      fecDeliverInOrder();
+    } else {
+      fecNextSeq++;
+    }
+  }
+
+  fecDeliverInOrder();
+}
+
+void Transmitter::fecCheckHold(void)
+{
+  if (!fecHolding ||
+      eventLoop.now() - fecHoldStart < std::chrono::milliseconds(TX_FEC_HOLD_MS)) {
+    return;
+  }
+
+  // No parity arrived in time, skip to the next received message
+  std::uint16_t next = fecNextSeq;
+  while (!fecFind(next) && next != fecHighestSeq) {
+    next++;
+  }
+
+  LOG_WARN(Net) << "Gave up waiting for video messages " << fecNextSeq << " - " << next;
+  fecUnrecoverable += static_cast<std::uint16_t>(next - fecNextSeq);
+  fecGiveUp(next);
+}
+
+Transmitter::FecEntry* Transmitter::fecFind(std::uint16_t seq)
+{
+  FecEntry& entry = fecHistory[seq % TX_FEC_HISTORY];
+  return entry.message && entry.seq == seq ? &entry : nullptr;
+}
+
 void Transmitter::updateRate()
 {
   // Time in ms since last update
-  auto now = std::chrono::steady_clock::now();
+  auto now = eventLoop.now();
   auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - rateTime).count();
   rateTime = now;
 
@@ -707,14 +1932,50 @@ void Transmitter::updateRate()
   if (onNetworkRate) {
     onNetworkRate(payloadRx, totalRx, payloadTx, totalTx);
   }
+
+  // Release buffers of incomplete messages that will not complete anymore
+  expireReassembly();
+  fecCheckHold();
+
+  // Emit buffer pool callback
+  if (onPoolStats) {
+    onPoolStats(getPoolHits(), getPoolMisses());
+  }
+
+  // Emit video FEC callback
+  if (onFecStats) {
+    onFecStats(fecRecovered, fecUnrecoverable);
+  }
+
+  // Emit datagrams per system call callback
+  if (onIoStats) {
+    float rxPerCall = ioReceiveCalls ? static_cast<float>(ioReceivePackets) / ioReceiveCalls : 0.0f;
+    float txPerCall = ioSendCalls ? static_cast<float>(ioSendPackets) / ioSendCalls : 0.0f;
+    onIoStats(rxPerCall, txPerCall);
+  }
+  ioReceiveCalls = 0;
+  ioReceivePackets = 0;
+  ioSendCalls = 0;
+  ioSendPackets = 0;
+
+  // Emit pacer callback
+  if (onPacerStats) {
+    auto delayMs = std::chrono::duration_cast<std::chrono::milliseconds>(pacerDelayMax).count();
+    onPacerStats(static_cast<int>(pacerQueue.size()), static_cast<int>(delayMs), pacerDrops);
+  }
+  pacerDelayMax = std::chrono::steady_clock::duration(0);
+  pacerDrops = 0;
 }
 
 void Transmitter::connectionTimeout()
 {
-  std::cout << "Connection timeout" << std::endl;
+  LOG_INFO(Net) << "Connection timeout";
+
+  // Start over with the initial resend timeout
+  rttEstimator.reset();
 
-  // Reset timeout to default
-  resendTimeoutMs = RESEND_TIMEOUT_DEFAULT;
+  // The peer may have restarted with new sequence numbers
+  receiveWindow.clear();
 
   if (connectionStatus != CONNECTION_STATUS_LOST) {
     connectionStatus = CONNECTION_STATUS_LOST;
@@ -6,14 +6,28 @@
 #pragma once
 
 #include "Message.h"
+#include "MessageView.h"
+#include "MessageBuilder.h"
+#include "MessageSchema.h"
+#include "Crc.h"
+#include "BufferPool.h"
+#include "BatchSocket.h"
+#include "InFlightTable.h"
+#include "ReceiveWindow.h"
+#include "RttEstimator.h"
+#include "RingQueue.h"
+#include "ReceiverReport.h"
 #include "Event.h"
 #include "Timer.h"
+#include "Metrics.h"
+#include "Capture.h"
 
 #include <string>
 #include <vector>
+#include <array>
 #include <functional>
 #include <chrono>
-#include <map>
+#include <bitset>
 #include <memory>
 #include <atomic>
 #include <asio.hpp>
@@ -22,31 +36,144 @@
 #define CONNECTION_STATUS_RETRYING    0x2
 #define CONNECTION_STATUS_LOST        0x3
 
+// Fixed storage for small control messages (Ping, Value, PeriodicValue, Ack)
+constexpr std::size_t TX_CONTROL_MAX_LEN = 16U;
+constexpr std::size_t TX_CONTROL_SLOTS   = 32U;
+
+// Datagrams received per wakeup with batched socket I/O
+constexpr std::size_t TX_IO_BATCH        = 16U;
+
+// Datagrams waiting to be sent are queued per priority class and sent
+// strictly in class order. Only a little data is let into the socket
+// send buffer so a control message doesn't wait behind queued video, the
+// buffer is polled while lower classes wait for room.
+constexpr std::size_t TX_SEND_CLASSES          = static_cast<std::size_t>(MessageSchema::Class::Video) + 1;
+constexpr std::size_t TX_SEND_QUEUE            = 256U;
+constexpr std::size_t TX_SOCKET_QUEUE_DEFAULT  = 16U * 1024U;
+constexpr int         TX_SOCKET_POLL_US        = 1000;
+
+// Header in front of the datagrams sent through a netrelay shared by
+// several cars: the magic and the session ID, 32 bits each in network
+// byte order. The relay strips it before forwarding, see netrelay/session.h.
+constexpr std::uint32_t TX_RELAY_MAGIC      = 0x504c5231U;  // "PLR1"
+constexpr std::size_t   TX_RELAY_HEADER_LEN = 8U;
+
+// Pooled storage for received datagrams and outgoing media messages
+constexpr std::size_t TX_MEDIA_MAX_LEN   = 4096U;
+constexpr std::size_t TX_MEDIA_SLOTS     = 64U + TX_IO_BATCH;
+
+// Coalesced small messages are kept well below the path MTU
+constexpr std::size_t TX_BATCH_MAX_LEN   = 512U;
+
+// Video, audio and debug messages longer than the fragment size are sent
+// in fragments and reassembled by the receiver
+constexpr std::size_t TX_FRAGMENT_SIZE_DEFAULT = 1400U;   // Fits in a 1500 byte MTU
+constexpr std::size_t TX_FRAGMENT_MAX_COUNT    = 255U;
+constexpr std::size_t TX_REASSEMBLY_SLOTS      = 8U;
+constexpr std::size_t TX_REASSEMBLY_MAX_LEN    = 1U << 20;
+constexpr int         TX_REASSEMBLY_TIMEOUT_MS = 500;
+
+// Forward error correction for video: one XOR parity message per group
+// of video messages recovers one lost message of the group
+constexpr std::size_t TX_FEC_MAX_GROUP = 32U;
+constexpr std::size_t TX_FEC_HISTORY   = 2 * TX_FEC_MAX_GROUP;
+constexpr int         TX_FEC_HOLD_MS   = 100;   // Max wait for a lost message to be recovered
+
+// Pacing of video datagrams. The token bucket holds a couple of full
+// datagrams so a lone small message is not delayed. Datagrams that don't
+// fit in the queue or have waited too long to be useful are dropped.
+constexpr std::size_t TX_PACER_QUEUE        = 256U;
+constexpr std::size_t TX_PACER_BURST        = 2 * TX_FRAGMENT_SIZE_DEFAULT;
+constexpr int         TX_PACER_MAX_DELAY_MS = 500;
+
+static_assert(MessageSchema::maxFixedLength() <= TX_CONTROL_MAX_LEN,
+              "Control message buffers too small for fixed size messages");
+
 class Transmitter
 {
  public:
   // Callback types
-  using RttCallback = std::function<void(int ms)>;
+  using RttCallback = std::function<void(int ms, int srttMs, int rttVarMs, int rtoMs)>;
   using ResendTimeoutCallback = std::function<void(int ms)>;
   using ResentPacketsCallback = std::function<void(uint32_t resendCounter)>;
-  using VideoCallback = std::function<void(std::vector<uint8_t>* video)>;
-  using AudioCallback = std::function<void(std::vector<uint8_t>* audio)>;
+  using VideoCallback = std::function<void(PooledBuffer video)>;
+  using AudioCallback = std::function<void(PooledBuffer audio)>;
   using DebugCallback = std::function<void(std::string* debug)>;
   using ValueCallback = std::function<void(uint8_t type, uint16_t value)>;
   using PeriodicValueCallback = std::function<void(uint8_t type, uint16_t value)>;
   using NetworkRateCallback = std::function<void(int payloadRx, int totalRx, int payloadTx, int totalTx)>;
   using ConnectionStatusCallback = std::function<void(int status)>;
+  using PoolStatsCallback = std::function<void(uint32_t hits, uint32_t misses)>;
+  using FecStatsCallback = std::function<void(uint32_t recovered, uint32_t unrecoverable)>;
+  using IoStatsCallback = std::function<void(float rxPacketsPerCall, float txPacketsPerCall)>;
+  using PacerStatsCallback = std::function<void(int queueDepth, int delayMs, uint32_t drops)>;
+  using ReceiverReportCallback = std::function<void(const ReceiverReport& report)>;
+  using DatagramSender = std::function<void(const std::uint8_t* data, std::size_t size)>;
 
   // Message handler function prototype
-  using messageHandler = void (Transmitter::*)(Message &msg);
+  using messageHandler = void (Transmitter::*)(const MessageView &msg);
 
   // Modified constructor to take EventLoop reference instead of creating its own
   Transmitter(EventLoop& eventLoop, const std::string& host, uint16_t port);
   ~Transmitter();
 
+  // All the networking and the callbacks run on this strand. The setters
+  // below are to be called before initSocket() or on the strand.
+  EventLoop::Strand& getStrand(void);
+
   void initSocket();
   void enableAutoPing(bool enable);
 
+  // Checksum mode for this connection, must match the remote end
+  void setCrcMode(Crc::Mode mode);
+
+  // Pack small messages sent within the same event loop turn, or within
+  // windowUs microseconds, into one datagram. Any receiver can unpack them.
+  void setCoalescing(bool enable, int windowUs = 0);
+
+  // Receive and send several datagrams per system call where supported
+  // (Linux). Enabled by default, must be set before initSocket().
+  void setBatchedIo(bool enable);
+
+  // Most bytes kept in the socket send buffer, 0 for no limit. Control
+  // messages are sent regardless of the limit.
+  void setSocketQueueLimit(std::size_t bytes);
+
+  // Send through a relay shared by several cars, with the session ID in
+  // a header in front of every datagram. 0 sends plain datagrams, as to
+  // a relay of one car. Must be set before initSocket().
+  void setRelaySession(std::uint32_t session);
+
+  // Largest datagram sent for fragmented messages
+  void setFragmentSize(std::size_t size);
+
+  // Send one parity message per groupSize video messages, 0 disables.
+  // The overhead is 1/groupSize. Receivers recover automatically.
+  void setVideoFec(std::size_t groupSize);
+
+  // Send video datagrams at most at bitsPerSecond, 0 disables. A rate
+  // somewhat above the encoder bitrate spreads each frame over the frame
+  // interval instead of sending it as one burst.
+  void setPacingRate(int bitsPerSecond);
+
+  // Append every datagram sent and received to a capture file, see
+  // Capture.h. To be called before initSocket() or on the strand.
+  bool startCapture(const std::string& path);
+  void stopCapture(void);
+
+  // Send nothing, e.g. when replaying a capture. Must be set before
+  // initSocket().
+  void setOffline(bool enable);
+
+  // Handle a datagram as if it was received from the socket, e.g. from
+  // a DatagramLink or a capture. Can be called from any thread.
+  void receiveDatagram(const std::uint8_t* data, std::size_t size);
+
+  // Hand the datagrams to the sender instead of a UDP socket, e.g. to a
+  // DatagramLink that delivers them with receiveDatagram(). No socket is
+  // opened. Must be set before initSocket().
+  void setDatagramSender(DatagramSender sender);
+
   // Methods to set callbacks
   void setRttCallback(RttCallback callback);
   void setResendTimeoutCallback(ResendTimeoutCallback callback);
@@ -58,57 +185,215 @@ class Transmitter
   void setPeriodicValueCallback(PeriodicValueCallback callback);
   void setNetworkRateCallback(NetworkRateCallback callback);
   void setConnectionStatusCallback(ConnectionStatusCallback callback);
+  void setPoolStatsCallback(PoolStatsCallback callback);
+  void setFecStatsCallback(FecStatsCallback callback);
+  void setIoStatsCallback(IoStatsCallback callback);
+  void setPacerStatsCallback(PacerStatsCallback callback);
+  void setReceiverReportCallback(ReceiverReportCallback callback);
 
-  // Public methods
+  // Public methods, these can be called from any thread
   void sendPing();
-  void sendVideo(std::vector<uint8_t>* video);
-  void sendAudio(std::vector<uint8_t>* audio);
+  void sendVideo(const std::uint8_t* video, std::size_t size);
+  void sendAudio(const std::uint8_t* audio, std::size_t size);
   void sendDebug(std::string* debug);
   void sendValue(uint8_t type, uint16_t value);
   void sendPeriodicValue(uint8_t type, uint16_t value);
+  void sendReceiverReport(const ReceiverReport& report);
+
+  // Buffers served from the pools and the ones that fell back to the heap
+  std::uint32_t getPoolHits(void) const;
+  std::uint32_t getPoolMisses(void) const;
+
+  // Fragmented messages dropped because not all fragments arrived in time
+  std::uint32_t getReassemblyTimeouts(void) const;
+
+  // Lost video messages recovered from parity, and ones given up on
+  std::uint32_t getFecRecovered(void) const;
+  std::uint32_t getFecUnrecoverable(void) const;
+
+  // Datagrams waiting to be sent, and ones dropped as their queue was full
+  std::size_t getSendQueueDepth(void) const;
+  std::uint32_t getSendQueueDrops(void) const;
+
+  // Datagrams waiting in the pacer and how long the oldest has waited
+  std::size_t getPacerQueueDepth(void) const;
+  int getPacerDelayMs(void) const;
 
  private:
+  // Received video message kept for parity recovery and in order delivery
+  struct FecEntry {
+    std::uint16_t seq;
+    PooledBuffer message;
+  };
+
+  // Datagram waiting for its turn in the pacer
+  struct PacedBuffer {
+    PooledBuffer buffer;
+    std::chrono::steady_clock::time_point queued;
+  };
+
+  // Fragmented message being reassembled
+  struct Reassembly {
+    bool inUse;
+    std::uint16_t id;
+    std::uint8_t count;
+    std::uint8_t received;
+    std::uint32_t total;
+    std::bitset<TX_FRAGMENT_MAX_COUNT> fragments;
+    std::chrono::steady_clock::time_point started;
+    PooledBuffer buffer;
+  };
+
+  bool openSocket(void);
   void readPendingDatagrams();
+  void receiveBatch();
+  void processDatagram(PooledBuffer& buffer);
   void printError(int error);
-  void sendMessage(Message* msg);
-  void resendMessage(Message* msg);
+  bool resolveRemote();
+  void sendMedia(std::uint8_t type, const std::uint8_t* payload, std::size_t size);
+  void enqueue(PooledBuffer buffer, bool control);
+  void queueMedia(PooledBuffer buffer);
+  void sendBuffer(PooledBuffer buffer);
+  void transmitBuffer(PooledBuffer buffer);
+  void flushSends();
+  void flushToSender(void);
+  void datagramSent(const std::uint8_t* data, std::size_t size);
+  void pollSocketQueue(void);
+  void queuePaced(PooledBuffer buffer);
+  void drainPacer(void);
+  void sendFragments(PooledBuffer message);
+  void queueControl(PooledBuffer buffer);
+  void flushBatch();
+  PooledBuffer takePayload(const MessageView& msg);
+  void messageSent(const MessageView& msg);
+  void resendMessage(const InFlightTable::Slot& slot);
   void updateRate();
   void connectionTimeout();
 
-  void printData(std::vector<uint8_t>* data);
-  void parseData(std::vector<uint8_t>* data);
-  void handleACK(Message& msg);
-  void handlePing(Message& msg);
-  void handleVideo(Message& msg);
-  void handleAudio(Message& msg);
-  void handleDebug(Message& msg);
-  void handleValue(Message& msg);
-  void handlePeriodicValue(Message& msg);
-  void sendACK(Message& incoming);
-  void startResendTimer(Message* msg);
-  void startRTTimer(Message* msg);
+  void printData(const std::uint8_t* data, std::size_t size);
+  void parseData(const std::uint8_t* data, std::size_t size);
+  void handleACK(const MessageView& msg);
+  void handlePing(const MessageView& msg);
+  void handleVideo(const MessageView& msg);
+  void handleAudio(const MessageView& msg);
+  void handleDebug(const MessageView& msg);
+  void handleValue(const MessageView& msg);
+  void handlePeriodicValue(const MessageView& msg);
+  void handleBatch(const MessageView& msg);
+  void handleFragment(const MessageView& msg);
+  void handleReceiverReport(const MessageView& msg);
+  Reassembly* findReassembly(std::uint16_t id, std::uint8_t count, std::uint32_t total);
+  void expireReassembly(void);
+  void handleVideoParity(const MessageView& msg);
+
+  // Handler of each message type known by MessageSchema, built at compile time
+  using MessageHandlers = std::array<messageHandler, MSG_TYPE_MAX>;
+  static constexpr MessageHandlers makeMessageHandlers(void);
+  static constexpr bool handlesSchemaTypes(const MessageHandlers& handlers);
+  static const MessageHandlers messageHandlers;
+
+  void fecAddVideo(const MessageView& msg);
+  void sendVideoParity(void);
+  void fecReceiveVideo(const MessageView& msg);
+  void fecDeliverInOrder(void);
+  void fecGiveUp(std::uint16_t untilSeq);
+  void fecCheckHold(void);
+  FecEntry* fecFind(std::uint16_t seq);
+  void sendACK(std::uint16_t fullType);
+  void armResendTimer(void);
+  void resendExpired(void);
   void startConnectionTimeout();
 
   // Reference to shared EventLoop instead of owning an io_context
   EventLoop& eventLoop;
 
+  // Serialises the handlers when the loop runs on several threads
+  EventLoop::Strand strand;
+
   // ASIO networking components (no io_context - we use the one from EventLoop)
-  asio::ip::udp::socket socket;
+  EventLoop::StrandSocket socket;
   asio::ip::udp::endpoint remote_endpoint;
 
-  // Add this to the private section:
-  std::vector<std::uint8_t> receiveBuffer;
+  // Buffers for control messages, media messages and received datagrams
+  std::shared_ptr<BufferPool> controlPool;
+  std::shared_ptr<BufferPool> mediaPool;
+  std::array<PooledBuffer, TX_IO_BATCH> receiveBuffers;
+  std::array<asio::ip::udp::endpoint, TX_IO_BATCH> receiveSenders;
+
+  // Batched socket I/O, datagrams sent in one event loop turn are queued
+  // and sent together
+  BatchSocket batchSocket;
+  bool batchIo;
+  bool sendFlushPending;
+
+  // Send queues by priority class, Control first
+  std::array<RingQueue<PooledBuffer, TX_SEND_QUEUE>, TX_SEND_CLASSES> sendQueues;
+  std::uint32_t sendQueueDrops;
+  bool sendInProgress;                    // Unbatched send waiting for completion
+  std::size_t socketQueueLimit;
+  EventLoop::StrandTimer socketPollTimer;
+  bool socketPollArmed;
+
+  // Relay header sent in front of every datagram, if in a relay session
+  std::uint32_t relaySession;
+  std::array<std::uint8_t, TX_RELAY_HEADER_LEN> relayHeader;
+
+  // Token bucket pacing of video datagrams
+  double pacerRate;                       // Bytes per second, 0 if not pacing
+  double pacerTokens;                     // Bytes that may be sent now, negative when in debt
+  std::chrono::steady_clock::time_point pacerRefill;
+  EventLoop::StrandTimer pacerTimer;
+  bool pacerTimerArmed;
+  RingQueue<PacedBuffer, TX_PACER_QUEUE> pacerQueue;
+  std::uint32_t pacerDrops;
+  std::chrono::steady_clock::duration pacerDelayMax;    // Since the last rate update
+
+  // Buffer holding the data being parsed, handlers may take it over
+  PooledBuffer* parseBuffer;
 
   std::string relayHost;
   uint16_t relayPort;
-  int resendTimeoutMs;
+  RttEstimator rttEstimator;
   uint32_t resendCounter;
+  Crc::Mode crcMode;
+
+  // Small messages waiting to be sent in one datagram
+  bool coalesce;
+  std::chrono::microseconds coalesceWindow;
+  Timer batchTimer;
+  PooledBuffer batchBuffer;
+
+  // Fragmentation and reassembly
+  std::size_t fragmentSize;
+  std::uint16_t nextFragmentId;
+  std::array<Reassembly, TX_REASSEMBLY_SLOTS> reassembly;
+  std::uint32_t reassemblyTimeouts;
+
+  // Video FEC sender
+  std::size_t fecGroupSize;
+  std::size_t fecGroupCount;
+  std::uint16_t fecFirstSeq;
+  std::uint16_t fecLengthXor;
+  std::size_t fecParityLength;
+  std::array<std::uint8_t, TX_MEDIA_MAX_LEN> fecParity;
 
-  // Map for managing resend timers and callbacks
-  std::map<uint16_t, std::shared_ptr<Timer>> resendTimers;
-  std::map<uint16_t, std::shared_ptr<std::chrono::steady_clock::time_point>> rtTimers;
-  std::map<uint16_t, std::unique_ptr<Message>> resendMessages;
-  messageHandler messageHandlers[MSG_TYPE_MAX] = {nullptr};
+  // Video FEC receiver, active once parity messages are received
+  std::shared_ptr<BufferPool> fecPool;
+  std::array<FecEntry, TX_FEC_HISTORY> fecHistory;
+  bool fecSynced;
+  std::uint16_t fecNextSeq;
+  std::uint16_t fecHighestSeq;
+  bool fecHolding;
+  std::chrono::steady_clock::time_point fecHoldStart;
+  std::uint32_t fecRecovered;
+  std::uint32_t fecUnrecoverable;
+
+  // Reliable messages waiting for an ACK, one timer for all resends
+  InFlightTable inFlight;
+  ReceiveWindow receiveWindow;
+  EventLoop::StrandTimer resendTimer;
+  bool resendTimerArmed;
+  std::chrono::steady_clock::time_point resendTimerDeadline;
 
   std::shared_ptr<Timer> connectionTimeoutTimer;
   int connectionStatus;
@@ -123,9 +408,32 @@ class Transmitter
   std::shared_ptr<Timer> rateTimer;
   std::chrono::steady_clock::time_point rateTime;
 
+  // System calls and datagrams since the last rate update
+  std::uint32_t ioReceiveCalls;
+  std::uint32_t ioReceivePackets;
+  std::uint32_t ioSendCalls;
+  std::uint32_t ioSendPackets;
+
   // No need for io_thread since the EventLoop handles this
   std::atomic<bool> running;
 
+  // Datagram capture and replay
+  CaptureWriter capture;
+  bool offline;
+
+  // In place of the socket, when set
+  DatagramSender datagramSender;
+
+  // Exported metrics, per message type where it matters
+  std::array<Metrics::Counter*, MSG_TYPE_MAX> metricSent;
+  std::array<Metrics::Counter*, MSG_TYPE_MAX> metricReceived;
+  std::array<Metrics::Counter*, MSG_TYPE_MAX> metricResent;
+  Metrics::Counter& metricSentBytes;
+  Metrics::Counter& metricReceivedBytes;
+  Metrics::Counter& metricSendQueueDrops;
+  Metrics::Counter& metricPacerDrops;
+  Metrics::Histogram& metricAckLatency;
+
   // Callback
   RttCallback onRtt;
   ResendTimeoutCallback onResendTimeout;
@@ -137,6 +445,11 @@ class Transmitter
   PeriodicValueCallback onPeriodicValue;
   NetworkRateCallback onNetworkRate;
   ConnectionStatusCallback onConnectionStatus;
+  PoolStatsCallback onPoolStats;
+  FecStatsCallback onFecStats;
+  IoStatsCallback onIoStats;
+  PacerStatsCallback onPacerStats;
+  ReceiverReportCallback onReceiverReport;
 };
 
 /* Emacs indentatation information
@@ -4,8 +4,8 @@
  */
 
 #include "AudioReceiver.h"
+#include "Log.h"
 
-#include <iostream>
 #include <cstring>  // for memcpy
 
 #include <gst/gst.h>
@@ -25,13 +25,13 @@ AudioReceiver::AudioReceiver()
   }
 #endif
 
-  std::cout << "AudioReceiver initialized" << std::endl;
+  LOG_INFO(Audio) << "AudioReceiver initialized";
 }
 
 AudioReceiver::~AudioReceiver()
 {
   // Clean up
-  std::cout << "Stopping audio playback" << std::endl;
+  LOG_INFO(Audio) << "Stopping audio playback";
   if (pipeline) {
     gst_element_set_state(pipeline, GST_STATE_NULL);
     gst_object_unref(GST_OBJECT(pipeline));
@@ -50,24 +50,24 @@ gboolean AudioReceiver::busCall(GstBus *bus, GstMessage *message, gpointer data)
   switch (GST_MESSAGE_TYPE(message)) {
   case GST_MESSAGE_ERROR:
     gst_message_parse_error(message, &error, &debug);
-    std::cerr << "Error: " << (error ? error->message : "unknown error") << std::endl;
+    LOG_ERROR(Audio) << "Error: " << (error ? error->message : "unknown error");
     g_error_free(error);
     g_free(debug);
     break;
 
   case GST_MESSAGE_EOS:
     // end-of-stream
-    std::cerr << "Warning: EOS" << std::endl;
+    LOG_WARN(Audio) << "EOS";
     break;
 
   case GST_MESSAGE_WARNING:
     gst_message_parse_warning(message, &error, &debug);
     if (error != nullptr) {
-      std::cerr << "Warning: " << error->message << std::endl;
+      LOG_WARN(Audio) << "Warning: " << error->message;
       g_error_free(error);
     }
     if (debug != nullptr) {
-      std::cout << "Debug: " << debug << std::endl;
+      LOG_DEBUG(Audio) << "Debug: " << debug;
       g_free(debug);
     }
     break;
@@ -80,7 +80,7 @@ gboolean AudioReceiver::busCall(GstBus *bus, GstMessage *message, gpointer data)
 
   default:
     // Unhandled message
-    std::cerr << "Unhandled message: " << gst_message_type_get_name(GST_MESSAGE_TYPE(message)) << std::endl;
+    LOG_WARN(Audio) << "Unhandled message: " << gst_message_type_get_name(GST_MESSAGE_TYPE(message));
     break;
   }
 
@@ -93,13 +93,13 @@ bool AudioReceiver::enableAudio(bool enable)
   GError *error = nullptr;
 
   if (!enable) {
-    std::cerr << "disabling AudioReceiver not implemented" << std::endl;
+    LOG_WARN(Audio) << "disabling AudioReceiver not implemented";
     return false;
   }
 
   // Initialisation
   if (!gst_init_check(nullptr, nullptr, nullptr)) {
-    std::cerr << "Failed to init GST" << std::endl;
+    LOG_ERROR(Audio) << "Failed to init GST";
     return false;
   }
 
@@ -111,19 +111,19 @@ bool AudioReceiver::enableAudio(bool enable)
                                "audioconvert ! "
                                "alsasink sync=false";
 
-  std::cout << "Using pipeline: " << pipelineString << std::endl;
+  LOG_INFO(Audio) << "Using pipeline: " << pipelineString;
 
   // Create decoding audio pipeline
   pipeline = gst_parse_launch(pipelineString.c_str(), &error);
   if (!pipeline) {
-    std::cerr << "Failed to parse pipeline: " << (error ? error->message : "unknown error") << std::endl;
+    LOG_ERROR(Audio) << "Failed to parse pipeline: " << (error ? error->message : "unknown error");
     if (error) g_error_free(error);
     return false;
   }
 
   source = gst_bin_get_by_name(GST_BIN(pipeline), "source");
   if (!source) {
-    std::cerr << "Failed to get source" << std::endl;
+    LOG_ERROR(Audio) << "Failed to get source";
     return false;
   }
 
@@ -139,27 +139,27 @@ bool AudioReceiver::enableAudio(bool enable)
   return true;
 }
 
-void AudioReceiver::consumeAudio(std::vector<std::uint8_t>* audio)
+void AudioReceiver::consumeAudio(PooledBuffer audio)
 {
-  std::cout << "AudioReceiver::consumeAudio" << std::endl;
+  LOG_DEBUG(Audio) << "AudioReceiver::consumeAudio";
 
   if (!audioEnabled || !source) {
     return;
   }
 
-  GstBuffer *buffer = gst_buffer_new_and_alloc(audio->size());
+  GstBuffer *buffer = gst_buffer_new_and_alloc(audio.size());
 
   // Map the buffer for writing
   GstMapInfo map;
   if (gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
-    std::memcpy(map.data, audio->data(), audio->size());
+    std::memcpy(map.data, audio.data(), audio.size());
     gst_buffer_unmap(buffer, &map);
 
     if (gst_app_src_push_buffer(GST_APP_SRC(source), buffer) != GST_FLOW_OK) {
-      std::cerr << "Error with gst_app_src_push_buffer" << std::endl;
+      LOG_ERROR(Audio) << "Error with gst_app_src_push_buffer";
     }
   } else {
-    std::cerr << "Error with gst_buffer_map" << std::endl;
+    LOG_ERROR(Audio) << "Error with gst_buffer_map";
     gst_buffer_unref(buffer);
   }
 }
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "BufferPool.h"
+
 #include <vector>
 #include <cstdint>
 
@@ -23,7 +25,7 @@ class AudioReceiver
   bool enableAudio(bool enable);
 
   // Method to consume audio data (replacing slot)
-  void consumeAudio(std::vector<std::uint8_t>* audio);
+  void consumeAudio(PooledBuffer audio);
 
  private:
   static gboolean busCall(GstBus* bus, GstMessage* msg, gpointer data);
@@ -4,9 +4,10 @@
  */
 
 #include "Controller.h"
+#include "Log.h"
 
-#include <iostream>
 #include <cmath>
+#include <cstdlib>
 
 #include "AudioReceiver.h"
 #include "IVideoReceiver.h"
@@ -49,7 +50,13 @@ Controller::Controller(EventLoop& loop, IVideoReceiver *vr, AudioReceiver *ar):
     ledState(false),
     throttleTimerCameraXY(nullptr),
     throttleTimerSpeedTurn(nullptr),
-    eventLoop(loop)
+    videoStats(),
+    receiverReportTimer(nullptr),
+    offline(false),
+    offlineCrcMode(Crc::Mode::Crc16),
+    eventLoop(loop),
+    strand(loop.makeStrand()),
+    mediaStrand(loop.makeStrand())
 {
 
 }
@@ -62,16 +69,19 @@ Controller::~Controller()
 void Controller::connect(const std::string& host, std::uint16_t port)
 {
   if (transmitter) {
-    std::cout << "Transmitter already created, doing nothing." << std::endl;
+    LOG_INFO(Main) << "Transmitter already created, doing nothing.";
     return;
   }
 
   transmitter = std::make_unique<Transmitter>(eventLoop, host, port);
 
-  std::cout << "Setting transmitter callbacks" << std::endl;
+  LOG_INFO(Main) << "Setting transmitter callbacks";
 
-  transmitter->setRttCallback([this](int ms) {
+  transmitter->setRttCallback([this](int ms, int srttMs, int rttVarMs, int rtoMs) {
     stats[Stats::Type::Rtt] = ms;
+    stats[Stats::Type::Srtt] = srttMs;
+    stats[Stats::Type::RttVar] = rttVarMs;
+    stats[Stats::Type::ResendTimeout] = rtoMs;
   });
 
   transmitter->setResendTimeoutCallback([this](int ms) {
@@ -106,18 +116,110 @@ void Controller::connect(const std::string& host, std::uint16_t port)
     stats[Stats::Type::ConnectionStatus] = status;
   });
 
-  transmitter->setVideoCallback([this](std::vector<uint8_t>* video) {
-    if (vr) vr->consumeBitStream(video);
+  // Media is handed to the decoders on its own strand, off the network path
+  transmitter->setVideoCallback([this](PooledBuffer video) {
+    RtpReceiveStats::Clock::time_point arrival = RtpReceiveStats::Clock::now();
+    asio::post(mediaStrand, [this, video = std::move(video), arrival]() mutable {
+      videoStats.packet(video.data(), video.size(), arrival);
+      if (vr) vr->consumeBitStream(std::move(video));
+    });
   });
 
-  transmitter->setAudioCallback([this](std::vector<uint8_t>* audio) {
-    if (ar) ar->consumeAudio(audio);
+  transmitter->setAudioCallback([this](PooledBuffer audio) {
+    asio::post(mediaStrand, [this, audio = std::move(audio)]() mutable {
+      if (ar) ar->consumeAudio(std::move(audio));
+    });
   });
 
+  transmitter->setPoolStatsCallback([this](uint32_t hits, uint32_t misses) {
+    stats[Stats::Type::PoolHits] = hits;
+    stats[Stats::Type::PoolMisses] = misses;
+  });
+
+  transmitter->setFecStatsCallback([this](uint32_t recovered, uint32_t unrecoverable) {
+    stats[Stats::Type::FecRecovered] = recovered;
+    stats[Stats::Type::FecUnrecoverable] = unrecoverable;
+  });
+
+  transmitter->setIoStatsCallback([this](float rxPacketsPerCall, float txPacketsPerCall) {
+    stats[Stats::Type::RxPerCall] = static_cast<int32_t>(rxPacketsPerCall * 100);
+    stats[Stats::Type::TxPerCall] = static_cast<int32_t>(txPacketsPerCall * 100);
+  });
+
+  // Optional checksum mode, must match the slave
+  const char* envCrc = std::getenv("PLECO_CRC");
+  Crc::Mode crcMode;
+  if (envCrc && Crc::parseMode(envCrc, crcMode)) {
+    transmitter->setCrcMode(crcMode);
+  }
+
+  // Optional coalescing of small messages, value is the window in microseconds
+  const char* envCoalesce = std::getenv("PLECO_COALESCE_US");
+  if (envCoalesce) {
+    transmitter->setCoalescing(true, std::atoi(envCoalesce));
+  }
+
+  // Batched socket I/O is used where supported, PLECO_BATCH_IO=0 disables it
+  const char* envBatchIo = std::getenv("PLECO_BATCH_IO");
+  if (envBatchIo) {
+    transmitter->setBatchedIo(std::atoi(envBatchIo) != 0);
+  }
+
+  // Session on a relay shared by several cars, must match the slave
+  const char* envSession = std::getenv("PLECO_RELAY_SESSION");
+  if (envSession) {
+    transmitter->setRelaySession(static_cast<std::uint32_t>(std::strtoul(envSession, nullptr, 0)));
+  }
+
+  // A replayed capture has the checksums of the captured connection
+  if (offline) {
+    transmitter->setCrcMode(offlineCrcMode);
+    transmitter->setOffline(true);
+  }
+
+  // Optional capture of every datagram for offline replay
+  const char* envCapture = std::getenv("PLECO_CAPTURE");
+  if (envCapture && *envCapture) {
+    transmitter->startCapture(envCapture);
+  }
+
   transmitter->initSocket();
 
   // Send ping every second (unless other high priority packet are sent)
   transmitter->enableAutoPing(true);
+
+  // Report the received video for the slave's congestion control
+  receiverReportTimer = std::make_shared<Timer>(eventLoop, mediaStrand);
+  receiverReportTimer->start(RR_INTERVAL_MS, [this]() {
+    sendReceiverReport();
+  }, true);
+}
+
+void Controller::setOffline(Crc::Mode crcMode)
+{
+  offline = true;
+  offlineCrcMode = crcMode;
+}
+
+void Controller::replayDatagram(const std::uint8_t* data, std::size_t size)
+{
+  if (transmitter) {
+    transmitter->receiveDatagram(data, size);
+  }
+}
+
+void Controller::sendReceiverReport()
+{
+  ReceiverReport report;
+  if (!videoStats.report(report, RtpReceiveStats::Clock::now())) {
+    return;
+  }
+
+  stats[Stats::Type::VideoLoss] = report.fractionLost * 100 / 256;
+  stats[Stats::Type::VideoJitter] = report.jitterUs / 1000;
+  stats[Stats::Type::VideoQueueDelay] = report.queueDelayUs / 1000;
+
+  transmitter->sendReceiverReport(report);
 }
 
 void Controller::getStats(int32_t* out) const {
@@ -148,7 +250,7 @@ void Controller::updateValue(std::uint8_t type, std::uint16_t value)
       stats[Stats::Type::WlanStrength] = value;
       break;
     default:
-      std::cout << "Unhandled value type: " << static_cast<int>(type) << " = " << value << std::endl;
+      LOG_INFO(Main) << "Unhandled value type: " << static_cast<int>(type) << " = " << value;
       break;
   }
 }
@@ -162,15 +264,24 @@ void Controller::updatePeriodicValue(std::uint8_t type, std::uint16_t value)
     case MessageSubtype::Uptime:
       stats[Stats::Type::Uptime] = value;
       break;
+    case MessageSubtype::PacerQueue:
+      stats[Stats::Type::PacerQueue] = value;
+      break;
+    case MessageSubtype::PacerDelay:
+      stats[Stats::Type::PacerDelay] = value;
+      break;
+    case MessageSubtype::VideoBitrate:
+      stats[Stats::Type::VideoBitrate] = value;
+      break;
     default:
-      std::cout << "Unhandled periodic value type: " << static_cast<int>(type) << " = " << value << std::endl;
+      LOG_INFO(Main) << "Unhandled periodic value type: " << static_cast<int>(type) << " = " << value;
       break;
   }
 }
 
 void Controller::start() {
   if (eventLoopRunning) {
-      std::cout << "Event loop already running" << std::endl;
+      LOG_INFO(Main) << "Event loop already running";
       return;
   }
 
@@ -179,12 +290,12 @@ void Controller::start() {
       try {
           eventLoop.run();
       } catch (const std::exception& e) {
-          std::cerr << "Exception in event loop: " << e.what() << std::endl;
+          LOG_ERROR(Main) << "Exception in event loop: " << e.what();
       }
       eventLoopRunning = false;
   });
 
-  std::cout << "Event loop thread started" << std::endl;
+  LOG_INFO(Main) << "Event loop thread started";
 }
 
 void Controller::stop() {
@@ -192,23 +303,27 @@ void Controller::stop() {
       return;
   }
 
-  std::cout << "Stopping event loop..." << std::endl;
+  LOG_INFO(Main) << "Stopping event loop...";
   eventLoop.stop();
 
   if (eventLoopThread.joinable()) {
       eventLoopThread.join();
   }
-  std::cout << "Event loop stopped" << std::endl;
+  LOG_INFO(Main) << "Event loop stopped";
 }
 
 void Controller::setLed(bool enable)
 {
+  if (postToStrand([this, enable]() { setLed(enable); })) {
+    return;
+  }
+
   if (ledState == enable) {
     return;
   }
   ledState = enable;
 
-  std::cout << "LED state changed: " << (ledState ? "enabled" : "disabled") << std::endl;
+  LOG_INFO(Main) << "LED state changed: " << (ledState ? "enabled" : "disabled");
 
   if (!transmitter) return;
 
@@ -221,23 +336,27 @@ void Controller::setLed(bool enable)
 
 void Controller::setVideo(bool enable)
 {
+  if (postToStrand([this, enable]() { setVideo(enable); })) {
+    return;
+  }
+
   if (videoState == enable) {
     return;
   }
   videoState = enable;
 
-  std::cout << "Video state changed: " << (videoState ? "enabled" : "disabled") << std::endl;
+  LOG_INFO(Main) << "Video state changed: " << (videoState ? "enabled" : "disabled");
 
   if (!transmitter) return;
 
   if (!vr) {
-    std::cerr << "Video receiver not set" << std::endl;
+    LOG_ERROR(Main) << "Video receiver not set";
     videoState = false;
     return;
   }
 
   if (!vr->init()) {
-    std::cerr << "Failed to initialize video receiver" << std::endl;
+    LOG_ERROR(Main) << "Failed to initialize video receiver";
     videoState = false;
     return;
   }
@@ -251,12 +370,16 @@ void Controller::setVideo(bool enable)
 
 void Controller::setAudio(bool enable)
 {
+  if (postToStrand([this, enable]() { setAudio(enable); })) {
+    return;
+  }
+
   if (audioState == enable) {
     return;
   }
   audioState = enable;
 
-  std::cout << "Audio state changed: " << (audioState ? "enabled" : "disabled") << std::endl;
+  LOG_INFO(Main) << "Audio state changed: " << (audioState ? "enabled" : "disabled");
 
   if (!transmitter) return;
 
@@ -269,21 +392,29 @@ void Controller::setAudio(bool enable)
 
 void Controller::setHalfSpeed(bool enable)
 {
+  if (postToStrand([this, enable]() { setHalfSpeed(enable); })) {
+    return;
+  }
+
   if (motorHalfSpeed == enable) {
     return;
   }
   motorHalfSpeed = enable;
 
-  std::cout << "Half speed state changed: " << (motorHalfSpeed ? "enabled" : "disabled") << std::endl;
+  LOG_INFO(Main) << "Half speed state changed: " << (motorHalfSpeed ? "enabled" : "disabled");
 
 }
 
 void Controller::setVideoQuality(int quality)
 {
+  if (postToStrand([this, quality]() { setVideoQuality(quality); })) {
+    return;
+  }
+
   // FIXME: Do these need to be class members or simply send to slave?
   videoQuality = quality;
 
-  std::cout << "Setting video quality: " << videoQuality << std::endl;
+  LOG_INFO(Main) << "Setting video quality: " << videoQuality;
   if (!transmitter) return;
 
   transmitter->sendValue(MessageSubtype::VideoQuality, videoQuality);
@@ -291,8 +422,12 @@ void Controller::setVideoQuality(int quality)
 
 void Controller::setVideoSource(int source)
 {
+  if (postToStrand([this, source]() { setVideoSource(source); })) {
+    return;
+  }
+
 
-  std::cout << "Setting video source: " << source << std::endl;
+  LOG_INFO(Main) << "Setting video source: " << source;
   if (!transmitter) return;
 
   transmitter->sendValue(MessageSubtype::VideoSource, static_cast<std::uint16_t>(source));
@@ -317,7 +452,7 @@ void Controller::sendCameraXY()
   std::uint16_t value = (x << 8) | y;
 
   if (!throttleTimerCameraXY) {
-    throttleTimerCameraXY = std::make_shared<Timer>(eventLoop);
+    throttleTimerCameraXY = std::make_shared<Timer>(eventLoop, strand);
   }
 
   if (throttleTimerCameraXY->isActive()) {
@@ -342,13 +477,17 @@ void Controller::sendSpeedTurnIfPending()
 
 void Controller::setSpeedTurn(int speed, int turn)
 {
+  if (postToStrand([this, speed, turn]() { setSpeedTurn(speed, turn); })) {
+    return;
+  }
+
   motorSpeed = speed;
   motorTurn = turn;
 
   if (!transmitter) return;
 
   if (!throttleTimerSpeedTurn) {
-    throttleTimerSpeedTurn = std::make_shared<Timer>(eventLoop);
+    throttleTimerSpeedTurn = std::make_shared<Timer>(eventLoop, strand);
   }
 
   if (throttleTimerSpeedTurn->isActive()) {
@@ -376,9 +515,13 @@ void Controller::setSpeedTurn(int speed, int turn)
 
 void Controller::setCameraZoom(int CameraZoom)
 {
+  if (postToStrand([this, CameraZoom]() { setCameraZoom(CameraZoom); })) {
+    return;
+  }
+
   cameraZoomPercent = CameraZoom;
 
-  std::cout << "Setting camera zoom: " << cameraZoomPercent << std::endl;
+  LOG_INFO(Main) << "Setting camera zoom: " << cameraZoomPercent;
   if (!transmitter) return;
 
   transmitter->sendValue(MessageSubtype::CameraZoom, cameraZoomPercent);
@@ -386,9 +529,13 @@ void Controller::setCameraZoom(int CameraZoom)
 
 void Controller::setCameraFocus(int cameraFocus)
 {
+  if (postToStrand([this, cameraFocus]() { setCameraFocus(cameraFocus); })) {
+    return;
+  }
+
   cameraFocusPercent = cameraFocus;
 
-  std::cout << "Setting camera focus: " << cameraFocusPercent << std::endl;
+  LOG_INFO(Main) << "Setting camera focus: " << cameraFocusPercent;
   if (!transmitter) return;
 
   transmitter->sendValue(MessageSubtype::CameraFocus, cameraFocusPercent);
@@ -403,7 +550,7 @@ void Controller::updateSpeedGracefully()
     change = MOTOR_SPEED_GRACE_LIMIT;
 
     if (!motorSpeedUpdateTimer) {
-      motorSpeedUpdateTimer = std::make_shared<Timer>(eventLoop);
+      motorSpeedUpdateTimer = std::make_shared<Timer>(eventLoop, strand);
     }
 
     motorSpeedUpdateTimer->start(1000/THROTTLE_FREQ_SPEED_TURN, [this]() {
@@ -427,12 +574,20 @@ void Controller::updateSpeedGracefully()
 
 void Controller::setCameraX(int degree)
 {
+  if (postToStrand([this, degree]() { setCameraX(degree); })) {
+    return;
+  }
+
   cameraX = degree;
   sendCameraXY();
 }
 
 void Controller::setCameraY(int degree)
 {
+  if (postToStrand([this, degree]() { setCameraY(degree); })) {
+    return;
+  }
+
   cameraY = degree;
   sendCameraXY();
 }
@@ -12,6 +12,7 @@
 #include "Event.h"
 #include "Timer.h"
 #include "Transmitter.h"
+#include "ReceiverReport.h"
 #include "IVideoReceiver.h"
 #include "AudioReceiver.h"
 #include "Joystick.h"
@@ -36,7 +37,21 @@
 #define CTRL_STATS_TOTAL_RX          14
 #define CTRL_STATS_TOTAL_TX          15
 #define CTRL_STATS_CONNECTION_STATUS 16
-#define CTRL_STATS_COUNT             17
+#define CTRL_STATS_POOL_HITS         17
+#define CTRL_STATS_POOL_MISSES       18
+#define CTRL_STATS_FEC_RECOVERED     19
+#define CTRL_STATS_FEC_UNRECOVERABLE 20
+#define CTRL_STATS_RX_PER_CALL       21
+#define CTRL_STATS_TX_PER_CALL       22
+#define CTRL_STATS_SRTT              23
+#define CTRL_STATS_RTTVAR            24
+#define CTRL_STATS_PACER_QUEUE       25
+#define CTRL_STATS_PACER_DELAY       26
+#define CTRL_STATS_VIDEO_LOSS        27
+#define CTRL_STATS_VIDEO_JITTER      28
+#define CTRL_STATS_VIDEO_QUEUE_DELAY 29
+#define CTRL_STATS_VIDEO_BITRATE     30
+#define CTRL_STATS_COUNT             31
 
 class Controller
 {
@@ -51,7 +66,14 @@ class Controller
   // Connect to the relay server
   void connect(const std::string& host, std::uint16_t port);
 
-  // Set functions for the UI
+  // Take the datagrams from replayDatagram() instead of the relay server
+  // and send nothing. Must be called before connect().
+  void setOffline(Crc::Mode crcMode);
+
+  // Handle a captured datagram as if it was received from the relay server
+  void replayDatagram(const std::uint8_t* data, std::size_t size);
+
+  // Set functions for the UI, these can be called from any thread
   void setCameraZoom();
   void setCameraFocus();
   void setVideoQuality();
@@ -84,6 +106,18 @@ class Controller
   void buttonChanged(int axis, std::uint16_t value);
   void updateValue(std::uint8_t type, std::uint16_t value);
   void updatePeriodicValue(std::uint8_t type, std::uint16_t value);
+  void sendReceiverReport();
+
+  // Post the call to the strand unless already running on it, true if posted
+  template <typename Handler>
+  bool postToStrand(Handler handler)
+  {
+    if (strand.running_in_this_thread()) {
+      return false;
+    }
+    asio::post(strand, handler);
+    return true;
+  }
 
   std::thread eventLoopThread;
   bool eventLoopRunning = false;
@@ -138,8 +172,21 @@ class Controller
   std::shared_ptr<Timer> throttleTimerCameraXY;
   std::shared_ptr<Timer> throttleTimerSpeedTurn;
 
+  // Loss and delay of the received video, reported back to the slave
+  RtpReceiveStats videoStats;
+  std::shared_ptr<Timer> receiverReportTimer;
+
+  // Replaying a capture instead of connecting
+  bool offline;
+  Crc::Mode offlineCrcMode;
+
   // Reference to event loop
   EventLoop& eventLoop;
+
+  // The UI requests and the timers run on the strand, the received media
+  // on its own so that decoding doesn't hold back the control path
+  EventLoop::Strand strand;
+  EventLoop::Strand mediaStrand;
 };
 
 /* Emacs indentatation information
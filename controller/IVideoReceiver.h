@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "BufferPool.h"
+
 #include <vector>
 #include <cstdint>
 
@@ -34,8 +36,8 @@ public:
     virtual bool init() = 0;
     virtual void deinit() = 0;
 
-    // Process incoming encoded video data (takes ownership of the provided vector)
-    virtual void consumeBitStream(std::vector<std::uint8_t>* video) = 0;
+    // Process incoming encoded video data, the buffer returns to its pool when dropped
+    virtual void consumeBitStream(PooledBuffer video) = 0;
 
     // Get the latest decoded frame data
     // Returns true if a valid frame is available, false otherwise
@@ -4,13 +4,13 @@
  */
 
 #include "Joystick.h"
+#include "Log.h"
 
 #include <sys/stat.h>        // open
 #include <fcntl.h>           // open
 #include <unistd.h>          // close
 #include <string.h>          // strerror
 #include <errno.h>           // errno
-#include <iostream>
 
 #define MAX_FEATURE_COUNT   32
 
@@ -65,7 +65,7 @@ Joystick::~Joystick()
     // NOLINTNEXTLINE(bugprone-unused-return-value)
     joystickDesc.cancel(ec);
     if (ec) {
-      std::cerr << "Error canceling joystick operations: " << ec.message() << std::endl;
+      LOG_ERROR(Ui) << "Error canceling joystick operations: " << ec.message();
     }
 
     // Close the file descriptor
@@ -95,22 +95,22 @@ bool Joystick::init(const std::string& inputDevicePath)
   // Open the input device using traditional open()
   fd = open(inputDevicePath.c_str(), O_RDONLY | O_NONBLOCK);
   if (fd < 0) {
-    std::cerr << "Failed to open joystick device: " << inputDevicePath << " - " << strerror(errno) << std::endl;
+    LOG_ERROR(Ui) << "Failed to open joystick device: " << inputDevicePath << " - " << strerror(errno);
     return false;
   }
 
   if (ioctl(fd, JSIOCGNAME(JOYSTICK_NAME_LEN), name) == -1) {
-    std::cerr << "Failed to get joystick name: " << strerror(errno) << std::endl;
+    LOG_ERROR(Ui) << "Failed to get joystick name: " << strerror(errno);
     close(fd);
     return false;
   }
-  std::cout << "Detected joystick: " << name << std::endl;
+  LOG_INFO(Ui) << "Detected joystick: " << name;
 
   std::string jstr(name);
   for (std::uint8_t j = 1; j < sizeof(supported)/sizeof(supported[0]); ++j) {
     if (jstr.find(supported[j].name) != std::string::npos) {
       joystick = j;
-      std::cout << "Found joystick mappings for " << supported[j].name << std::endl;
+      LOG_INFO(Ui) << "Found joystick mappings for " << supported[j].name;
       break;
     }
   }
@@ -120,7 +120,7 @@ bool Joystick::init(const std::string& inputDevicePath)
   // NOLINTNEXTLINE(bugprone-unused-return-value)
   joystickDesc.assign(fd, ec);
   if (ec) {
-    std::cerr << "Failed to assign joystick descriptor: " << ec.message() << std::endl;
+    LOG_ERROR(Ui) << "Failed to assign joystick descriptor: " << ec.message();
     close(fd);
     return false;
   }
@@ -145,14 +145,14 @@ void Joystick::readPendingInputData()
     [this](const asio::error_code& ec, std::size_t bytes_transferred) {
       if (ec) {
         if (ec != asio::error::operation_aborted) {
-          std::cerr << "Joystick read error: " << ec.message() << std::endl;
+          LOG_ERROR(Ui) << "Joystick read error: " << ec.message();
           enabled = false;
         }
         return;
       }
 
       if (bytes_transferred < sizeof(js_event)) {
-        std::cerr << "Too few bytes read: " << bytes_transferred << std::endl;
+        LOG_WARN(Ui) << "Too few bytes read: " << bytes_transferred;
         readPendingInputData();  // Continue reading
         return;
       }
@@ -166,7 +166,7 @@ void Joystick::readPendingInputData()
 
       int ab_number = event.number;
       if (ab_number >= MAX_FEATURE_COUNT) {
-        std::cerr << "Axis/button number too high, ignoring: " << ab_number << std::endl;
+        LOG_WARN(Ui) << "Axis/button number too high, ignoring: " << ab_number;
         readPendingInputData();
         return;
       }
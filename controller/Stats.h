@@ -27,6 +27,32 @@ enum class Type : std::uint8_t {
   TotalTx,
   ConnectionStatus,
 
+  // Transmitter buffer pools
+  PoolHits,
+  PoolMisses,
+
+  // Video forward error correction
+  FecRecovered,
+  FecUnrecoverable,
+
+  // Datagrams per socket system call, in hundredths
+  RxPerCall,
+  TxPerCall,
+
+  // Smoothed round trip time and its variation
+  Srtt,
+  RttVar,
+
+  // Slave's video pacer queue
+  PacerQueue,
+  PacerDelay,
+
+  // Received video as sent in the receiver reports, and the slave's bitrate
+  VideoLoss,
+  VideoJitter,
+  VideoQueueDelay,
+  VideoBitrate,
+
   // This must be the last item
   Count
 };
@@ -4,8 +4,8 @@
  */
 
 #include "UI-sdl.h"
+#include "Log.h"
 
-#include <iostream>
 #include <string>
 #include <cmath>
 
@@ -55,14 +55,14 @@ bool UI_Sdl::initSDL()
 {
   // Initialize SDL
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER) != 0) {
-    std::cerr << "Error: SDL_Init failed: " << SDL_GetError() << std::endl;
+    LOG_ERROR(Ui) << "SDL_Init failed: " << SDL_GetError();
     return false;
   }
 
   // Initialize SDL_image
   int imgFlags = IMG_INIT_PNG;
   if (!(IMG_Init(imgFlags) & imgFlags)) {
-    std::cerr << "Error: SDL_image could not initialize! SDL_image Error: " << IMG_GetError() << std::endl;
+    LOG_ERROR(Ui) << "SDL_image could not initialize! SDL_image Error: " << IMG_GetError();
     return false;
   }
 
@@ -74,7 +74,7 @@ bool UI_Sdl::initSDL()
     SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE
   );
   if (!window) {
-    std::cerr << "Error: Window could not be created! SDL Error: " << SDL_GetError() << std::endl;
+    LOG_ERROR(Ui) << "Window could not be created! SDL Error: " << SDL_GetError();
     return false;
   }
 
@@ -84,7 +84,7 @@ bool UI_Sdl::initSDL()
     SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
   );
   if (!renderer) {
-    std::cerr << "Error: Renderer could not be created! SDL Error: " << SDL_GetError() << std::endl;
+    LOG_ERROR(Ui) << "Renderer could not be created! SDL Error: " << SDL_GetError();
     return false;
   }
 
@@ -144,22 +144,22 @@ void UI_Sdl::cleanupImGui()
 void UI_Sdl::createGUI()
 {
 
-  std::cout << "Initializing SDL..." << std::endl;
+  LOG_INFO(Ui) << "Initializing SDL...";
   // Initialize SDL and ImGui
   if (!initSDL()) {
-    std::cerr << "Failed to initialize SDL" << std::endl;
+    LOG_ERROR(Ui) << "Failed to initialize SDL";
     return;
   }
 
-  std::cout << "Initializing ImGui..." << std::endl;
+  LOG_INFO(Ui) << "Initializing ImGui...";
   if (!initImGui()) {
-    std::cerr << "Failed to initialize ImGui" << std::endl;
+    LOG_ERROR(Ui) << "Failed to initialize ImGui";
     return;
   }
 
   // Set application as running
   running = true;
-  std::cout << "GUI creation complete" << std::endl;
+  LOG_INFO(Ui) << "GUI creation complete";
 }
 
 
@@ -168,7 +168,7 @@ void UI_Sdl::run()
   // Main UI loop
   running = true;
 
-  std::cout << "Starting main SDL loop..." << std::endl;
+  LOG_INFO(Ui) << "Starting main SDL loop...";
 
   // Traditional SDL main loop
   while (running) {
@@ -182,7 +182,7 @@ void UI_Sdl::run()
     SDL_Delay(16); // ~60 FPS
   }
 
-  std::cout << "Main SDL loop finished, stopping event loop..." << std::endl;
+  LOG_INFO(Ui) << "Main SDL loop finished, stopping event loop...";
 }
 
 void UI_Sdl::renderFrame()
@@ -243,15 +243,15 @@ void UI_Sdl::renderFrame()
             // Reduce logging frequency - uncomment if needed for debugging
             static int frameCounter = 0;
             if (frameCounter++ % 60 == 0) {  // Log only every 60 frames
-                 std::cout << "Video rendered: " << videoWidth << "x" << videoHeight
-                     << " -> " << destW << "x" << destH
-                     << " at position: " << x << "," << y << std::endl;
+                 LOG_DEBUG(Ui) << "Video rendered: " << videoWidth << "x" << videoHeight
+                               << " -> " << destW << "x" << destH
+                               << " at position: " << x << "," << y;
             }
         } else {
             // No video texture available, show a message
-            std::cout << "No video texture available, size: "
-                      << videoWidth << "x" << videoHeight
-                      << ", texture: " << videoTexture << std::endl;
+            LOG_DEBUG(Ui) << "No video texture available, size: "
+                          << videoWidth << "x" << videoHeight
+                          << ", texture: " << videoTexture;
         }
     }
 
@@ -425,7 +425,7 @@ void UI_Sdl::renderStatusPanel()
 
   if (stats[CTRL_STATS_CONNECTION_STATUS] != CONNECTION_STATUS_OK) {
     if (stats[CTRL_STATS_CONNECTION_STATUS] != ctrlStats[CTRL_STATS_CONNECTION_STATUS]) {
-      std::cout << "Connection lost, stopping video and audio" << std::endl;
+      LOG_INFO(Ui) << "Connection lost, stopping video and audio";
       enableVideo = false;
       ctrl.setVideo(enableVideo);
       enableAudio = false;
@@ -442,6 +442,7 @@ void UI_Sdl::renderStatusPanel()
     stats[CTRL_STATS_CONNECTION_STATUS] == CONNECTION_STATUS_LOST ? "Lost" : "Unknown");
 
   ImGui::Text("RTT: %d ms", stats[CTRL_STATS_RTT]);
+  ImGui::Text("SRTT: %d ms, RTTVAR: %d ms", stats[CTRL_STATS_SRTT], stats[CTRL_STATS_RTTVAR]);
   ImGui::Text("Resends: %u", stats[CTRL_STATS_RESENT_PACKETS]);
   ImGui::Text("Resend timeout: %d ms", stats[CTRL_STATS_RESEND_TIMEOUT]);
   ImGui::Text("Uptime: %d sec", stats[CTRL_STATS_UPTIME]);
@@ -465,6 +466,16 @@ void UI_Sdl::renderStatusPanel()
   ImGui::Text("Total Rx: %d", stats[CTRL_STATS_TOTAL_RX]);
   ImGui::Text("Payload Tx: %d", stats[CTRL_STATS_PAYLOAD_TX]);
   ImGui::Text("Total Tx: %d", stats[CTRL_STATS_TOTAL_TX]);
+  ImGui::Text("Buffer pool hits: %d", stats[CTRL_STATS_POOL_HITS]);
+  ImGui::Text("Buffer pool misses: %d", stats[CTRL_STATS_POOL_MISSES]);
+  ImGui::Text("Video FEC recovered: %d", stats[CTRL_STATS_FEC_RECOVERED]);
+  ImGui::Text("Video FEC unrecoverable: %d", stats[CTRL_STATS_FEC_UNRECOVERABLE]);
+  ImGui::Text("Rx packets/syscall: %.2f", stats[CTRL_STATS_RX_PER_CALL] / 100.0);
+  ImGui::Text("Tx packets/syscall: %.2f", stats[CTRL_STATS_TX_PER_CALL] / 100.0);
+  ImGui::Text("Video pacer: %d queued, %d ms", stats[CTRL_STATS_PACER_QUEUE], stats[CTRL_STATS_PACER_DELAY]);
+  ImGui::Text("Video bitrate: %d kbit/s", stats[CTRL_STATS_VIDEO_BITRATE]);
+  ImGui::Text("Video loss: %d%%, jitter: %d ms, queue: %d ms", stats[CTRL_STATS_VIDEO_LOSS],
+              stats[CTRL_STATS_VIDEO_JITTER], stats[CTRL_STATS_VIDEO_QUEUE_DELAY]);
 
   ImGui::Separator();
 
@@ -541,15 +552,15 @@ void UI_Sdl::renderControlPanel()
 
 void UI_Sdl::updateVideoTexture(const void* data, int width, int height)
 {
-  std::cout << "Updating video texture with dimensions: " << width << "x" << height << std::endl;
+  LOG_DEBUG(Ui) << "Updating video texture with dimensions: " << width << "x" << height;
   if (data == nullptr || width <= 0 || height <= 0) {
-    std::cerr << "Warning: Invalid texture data" << std::endl;
+    LOG_WARN(Ui) << "Invalid texture data";
     return;
   }
 
   // If texture doesn't exist or dimensions have changed, recreate it
   if (!videoTexture || this->videoWidth != width || this->videoHeight != height) {
-    std::cout << "Creating new texture of size " << width << "x" << height << std::endl;
+    LOG_DEBUG(Ui) << "Creating new texture of size " << width << "x" << height;
     if (videoTexture) {
       SDL_DestroyTexture(videoTexture);
     }
@@ -565,7 +576,7 @@ void UI_Sdl::updateVideoTexture(const void* data, int width, int height)
     );
 
     if (!videoTexture) {
-      std::cerr << "Failed to create video texture: " << SDL_GetError() << std::endl;
+      LOG_ERROR(Ui) << "Failed to create video texture: " << SDL_GetError();
       return;
     }
 
@@ -579,7 +590,7 @@ void UI_Sdl::updateVideoTexture(const void* data, int width, int height)
     Uint32 format;
     int access, w, h;
     if (SDL_QueryTexture(videoTexture, &format, &access, &w, &h) == 0) {
-      std::cout << "Texture created successfully with dimensions: " << w << "x" << h << std::endl;
+      LOG_DEBUG(Ui) << "Texture created successfully with dimensions: " << w << "x" << h;
     }
 
     this->videoWidth = width;
@@ -590,15 +601,15 @@ void UI_Sdl::updateVideoTexture(const void* data, int width, int height)
   const uint8_t* pixels = static_cast<const uint8_t*>(data);
   int stride = width * 4; // 4 bytes per pixel for RGBA
 
-  std::cout << "First pixel RGBA: ("
-            << static_cast<int>(pixels[0]) << ", "
-            << static_cast<int>(pixels[1]) << ", "
-            << static_cast<int>(pixels[2]) << ", "
-            << static_cast<int>(pixels[3]) << ")" << std::endl;
+  LOG_DEBUG(Ui) << "First pixel RGBA: ("
+                << static_cast<int>(pixels[0]) << ", "
+                << static_cast<int>(pixels[1]) << ", "
+                << static_cast<int>(pixels[2]) << ", "
+                << static_cast<int>(pixels[3]) << ")";
 
   // Update the texture with new data - use correct stride
   SDL_UpdateTexture(videoTexture, nullptr, data, stride);
-  std::cout << "Texture updated successfully" << std::endl;
+  LOG_DEBUG(Ui) << "Texture updated successfully";
 }
 
 void UI_Sdl::renderVideoPanel()
@@ -638,10 +649,10 @@ void UI_Sdl::renderVideoPanel()
     // Display the image with proper sizing
     ImGui::Image((ImTextureID)(intptr_t)videoTexture, displaySize);
 
-    std::cout << "ImGui video panel: Texture " << videoWidth << "x" << videoHeight
-              << " rendered at " << displaySize.x << "x" << displaySize.y
-              << " position: " << pos.x << "," << pos.y
-              << " (panel size: " << contentSize.x << "x" << contentSize.y << ")" << std::endl;
+    LOG_DEBUG(Ui) << "ImGui video panel: Texture " << videoWidth << "x" << videoHeight
+                  << " rendered at " << displaySize.x << "x" << displaySize.y
+                  << " position: " << pos.x << "," << pos.y
+                  << " (panel size: " << contentSize.x << "x" << contentSize.y << ")";
   } else {
     ImGui::TextWrapped("No video feed available. Enable video to start streaming.");
   }
@@ -664,7 +675,7 @@ void UI_Sdl::showDebug(const std::string& msg)
   debugTextBuffer.append("\n");
 
   // Print to console as well
-  std::cout << "Debug: " << msg << std::endl;
+  LOG_INFO(Ui) << "Debug: " << msg;
 }
 
 /* Emacs indentatation information
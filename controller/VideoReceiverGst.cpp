@@ -3,8 +3,8 @@
  * SPDX-License-Identifier: MIT
  */
 #include "VideoReceiverGst.h"
+#include "Log.h"
 
-#include <iostream>
 #include <cstring>  // for memcpy
 #include <chrono>   // for timestamps
 
@@ -19,9 +19,14 @@ VideoReceiverGst::VideoReceiverGst()
     source(nullptr),
     sink(nullptr),
     videoEnabled(false),
-    initialized(false)
+    initialized(false),
+    metricBuffers(Metrics::registry().counter("pleco_video_received_buffers_total",
+                                              "Encoded video buffers passed to the decoder")),
+    metricBytes(Metrics::registry().counter("pleco_video_received_bytes_total",
+                                            "Encoded video bytes passed to the decoder")),
+    metricDecodedFrames(Metrics::registry().counter("pleco_video_decoded_frames_total", "Video frames decoded"))
 {
-  std::cout << "VideoReceiverGst created" << std::endl;
+  LOG_INFO(Video) << "VideoReceiverGst created";
 }
 
 VideoReceiverGst::~VideoReceiverGst()
@@ -37,7 +42,7 @@ bool VideoReceiverGst::init()
 
   // Initialization
   if (!gst_init_check(nullptr, nullptr, nullptr)) {
-    std::cerr << "Failed to init GStreamer" << std::endl;
+    LOG_ERROR(Video) << "Failed to init GStreamer";
     return false;
   }
   // Create or update the pipeline if needed
@@ -48,7 +53,7 @@ bool VideoReceiverGst::init()
   }
 
   initialized = true;
-  std::cout << "VideoReceiverGst initialized" << std::endl;
+  LOG_INFO(Video) << "VideoReceiverGst initialized";
   return true;
 }
 
@@ -56,7 +61,7 @@ void VideoReceiverGst::deinit()
 {
   // Clean up pipeline and resources
   if (pipeline) {
-    std::cout << "Stopping GStreamer pipeline" << std::endl;
+    LOG_INFO(Video) << "Stopping GStreamer pipeline";
     // Proper state change sequence to ensure proper cleanup
     gst_element_set_state(pipeline, GST_STATE_NULL);
 
@@ -78,7 +83,7 @@ void VideoReceiverGst::deinit()
   }
 
   videoEnabled = false;
-  std::cout << "VideoReceiverGst deinitialized" << std::endl;
+  LOG_INFO(Video) << "VideoReceiverGst deinitialized";
 }
 
 gboolean VideoReceiverGst::busCall(GstBus *bus, GstMessage *message, gpointer data)
@@ -89,16 +94,16 @@ gboolean VideoReceiverGst::busCall(GstBus *bus, GstMessage *message, gpointer da
   (void)bus;
   VideoReceiverGst* self = static_cast<VideoReceiverGst*>(data);
   if (!self) {
-    std::cerr << "Invalid VideoReceiverGst pointer in bus call" << std::endl;
+    LOG_ERROR(Video) << "Invalid VideoReceiverGst pointer in bus call";
     return TRUE;
   }
 
   switch (GST_MESSAGE_TYPE(message)) {
   case GST_MESSAGE_ERROR:
     gst_message_parse_error(message, &error, &debug);
-    std::cerr << "Error: " << (error ? error->message : "unknown error") << std::endl;
+    LOG_ERROR(Video) << "Error: " << (error ? error->message : "unknown error");
     if (debug) {
-      std::cerr << "Debug info: " << debug << std::endl;
+      LOG_ERROR(Video) << "Debug info: " << debug;
     }
     g_error_free(error);
     g_free(debug);
@@ -106,17 +111,17 @@ gboolean VideoReceiverGst::busCall(GstBus *bus, GstMessage *message, gpointer da
 
   case GST_MESSAGE_EOS:
     // end-of-stream
-    std::cerr << "End of stream reached" << std::endl;
+    LOG_WARN(Video) << "End of stream reached";
     break;
 
   case GST_MESSAGE_WARNING:
     gst_message_parse_warning(message, &error, &debug);
     if (error != nullptr) {
-      std::cerr << "Warning: " << error->message << std::endl;
+      LOG_WARN(Video) << "Warning: " << error->message;
       g_error_free(error);
     }
     if (debug != nullptr) {
-      std::cout << "Debug: " << debug << std::endl;
+      LOG_DEBUG(Video) << "Debug: " << debug;
       g_free(debug);
     }
     break;
@@ -129,7 +134,7 @@ gboolean VideoReceiverGst::busCall(GstBus *bus, GstMessage *message, gpointer da
 
   default:
     // Unhandled message
-    std::cerr << "Unhandled message: " << gst_message_type_get_name(GST_MESSAGE_TYPE(message)) << std::endl;
+    LOG_WARN(Video) << "Unhandled message: " << gst_message_type_get_name(GST_MESSAGE_TYPE(message));
     break;
   }
 
@@ -140,33 +145,33 @@ GstFlowReturn VideoReceiverGst::onNewSample(GstElement* sink, gpointer userData)
 {
   VideoReceiverGst* self = static_cast<VideoReceiverGst*>(userData);
   if (!self) {
-    std::cerr << "Invalid VideoReceiverGst pointer in sample callback" << std::endl;
+    LOG_ERROR(Video) << "Invalid VideoReceiverGst pointer in sample callback";
     return GST_FLOW_ERROR;
   }
 
   GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK(sink));
   if (!sample) {
-    std::cerr << "Failed to get sample from sink" << std::endl;
+    LOG_ERROR(Video) << "Failed to get sample from sink";
     return GST_FLOW_ERROR;
   }
 
   GstBuffer* buffer = gst_sample_get_buffer(sample);
   if (!buffer) {
-    std::cerr << "Sample contains no buffer" << std::endl;
+    LOG_ERROR(Video) << "Sample contains no buffer";
     gst_sample_unref(sample);
     return GST_FLOW_ERROR;
   }
 
   GstCaps* caps = gst_sample_get_caps(sample);
   if (!caps) {
-    std::cerr << "Sample has no caps" << std::endl;
+    LOG_ERROR(Video) << "Sample has no caps";
     gst_sample_unref(sample);
     return GST_FLOW_ERROR;
   }
 
   GstStructure* structure = gst_caps_get_structure(caps, 0);
   if (!structure) {
-    std::cerr << "Caps has no structure" << std::endl;
+    LOG_ERROR(Video) << "Caps has no structure";
     gst_sample_unref(sample);
     return GST_FLOW_ERROR;
   }
@@ -174,7 +179,7 @@ GstFlowReturn VideoReceiverGst::onNewSample(GstElement* sink, gpointer userData)
   int width, height;
   if (!gst_structure_get_int(structure, "width", &width) ||
       !gst_structure_get_int(structure, "height", &height)) {
-    std::cerr << "Failed to get dimensions from caps" << std::endl;
+    LOG_ERROR(Video) << "Failed to get dimensions from caps";
     gst_sample_unref(sample);
     return GST_FLOW_ERROR;
   }
@@ -198,7 +203,7 @@ GstFlowReturn VideoReceiverGst::onNewSample(GstElement* sink, gpointer userData)
   // Map the buffer for reading
   GstMapInfo map;
   if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-    std::cerr << "Failed to map buffer" << std::endl;
+    LOG_ERROR(Video) << "Failed to map buffer";
     gst_sample_unref(sample);
     return GST_FLOW_ERROR;
   }
@@ -215,6 +220,8 @@ GstFlowReturn VideoReceiverGst::onNewSample(GstElement* sink, gpointer userData)
 
 void VideoReceiverGst::storeDecodedFrame(const void* data, int width, int height, int stride, int64_t timestamp)
 {
+    metricDecodedFrames.add();
+
     std::lock_guard<std::mutex> lock(frameMutex);
 
     // Create a new FrameData object for storing the frame
@@ -253,45 +260,45 @@ void VideoReceiverGst::cleanupOldFrames()
   }
 }
 
-void VideoReceiverGst::consumeBitStream(std::vector<std::uint8_t>* video)
+void VideoReceiverGst::consumeBitStream(PooledBuffer video)
 {
   if (!video) {
-    std::cerr << "Received null video data" << std::endl;
+    LOG_ERROR(Video) << "Received null video data";
     return;
   }
 
-  std::cout << "Received video data: " << video->size() << " bytes" << std::endl;
+  LOG_DEBUG(Video) << "Received video data: " << video.size() << " bytes";
 
   if (!videoEnabled || !source) {
-    std::cerr << "VideoReceiver not enabled or source not set" << std::endl;
-    delete video;
+    LOG_ERROR(Video) << "VideoReceiver not enabled or source not set";
     return;
   }
 
-  GstBuffer* buffer = gst_buffer_new_and_alloc(video->size());
+  GstBuffer* buffer = gst_buffer_new_and_alloc(video.size());
   if (!buffer) {
-    std::cerr << "Failed to allocate GstBuffer" << std::endl;
-    delete video;
+    LOG_ERROR(Video) << "Failed to allocate GstBuffer";
     return;
   }
 
   // Map the buffer for writing
   GstMapInfo map;
   if (gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
-    std::memcpy(map.data, video->data(), video->size());
+    std::memcpy(map.data, video.data(), video.size());
     gst_buffer_unmap(buffer, &map);
 
     GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(source), buffer);
     if (ret != GST_FLOW_OK) {
-      std::cerr << "Error pushing buffer: " << gst_flow_get_name(ret) << std::endl;
+      LOG_ERROR(Video) << "Error pushing buffer: " << gst_flow_get_name(ret);
+    } else {
+      metricBuffers.add();
+      metricBytes.add(video.size());
     }
   } else {
-    std::cerr << "Error mapping buffer" << std::endl;
+    LOG_ERROR(Video) << "Error mapping buffer";
     gst_buffer_unref(buffer);
   }
 
-  // Delete the video data as we've copied it into the GStreamer buffer
-  delete video;
+  // The pooled video buffer is released here as we've copied it into the GStreamer buffer
 }
 
 bool VideoReceiverGst::createPipeline()
@@ -300,18 +307,18 @@ bool VideoReceiverGst::createPipeline()
     return true; // Already created
   }
 
-  std::cout << "Creating GStreamer pipeline" << std::endl;
+  LOG_INFO(Video) << "Creating GStreamer pipeline";
 
   // Create receiving video pipeline
   pipeline = gst_pipeline_new("videopipeline");
   if (!pipeline) {
-    std::cerr << "Failed to create pipeline" << std::endl;
+    LOG_ERROR(Video) << "Failed to create pipeline";
     return false;
   }
 
   source = gst_element_factory_make("appsrc", "source");
   if (!source) {
-    std::cerr << "Failed to create appsrc element" << std::endl;
+    LOG_ERROR(Video) << "Failed to create appsrc element";
     gst_object_unref(pipeline);
     pipeline = nullptr;
     return false;
@@ -324,7 +331,7 @@ bool VideoReceiverGst::createPipeline()
   sink = gst_element_factory_make("appsink", "sink");
 
   if (!rtpdepay || !parse || !decoder || !convert || !sink) {
-    std::cerr << "Failed to create pipeline elements" << std::endl;
+    LOG_ERROR(Video) << "Failed to create pipeline elements";
     gst_object_unref(pipeline);
     pipeline = nullptr;
     return false;
@@ -365,7 +372,7 @@ bool VideoReceiverGst::createPipeline()
 
   // Link elements
   if (!gst_element_link_many(source, rtpdepay, parse, decoder, convert, sink, nullptr)) {
-    std::cerr << "Failed to link pipeline elements" << std::endl;
+    LOG_ERROR(Video) << "Failed to link pipeline elements";
     gst_object_unref(pipeline);
     pipeline = nullptr;
     return false;
@@ -379,14 +386,14 @@ bool VideoReceiverGst::createPipeline()
   // Start the pipeline
   GstStateChangeReturn ret = gst_element_set_state(pipeline, GST_STATE_PLAYING);
   if (ret == GST_STATE_CHANGE_FAILURE) {
-    std::cerr << "Failed to start GStreamer pipeline" << std::endl;
+    LOG_ERROR(Video) << "Failed to start GStreamer pipeline";
     gst_object_unref(pipeline);
     pipeline = nullptr;
     return false;
   }
 
   videoEnabled = true;
-  std::cout << "GStreamer pipeline created and started" << std::endl;
+  LOG_INFO(Video) << "GStreamer pipeline created and started";
   return true;
 }
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "IVideoReceiver.h"
+#include "Metrics.h"
 #include <vector>
 #include <deque>
 #include <mutex>
@@ -25,7 +26,7 @@ class VideoReceiverGst : public IVideoReceiver
   // Implement IVideoReceiver interface
   bool init() override;
   void deinit() override;
-  void consumeBitStream(std::vector<std::uint8_t>* video) override;
+  void consumeBitStream(PooledBuffer video) override;
   std::uint16_t getBufferFilled() override;
 
   // Get the latest decoded frame data
@@ -63,6 +64,11 @@ class VideoReceiverGst : public IVideoReceiver
   // Video state
   bool videoEnabled;
   bool initialized;
+
+  // Exported metrics
+  Metrics::Counter& metricBuffers;
+  Metrics::Counter& metricBytes;
+  Metrics::Counter& metricDecodedFrames;
 };
 
 /* Emacs indentatation information
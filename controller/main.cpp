@@ -7,10 +7,13 @@
 #include <iostream>
 #include <cstdlib>
 #include <filesystem>
+#include <memory>
 
 #include "Controller.h"
 #include "UI-sdl.h"
 #include "VideoReceiverGst.h"
+#include "MetricsExporter.h"
+#include "Log.h"
 
 extern "C" const char* __lsan_default_options() {
   // You can combine multiple options with colons
@@ -19,8 +22,11 @@ extern "C" const char* __lsan_default_options() {
 
 int main(int argc, char *argv[])
 {
+  Log::init();
+
   // Create the event loop
   EventLoop eventLoop;
+  eventLoop.configureFromEnvironment();
 
     // Create the controller
   Controller controller(eventLoop, new VideoReceiverGst(), new AudioReceiver());
@@ -56,6 +62,14 @@ int main(int argc, char *argv[])
   // Connect to the server
   controller.connect(relay, 12347);
 
+  // Metrics for scraping, the controller runs without them if this fails
+  std::unique_ptr<MetricsExporter> metrics;
+  std::string metricsPath = MetricsExporter::pathFromEnvironment("/tmp/pleco-controller.sock");
+  if (!metricsPath.empty()) {
+    metrics = std::make_unique<MetricsExporter>(eventLoop, metricsPath);
+    metrics->start();
+  }
+
   // Run the event loop in a separate thread
   controller.start();
 
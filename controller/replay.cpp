@@ -0,0 +1,140 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Capture.h"
+#include "Controller.h"
+#include "VideoReceiverGst.h"
+#include "AudioReceiver.h"
+#include "Metrics.h"
+#include "Log.h"
+
+// Time given to the decoders after the last datagram
+constexpr int REPLAY_DRAIN_MS = 1000;
+
+using Clock = std::chrono::steady_clock;
+
+static void usage(const char* argv0)
+{
+  std::filesystem::path exePath(argv0);
+  std::cout << "Usage: " << exePath.filename().string() << " [options] <capture file>" << std::endl
+            << "  --speed <factor>  Replay speed, 1 for the original timing (default),"
+            << " 0 for as fast as possible" << std::endl
+            << "  --sent            Replay the sent datagrams, e.g. of a slave capture" << std::endl
+            << "  --audio           Play the audio" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+  Log::init();
+
+  double speed = 1.0;
+  bool replaySent = false;
+  bool playAudio = false;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--speed" && i + 1 < argc) {
+      speed = std::atof(argv[++i]);
+    } else if (arg == "--sent") {
+      replaySent = true;
+    } else if (arg == "--audio") {
+      playAudio = true;
+    } else if (arg == "--help" || arg == "-h" || !path.empty()) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    } else {
+      path = arg;
+    }
+  }
+
+  if (path.empty() || speed < 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  CaptureReader capture;
+  if (!capture.open(path)) {
+    return EXIT_FAILURE;
+  }
+
+  CaptureDirection direction = replaySent ? CaptureDirection::Sent : CaptureDirection::Received;
+
+  // The decoders are ready before the first datagram arrives
+  VideoReceiverGst* video = new VideoReceiverGst();
+  if (!video->init()) {
+    LOG_ERROR(Main) << "Failed to initialize the video receiver";
+  }
+
+  AudioReceiver* audio = new AudioReceiver();
+  if (playAudio) {
+    audio->enableAudio(true);
+  }
+
+  EventLoop eventLoop;
+  eventLoop.configureFromEnvironment();
+
+  // The controller stack as in a live run, but fed from the capture
+  Controller controller(eventLoop, video, audio);
+  controller.setOffline(capture.getCrcMode());
+  controller.connect("127.0.0.1", 0);
+  controller.start();
+
+  LOG_INFO(Main) << "Replaying " << path << " at speed " << speed;
+
+  std::uint64_t datagrams = 0;
+  std::uint64_t bytes = 0;
+  bool first = true;
+  std::chrono::nanoseconds firstTimestamp(0);
+  Clock::time_point start = Clock::now();
+
+  CaptureReader::Record record;
+  while (capture.next(record)) {
+    if (record.direction != direction) {
+      continue;
+    }
+
+    if (first) {
+      firstTimestamp = record.timestamp;
+      first = false;
+    }
+
+    // Keep the original spacing, scaled by the speed
+    if (speed > 0) {
+      auto offset = std::chrono::duration_cast<Clock::duration>((record.timestamp - firstTimestamp) / speed);
+      std::this_thread::sleep_until(start + offset);
+    }
+
+    controller.replayDatagram(record.data, record.size);
+    datagrams++;
+    bytes += record.size;
+  }
+
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(REPLAY_DRAIN_MS));
+  controller.stop();
+
+  std::cout << "Replayed " << datagrams << " datagrams, " << bytes << " bytes in "
+            << seconds << " s" << std::endl;
+  std::cout << Metrics::registry().format();
+
+  return EXIT_SUCCESS;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
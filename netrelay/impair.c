@@ -0,0 +1,414 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "impair.h"
+
+#include <errno.h>          /* errno */
+#include <stdio.h>          /* *printf, fopen */
+#include <stdlib.h>         /* malloc */
+#include <string.h>         /* strerror, memcpy */
+#include <time.h>           /* clock_gettime */
+#include <sys/socket.h>     /* sendto */
+
+struct impair_packet {
+  uint64_t due_us;
+  uint64_t seq;
+  int fd;
+  struct sockaddr_in dst;
+  size_t len;
+  unsigned char data[];
+};
+
+static int config_enabled(const impair_config_t *c);
+static uint64_t splitmix64(uint64_t *state);
+static double random_unit(void *arg);
+static void schedule(impair_dir_t *dir, uint64_t due_us, int fd,
+                     const struct sockaddr_in *dst, const void *data, size_t len);
+static void heap_push(impair_dir_t *dir, impair_packet_t *packet);
+static impair_packet_t *heap_pop(impair_dir_t *dir);
+static void send_packet(impair_dir_t *dir, const impair_packet_t *packet);
+
+
+uint64_t impair_now_us(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+
+void impair_init(impair_dir_t *dir, const char *name, uint64_t seed)
+{
+  memset(dir, 0, sizeof(*dir));
+  dir->name = name;
+  dir->rng = splitmix64(&seed);
+
+  /* xorshift never leaves zero */
+  if (dir->rng == 0) {
+    dir->rng = 1;
+  }
+}
+
+
+void impair_configure(impair_dir_t *dir, const impair_config_t *config)
+{
+  dir->config = *config;
+  dir->enabled = config_enabled(config);
+  dir->ge_bad = 0;
+}
+
+
+void impair_describe(const char *name, const impair_config_t *config)
+{
+  const impair_config_t *c = config;
+  int enabled = config_enabled(config);
+
+  printf("Impairment %s: %s", name, enabled ? "" : "off");
+  if (enabled) {
+    printf("loss %.2f%%", c->loss * 100);
+    if (c->ge) {
+      printf(", GE p %.2f%% r %.2f%% h %.2f%% k %.2f%%",
+             c->ge_p * 100, c->ge_r * 100, c->ge_h * 100, c->ge_k * 100);
+    }
+    printf(", delay %.1f ms, jitter %.1f ms, reorder %.2f%%, dup %.2f%%",
+           c->delay_us / 1000.0, c->jitter_us / 1000.0, c->reorder * 100, c->dup * 100);
+    if (c->rate_bps > 0) {
+      printf(", rate %llu kbit/s, queue %zu bytes",
+             (unsigned long long)(c->rate_bps / 1000), c->queue_bytes);
+    }
+  }
+  printf("\n");
+}
+
+
+void impair_free(impair_dir_t *dir)
+{
+  size_t i;
+
+  for (i = 0; i < dir->count; i++) {
+    free(dir->heap[i]);
+  }
+  free(dir->heap);
+  dir->heap = NULL;
+  dir->count = 0;
+  dir->capacity = 0;
+}
+
+
+void impair_submit(impair_dir_t *dir, uint64_t now_us, int fd,
+                   const struct sockaddr_in *dst, const void *data, size_t len)
+{
+  const impair_config_t *c = &dir->config;
+  uint64_t depart_us = now_us;
+  int copies = 1;
+  int i;
+
+  dir->received++;
+
+  if (impair_lose(c, &dir->ge_bad, random_unit, dir)) {
+    dir->lost++;
+    return;
+  }
+
+  /* Serialisation at the capped rate, tail drop when the queue is full */
+  if (c->rate_bps > 0) {
+    uint64_t start_us = dir->link_free_us > now_us ? dir->link_free_us : now_us;
+    uint64_t backlog = (start_us - now_us) * c->rate_bps / 8 / 1000000;
+
+    if (backlog + len > c->queue_bytes) {
+      dir->queue_drops++;
+      return;
+    }
+
+    depart_us = start_us + (uint64_t)len * 8 * 1000000 / c->rate_bps;
+    dir->link_free_us = depart_us;
+  }
+
+  if (c->dup > 0 && random_unit(dir) < c->dup) {
+    dir->duplicated++;
+    copies = 2;
+  }
+
+  for (i = 0; i < copies; i++) {
+    uint64_t due_us = depart_us;
+
+    if (c->reorder > 0 && random_unit(dir) < c->reorder) {
+      /* Ahead of the packets still in flight */
+      dir->reordered++;
+    } else {
+      int64_t delay = (int64_t)c->delay_us;
+      if (c->jitter_us > 0) {
+        delay += (int64_t)(random_unit(dir) * (double)(2 * c->jitter_us)) - (int64_t)c->jitter_us;
+      }
+      if (delay > 0) {
+        due_us += (uint64_t)delay;
+      }
+    }
+
+    schedule(dir, due_us, fd, dst, data, len);
+  }
+
+  impair_flush(dir, now_us);
+}
+
+
+int impair_next_due(const impair_dir_t *dir, uint64_t *due_us)
+{
+  if (dir->count == 0) {
+    return 0;
+  }
+
+  *due_us = dir->heap[0]->due_us;
+  return 1;
+}
+
+
+void impair_flush(impair_dir_t *dir, uint64_t now_us)
+{
+  while (dir->count > 0 && dir->heap[0]->due_us <= now_us) {
+    impair_packet_t *packet = heap_pop(dir);
+    send_packet(dir, packet);
+    free(packet);
+  }
+}
+
+
+void impair_print_stats(const impair_dir_t *dir)
+{
+  printf("Impairment %s: received %llu, sent %llu, lost %llu, queue drops %llu, "
+         "duplicated %llu, reordered %llu, send errors %llu\n",
+         dir->name,
+         (unsigned long long)dir->received, (unsigned long long)dir->sent,
+         (unsigned long long)dir->lost, (unsigned long long)dir->queue_drops,
+         (unsigned long long)dir->duplicated, (unsigned long long)dir->reordered,
+         (unsigned long long)dir->send_errors);
+}
+
+
+int impair_script_load(impair_script_t *script, const char *path)
+{
+  FILE *file;
+  char line[600];
+  int lineno = 0;
+
+  memset(script, 0, sizeof(*script));
+
+  file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open impairment script %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char direction[16];
+    char spec[512];
+    double at_ms;
+    int fields;
+    impair_step_t *step;
+
+    lineno++;
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\0') {
+      continue;
+    }
+
+    spec[0] = '\0';
+    fields = sscanf(line, "%lf %15s %511s", &at_ms, direction, spec);
+    if (fields < 2 || at_ms < 0 ||
+        (strcmp(direction, "up") != 0 && strcmp(direction, "down") != 0)) {
+      fprintf(stderr, "%s:%d: expected \"<ms> up|down <impairment>\"\n", path, lineno);
+      fclose(file);
+      return -1;
+    }
+
+    if (script->count == IMPAIR_SCRIPT_MAX_STEPS) {
+      fprintf(stderr, "%s:%d: too many steps\n", path, lineno);
+      fclose(file);
+      return -1;
+    }
+
+    step = &script->steps[script->count];
+    step->at_us = (uint64_t)(at_ms * 1000);
+    step->up = strcmp(direction, "up") == 0;
+    if (impair_parse(&step->config, spec) != 0) {
+      fprintf(stderr, "%s:%d: invalid impairment\n", path, lineno);
+      fclose(file);
+      return -1;
+    }
+
+    if (script->count > 0 && step->at_us < script->steps[script->count - 1].at_us) {
+      fprintf(stderr, "%s:%d: steps must be in time order\n", path, lineno);
+      fclose(file);
+      return -1;
+    }
+
+    script->count++;
+  }
+
+  fclose(file);
+  return 0;
+}
+
+
+void impair_script_run(impair_script_t *script, uint64_t elapsed_us,
+                       impair_dir_t *up, impair_dir_t *down, int describe)
+{
+  while (script->next < script->count && script->steps[script->next].at_us <= elapsed_us) {
+    impair_step_t *step = &script->steps[script->next++];
+    impair_configure(step->up ? up : down, &step->config);
+    if (describe) {
+      impair_describe(step->up ? "up" : "down", &step->config);
+    }
+  }
+}
+
+
+int impair_script_next(const impair_script_t *script, uint64_t *at_us)
+{
+  if (script->next >= script->count) {
+    return 0;
+  }
+
+  *at_us = script->steps[script->next].at_us;
+  return 1;
+}
+
+
+static int config_enabled(const impair_config_t *c)
+{
+  return c->loss > 0 || c->ge || c->delay_us > 0 || c->jitter_us > 0 ||
+    c->reorder > 0 || c->dup > 0 || c->rate_bps > 0;
+}
+
+
+static uint64_t splitmix64(uint64_t *state)
+{
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+
+/* xorshift64*, uniform in [0, 1) */
+static double random_unit(void *arg)
+{
+  impair_dir_t *dir = arg;
+
+  dir->rng ^= dir->rng >> 12;
+  dir->rng ^= dir->rng << 25;
+  dir->rng ^= dir->rng >> 27;
+  return (double)((dir->rng * 0x2545f4914f6cdd1dULL) >> 11) / (double)(1ULL << 53);
+}
+
+
+static void schedule(impair_dir_t *dir, uint64_t due_us, int fd,
+                     const struct sockaddr_in *dst, const void *data, size_t len)
+{
+  impair_packet_t *packet = malloc(sizeof(*packet) + len);
+
+  if (packet == NULL) {
+    fprintf(stderr, "Out of memory, dropping a %zu byte packet\n", len);
+    return;
+  }
+
+  packet->due_us = due_us;
+  packet->seq = dir->seq++;
+  packet->fd = fd;
+  packet->dst = *dst;
+  packet->len = len;
+  memcpy(packet->data, data, len);
+
+  heap_push(dir, packet);
+}
+
+
+/* Earlier due first, in arrival order when due at the same time */
+static int heap_before(const impair_packet_t *a, const impair_packet_t *b)
+{
+  return a->due_us < b->due_us || (a->due_us == b->due_us && a->seq < b->seq);
+}
+
+
+static void heap_push(impair_dir_t *dir, impair_packet_t *packet)
+{
+  size_t i;
+
+  if (dir->count == dir->capacity) {
+    size_t capacity = dir->capacity ? dir->capacity * 2 : 256;
+    impair_packet_t **heap = realloc(dir->heap, capacity * sizeof(*heap));
+    if (heap == NULL) {
+      fprintf(stderr, "Out of memory, dropping a %zu byte packet\n", packet->len);
+      free(packet);
+      return;
+    }
+    dir->heap = heap;
+    dir->capacity = capacity;
+  }
+
+  i = dir->count++;
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!heap_before(packet, dir->heap[parent])) {
+      break;
+    }
+    dir->heap[i] = dir->heap[parent];
+    i = parent;
+  }
+  dir->heap[i] = packet;
+}
+
+
+static impair_packet_t *heap_pop(impair_dir_t *dir)
+{
+  impair_packet_t *top = dir->heap[0];
+  impair_packet_t *last = dir->heap[--dir->count];
+  size_t i = 0;
+
+  while (1) {
+    size_t child = 2 * i + 1;
+    if (child >= dir->count) {
+      break;
+    }
+    if (child + 1 < dir->count && heap_before(dir->heap[child + 1], dir->heap[child])) {
+      child++;
+    }
+    if (!heap_before(dir->heap[child], last)) {
+      break;
+    }
+    dir->heap[i] = dir->heap[child];
+    i = child;
+  }
+  if (dir->count > 0) {
+    dir->heap[i] = last;
+  }
+
+  return top;
+}
+
+
+static void send_packet(impair_dir_t *dir, const impair_packet_t *packet)
+{
+  ssize_t bytes_sent = sendto(packet->fd, packet->data, packet->len, 0,
+                              (const struct sockaddr *)&packet->dst, sizeof(packet->dst));
+
+  /* Counted only, a full socket buffer would fail every datagram */
+  if (bytes_sent < 0) {
+    dir->send_errors++;
+    return;
+  }
+
+  dir->sent++;
+}
+
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NETRELAY_IMPAIR_H
+#define NETRELAY_IMPAIR_H
+
+#include <stddef.h>         /* size_t */
+#include <stdint.h>         /* std data types */
+#include <netinet/in.h>     /* sockaddr_in */
+
+#include "impair_config.h"
+
+/*
+ * Network impairment for one direction of the relay, in the spirit of
+ * netem. The configuration and its loss model are in impair_config.h.
+ */
+
+#define IMPAIR_SCRIPT_MAX_STEPS   1024
+
+typedef struct impair_packet impair_packet_t;
+
+typedef struct {
+  const char *name;
+  int enabled;
+  impair_config_t config;
+
+  uint64_t rng;
+  int ge_bad;
+  uint64_t link_free_us;        /* When the capped link is idle again */
+
+  /* Packets waiting for their time, a binary heap on the due time */
+  impair_packet_t **heap;
+  size_t count;
+  size_t capacity;
+  uint64_t seq;
+
+  /* Statistics */
+  uint64_t received;
+  uint64_t sent;
+  uint64_t lost;
+  uint64_t queue_drops;
+  uint64_t duplicated;
+  uint64_t reordered;
+  uint64_t send_errors;
+} impair_dir_t;
+
+/* A configuration change at a time from the start, see impair_script_load() */
+typedef struct {
+  uint64_t at_us;
+  int up;
+  impair_config_t config;
+} impair_step_t;
+
+typedef struct {
+  impair_step_t steps[IMPAIR_SCRIPT_MAX_STEPS];
+  size_t count;
+  size_t next;
+} impair_script_t;
+
+uint64_t impair_now_us(void);
+
+/* Each direction draws from its own generator seeded from seed */
+void impair_init(impair_dir_t *dir, const char *name, uint64_t seed);
+void impair_configure(impair_dir_t *dir, const impair_config_t *config);
+void impair_free(impair_dir_t *dir);
+
+/* Print the configuration of the direction called name */
+void impair_describe(const char *name, const impair_config_t *config);
+
+/* Drop, delay or pass on a datagram to dst through fd */
+void impair_submit(impair_dir_t *dir, uint64_t now_us, int fd,
+                   const struct sockaddr_in *dst, const void *data, size_t len);
+
+/* Due time of the next delayed datagram, returns 0 if there is none */
+int impair_next_due(const impair_dir_t *dir, uint64_t *due_us);
+
+/* Send the datagrams that are due */
+void impair_flush(impair_dir_t *dir, uint64_t now_us);
+
+void impair_print_stats(const impair_dir_t *dir);
+
+/*
+ * Load a script of configuration changes, one per line:
+ *   <ms from start> up|down <configuration>
+ * e.g. "5000 up loss=10,delay=50". Empty lines and lines starting with
+ * # are skipped. Returns -1 on error.
+ */
+int impair_script_load(impair_script_t *script, const char *path);
+
+/* Apply the steps due by elapsed_us, printing them if describe is set.
+ * Each worker runs its own copy of the script, one of them describes. */
+void impair_script_run(impair_script_t *script, uint64_t elapsed_us,
+                       impair_dir_t *up, impair_dir_t *down, int describe);
+
+/* Time from the start of the next step, returns 0 if there is none */
+int impair_script_next(const impair_script_t *script, uint64_t *at_us);
+
+#endif
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "impair_config.h"
+
+#include <stdio.h>          /* fprintf */
+#include <stdlib.h>         /* strtod */
+#include <string.h>         /* strtok_r, strcmp */
+
+static int parse_percent(const char *value, double *result);
+static int parse_ms(const char *value, uint64_t *result);
+
+
+int impair_parse(impair_config_t *config, const char *spec)
+{
+  char buf[512];
+  char *saveptr = NULL;
+  char *token;
+
+  memset(config, 0, sizeof(*config));
+  config->queue_bytes = IMPAIR_QUEUE_DEFAULT_KB * 1024;
+
+  if (spec == NULL || spec[0] == '\0' || strcmp(spec, "off") == 0) {
+    return 0;
+  }
+
+  if (strlen(spec) >= sizeof(buf)) {
+    fprintf(stderr, "Impairment too long: %s\n", spec);
+    return -1;
+  }
+  strcpy(buf, spec);
+
+  for (token = strtok_r(buf, ",", &saveptr); token != NULL;
+       token = strtok_r(NULL, ",", &saveptr)) {
+    char *value = strchr(token, '=');
+    int ok = -1;
+
+    if (value == NULL) {
+      fprintf(stderr, "Impairment without a value: %s\n", token);
+      return -1;
+    }
+    *value++ = '\0';
+
+    if (strcmp(token, "loss") == 0) {
+      ok = parse_percent(value, &config->loss);
+    } else if (strcmp(token, "ge") == 0) {
+      char *fields[4] = { NULL, NULL, NULL, NULL };
+      char *fieldptr = NULL;
+      int count = 0;
+      char *field;
+
+      for (field = strtok_r(value, ":", &fieldptr); field != NULL;
+           field = strtok_r(NULL, ":", &fieldptr)) {
+        if (count < 4) {
+          fields[count] = field;
+        }
+        count++;
+      }
+
+      /* By default the bad state loses everything and the good nothing */
+      config->ge = 1;
+      config->ge_h = 0.0;
+      config->ge_k = 1.0;
+      ok = count >= 2 && count <= 4 ? 0 : -1;
+      if (ok == 0) ok = parse_percent(fields[0], &config->ge_p);
+      if (ok == 0) ok = parse_percent(fields[1], &config->ge_r);
+      if (ok == 0 && fields[2] != NULL) ok = parse_percent(fields[2], &config->ge_h);
+      if (ok == 0 && fields[3] != NULL) ok = parse_percent(fields[3], &config->ge_k);
+    } else if (strcmp(token, "delay") == 0) {
+      ok = parse_ms(value, &config->delay_us);
+    } else if (strcmp(token, "jitter") == 0) {
+      ok = parse_ms(value, &config->jitter_us);
+    } else if (strcmp(token, "reorder") == 0) {
+      ok = parse_percent(value, &config->reorder);
+    } else if (strcmp(token, "dup") == 0) {
+      ok = parse_percent(value, &config->dup);
+    } else if (strcmp(token, "rate") == 0) {
+      char *end;
+      double kbit = strtod(value, &end);
+      if (*end == '\0' && kbit >= 0) {
+        config->rate_bps = (uint64_t)(kbit * 1000);
+        ok = 0;
+      }
+    } else if (strcmp(token, "queue") == 0) {
+      char *end;
+      double kb = strtod(value, &end);
+      if (*end == '\0' && kb >= 0) {
+        config->queue_bytes = (size_t)(kb * 1024);
+        ok = 0;
+      }
+    } else {
+      fprintf(stderr, "Unknown impairment: %s\n", token);
+      return -1;
+    }
+
+    if (ok != 0) {
+      fprintf(stderr, "Invalid value for %s: %s\n", token, value);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+
+int impair_lose(const impair_config_t *config, int *ge_bad,
+                double (*random_unit)(void *arg), void *arg)
+{
+  /* Burst loss: the state changes per packet, then the packet gets
+   * through with the probability of the state */
+  if (config->ge) {
+    double pass;
+    if (*ge_bad) {
+      if (random_unit(arg) < config->ge_r) {
+        *ge_bad = 0;
+      }
+    } else {
+      if (random_unit(arg) < config->ge_p) {
+        *ge_bad = 1;
+      }
+    }
+    pass = *ge_bad ? config->ge_h : config->ge_k;
+    if (random_unit(arg) >= pass) {
+      return 1;
+    }
+  }
+
+  return config->loss > 0 && random_unit(arg) < config->loss;
+}
+
+
+static int parse_percent(const char *value, double *result)
+{
+  char *end;
+  double percent = strtod(value, &end);
+
+  if (end == value || *end != '\0' || percent < 0 || percent > 100) {
+    return -1;
+  }
+
+  *result = percent / 100;
+  return 0;
+}
+
+
+static int parse_ms(const char *value, uint64_t *result)
+{
+  char *end;
+  double ms = strtod(value, &end);
+
+  if (end == value || *end != '\0' || ms < 0) {
+    return -1;
+  }
+
+  *result = (uint64_t)(ms * 1000);
+  return 0;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NETRELAY_IMPAIR_CONFIG_H
+#define NETRELAY_IMPAIR_CONFIG_H
+
+#include <stddef.h>         /* size_t */
+#include <stdint.h>         /* std data types */
+
+/*
+ * Network impairment configuration, in the spirit of netem: random and
+ * Gilbert-Elliott burst loss, delay with jitter, reordering, duplication
+ * and a bandwidth cap with a tail drop queue. Shared by the relay and
+ * the in-memory DatagramLink of common/, so that the same configuration
+ * behaves the same in both.
+ *
+ * A configuration is given as comma separated key=value pairs, e.g.
+ * "loss=1,delay=20,jitter=5,rate=4000". Percentages are 0-100.
+ *
+ *   loss=PCT           random loss
+ *   ge=P:R[:H[:K]]     Gilbert-Elliott loss: P good->bad and R bad->good
+ *                      transition per packet, packets get through with H
+ *                      in the bad state (default 0) and K in the good
+ *                      state (default 100)
+ *   delay=MS           one way delay
+ *   jitter=MS          delay varies uniformly by +-MS, may reorder
+ *   reorder=PCT        packets sent at once, ahead of the delayed ones
+ *   dup=PCT            packets sent twice
+ *   rate=KBIT          bandwidth cap in kbit/s
+ *   queue=KB           bytes queued at the cap before tail drop (default 64)
+ *
+ * "off" or an empty string disables the impairment.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMPAIR_QUEUE_DEFAULT_KB   64
+
+typedef struct {
+  double loss;
+  int ge;
+  double ge_p;
+  double ge_r;
+  double ge_h;
+  double ge_k;
+  uint64_t delay_us;
+  uint64_t jitter_us;
+  double reorder;
+  double dup;
+  uint64_t rate_bps;
+  size_t queue_bytes;
+} impair_config_t;
+
+/* Parse a configuration, returns -1 on error */
+int impair_parse(impair_config_t *config, const char *spec);
+
+/* Decide if a packet is lost, random and burst loss. ge_bad is the
+ * Gilbert-Elliott state of the direction, random_unit returns a
+ * uniform value in [0, 1) from the generator in arg. */
+int impair_lose(const impair_config_t *config, int *ge_bad,
+                double (*random_unit)(void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
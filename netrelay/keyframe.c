@@ -0,0 +1,282 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdlib.h>         /* calloc, realloc, free */
+#include <string.h>         /* memcpy */
+
+#include "keyframe.h"
+
+/* From MessageOffset and MessageType in common/Message.h */
+#define MESSAGE_OFFSET_TYPE       4
+#define MESSAGE_OFFSET_PAYLOAD    6
+#define MESSAGE_TYPE_VIDEO        66
+
+#define RTP_HEADER_LEN            12
+
+/* H.264 NAL unit types, RFC 6184 */
+#define NAL_IDR                   5
+#define NAL_SPS                   7
+#define NAL_PPS                   8
+#define NAL_STAP_A                24
+#define NAL_FU_A                  28
+
+#define KEYFRAME_INITIAL_CAPACITY (16 * 1024)
+
+typedef struct {
+  uint16_t seq;
+  uint32_t timestamp;
+  int marker;
+  int params;                   /* Carries SPS or PPS */
+  int idr;                      /* Carries a part of an IDR slice */
+  int idr_start;                /* Carries the start of an IDR slice */
+} rtp_info_t;
+
+static int parse_packet(const unsigned char *rtp, size_t len, rtp_info_t *info);
+static void classify_nal(unsigned char nal, rtp_info_t *info);
+static void buffer_reset(keyframe_buffer_t *buffer, uint32_t timestamp);
+static int buffer_reserve(keyframe_buffer_t *buffer, size_t needed);
+static int buffer_append(keyframe_buffer_t *buffer, const unsigned char *msg, size_t len);
+static int buffer_copy(keyframe_buffer_t *buffer, const keyframe_buffer_t *source);
+
+
+void keyframe_observe(keyframe_cache_t **cache, const unsigned char *msg, size_t len)
+{
+  keyframe_cache_t *keyframes;
+  rtp_info_t info;
+
+  if (len <= MESSAGE_OFFSET_PAYLOAD || msg[MESSAGE_OFFSET_TYPE] != MESSAGE_TYPE_VIDEO) {
+    return;
+  }
+
+  if (parse_packet(msg + MESSAGE_OFFSET_PAYLOAD, len - MESSAGE_OFFSET_PAYLOAD, &info) != 0) {
+    return;
+  }
+
+  if (*cache == NULL) {
+    *cache = calloc(1, sizeof(**cache));
+    if (*cache == NULL) {
+      return;
+    }
+  }
+  keyframes = *cache;
+
+  /* The encoder sends the parameter sets in front of each IDR */
+  if (info.params && !info.idr) {
+    if (keyframes->params.count == 0 || keyframes->params.timestamp != info.timestamp) {
+      buffer_reset(&keyframes->params, info.timestamp);
+    }
+    buffer_append(&keyframes->params, msg, len);
+    return;
+  }
+
+  if (info.idr_start &&
+      (!keyframes->building_active || keyframes->building.timestamp != info.timestamp)) {
+    /* The keyframe starts with the parameter sets it was encoded with */
+    if (buffer_copy(&keyframes->building, &keyframes->params) != 0) {
+      keyframes->building_active = 0;
+      return;
+    }
+    keyframes->building.timestamp = info.timestamp;
+    keyframes->building_active = 1;
+  } else if (!keyframes->building_active || keyframes->building.timestamp != info.timestamp) {
+    /* Not a part of an IDR access unit */
+    return;
+  } else if (info.seq != keyframes->next_seq) {
+    /* A packet of the IDR was lost, wait for the next one */
+    keyframes->building_active = 0;
+    return;
+  }
+
+  if (buffer_append(&keyframes->building, msg, len) != 0) {
+    keyframes->building_active = 0;
+    return;
+  }
+  keyframes->next_seq = (uint16_t)(info.seq + 1);
+
+  /* The marker is on the last packet of the access unit */
+  if (info.marker) {
+    keyframe_buffer_t previous = keyframes->frame;
+
+    keyframes->frame = keyframes->building;
+    keyframes->building = previous;
+    keyframes->building_active = 0;
+  }
+}
+
+
+int keyframe_next(const keyframe_cache_t *cache, size_t *offset,
+                  const unsigned char **msg, size_t *len)
+{
+  const keyframe_buffer_t *frame;
+
+  if (cache == NULL || *offset >= cache->frame.size) {
+    return 0;
+  }
+
+  frame = &cache->frame;
+  *len = ((size_t)frame->data[*offset] << 8) | frame->data[*offset + 1];
+  *msg = frame->data + *offset + 2;
+  *offset += 2 + *len;
+
+  return 1;
+}
+
+
+void keyframe_free(keyframe_cache_t *cache)
+{
+  if (cache == NULL) {
+    return;
+  }
+
+  free(cache->params.data);
+  free(cache->frame.data);
+  free(cache->building.data);
+  free(cache);
+}
+
+
+static int parse_packet(const unsigned char *rtp, size_t len, rtp_info_t *info)
+{
+  size_t offset = RTP_HEADER_LEN + 4 * (size_t)(rtp[0] & 0x0f);
+  unsigned char nal;
+
+  if (len < RTP_HEADER_LEN || (rtp[0] >> 6) != 2) {
+    return -1;
+  }
+
+  /* Header extension */
+  if (rtp[0] & 0x10) {
+    if (len < offset + 4) {
+      return -1;
+    }
+    offset += 4 + 4 * (size_t)((rtp[offset + 2] << 8) | rtp[offset + 3]);
+  }
+  if (len <= offset) {
+    return -1;
+  }
+
+  memset(info, 0, sizeof(*info));
+  info->marker = (rtp[1] & 0x80) != 0;
+  info->seq = (uint16_t)((rtp[2] << 8) | rtp[3]);
+  info->timestamp = ((uint32_t)rtp[4] << 24) | ((uint32_t)rtp[5] << 16) |
+    ((uint32_t)rtp[6] << 8) | rtp[7];
+
+  nal = rtp[offset] & 0x1f;
+  if (nal == NAL_STAP_A) {
+    /* Aggregated NAL units, each after its 16 bit size */
+    size_t pos = offset + 1;
+    while (pos + 2 < len) {
+      size_t size = (size_t)((rtp[pos] << 8) | rtp[pos + 1]);
+      if (size == 0 || pos + 2 + size > len) {
+        break;
+      }
+      classify_nal(rtp[pos + 2] & 0x1f, info);
+      pos += 2 + size;
+    }
+  } else if (nal == NAL_FU_A) {
+    /* A fragment of a NAL unit, the type and the start bit in the FU header */
+    if (len < offset + 2) {
+      return -1;
+    }
+    if ((rtp[offset + 1] & 0x1f) == NAL_IDR) {
+      info->idr = 1;
+      info->idr_start = (rtp[offset + 1] & 0x80) != 0;
+    }
+  } else {
+    classify_nal(nal, info);
+  }
+
+  return 0;
+}
+
+
+static void classify_nal(unsigned char nal, rtp_info_t *info)
+{
+  if (nal == NAL_IDR) {
+    info->idr = 1;
+    info->idr_start = 1;
+  } else if (nal == NAL_SPS || nal == NAL_PPS) {
+    info->params = 1;
+  }
+}
+
+
+static void buffer_reset(keyframe_buffer_t *buffer, uint32_t timestamp)
+{
+  buffer->size = 0;
+  buffer->count = 0;
+  buffer->timestamp = timestamp;
+}
+
+
+static int buffer_reserve(keyframe_buffer_t *buffer, size_t needed)
+{
+  if (needed > KEYFRAME_MAX_BYTES) {
+    return -1;
+  }
+
+  if (needed > buffer->capacity) {
+    size_t capacity = buffer->capacity ? buffer->capacity : KEYFRAME_INITIAL_CAPACITY;
+    unsigned char *data;
+
+    while (capacity < needed) {
+      capacity *= 2;
+    }
+    data = realloc(buffer->data, capacity);
+    if (data == NULL) {
+      return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+
+  return 0;
+}
+
+
+static int buffer_append(keyframe_buffer_t *buffer, const unsigned char *msg, size_t len)
+{
+  size_t needed = buffer->size + 2 + len;
+
+  if (len > 0xffff || buffer_reserve(buffer, needed) != 0) {
+    return -1;
+  }
+
+  buffer->data[buffer->size] = (unsigned char)(len >> 8);
+  buffer->data[buffer->size + 1] = (unsigned char)len;
+  memcpy(buffer->data + buffer->size + 2, msg, len);
+  buffer->size = needed;
+  buffer->count++;
+
+  return 0;
+}
+
+
+static int buffer_copy(keyframe_buffer_t *buffer, const keyframe_buffer_t *source)
+{
+  buffer_reset(buffer, source->timestamp);
+
+  if (source->size == 0) {
+    return 0;
+  }
+  if (buffer_reserve(buffer, source->size) != 0) {
+    return -1;
+  }
+
+  memcpy(buffer->data, source->data, source->size);
+  buffer->size = source->size;
+  buffer->count = source->count;
+
+  return 0;
+}
+
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
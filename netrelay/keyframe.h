@@ -0,0 +1,66 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NETRELAY_KEYFRAME_H
+#define NETRELAY_KEYFRAME_H
+
+#include <stddef.h>         /* size_t */
+#include <stdint.h>         /* std data types */
+
+/*
+ * Cache of the latest H.264 keyframe of a session, so that a controller
+ * that joins sees a picture at once instead of waiting for the encoder's
+ * next IDR, which can be seconds away.
+ *
+ * The relay looks into the Video messages from the client, see
+ * MessageOffset in common/Message.h. Their payload is an RTP packet of
+ * rtph264pay. The packets of the latest complete IDR access unit, after
+ * the SPS and PPS sent before it, are kept as whole messages and
+ * replayed as they were to a newly learned server. Fragmented messages
+ * are not looked into, the video RTP packets fit in one datagram.
+ *
+ * The frames after the IDR are not cached, so the picture is only
+ * correct from the next IDR on, but the decoder has something to show.
+ */
+
+#define KEYFRAME_MAX_BYTES        (512 * 1024)  /* Larger keyframes are not cached */
+
+/* Messages stored back to back, each after its 16 bit length */
+typedef struct {
+  unsigned char *data;
+  size_t size;
+  size_t capacity;
+  size_t count;
+  uint32_t timestamp;           /* RTP timestamp of the messages */
+} keyframe_buffer_t;
+
+typedef struct {
+  keyframe_buffer_t params;     /* Latest SPS and PPS */
+  keyframe_buffer_t frame;      /* Latest complete IDR after its SPS and PPS */
+  keyframe_buffer_t building;   /* IDR being received */
+  int building_active;
+  uint16_t next_seq;            /* Next RTP sequence number of the IDR */
+} keyframe_cache_t;
+
+/* Look at a message from the client, with the relay header already
+ * stripped. The cache is allocated on the first video message. */
+void keyframe_observe(keyframe_cache_t **cache, const unsigned char *msg, size_t len);
+
+/* Next message of the cached keyframe, start with *offset 0. Returns 0
+ * when there are no more. */
+int keyframe_next(const keyframe_cache_t *cache, size_t *offset,
+                  const unsigned char **msg, size_t *len);
+
+void keyframe_free(keyframe_cache_t *cache);
+
+#endif
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
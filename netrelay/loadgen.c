@@ -0,0 +1,400 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>          /* errno */
+#include <string.h>         /* strerror */
+#include <stdio.h>          /* *printf */
+#include <stdint.h>         /* std data types */
+#include <stdlib.h>         /* exit */
+#include <unistd.h>         /* close */
+#include <arpa/inet.h>      /* inet_pton, htons */
+#include <netinet/in.h>     /* sockaddr_in */
+#include <sys/epoll.h>      /* epoll_* */
+#include <sys/socket.h>     /* socket, sendto, recvfrom */
+#include <getopt.h>         /* getopt_long */
+#include <time.h>           /* clock_gettime */
+
+#include "session.h"
+
+/*
+ * Load generator for netrelay: many sessions, each with a client and a
+ * server sending to each other through the relay at a fixed rate. The
+ * sessions share a few sockets per side, the payload tells the session
+ * and the send time. Reports the packets per second relayed, the loss
+ * and the latency through the relay.
+ */
+
+#define LOADGEN_CLIENT_PORT       8500
+#define LOADGEN_SERVER_PORT       12347
+
+#define LOADGEN_SESSIONS_DEFAULT  1000
+#define LOADGEN_RATE_DEFAULT      20      /* Per session and direction */
+#define LOADGEN_SIZE_DEFAULT      200
+#define LOADGEN_DURATION_DEFAULT  10
+#define LOADGEN_SOCKETS_DEFAULT   8       /* Per side */
+#define LOADGEN_MAX_SOCKETS       256
+#define LOADGEN_MAX_SIZE          1400
+#define LOADGEN_WARMUP_US         500000  /* For the relay to learn the peers */
+#define LOADGEN_DRAIN_US          500000
+#define LOADGEN_TICK_MS           1
+#define LOADGEN_SOCKET_BUFFER     (4 * 1024 * 1024)
+
+/* Latency histogram in 10 us buckets up to 100 ms */
+#define LOADGEN_BUCKET_US         10
+#define LOADGEN_BUCKETS           10000
+
+/* Payload after the relay header, which the relay strips */
+typedef struct {
+  uint32_t session;
+  uint32_t seq;                 /* 0 while warming up */
+  uint64_t sent_us;
+} loadgen_payload_t;
+
+typedef struct {
+  uint64_t sent;
+  uint64_t send_drops;          /* Socket buffer full */
+  uint64_t received;
+  uint64_t invalid;
+  uint64_t histogram[LOADGEN_BUCKETS + 1];
+} loadgen_dir_t;
+
+static uint64_t now_us(void);
+static int open_socket(void);
+static void send_one(int fd, const struct sockaddr_in *relay, uint32_t session,
+                     uint32_t seq, size_t size, loadgen_dir_t *dir);
+static void receive_all(int fd, uint32_t first, uint32_t count, loadgen_dir_t *dir);
+static uint64_t percentile_us(const loadgen_dir_t *dir, double p);
+static void print_dir(const char *name, const loadgen_dir_t *dir);
+static void usage(const char *argv0);
+
+/* up: client to server, down: server to client */
+static loadgen_dir_t dirs[2];
+
+int
+main(int argc, char **argv)
+{
+  const char *relay_host = "127.0.0.1";
+  uint32_t sessions = LOADGEN_SESSIONS_DEFAULT;
+  uint32_t first = 1;
+  int rate = LOADGEN_RATE_DEFAULT;
+  size_t size = LOADGEN_SIZE_DEFAULT;
+  int duration = LOADGEN_DURATION_DEFAULT;
+  int sockets = LOADGEN_SOCKETS_DEFAULT;
+  struct sockaddr_in relay[2];
+  int fd[2][LOADGEN_MAX_SOCKETS];
+  int epoll_fd;
+  uint64_t start_us, end_us, total, sent_total = 0;
+  double pps;
+  uint32_t s;
+  int side, i, opt;
+
+  static const struct option options[] = {
+    { "relay",    required_argument, NULL, 'r' },
+    { "sessions", required_argument, NULL, 'n' },
+    { "first",    required_argument, NULL, 'f' },
+    { "rate",     required_argument, NULL, 'p' },
+    { "size",     required_argument, NULL, 's' },
+    { "duration", required_argument, NULL, 'd' },
+    { "sockets",  required_argument, NULL, 'k' },
+    { "help",     no_argument,       NULL, 'h' },
+    { NULL,       0,                 NULL, 0 }
+  };
+
+  while ((opt = getopt_long(argc, argv, "r:n:f:p:s:d:k:h", options, NULL)) != -1) {
+    switch (opt) {
+    case 'r':
+      relay_host = optarg;
+      break;
+    case 'n':
+      sessions = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'f':
+      first = (uint32_t)strtoul(optarg, NULL, 0);
+      break;
+    case 'p':
+      rate = atoi(optarg);
+      break;
+    case 's':
+      size = strtoul(optarg, NULL, 0);
+      break;
+    case 'd':
+      duration = atoi(optarg);
+      break;
+    case 'k':
+      sockets = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      exit(opt == 'h' ? 0 : -1);
+    }
+  }
+
+  if (sessions == 0 || first == 0 || rate <= 0 || duration <= 0 ||
+      size < sizeof(loadgen_payload_t) || size > LOADGEN_MAX_SIZE ||
+      sockets <= 0 || sockets > LOADGEN_MAX_SOCKETS) {
+    usage(argv[0]);
+    exit(-1);
+  }
+
+  memset(relay, 0, sizeof(relay));
+  for (side = 0; side < 2; side++) {
+    relay[side].sin_family = AF_INET;
+    relay[side].sin_port = htons(side == RELAY_SIDE_CLIENT ? LOADGEN_CLIENT_PORT : LOADGEN_SERVER_PORT);
+    if (inet_pton(AF_INET, relay_host, &relay[side].sin_addr) != 1) {
+      fprintf(stderr, "Invalid relay address: %s\n", relay_host);
+      exit(-1);
+    }
+  }
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd == -1) {
+    fprintf(stderr, "Failed to create epoll: %s\n", strerror(errno));
+    exit(-1);
+  }
+
+  for (side = 0; side < 2; side++) {
+    for (i = 0; i < sockets; i++) {
+      struct epoll_event event;
+
+      fd[side][i] = open_socket();
+      if (fd[side][i] == -1) {
+        exit(-1);
+      }
+
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.u32 = (uint32_t)(side * LOADGEN_MAX_SOCKETS + i);
+      if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd[side][i], &event) == -1) {
+        fprintf(stderr, "Failed to add a socket to epoll: %s\n", strerror(errno));
+        exit(-1);
+      }
+    }
+  }
+
+  printf("%u sessions, %d datagrams/s per session and direction, %zu bytes, %d s\n",
+         sessions, rate, size, duration);
+
+  /* Every peer says hello first so that the relay learns them all */
+  for (side = 0; side < 2; side++) {
+    for (s = 0; s < sessions; s++) {
+      send_one(fd[side][s % sockets], &relay[side], first + s, 0, size, &dirs[side]);
+    }
+  }
+
+  /* The datagrams go out in turns of client and server of each session,
+   * as many as are due by now */
+  total = (uint64_t)sessions * 2 * rate * duration;
+  start_us = now_us() + LOADGEN_WARMUP_US;
+  end_us = start_us + (uint64_t)duration * 1000000;
+
+  while (1) {
+    struct epoll_event events[64];
+    uint64_t now = now_us();
+    uint64_t due;
+    int count;
+
+    if (now >= end_us + LOADGEN_DRAIN_US) {
+      break;
+    }
+
+    if (now >= start_us) {
+      due = now >= end_us ? total : (now - start_us) * total / (end_us - start_us);
+
+      for (; sent_total < due; sent_total++) {
+        uint64_t turn = sent_total / 2;
+        s = (uint32_t)(turn % sessions);
+        side = (int)(sent_total % 2);
+        send_one(fd[side][s % sockets], &relay[side], first + s,
+                 (uint32_t)(turn / sessions + 1), size, &dirs[side]);
+      }
+    }
+
+    count = epoll_wait(epoll_fd, events, 64, LOADGEN_TICK_MS);
+    for (i = 0; i < count; i++) {
+      uint32_t index = events[i].data.u32;
+      int to = (int)(index / LOADGEN_MAX_SOCKETS);
+
+      /* A client socket receives what the servers sent */
+      receive_all(fd[to][index % LOADGEN_MAX_SOCKETS], first, sessions, &dirs[!to]);
+    }
+  }
+
+  pps = (double)(dirs[0].received + dirs[1].received) / duration;
+  print_dir("up", &dirs[RELAY_SIDE_CLIENT]);
+  print_dir("down", &dirs[RELAY_SIDE_SERVER]);
+  printf("Relayed %.0f datagrams/s, offered %llu\n", pps,
+         (unsigned long long)(total / (uint64_t)duration));
+
+  for (side = 0; side < 2; side++) {
+    for (i = 0; i < sockets; i++) {
+      close(fd[side][i]);
+    }
+  }
+  close(epoll_fd);
+
+  return 0;
+}
+
+
+static uint64_t now_us(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+
+static int open_socket(void)
+{
+  struct sockaddr_in addr;
+  int size = LOADGEN_SOCKET_BUFFER;
+  int fd;
+
+  fd = socket(PF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Error creating socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = INADDR_ANY;
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    fprintf(stderr, "Error binding socket: %s\n", strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+static void send_one(int fd, const struct sockaddr_in *relay, uint32_t session,
+                     uint32_t seq, size_t size, loadgen_dir_t *dir)
+{
+  unsigned char buf[RELAY_HEADER_LEN + LOADGEN_MAX_SIZE];
+  loadgen_payload_t payload;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    buf[i] = (unsigned char)(RELAY_MAGIC >> (24 - 8 * i));
+    buf[4 + i] = (unsigned char)(session >> (24 - 8 * i));
+  }
+
+  payload.session = session;
+  payload.seq = seq;
+  payload.sent_us = now_us();
+  memset(buf + RELAY_HEADER_LEN, 0, size);
+  memcpy(buf + RELAY_HEADER_LEN, &payload, sizeof(payload));
+
+  if (sendto(fd, buf, RELAY_HEADER_LEN + size, 0,
+             (const struct sockaddr *)relay, sizeof(*relay)) == -1) {
+    if (seq > 0) {
+      dir->send_drops++;
+    }
+    return;
+  }
+
+  if (seq > 0) {
+    dir->sent++;
+  }
+}
+
+
+static void receive_all(int fd, uint32_t first, uint32_t count, loadgen_dir_t *dir)
+{
+  unsigned char buf[RELAY_HEADER_LEN + LOADGEN_MAX_SIZE];
+
+  while (1) {
+    loadgen_payload_t payload;
+    uint64_t latency;
+    ssize_t len;
+
+    len = recvfrom(fd, buf, sizeof(buf), 0, NULL, NULL);
+    if (len == -1) {
+      return;
+    }
+
+    if ((size_t)len < sizeof(payload)) {
+      dir->invalid++;
+      continue;
+    }
+
+    memcpy(&payload, buf, sizeof(payload));
+    if (payload.session < first || payload.session - first >= count) {
+      dir->invalid++;
+      continue;
+    }
+
+    /* The hellos only teach the relay */
+    if (payload.seq == 0) {
+      continue;
+    }
+
+    dir->received++;
+    latency = (now_us() - payload.sent_us) / LOADGEN_BUCKET_US;
+    dir->histogram[latency < LOADGEN_BUCKETS ? latency : LOADGEN_BUCKETS]++;
+  }
+}
+
+
+static uint64_t percentile_us(const loadgen_dir_t *dir, double p)
+{
+  uint64_t target = (uint64_t)(p * (double)dir->received);
+  uint64_t seen = 0;
+  int i;
+
+  for (i = 0; i <= LOADGEN_BUCKETS; i++) {
+    seen += dir->histogram[i];
+    if (seen > target) {
+      return (uint64_t)i * LOADGEN_BUCKET_US;
+    }
+  }
+
+  return (uint64_t)LOADGEN_BUCKETS * LOADGEN_BUCKET_US;
+}
+
+
+static void print_dir(const char *name, const loadgen_dir_t *dir)
+{
+  uint64_t lost = dir->sent > dir->received ? dir->sent - dir->received : 0;
+
+  printf("%-4s sent %llu, received %llu, lost %llu (%.2f%%), send drops %llu, invalid %llu, "
+         "latency p50 %llu us, p99 %llu us\n",
+         name,
+         (unsigned long long)dir->sent, (unsigned long long)dir->received,
+         (unsigned long long)lost, dir->sent ? 100.0 * (double)lost / (double)dir->sent : 0.0,
+         (unsigned long long)dir->send_drops, (unsigned long long)dir->invalid,
+         (unsigned long long)percentile_us(dir, 0.5),
+         (unsigned long long)percentile_us(dir, 0.99));
+}
+
+
+static void usage(const char *argv0)
+{
+  printf("Usage: %s [options]\n"
+         "  -r, --relay <address>     Address of the relay (default 127.0.0.1)\n"
+         "  -n, --sessions <n>        Sessions (default %d)\n"
+         "  -f, --first <id>          ID of the first session (default 1)\n"
+         "  -p, --rate <n>            Datagrams per second per session and direction (default %d)\n"
+         "  -s, --size <bytes>        Payload size (default %d)\n"
+         "  -d, --duration <s>        Time to send (default %d)\n"
+         "  -k, --sockets <n>         Sockets per side shared by the sessions (default %d)\n",
+         argv0, LOADGEN_SESSIONS_DEFAULT, LOADGEN_RATE_DEFAULT, LOADGEN_SIZE_DEFAULT,
+         LOADGEN_DURATION_DEFAULT, LOADGEN_SOCKETS_DEFAULT);
+}
+
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -3,245 +3,316 @@
  * SPDX-License-Identifier: MIT
  */
 
-#include <assert.h>         /* assert */
+#define _GNU_SOURCE         /* mmsghdr in worker.h */
+
 #include <errno.h>          /* errno */
-#include <fcntl.h>          /* open, fcntl */
 #include <string.h>         /* strerror */
 #include <stdio.h>          /* *printf */
 #include <stdint.h>         /* std data types */
 #include <stdlib.h>         /* exit */
-#include <unistd.h>         /* close, read, fcntl */
-#include <arpa/inet.h>      /* inet_ntoa, htons */
-#include <netinet/in.h>     /* INADDR_ANY, inet_ntoa */
-#include <sys/select.h>     /* select */
-#include <sys/socket.h>     /* socket, bind, listen,
-                             * inet_ntoa, setsockopt, recvfrom */
-#include <sys/stat.h>       /* open */
-#include <sys/types.h>      /* recvfrom */
-
+#include <unistd.h>         /* close, write */
+#include <getopt.h>         /* getopt_long */
+#include <pthread.h>        /* pthread_sigmask */
+#include <signal.h>         /* sigwait */
+#include <time.h>           /* time */
+#include <linux/filter.h>   /* sock_fprog */
+#include <sys/eventfd.h>    /* eventfd */
+#include <arpa/inet.h>      /* htons */
+#include <netinet/in.h>     /* INADDR_ANY */
+#include <sys/socket.h>     /* socket, bind, setsockopt */
+
+#include "impair.h"
+#include "session.h"
+#include "worker.h"
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF        51
+#endif
 
 #define NETRELAY_CLIENT_STREAM_PORT     8500
 #define NETRELAY_SERVER_STREAM_PORT     12347
 
-int open_udp_socket(int port);
+#define NETRELAY_MAX_SESSIONS_DEFAULT   4096
+#define NETRELAY_TIMEOUT_DEFAULT_S      30
+#define NETRELAY_MAX_WORKERS            64
+
+static int relay_check_port(int port);
+static int relay_steer(int fd, int workers);
+static void usage(const char *argv0);
 
 int
 main(int argc, char **argv)
 {
-  int client_stream_listen_fd = -1, server_stream_listen_fd = -1;
-  int client_data_fd = -1;
-  uint16_t server_stream_port = 0;
-  uint16_t client_stream_port = 0;
-  struct sockaddr_in si_server;
-  unsigned int slen_server = sizeof(si_server);
-  struct sockaddr_in si_client;
-  unsigned int slen_client = sizeof(si_client);
-  struct in_addr  server_stream_addr;
-  struct in_addr  client_stream_addr;
-
-  memset(&server_stream_addr, 0, sizeof(server_stream_addr));
-  memset(&client_stream_addr, 0, sizeof(client_stream_addr));
-
-  /* Unused */
-  (void)argc;
-  (void)argv;
-
-  /* Open listening socket for client stream connection */
-  client_stream_listen_fd = open_udp_socket(NETRELAY_CLIENT_STREAM_PORT);
-  if (client_stream_listen_fd == -1) {
-    fprintf(stderr,
-            "Failed to create client stream listen socket for port %d.\n",
-            NETRELAY_CLIENT_STREAM_PORT);
-    exit(-1);
+  worker_config_t config;
+  relay_worker_t *workers;
+  impair_script_t *script = NULL;
+  size_t max_sessions = NETRELAY_MAX_SESSIONS_DEFAULT;
+  int timeout_s = NETRELAY_TIMEOUT_DEFAULT_S;
+  int stats_s = 0;
+  int count = 1;
+  int started = 0;
+  int stop_fd;
+  sigset_t signals;
+  int signum;
+  int opt;
+  int i;
+
+  static const struct option options[] = {
+    { "up",           required_argument, NULL, 'u' },
+    { "down",         required_argument, NULL, 'd' },
+    { "seed",         required_argument, NULL, 's' },
+    { "script",       required_argument, NULL, 'S' },
+    { "max-sessions", required_argument, NULL, 'm' },
+    { "timeout",      required_argument, NULL, 't' },
+    { "stats",        required_argument, NULL, 'i' },
+    { "workers",      required_argument, NULL, 'w' },
+    { "no-keyframes", no_argument,       NULL, 'k' },
+    { "quiet",        no_argument,       NULL, 'q' },
+    { "help",         no_argument,       NULL, 'h' },
+    { NULL,           0,                 NULL, 0 }
+  };
+
+  memset(&config, 0, sizeof(config));
+  config.port[RELAY_SIDE_CLIENT] = NETRELAY_CLIENT_STREAM_PORT;
+  config.port[RELAY_SIDE_SERVER] = NETRELAY_SERVER_STREAM_PORT;
+  config.seed = (uint64_t)time(NULL);
+  config.keyframes = 1;
+
+  impair_parse(&config.impair[RELAY_SIDE_CLIENT], NULL);
+  impair_parse(&config.impair[RELAY_SIDE_SERVER], NULL);
+
+  while ((opt = getopt_long(argc, argv, "u:d:s:S:m:t:i:w:kqh", options, NULL)) != -1) {
+    switch (opt) {
+    case 'u':
+      if (impair_parse(&config.impair[RELAY_SIDE_CLIENT], optarg) != 0) {
+        exit(-1);
+      }
+      break;
+    case 'd':
+      if (impair_parse(&config.impair[RELAY_SIDE_SERVER], optarg) != 0) {
+        exit(-1);
+      }
+      break;
+    case 's':
+      config.seed = strtoull(optarg, NULL, 0);
+      break;
+    case 'S':
+      script = malloc(sizeof(*script));
+      if (script == NULL || impair_script_load(script, optarg) != 0) {
+        exit(-1);
+      }
+      break;
+    case 'm':
+      max_sessions = strtoul(optarg, NULL, 0);
+      break;
+    case 't':
+      timeout_s = atoi(optarg);
+      break;
+    case 'i':
+      stats_s = atoi(optarg);
+      break;
+    case 'w':
+      count = atoi(optarg);
+      break;
+    case 'k':
+      config.keyframes = 0;
+      break;
+    case 'q':
+      config.quiet = 1;
+      break;
+    default:
+      usage(argv[0]);
+      exit(opt == 'h' ? 0 : -1);
+    }
   }
 
-  /* Open listening socket for server stream connection */
-  server_stream_listen_fd = open_udp_socket(NETRELAY_SERVER_STREAM_PORT);
-  if (server_stream_listen_fd == -1) {
-    fprintf(stderr,
-            "Failed to create server stream listen socket for port %d.\n",
-            NETRELAY_SERVER_STREAM_PORT);
-    close(client_stream_listen_fd);
+  if (max_sessions == 0 || timeout_s <= 0 || stats_s < 0 ||
+      count < 1 || count > NETRELAY_MAX_WORKERS) {
+    usage(argv[0]);
     exit(-1);
   }
 
-  /* Listen for new data */
-  while (1) {
-    fd_set fds;
-    int retval;
-    int max_fd = client_stream_listen_fd;
+  /* Session IDs are spread evenly over the workers, leave some slack */
+  config.max_sessions = count == 1 ? max_sessions : max_sessions / (size_t)count + max_sessions / 8 + 1;
+  config.timeout_us = (uint64_t)timeout_s * 1000000;
+  config.stats_interval_us = (uint64_t)stats_s * 1000000;
+  config.script = script;
+  config.reuse_port = count > 1;
+
+  /* Print the seed so that a run can be repeated */
+  printf("Impairment seed: %llu\n", (unsigned long long)config.seed);
+  impair_describe("up", &config.impair[RELAY_SIDE_CLIENT]);
+  impair_describe("down", &config.impair[RELAY_SIDE_SERVER]);
+
+  /* The workers could join the sockets of another relay on the ports */
+  if (config.reuse_port &&
+      (relay_check_port(config.port[RELAY_SIDE_CLIENT]) != 0 ||
+       relay_check_port(config.port[RELAY_SIDE_SERVER]) != 0)) {
+    exit(-1);
+  }
 
-    FD_ZERO(&fds);
+  /* The workers wait on this until told to stop */
+  stop_fd = eventfd(0, EFD_CLOEXEC);
+  if (stop_fd == -1) {
+    fprintf(stderr, "Failed to create eventfd: %s\n", strerror(errno));
+    exit(-1);
+  }
 
-    /* Add client stream fd for udp packets */
-    FD_SET(client_stream_listen_fd, &fds);
+  /* Only the main thread takes the signals, to print the statistics when stopped */
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
 
-    /* Add server stream fd for udp packets */
-    FD_SET(server_stream_listen_fd, &fds);
-    if (server_stream_listen_fd > max_fd) {
-      max_fd = server_stream_listen_fd;
-    }
+  workers = calloc((size_t)count, sizeof(*workers));
+  if (workers == NULL) {
+    fprintf(stderr, "Failed to allocate %d workers\n", count);
+    exit(-1);
+  }
 
-    /* Add client data fd for new data, if connected */
-    if (client_data_fd > -1) {
-      FD_SET(client_data_fd, &fds);
-      if (client_data_fd > max_fd) {
-        max_fd = client_data_fd;
-      }
+  for (i = 0; i < count; i++) {
+    if (worker_init(&workers[i], i, &config, stop_fd) != 0) {
+      count = i + 1;
+      goto cleanup;
     }
+  }
 
-    retval = select(max_fd + 1, &fds, NULL, NULL, NULL);
-    if(retval == -1) {
-      fprintf(stderr, "Failed to select: %s\n",
-              strerror(errno));
-      exit(-1);
-    }
+  if (count > 1 &&
+      (relay_steer(workers[0].fd[RELAY_SIDE_CLIENT], count) != 0 ||
+       relay_steer(workers[0].fd[RELAY_SIDE_SERVER], count) != 0)) {
+    goto cleanup;
+  }
 
-    if(retval == 0) {
-      printf( "Select timeout (shouldn't happen)\n");
-      continue;
+  for (started = 0; started < count; started++) {
+    if (worker_start(&workers[started]) != 0) {
+      break;
     }
+  }
 
-    /*printf("New data in %d sockets\n", retval);*/
-
-    /* Check which socket has new data */
-
-    /* New client stream data */
-    if (FD_ISSET(client_stream_listen_fd, &fds)) {
-      char buf[4096];
-      ssize_t bytes_recv;
-
-      printf("data from client_stream_listen_fd\n");
-
-      /* Get data from client */
-      bytes_recv = recvfrom(client_stream_listen_fd, buf, 4096, 0,
-                            (struct sockaddr *)&si_client, &slen_client);
-      if (bytes_recv == -1) {
-        fprintf(stderr, "Failed to receive UDP data from client: %s\n",
-                strerror(errno));
-      } else {
-
-        client_stream_addr = si_client.sin_addr;
-        client_stream_port = si_client.sin_port;
-
-        printf("Received client packet from %s:%d\n",
-               inet_ntoa(client_stream_addr), ntohs(client_stream_port));
-
-        printf("Server port: %d\n", ntohs(server_stream_port));
-
-        if (ntohs(server_stream_port) > 0) {
-          ssize_t bytes_sent;
-
-          printf("Sending client data to %s:%d\n",
-                 inet_ntoa(server_stream_addr), ntohs(server_stream_port));
+  if (started == count) {
+    printf("Relaying with %d worker%s\n", count, count == 1 ? "" : "s");
+    fflush(stdout);
+    sigwait(&signals, &signum);
+  }
 
-          /* Send data to server */
-          bytes_sent = sendto(server_stream_listen_fd,
-                              buf, (size_t)bytes_recv, 0,
-                              (struct sockaddr *)&si_server, slen_server);
+  /* Tell the workers to stop, the eventfd stays readable */
+  {
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) == -1) {
+      fprintf(stderr, "Failed to stop the workers: %s\n", strerror(errno));
+    }
+  }
 
-          if (bytes_sent < 0) {
-            fprintf(stderr, "Failed to send UDP data to server: %s\n",
-                    strerror(errno));
-          }
+  for (i = 0; i < started; i++) {
+    worker_join(&workers[i]);
+  }
 
-          if (bytes_sent < bytes_recv) {
-            fprintf(stderr, "Failed to send all UDP data to server: %d < %d\n",
-                    (int)bytes_sent, (int)bytes_recv);
-          }
+  for (i = 0; i < count; i++) {
+    worker_print_stats(&workers[i], 0);
+  }
+  for (i = 0; i < count; i++) {
+    impair_print_stats(&workers[i].impair[RELAY_SIDE_CLIENT]);
+    impair_print_stats(&workers[i].impair[RELAY_SIDE_SERVER]);
+  }
 
-        }
-      }
+ cleanup:
+  for (i = 0; i < count; i++) {
+    worker_free(&workers[i]);
+  }
+  free(workers);
+  free(script);
+  close(stop_fd);
 
-    }
+  return started == count ? 0 : -1;
+}
 
-    /* New server stream data */
-    if (FD_ISSET(server_stream_listen_fd, &fds)) {
-      char buf[4096];
-      ssize_t bytes_recv;
-
-      printf("data from server_stream_listen_fd\n");
-
-      /* Get data from server and send it to client */
-      bytes_recv = recvfrom(server_stream_listen_fd,
-                            buf, 4096, 0,
-                            (struct sockaddr *)&si_server, &slen_server);
-      if ( bytes_recv == -1) {
-        fprintf(stderr, "Failed to receive UDP data from server: %s\n", strerror(errno));
-      } else {
-        ssize_t bytes_sent;
-
-        server_stream_addr = si_server.sin_addr;
-        server_stream_port = si_server.sin_port;
-
-        printf("Received server packet from %s:%d\n",
-               inet_ntoa(server_stream_addr), ntohs(server_stream_port));
-
-        /* Send data to client, if we have the address */
-        if (ntohs(client_stream_port) > 0) {
-          bytes_sent = sendto(client_stream_listen_fd,
-                              buf, (size_t)bytes_recv, 0,
-                              (struct sockaddr *)&si_client, slen_client);
-
-          if (bytes_sent < 0) {
-            fprintf(stderr, "Failed to send UDP data to client: %s\n",
-                    strerror(errno));
-          }
-
-          if (bytes_sent < bytes_recv) {
-            fprintf(stderr, "Failed to send all UDP data to client: %d < %d\n",
-                    (int)bytes_sent, (int)bytes_recv);
-          }
-        } else {
-          fprintf(stderr, "No client port, not sending data to client\n");
-        }
-      }
-    }
-  }
 
-  return 0;
+static void usage(const char *argv0)
+{
+  printf("Usage: %s [options]\n"
+         "  -u, --up <impairment>     Impair the client (slave) to server direction\n"
+         "  -d, --down <impairment>   Impair the server (controller) to client direction\n"
+         "  -s, --seed <n>            Seed for the random impairments\n"
+         "  -S, --script <file>       Change the impairments over time, lines of\n"
+         "                            \"<ms from start> up|down <impairment>\"\n"
+         "  -m, --max-sessions <n>    Most sessions relayed at once (default %d)\n"
+         "  -t, --timeout <s>         Forget a peer quiet for this long (default %d)\n"
+         "  -i, --stats <s>           Print the statistics at this interval\n"
+         "  -w, --workers <n>         Relay in this many threads (default 1)\n"
+         "  -k, --no-keyframes        Don't replay the latest keyframe to a joining server\n"
+         "  -q, --quiet               Don't print the peers coming and going\n"
+         "\n"
+         "An impairment is comma separated key=value pairs, percentages 0-100:\n"
+         "  loss=PCT, ge=P:R[:H[:K]] (Gilbert-Elliott), delay=MS, jitter=MS,\n"
+         "  reorder=PCT, dup=PCT, rate=KBIT, queue=KB, or off\n"
+         "e.g. %s --up loss=1,delay=20,jitter=5,rate=4000 --down delay=20\n"
+         "Each worker impairs its own sessions, a rate cap applies per worker.\n"
+         "\n"
+         "Datagrams with a relay header are relayed in the session given in it,\n"
+         "the others in session 0.\n",
+         argv0, NETRELAY_MAX_SESSIONS_DEFAULT, NETRELAY_TIMEOUT_DEFAULT_S, argv0);
 }
 
 
 /*
- * Open UDP listening socket
+ * Fail if the port is taken, also by sockets sharing it with SO_REUSEPORT
  */
-int open_udp_socket(int port)
+static int relay_check_port(int port)
 {
-
-  int fd;
   struct sockaddr_in addr;
-  int opt = 1;
+  int fd;
 
-  /* try to create a socket */
-  fd = socket(PF_INET, SOCK_DGRAM, 0);
+  fd = socket(PF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
   if (fd == -1) {
     fprintf(stderr, "Error creating socket: %s\n", strerror(errno));
     return -1;
   }
 
-  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof (opt)) < 0) {
-    fprintf(stderr, "Failed to set SO_REUSEADDR: %s\n",
-            strerror(errno));
-    return -1;
-  }
-
-  /* Clear structure */
-  memset(&addr, 0, sizeof(struct sockaddr));
-
+  memset(&addr, 0, sizeof(addr));
   addr.sin_family = PF_INET;
   addr.sin_port = htons(port);
   addr.sin_addr.s_addr = INADDR_ANY;
 
-  if (bind(fd,
-           (struct sockaddr *) &addr,
-           sizeof(struct sockaddr_in)) == -1) {
-    fprintf(stderr, "Error binding socket: %s\n", strerror(errno));
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    fprintf(stderr, "Port %d is not available: %s\n", port, strerror(errno));
     close(fd);
-    return 0;
+    return -1;
   }
 
-  return fd;
+  close(fd);
+  return 0;
+}
+
+
+/*
+ * Steer the datagrams of a session to the same worker on both ports.
+ * The default SO_REUSEPORT hash is on the 4-tuple, which would split the
+ * client and the server of a session over different workers. The
+ * program returns the index of the socket in the group, in the order
+ * of binding: the session ID modulo the workers, session 0 for the
+ * datagrams without a relay header.
+ */
+static int relay_steer(int fd, int workers)
+{
+  struct sock_filter code[] = {
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 0),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, RELAY_MAGIC, 1, 0),
+    BPF_STMT(BPF_RET | BPF_K, 0),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 4),
+    BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)workers),
+    BPF_STMT(BPF_RET | BPF_A, 0),
+  };
+  struct sock_fprog program;
+
+  program.len = sizeof(code) / sizeof(code[0]);
+  program.filter = code;
+
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == -1) {
+    fprintf(stderr, "Failed to steer the sessions to the workers: %s\n", strerror(errno));
+    return -1;
+  }
+
+  return 0;
 }
 
 
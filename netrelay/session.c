@@ -0,0 +1,233 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>          /* *printf */
+#include <stdlib.h>         /* calloc, free */
+#include <string.h>         /* memcmp */
+#include <arpa/inet.h>      /* inet_ntop, ntohl */
+
+#include "session.h"
+
+static const char *side_name[2] = { "client", "server" };
+
+static size_t slot_of(const session_table_t *table, uint32_t id);
+static void remove_slot(session_table_t *table, size_t slot);
+static void print_peer(const relay_session_t *session, int side, const char *event);
+
+
+int session_table_init(session_table_t *table, size_t max_count, int quiet)
+{
+  size_t capacity = 16;
+
+  /* At most half full keeps the probe sequences short */
+  while (capacity < 2 * max_count) {
+    capacity *= 2;
+  }
+
+  table->slots = calloc(capacity, sizeof(*table->slots));
+  if (table->slots == NULL) {
+    fprintf(stderr, "Failed to allocate %zu sessions\n", max_count);
+    return -1;
+  }
+
+  table->mask = capacity - 1;
+  table->count = 0;
+  table->max_count = max_count;
+  table->quiet = quiet;
+  return 0;
+}
+
+
+void session_table_free(session_table_t *table)
+{
+  size_t slot;
+
+  if (table->slots != NULL) {
+    for (slot = 0; slot <= table->mask; slot++) {
+      if (table->slots[slot].used) {
+        keyframe_free(table->slots[slot].keyframes);
+      }
+    }
+  }
+
+  free(table->slots);
+  table->slots = NULL;
+  table->count = 0;
+}
+
+
+size_t session_parse_header(const void *data, size_t len, uint32_t *id)
+{
+  const unsigned char *bytes = data;
+  uint32_t magic;
+
+  if (len < RELAY_HEADER_LEN) {
+    *id = 0;
+    return 0;
+  }
+
+  magic = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+    ((uint32_t)bytes[2] << 8) | bytes[3];
+  if (magic != RELAY_MAGIC) {
+    *id = 0;
+    return 0;
+  }
+
+  *id = ((uint32_t)bytes[4] << 24) | ((uint32_t)bytes[5] << 16) |
+    ((uint32_t)bytes[6] << 8) | bytes[7];
+  return RELAY_HEADER_LEN;
+}
+
+
+relay_session_t *session_find(session_table_t *table, uint32_t id)
+{
+  size_t slot;
+
+  for (slot = slot_of(table, id); table->slots[slot].used; slot = (slot + 1) & table->mask) {
+    if (table->slots[slot].id == id) {
+      return &table->slots[slot];
+    }
+  }
+
+  return NULL;
+}
+
+
+relay_session_t *session_get(session_table_t *table, uint32_t id)
+{
+  relay_session_t *session;
+  size_t slot;
+
+  for (slot = slot_of(table, id); table->slots[slot].used; slot = (slot + 1) & table->mask) {
+    if (table->slots[slot].id == id) {
+      return &table->slots[slot];
+    }
+  }
+
+  if (table->count == table->max_count) {
+    return NULL;
+  }
+
+  session = &table->slots[slot];
+  memset(session, 0, sizeof(*session));
+  session->id = id;
+  session->used = 1;
+  table->count++;
+
+  return session;
+}
+
+
+int session_learn(session_table_t *table, relay_session_t *session, int side,
+                   const struct sockaddr_in *addr, uint64_t now_us)
+{
+  relay_peer_t *peer = &session->peer[side];
+  int known = peer->last_us != 0;
+
+  peer->last_us = now_us;
+
+  /* The peer stays in its session, the newest address wins */
+  if (known && peer->addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+      peer->addr.sin_port == addr->sin_port) {
+    return 0;
+  }
+
+  peer->addr = *addr;
+  if (!table->quiet) {
+    print_peer(session, side, known ? "moved to" : "at");
+  }
+
+  return 1;
+}
+
+
+void session_expire(session_table_t *table, uint64_t now_us, uint64_t timeout_us)
+{
+  size_t slot = 0;
+
+  while (slot <= table->mask) {
+    relay_session_t *session = &table->slots[slot];
+    int side;
+
+    if (!session->used) {
+      slot++;
+      continue;
+    }
+
+    for (side = 0; side < 2; side++) {
+      relay_peer_t *peer = &session->peer[side];
+      if (peer->last_us != 0 && now_us - peer->last_us > timeout_us) {
+        if (!table->quiet) {
+          print_peer(session, side, "timed out at");
+        }
+        peer->last_us = 0;
+      }
+    }
+
+    if (session->peer[0].last_us == 0 && session->peer[1].last_us == 0) {
+      /* A later session may move into this slot, check it again */
+      remove_slot(table, slot);
+      continue;
+    }
+
+    slot++;
+  }
+}
+
+
+static size_t slot_of(const session_table_t *table, uint32_t id)
+{
+  /* The IDs may well be sequential, mix them over the table */
+  id ^= id >> 16;
+  id *= 0x7feb352dU;
+  id ^= id >> 15;
+  id *= 0x846ca68bU;
+  id ^= id >> 16;
+
+  return id & table->mask;
+}
+
+
+/* Backward shift deletion, no tombstones are left behind */
+static void remove_slot(session_table_t *table, size_t slot)
+{
+  size_t hole = slot;
+  size_t next = (slot + 1) & table->mask;
+
+  keyframe_free(table->slots[slot].keyframes);
+
+  while (table->slots[next].used) {
+    size_t home = slot_of(table, table->slots[next].id);
+
+    /* The entry can move to the hole if its home is not between them */
+    if (((next - home) & table->mask) >= ((next - hole) & table->mask)) {
+      table->slots[hole] = table->slots[next];
+      hole = next;
+    }
+    next = (next + 1) & table->mask;
+  }
+
+  table->slots[hole].used = 0;
+  table->count--;
+}
+
+
+static void print_peer(const relay_session_t *session, int side, const char *event)
+{
+  char address[INET_ADDRSTRLEN];
+
+  inet_ntop(AF_INET, &session->peer[side].addr.sin_addr, address, sizeof(address));
+  printf("Session %u: %s %s %s:%d\n", session->id, side_name[side], event,
+         address, ntohs(session->peer[side].addr.sin_port));
+}
+
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
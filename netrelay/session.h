@@ -0,0 +1,91 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NETRELAY_SESSION_H
+#define NETRELAY_SESSION_H
+
+#include <stddef.h>         /* size_t */
+#include <stdint.h>         /* std data types */
+#include <netinet/in.h>     /* sockaddr_in */
+
+#include "keyframe.h"
+
+/*
+ * Sessions of the relay, one per car. A session joins the client (slave)
+ * and the server (controller) that send with the same session ID. Their
+ * addresses are learned from the datagrams and forgotten when a peer has
+ * been quiet for the timeout, so that a car that changes its address or
+ * a controller that restarts is found again.
+ *
+ * The session ID is in a relay header in front of the datagram, which
+ * the relay strips before forwarding. It must match TX_RELAY_MAGIC in
+ * common/Transmitter.h. In network byte order:
+ *
+ *   0  magic "PLR1"
+ *   4  session ID
+ *
+ * Datagrams without the header belong to session 0, which makes a relay
+ * of one car as before.
+ */
+
+#define RELAY_MAGIC               0x504c5231U
+#define RELAY_HEADER_LEN          8
+
+#define RELAY_SIDE_CLIENT         0
+#define RELAY_SIDE_SERVER         1
+
+typedef struct {
+  struct sockaddr_in addr;
+  uint64_t last_us;             /* 0 if not known */
+} relay_peer_t;
+
+typedef struct {
+  uint32_t id;
+  int used;
+  relay_peer_t peer[2];         /* By side */
+  uint64_t forwarded[2];        /* From each side */
+  uint64_t no_peer[2];          /* From each side with no peer to forward to */
+  keyframe_cache_t *keyframes;  /* Of the client's video, NULL if none seen */
+} relay_session_t;
+
+/* Open addressing on the session ID, allocated once for max_count */
+typedef struct {
+  relay_session_t *slots;
+  size_t mask;
+  size_t count;
+  size_t max_count;
+  int quiet;                    /* No messages of peers coming and going */
+} session_table_t;
+
+int session_table_init(session_table_t *table, size_t max_count, int quiet);
+void session_table_free(session_table_t *table);
+
+/* Length of the relay header at the start of data, 0 if there is none */
+size_t session_parse_header(const void *data, size_t len, uint32_t *id);
+
+/* Session with the ID, NULL if there is none */
+relay_session_t *session_find(session_table_t *table, uint32_t id);
+
+/* Session with the ID, created if needed. NULL if the table is full. */
+relay_session_t *session_get(session_table_t *table, uint32_t id);
+
+/* A datagram from the peer on the side was received. Returns 1 if the
+ * peer is new or moved to this address. */
+int session_learn(session_table_t *table, relay_session_t *session, int side,
+                   const struct sockaddr_in *addr, uint64_t now_us);
+
+/* Forget the peers quiet for longer than timeout_us, and the sessions
+ * left with no peers */
+void session_expire(session_table_t *table, uint64_t now_us, uint64_t timeout_us);
+
+#endif
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
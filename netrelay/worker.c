@@ -0,0 +1,571 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _GNU_SOURCE         /* recvmmsg, sendmmsg */
+
+#include <errno.h>          /* errno */
+#include <string.h>         /* strerror */
+#include <stdio.h>          /* *printf */
+#include <stdlib.h>         /* malloc */
+#include <unistd.h>         /* close, read */
+#include <arpa/inet.h>      /* htons */
+#include <netinet/in.h>     /* INADDR_ANY */
+#include <sys/epoll.h>      /* epoll_* */
+#include <sys/socket.h>     /* socket, bind, setsockopt, recvmmsg, sendmmsg */
+#include <sys/timerfd.h>    /* timerfd_* */
+
+#include "worker.h"
+
+#define WORKER_RECEIVE_ROUNDS     4       /* Batches read from a socket per wakeup */
+#define WORKER_EPOLL_EVENTS       8
+#define WORKER_SOCKET_BUFFER      (4 * 1024 * 1024)
+#define WORKER_EXPIRE_INTERVAL_US 1000000
+
+/* epoll data of the timer and the stop event, the sockets are 0 and 1 by side */
+#define WORKER_EVENT_TIMER        2
+#define WORKER_EVENT_STOP         3
+
+static const char *side_name[2] = { "client", "server" };
+
+static int open_udp_socket(int port, int reuse_port);
+static int add_event(relay_worker_t *worker, int fd, uint32_t event);
+static void *worker_run(void *arg);
+static void worker_arm_timer(relay_worker_t *worker, uint64_t now_us);
+static void worker_receive(relay_worker_t *worker, int side, uint64_t now_us);
+static relay_peer_t *worker_route(relay_worker_t *worker, int side, const struct sockaddr_in *from,
+                                  const unsigned char *data, size_t len, size_t *header,
+                                  uint64_t now_us);
+static void worker_send(relay_worker_t *worker, int side, int count);
+static void worker_replay(relay_worker_t *worker, const keyframe_cache_t *cache,
+                          const struct sockaddr_in *to, uint64_t now_us);
+static void worker_tick(relay_worker_t *worker, uint64_t now_us);
+
+
+int worker_init(relay_worker_t *worker, int index, const worker_config_t *config, int stop_fd)
+{
+  int side;
+
+  memset(worker, 0, sizeof(*worker));
+  worker->index = index;
+  worker->config = config;
+  worker->fd[0] = worker->fd[1] = worker->epoll_fd = worker->timer_fd = -1;
+  worker->stop_fd = stop_fd;
+
+  /* Each worker draws its own impairments, repeatable with the seed */
+  impair_init(&worker->impair[RELAY_SIDE_CLIENT], "up", config->seed + 2 * (uint64_t)index);
+  impair_init(&worker->impair[RELAY_SIDE_SERVER], "down", config->seed + 2 * (uint64_t)index + 1);
+  impair_configure(&worker->impair[RELAY_SIDE_CLIENT], &config->impair[RELAY_SIDE_CLIENT]);
+  impair_configure(&worker->impair[RELAY_SIDE_SERVER], &config->impair[RELAY_SIDE_SERVER]);
+  if (config->script != NULL) {
+    worker->script = *config->script;
+    worker->scripted = 1;
+  }
+
+  if (session_table_init(&worker->sessions, config->max_sessions, config->quiet) != 0) {
+    return -1;
+  }
+
+  worker->buffers = malloc(WORKER_BATCH * sizeof(*worker->buffers));
+  if (worker->buffers == NULL) {
+    fprintf(stderr, "Failed to allocate the buffers of worker %d\n", index);
+    return -1;
+  }
+
+  worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (worker->epoll_fd == -1) {
+    fprintf(stderr, "Failed to create epoll: %s\n", strerror(errno));
+    return -1;
+  }
+
+  /* Open listening sockets for the client and the server streams */
+  for (side = 0; side < 2; side++) {
+    worker->fd[side] = open_udp_socket(config->port[side], config->reuse_port);
+    if (worker->fd[side] == -1) {
+      fprintf(stderr, "Failed to create %s stream listen socket for port %d.\n",
+              side_name[side], config->port[side]);
+      return -1;
+    }
+    if (add_event(worker, worker->fd[side], (uint32_t)side) != 0) {
+      return -1;
+    }
+  }
+
+  /* Wakes up for the delayed datagrams, the script and the housekeeping */
+  worker->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (worker->timer_fd == -1) {
+    fprintf(stderr, "Failed to create timer: %s\n", strerror(errno));
+    return -1;
+  }
+  if (add_event(worker, worker->timer_fd, WORKER_EVENT_TIMER) != 0 ||
+      add_event(worker, worker->stop_fd, WORKER_EVENT_STOP) != 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
+
+void worker_free(relay_worker_t *worker)
+{
+  int side;
+
+  for (side = 0; side < 2; side++) {
+    impair_free(&worker->impair[side]);
+    if (worker->fd[side] != -1) {
+      close(worker->fd[side]);
+    }
+  }
+  if (worker->timer_fd != -1) {
+    close(worker->timer_fd);
+  }
+  if (worker->epoll_fd != -1) {
+    close(worker->epoll_fd);
+  }
+  session_table_free(&worker->sessions);
+  free(worker->buffers);
+  worker->buffers = NULL;
+}
+
+
+int worker_start(relay_worker_t *worker)
+{
+  int error = pthread_create(&worker->thread, NULL, worker_run, worker);
+
+  if (error != 0) {
+    fprintf(stderr, "Failed to start worker %d: %s\n", worker->index, strerror(error));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+void worker_join(relay_worker_t *worker)
+{
+  pthread_join(worker->thread, NULL);
+}
+
+
+void worker_print_stats(relay_worker_t *worker, uint64_t interval_us)
+{
+  int side;
+
+  printf("Worker %d sessions: %zu\n", worker->index, worker->sessions.count);
+
+  for (side = 0; side < 2; side++) {
+    const worker_stats_t *now = &worker->stats[side];
+    worker_stats_t *then = &worker->reported[side];
+    worker_stats_t zero;
+    double seconds = (double)interval_us / 1000000;
+
+    /* Totals when not printed periodically */
+    if (interval_us == 0) {
+      memset(&zero, 0, sizeof(zero));
+      then = &zero;
+    }
+
+    printf("Worker %d from %s: received %llu, forwarded %llu, no peer %llu, no session %llu, "
+           "truncated %llu, send drops %llu, receive errors %llu, send errors %llu, "
+           "replayed %llu, %.1f per receive, %.1f per send",
+           worker->index, side_name[side],
+           (unsigned long long)(now->received - then->received),
+           (unsigned long long)(now->forwarded - then->forwarded),
+           (unsigned long long)(now->no_peer - then->no_peer),
+           (unsigned long long)(now->no_session - then->no_session),
+           (unsigned long long)(now->truncated - then->truncated),
+           (unsigned long long)(now->send_drops - then->send_drops),
+           (unsigned long long)(now->receive_errors - then->receive_errors),
+           (unsigned long long)(now->send_errors - then->send_errors),
+           (unsigned long long)(now->replayed - then->replayed),
+           now->receive_calls > then->receive_calls ?
+           (double)(now->received - then->received) / (double)(now->receive_calls - then->receive_calls) : 0.0,
+           now->send_calls > then->send_calls ?
+           (double)(now->forwarded - then->forwarded) / (double)(now->send_calls - then->send_calls) : 0.0);
+    if (interval_us > 0) {
+      printf(", %.0f/s in, %.0f/s out",
+             (double)(now->received - then->received) / seconds,
+             (double)(now->forwarded - then->forwarded) / seconds);
+      *then = *now;
+    }
+    printf("\n");
+  }
+  fflush(stdout);
+}
+
+
+static void *worker_run(void *arg)
+{
+  relay_worker_t *worker = arg;
+  int stop = 0;
+
+  worker->start_us = impair_now_us();
+  worker->next_expire_us = worker->start_us + WORKER_EXPIRE_INTERVAL_US;
+  worker->next_stats_us = worker->start_us + worker->config->stats_interval_us;
+
+  while (!stop) {
+    struct epoll_event events[WORKER_EPOLL_EVENTS];
+    uint64_t now_us;
+    int count;
+    int i;
+
+    worker_arm_timer(worker, impair_now_us());
+
+    count = epoll_wait(worker->epoll_fd, events, WORKER_EPOLL_EVENTS, -1);
+    if (count == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "Failed to wait for events: %s\n", strerror(errno));
+      break;
+    }
+
+    now_us = impair_now_us();
+
+    for (i = 0; i < count; i++) {
+      uint32_t event = events[i].data.u32;
+
+      if (event == WORKER_EVENT_STOP) {
+        stop = 1;
+      } else if (event == WORKER_EVENT_TIMER) {
+        uint64_t expirations;
+        if (read(worker->timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+          fprintf(stderr, "Failed to read the timer: %s\n", strerror(errno));
+        }
+        worker->armed_us = 0;
+      } else {
+        worker_receive(worker, (int)event, now_us);
+      }
+    }
+
+    worker_tick(worker, now_us);
+  }
+
+  return NULL;
+}
+
+
+static int add_event(relay_worker_t *worker, int fd, uint32_t event)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u32 = event;
+  if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+    fprintf(stderr, "Failed to add to epoll: %s\n", strerror(errno));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+/* The timer runs on the clock of impair_now_us() */
+static void worker_arm_timer(relay_worker_t *worker, uint64_t now_us)
+{
+  struct itimerspec spec;
+  uint64_t wake_us = worker->next_expire_us;
+  uint64_t due_us;
+  int side;
+
+  for (side = 0; side < 2; side++) {
+    if (impair_next_due(&worker->impair[side], &due_us) && due_us < wake_us) {
+      wake_us = due_us;
+    }
+  }
+  if (worker->scripted && impair_script_next(&worker->script, &due_us) &&
+      worker->start_us + due_us < wake_us) {
+    wake_us = worker->start_us + due_us;
+  }
+  if (worker->config->stats_interval_us > 0 && worker->next_stats_us < wake_us) {
+    wake_us = worker->next_stats_us;
+  }
+
+  /* Already armed for this time */
+  if (wake_us == worker->armed_us && wake_us > now_us) {
+    return;
+  }
+
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = (time_t)(wake_us / 1000000);
+  spec.it_value.tv_nsec = (long)(wake_us % 1000000) * 1000;
+  if (timerfd_settime(worker->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+    fprintf(stderr, "Failed to arm the timer: %s\n", strerror(errno));
+    return;
+  }
+  worker->armed_us = wake_us;
+}
+
+
+static void worker_receive(relay_worker_t *worker, int side, uint64_t now_us)
+{
+  worker_stats_t *stats = &worker->stats[side];
+  int to = !side;
+  int round;
+
+  /* A few batches at a time so that the other side gets its turn */
+  for (round = 0; round < WORKER_RECEIVE_ROUNDS; round++) {
+    int count;
+    int out = 0;
+    int i;
+
+    for (i = 0; i < WORKER_BATCH; i++) {
+      worker->rx_iov[i].iov_base = worker->buffers[i];
+      worker->rx_iov[i].iov_len = WORKER_MAX_DATAGRAM;
+      memset(&worker->rx[i].msg_hdr, 0, sizeof(worker->rx[i].msg_hdr));
+      worker->rx[i].msg_hdr.msg_name = &worker->rx_from[i];
+      worker->rx[i].msg_hdr.msg_namelen = sizeof(worker->rx_from[i]);
+      worker->rx[i].msg_hdr.msg_iov = &worker->rx_iov[i];
+      worker->rx[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    count = recvmmsg(worker->fd[side], worker->rx, WORKER_BATCH, MSG_DONTWAIT, NULL);
+    if (count == -1) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        stats->receive_errors++;
+      }
+      return;
+    }
+    stats->receive_calls++;
+    stats->received += (uint64_t)count;
+
+    /* The datagrams that go out at once are sent straight from the
+     * receive buffers */
+    for (i = 0; i < count; i++) {
+      size_t len = worker->rx[i].msg_len;
+      size_t header;
+      relay_peer_t *peer;
+
+      if (worker->rx[i].msg_hdr.msg_flags & MSG_TRUNC) {
+        stats->truncated++;
+        continue;
+      }
+
+      peer = worker_route(worker, side, &worker->rx_from[i], worker->buffers[i], len,
+                          &header, now_us);
+      if (peer == NULL) {
+        continue;
+      }
+
+      if (worker->impair[side].enabled) {
+        stats->forwarded++;
+        impair_submit(&worker->impair[side], now_us, worker->fd[to], &peer->addr,
+                      worker->buffers[i] + header, len - header);
+        continue;
+      }
+
+      worker->tx_to[out] = peer->addr;
+      worker->tx_iov[out].iov_base = worker->buffers[i] + header;
+      worker->tx_iov[out].iov_len = len - header;
+      memset(&worker->tx[out].msg_hdr, 0, sizeof(worker->tx[out].msg_hdr));
+      worker->tx[out].msg_hdr.msg_name = &worker->tx_to[out];
+      worker->tx[out].msg_hdr.msg_namelen = sizeof(worker->tx_to[out]);
+      worker->tx[out].msg_hdr.msg_iov = &worker->tx_iov[out];
+      worker->tx[out].msg_hdr.msg_iovlen = 1;
+      out++;
+    }
+
+    worker_send(worker, side, out);
+
+    if (count < WORKER_BATCH) {
+      return;
+    }
+  }
+}
+
+
+/* Peer to forward a datagram from the side to, NULL if there is none */
+static relay_peer_t *worker_route(relay_worker_t *worker, int side, const struct sockaddr_in *from,
+                                  const unsigned char *data, size_t len, size_t *header,
+                                  uint64_t now_us)
+{
+  relay_session_t *session;
+  relay_peer_t *peer;
+  uint32_t id;
+  int learned;
+
+  *header = session_parse_header(data, len, &id);
+  session = session_get(&worker->sessions, id);
+  if (session == NULL) {
+    worker->stats[side].no_session++;
+    return NULL;
+  }
+
+  learned = session_learn(&worker->sessions, session, side, from, now_us);
+
+  if (worker->config->keyframes) {
+    if (side == RELAY_SIDE_CLIENT) {
+      /* Also while no server is there to forward to */
+      keyframe_observe(&session->keyframes, data + *header, len - *header);
+    } else if (learned) {
+      /* A joining server gets the latest keyframe at once, ahead of the
+       * datagrams from the client */
+      worker_replay(worker, session->keyframes, from, now_us);
+    }
+  }
+
+  peer = &session->peer[!side];
+  if (peer->last_us == 0) {
+    session->no_peer[side]++;
+    worker->stats[side].no_peer++;
+    return NULL;
+  }
+
+  session->forwarded[side]++;
+  return peer;
+}
+
+
+/* Send the batch of datagrams from the side to the other side */
+static void worker_send(relay_worker_t *worker, int side, int count)
+{
+  worker_stats_t *stats = &worker->stats[side];
+  int first = 0;
+
+  while (first < count) {
+    int sent = sendmmsg(worker->fd[!side], &worker->tx[first], (unsigned int)(count - first),
+                        MSG_DONTWAIT);
+    if (sent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        /* Late is as good as lost for the relayed streams */
+        stats->send_drops += (uint64_t)(count - first);
+        return;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+
+      /* Drop the datagram that failed and try the rest */
+      stats->send_errors++;
+      first++;
+      continue;
+    }
+
+    stats->send_calls++;
+    stats->forwarded += (uint64_t)sent;
+    first += sent;
+  }
+}
+
+
+/* Send the cached keyframe to a joining server the way the datagrams
+ * from the client go: through the impairment, or straight to the socket
+ * dropping what it doesn't take */
+static void worker_replay(relay_worker_t *worker, const keyframe_cache_t *cache,
+                          const struct sockaddr_in *to, uint64_t now_us)
+{
+  worker_stats_t *stats = &worker->stats[RELAY_SIDE_CLIENT];
+  impair_dir_t *impair = &worker->impair[RELAY_SIDE_CLIENT];
+  int fd = worker->fd[RELAY_SIDE_SERVER];
+  const unsigned char *msg;
+  size_t offset = 0;
+  size_t len;
+  int full = 0;
+
+  while (keyframe_next(cache, &offset, &msg, &len)) {
+    if (impair->enabled) {
+      impair_submit(impair, now_us, fd, to, msg, len);
+      stats->replayed++;
+      continue;
+    }
+
+    /* The rest of the keyframe is useless once the socket is full */
+    if (full) {
+      stats->send_drops++;
+      continue;
+    }
+
+    if (sendto(fd, msg, len, MSG_DONTWAIT, (const struct sockaddr *)to, sizeof(*to)) == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        stats->send_drops++;
+        full = 1;
+      } else {
+        stats->send_errors++;
+      }
+      continue;
+    }
+    stats->replayed++;
+  }
+}
+
+
+static void worker_tick(relay_worker_t *worker, uint64_t now_us)
+{
+  if (worker->scripted) {
+    impair_script_run(&worker->script, now_us - worker->start_us,
+                      &worker->impair[RELAY_SIDE_CLIENT], &worker->impair[RELAY_SIDE_SERVER],
+                      worker->index == 0);
+  }
+  impair_flush(&worker->impair[RELAY_SIDE_CLIENT], now_us);
+  impair_flush(&worker->impair[RELAY_SIDE_SERVER], now_us);
+
+  if (now_us >= worker->next_expire_us) {
+    session_expire(&worker->sessions, now_us, worker->config->timeout_us);
+    worker->next_expire_us = now_us + WORKER_EXPIRE_INTERVAL_US;
+  }
+
+  if (worker->config->stats_interval_us > 0 && now_us >= worker->next_stats_us) {
+    worker_print_stats(worker, now_us - (worker->next_stats_us - worker->config->stats_interval_us));
+    worker->next_stats_us = now_us + worker->config->stats_interval_us;
+  }
+}
+
+
+/*
+ * Open non-blocking UDP listening socket, shared with the other workers
+ * if reuse_port is set. Without it the bind fails if the port is taken.
+ */
+static int open_udp_socket(int port, int reuse_port)
+{
+
+  int fd;
+  struct sockaddr_in addr;
+  int opt = 1;
+  int size = WORKER_SOCKET_BUFFER;
+
+  /* try to create a socket */
+  fd = socket(PF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Error creating socket: %s\n", strerror(errno));
+    return -1;
+  }
+
+  if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof (opt)) < 0) {
+    fprintf(stderr, "Failed to set SO_REUSEPORT: %s\n",
+            strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  /* Room for the bursts of many sessions, the kernel may cap these */
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  /* Clear structure */
+  memset(&addr, 0, sizeof(struct sockaddr));
+
+  addr.sin_family = PF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = INADDR_ANY;
+
+  if (bind(fd,
+           (struct sockaddr *) &addr,
+           sizeof(struct sockaddr_in)) == -1) {
+    fprintf(stderr, "Error binding socket: %s\n", strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NETRELAY_WORKER_H
+#define NETRELAY_WORKER_H
+
+#include <stddef.h>         /* size_t */
+#include <stdint.h>         /* std data types */
+#include <pthread.h>        /* pthread_t */
+#include <sys/socket.h>     /* mmsghdr */
+#include <sys/uio.h>        /* iovec */
+
+#include "impair.h"
+#include "session.h"
+
+/*
+ * A relay worker runs in its own thread with its own pair of listening
+ * sockets, bound with SO_REUSEPORT to the relay ports, and its own shard
+ * of the sessions. The kernel steers each datagram to the worker of its
+ * session, see relay_steer() in netrelay.c. Datagrams are received and
+ * forwarded in batches with recvmmsg() and sendmmsg() using buffers
+ * allocated when the worker is created.
+ */
+
+#define WORKER_BATCH              64      /* Datagrams per system call */
+#define WORKER_MAX_DATAGRAM       9216    /* Longer ones are dropped as truncated */
+
+typedef struct {
+  int port[2];                  /* By side */
+  int reuse_port;               /* Share the ports with the other workers */
+  size_t max_sessions;          /* Per worker */
+  int quiet;
+  int keyframes;                /* Cache keyframes for the joining servers */
+  uint64_t timeout_us;
+  uint64_t stats_interval_us;
+  uint64_t seed;
+  impair_config_t impair[2];
+  const impair_script_t *script;
+} worker_config_t;
+
+/* Counters by the side the datagrams came from */
+typedef struct {
+  uint64_t received;
+  uint64_t forwarded;
+  uint64_t no_peer;
+  uint64_t no_session;
+  uint64_t truncated;
+  uint64_t send_drops;          /* Socket send buffer full */
+  uint64_t send_errors;
+  uint64_t receive_errors;
+  uint64_t replayed;            /* Cached keyframe messages sent to a new peer */
+  uint64_t receive_calls;
+  uint64_t send_calls;
+} worker_stats_t;
+
+typedef struct {
+  int index;
+  pthread_t thread;
+  const worker_config_t *config;
+
+  int fd[2];                    /* By side */
+  int epoll_fd;
+  int timer_fd;
+  int stop_fd;                  /* Readable when the relay stops, not owned */
+  uint64_t armed_us;            /* Timer expiry, 0 if not armed */
+
+  session_table_t sessions;
+  uint64_t next_expire_us;
+
+  /* Impairment of the datagrams from each side: up from the client
+   * (slave) and down from the server (controller) */
+  impair_dir_t impair[2];
+  impair_script_t script;
+  int scripted;
+  uint64_t start_us;
+
+  uint64_t next_stats_us;
+  worker_stats_t stats[2];
+  worker_stats_t reported[2];   /* At the previous statistics */
+
+  /* Receive and send batches */
+  unsigned char (*buffers)[WORKER_MAX_DATAGRAM];
+  struct mmsghdr rx[WORKER_BATCH];
+  struct iovec rx_iov[WORKER_BATCH];
+  struct sockaddr_in rx_from[WORKER_BATCH];
+  struct mmsghdr tx[WORKER_BATCH];
+  struct iovec tx_iov[WORKER_BATCH];
+  struct sockaddr_in tx_to[WORKER_BATCH];
+} relay_worker_t;
+
+/* Open the sockets of the worker. The workers must be opened in the
+ * order of their index, as the kernel steers by the order of binding. */
+int worker_init(relay_worker_t *worker, int index, const worker_config_t *config, int stop_fd);
+void worker_free(relay_worker_t *worker);
+
+int worker_start(relay_worker_t *worker);
+void worker_join(relay_worker_t *worker);
+
+/* Print the counters, since the previous call if interval is set */
+void worker_print_stats(relay_worker_t *worker, uint64_t interval_us);
+
+#endif
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/
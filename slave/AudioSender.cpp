@@ -4,8 +4,8 @@
  */
 
 #include "AudioSender.h"
+#include "Log.h"
 
-#include <iostream>
 #include <string>
 #include <cstdlib>
 
@@ -28,12 +28,12 @@ AudioSender::AudioSender(Hardware *hardware):
 AudioSender::~AudioSender()
 {
   // Clean up
-  std::cout << "Stopping audio encoding" << std::endl;
+  LOG_INFO(Audio) << "Stopping audio encoding";
   if (pipeline) {
     gst_element_set_state(pipeline, GST_STATE_NULL);
   }
 
-  std::cout << "Deleting pipeline" << std::endl;
+  LOG_INFO(Audio) << "Deleting pipeline";
   if (pipeline) {
     gst_object_unref(GST_OBJECT(pipeline));
     pipeline = nullptr;
@@ -45,16 +45,16 @@ bool AudioSender::enableSending(bool enable)
   GstElement *sink;
   GError *error = nullptr;
 
-  std::cout << "In " << __FUNCTION__ << ", Enable: " << (enable ? "true" : "false") << std::endl;
+  LOG_INFO(Audio) << "In " << __FUNCTION__ << ", Enable: " << (enable ? "true" : "false");
 
   // Disable audio sending
   if (!enable) {
-    std::cout << "Stopping audio encoding" << std::endl;
+    LOG_INFO(Audio) << "Stopping audio encoding";
     if (pipeline) {
       gst_element_set_state(pipeline, GST_STATE_NULL);
     }
 
-    std::cout << "Deleting pipeline" << std::endl;
+    LOG_INFO(Audio) << "Deleting pipeline";
     if (pipeline) {
       gst_object_unref(GST_OBJECT(pipeline));
       pipeline = nullptr;
@@ -67,18 +67,18 @@ bool AudioSender::enableSending(bool enable)
   if (pipeline) {
     // Do nothing as the pipeline has already been created and is
     // probably running
-    std::cerr << "Pipeline exists already, doing nothing" << std::endl;
+    LOG_WARN(Audio) << "Pipeline exists already, doing nothing";
     return true;
   }
 
   // Initialisation. We don't pass command line arguments here
   if (!gst_init_check(NULL, NULL, NULL)) {
-    std::cerr << "Failed to init GST" << std::endl;
+    LOG_ERROR(Audio) << "Failed to init GST";
     return false;
   }
 
   if (!hardware) {
-    std::cerr << "No hardware plugin" << std::endl;
+    LOG_ERROR(Audio) << "No hardware plugin";
     return false;
   }
 
@@ -92,12 +92,12 @@ bool AudioSender::enableSending(bool enable)
   pipelineString += " ! ";
   pipelineString += "appsink name=sink sync=false max-buffers=1 drop=true";
 
-  std::cout << "Using pipeline: " << pipelineString << std::endl;
+  LOG_INFO(Audio) << "Using pipeline: " << pipelineString;
 
   // Create encoding audio pipeline
   pipeline = gst_parse_launch(pipelineString.c_str(), &error);
   if (!pipeline) {
-    std::cerr << "Failed to parse pipeline: " << error->message << std::endl;
+    LOG_ERROR(Audio) << "Failed to parse pipeline: " << error->message;
     g_error_free(error);
     return false;
   }
@@ -107,7 +107,7 @@ bool AudioSender::enableSending(bool enable)
     GstElement *source;
     source = gst_bin_get_by_name(GST_BIN(pipeline), "source");
     if (!source) {
-      std::cerr << "Failed to get source" << std::endl;
+      LOG_ERROR(Audio) << "Failed to get source";
       return false;
     }
 
@@ -116,7 +116,7 @@ bool AudioSender::enableSending(bool enable)
 
   sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
   if (!sink) {
-    std::cerr << "Failed to get sink" << std::endl;
+    LOG_ERROR(Audio) << "Failed to get sink";
     return false;
   }
 
@@ -134,12 +134,12 @@ bool AudioSender::enableSending(bool enable)
   return true;
 }
 
-void AudioSender::emitAudio(std::vector<std::uint8_t> *data)
+void AudioSender::emitAudio(const std::uint8_t* data, std::size_t size)
 {
-  std::cout << "In " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Audio) << "In " << __FUNCTION__;
 
   if (audioCallback) {
-    audioCallback(data);
+    audioCallback(data, size);
   }
 }
 
@@ -150,29 +150,26 @@ void AudioSender::setAudioCallback(AudioCallback callback)
 
 GstFlowReturn AudioSender::newBufferCB(GstAppSink *sink, gpointer user_data)
 {
-  std::cout << "In " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Audio) << "In " << __FUNCTION__;
 
   AudioSender *as = static_cast<AudioSender *>(user_data);
 
   // Get new audio sample
   GstSample *sample = gst_app_sink_pull_sample(sink);
   if (sample == NULL) {
-    std::cerr << __FUNCTION__ << ": Failed to get new sample" << std::endl;
+    LOG_ERROR(Audio) << __FUNCTION__ << ": Failed to get new sample";
     return GST_FLOW_OK;
   }
 
-  // FIXME: zero copy?
   GstBuffer *buffer = gst_sample_get_buffer(sample);
   GstMapInfo map;
-  std::vector<std::uint8_t> *data = NULL;
 
   if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-    // Copy the data to std::vector
-    data = new std::vector<std::uint8_t>(map.data, map.data + map.size);
-    as->emitAudio(data);
+    // The data is copied only once, into the outgoing message
+    as->emitAudio(map.data, map.size);
     gst_buffer_unmap(buffer, &map);
   } else {
-    std::cerr << "Error with gst_buffer_map" << std::endl;
+    LOG_ERROR(Audio) << "Error with gst_buffer_map";
   }
 
   gst_sample_unref(sample);
@@ -24,13 +24,13 @@ class AudioSender
   bool enableSending(bool enable);
 
   // Callback type for audio data
-  using AudioCallback = std::function<void(std::vector<std::uint8_t>*)>;
+  using AudioCallback = std::function<void(const std::uint8_t*, std::size_t)>;
 
   // Set callback for audio data
   void setAudioCallback(AudioCallback callback);
 
  private:
-  void emitAudio(std::vector<std::uint8_t> *data);
+  void emitAudio(const std::uint8_t* data, std::size_t size);
   static GstFlowReturn newBufferCB(GstAppSink *sink, gpointer user_data);
 
   GstElement *pipeline;
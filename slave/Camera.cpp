@@ -4,8 +4,8 @@
  */
 
 #include "Camera.h"
+#include "Log.h"
 
-#include <iostream>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
@@ -40,8 +40,8 @@ bool Camera::init(void)
   }
   fd = open(camera, O_RDWR);
   if (fd < 0) {
-    std::cerr << "Failed to open V4L2 device (" << camera << "): "
-              << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to open V4L2 device (" << camera << "): "
+                  << strerror(errno);
     return false;
   }
 
@@ -54,7 +54,7 @@ bool Camera::setBrightness(std::uint8_t value)
   struct v4l2_queryctrl query;
 
   if (fd < 0) {
-    std::cerr << "Camera not initialised." << std::endl;
+    LOG_ERROR(Hw) << "Camera not initialised.";
     return false;
   }
 
@@ -63,7 +63,7 @@ bool Camera::setBrightness(std::uint8_t value)
 
   query.id = V4L2_CID_BRIGHTNESS;
   if (ioctl(fd, VIDIOC_QUERYCTRL, &query) == -1) {
-    std::cerr << "Failed to query brightness: " << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to query brightness: " << strerror(errno);
     return false;
   }
 
@@ -72,11 +72,11 @@ bool Camera::setBrightness(std::uint8_t value)
   control.value = static_cast<int>((((query.maximum - query.minimum) / 100.0) * value) + query.minimum);
 
   if (ioctl(fd, VIDIOC_S_CTRL, &control) == -1) {
-    std::cerr << "Failed to set brightness values: " << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to set brightness values: " << strerror(errno);
     return false;
   }
 
-  std::cout << "in " << __FUNCTION__ << ", brightness set to " << control.value << std::endl;
+  LOG_INFO(Hw) << "in " << __FUNCTION__ << ", brightness set to " << control.value;
 
   return true;
 }
@@ -87,7 +87,7 @@ bool Camera::setZoom(std::uint8_t value)
   struct v4l2_queryctrl query;
 
   if (fd < 0) {
-    std::cerr << "Camera not initialised." << std::endl;
+    LOG_ERROR(Hw) << "Camera not initialised.";
     return false;
   }
 
@@ -96,7 +96,7 @@ bool Camera::setZoom(std::uint8_t value)
 
   query.id = V4L2_CID_ZOOM_ABSOLUTE;
   if (ioctl(fd, VIDIOC_QUERYCTRL, &query) == -1) {
-    std::cerr << "Failed to query zoom: " << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to query zoom: " << strerror(errno);
     return false;
   }
 
@@ -105,11 +105,11 @@ bool Camera::setZoom(std::uint8_t value)
   control.value = static_cast<int>((((query.maximum - query.minimum) / 100.0) * value) + query.minimum);
 
   if (ioctl(fd, VIDIOC_S_CTRL, &control) == -1) {
-    std::cerr << "Failed to set zoom values: " << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to set zoom values: " << strerror(errno);
     return false;
   }
 
-  std::cout << "in " << __FUNCTION__ << ", zoom set to " << control.value << std::endl;
+  LOG_INFO(Hw) << "in " << __FUNCTION__ << ", zoom set to " << control.value;
 
   return true;
 }
@@ -122,7 +122,7 @@ bool Camera::setFocus(std::uint8_t value)
   bool new_auto_focus = (value == 0);
 
   if (fd < 0) {
-    std::cerr << "Camera not initialised." << std::endl;
+    LOG_ERROR(Hw) << "Camera not initialised.";
     return false;
   }
 
@@ -135,13 +135,13 @@ bool Camera::setFocus(std::uint8_t value)
     control.value = new_auto_focus ? 1 : 0;
 
     if (ioctl(fd, VIDIOC_S_CTRL, &control) == -1) {
-      std::cerr << "Failed to set auto focus: " << strerror(errno) << std::endl;
+      LOG_ERROR(Hw) << "Failed to set auto focus: " << strerror(errno);
       return false;
     }
 
     auto_focus = new_auto_focus;
 
-    std::cout << "in " << __FUNCTION__ << ", focus set to " << control.value << std::endl;
+    LOG_INFO(Hw) << "in " << __FUNCTION__ << ", focus set to " << control.value;
   }
 
   // Nothing more to do if auto focus enabled
@@ -152,7 +152,7 @@ bool Camera::setFocus(std::uint8_t value)
   // Set manual focus, 1-100%
   query.id = V4L2_CID_FOCUS_ABSOLUTE;
   if (ioctl(fd, VIDIOC_QUERYCTRL, &query) == -1) {
-    std::cerr << "Failed to query focus: " << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to query focus: " << strerror(errno);
     return false;
   }
 
@@ -161,11 +161,11 @@ bool Camera::setFocus(std::uint8_t value)
   control.value = static_cast<int>((((query.maximum - query.minimum) / 100.0) * value) + query.minimum);
 
   if (ioctl(fd, VIDIOC_S_CTRL, &control) == -1) {
-    std::cerr << "Failed to set focus values: " << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to set focus values: " << strerror(errno);
     return false;
   }
 
-  std::cout << "in " << __FUNCTION__ << ", focus set to " << control.value << std::endl;
+  LOG_INFO(Hw) << "in " << __FUNCTION__ << ", focus set to " << control.value;
 
   return true;
 }
@@ -6,8 +6,8 @@
 #include "ControlBoard.h"
 #include "Timer.h"
 #include "Event.h"
+#include "Log.h"
 
-#include <iostream>
 #include <cstring>
 #include <string>
 #include <memory>
@@ -25,16 +25,25 @@
 constexpr size_t CB_BUFFER_SIZE = 1;
 
 ControlBoard::ControlBoard(EventLoop& eventLoop, const std::string& serialDevice):
-  serial_port(eventLoop.context()),
+  strand(eventLoop.makeStrand()),
+  serial_port(strand),
   serialDevice(serialDevice),
   serialData(),
   enabled(false),
   reopenTimer(nullptr),
-  wdgTimer(nullptr)
+  wdgTimer(nullptr),
+  metricReadBytes(Metrics::registry().counter("pleco_control_board_read_bytes_total",
+                                              "Bytes read from the control board")),
+  metricCommands(Metrics::registry().counter("pleco_control_board_commands_total",
+                                             "Commands written to the control board")),
+  metricWriteErrors(Metrics::registry().counter("pleco_control_board_write_errors_total",
+                                                "Failed writes to the control board")),
+  metricReopens(Metrics::registry().counter("pleco_control_board_reopens_total",
+                                            "Control board serial port reopened"))
 {
   // Create timers
-  reopenTimer = std::make_shared<Timer>(eventLoop);
-  wdgTimer = std::make_shared<Timer>(eventLoop);
+  reopenTimer = std::make_shared<Timer>(eventLoop, strand);
+  wdgTimer = std::make_shared<Timer>(eventLoop, strand);
 }
 
 ControlBoard::~ControlBoard()
@@ -46,34 +55,34 @@ ControlBoard::~ControlBoard()
 
 void ControlBoard::closeSerialDevice(void)
 {
-  std::cout << "in " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Hw) << "in " << __FUNCTION__;
 
   if (serial_port.is_open()) {
-    std::cout << "in " << __FUNCTION__ << ": aborting" << std::endl;
+    LOG_DEBUG(Hw) << "in " << __FUNCTION__ << ": aborting";
 
     // Cancel any ongoing asynchronous operations
     asio::error_code ec;
     // NOLINTNEXTLINE(bugprone-unused-return-value)
     serial_port.cancel(ec);
     if (ec) {
-      std::cerr << "Error canceling operations: " << ec.message() << std::endl;
+      LOG_ERROR(Hw) << "Error canceling operations: " << ec.message();
     }
 
-    std::cout << "in " << __FUNCTION__ << ": closing" << std::endl;
+    LOG_DEBUG(Hw) << "in " << __FUNCTION__ << ": closing";
     // NOLINTNEXTLINE(bugprone-unused-return-value)
     serial_port.close(ec);
     if (ec) {
-      std::cerr << "Error closing operations: " << ec.message() << std::endl;
+      LOG_ERROR(Hw) << "Error closing operations: " << ec.message();
     }  }
 
-  std::cout << "out " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Hw) << "out " << __FUNCTION__;
 }
 
 bool ControlBoard::init(void)
 {
   // Enable Control Board connection
   if (!openSerialDevice()) {
-    std::cerr << "Failed to open and setup serial port" << std::endl;
+    LOG_ERROR(Hw) << "Failed to open and setup serial port";
     return false;
   }
 
@@ -96,6 +105,7 @@ void ControlBoard::readPendingSerialData(void)
   if (bytes_read > 0) {
     // Append new data to our serialData buffer
     serialData.insert(serialData.end(), buffer.begin(), buffer.begin() + bytes_read);
+    metricReadBytes.add(bytes_read);
 
     // If no new data coming from the serial port in 2 seconds, reopen
     // the tty device
@@ -116,6 +126,7 @@ void ControlBoard::readPendingSerialData(void)
       if (bytes_transferred > 0) {
         // Append new data to our serialData buffer
         serialData.insert(serialData.end(), buffer.begin(), buffer.begin() + bytes_transferred);
+        metricReadBytes.add(bytes_transferred);
 
         // Reset watchdog timer
         wdgTimer->start(2000, [this]() { reopenSerialDevice(); });
@@ -131,27 +142,28 @@ void ControlBoard::readPendingSerialData(void)
 
 void ControlBoard::portError(int error)
 {
-  std::cerr << __FUNCTION__ << ": Socket error: " << error << std::endl;
+  LOG_ERROR(Hw) << __FUNCTION__ << ": Socket error: " << error;
 }
 
 void ControlBoard::portDisconnected(void)
 {
-  std::cerr << __FUNCTION__ << ": Socket disconnected" << std::endl;
+  LOG_ERROR(Hw) << __FUNCTION__ << ": Socket disconnected";
 }
 
 void ControlBoard::reopenSerialDevice(void)
 {
-  std::cout << "in " << __FUNCTION__ << std::endl;
-  std::cout << "Closing" << std::endl;
+  LOG_DEBUG(Hw) << "in " << __FUNCTION__;
+  metricReopens.add();
+  LOG_DEBUG(Hw) << "Closing";
   closeSerialDevice();
-  std::cout << "Opening" << std::endl;
+  LOG_DEBUG(Hw) << "Opening";
   openSerialDevice();
-  std::cout << "wdg" << std::endl;
+  LOG_DEBUG(Hw) << "wdg";
 
   // If no new data coming from the serial port in 2 seconds, reopen
   // the tty device
   wdgTimer->start(2000, [this]() { reopenSerialDevice(); });
-  std::cout << "out " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Hw) << "out " << __FUNCTION__;
 }
 
 bool ControlBoard::openSerialDevice(void)
@@ -159,8 +171,8 @@ bool ControlBoard::openSerialDevice(void)
   // Open device
   int fd = open(serialDevice.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
   if (fd < 0) {
-    std::cerr << "Failed to open Control Board device (" << serialDevice << "): "
-              << strerror(errno) << std::endl;
+    LOG_ERROR(Hw) << "Failed to open Control Board device (" << serialDevice << "): "
+                  << strerror(errno);
 
     // Launch a timer and try to open again
     reopenTimer->start(1000, [this]() { reopenSerialDevice(); });
@@ -198,8 +210,8 @@ bool ControlBoard::openSerialDevice(void)
   // NOLINTNEXTLINE(bugprone-unused-return-value)
   serial_port.assign(fd, ec);
   if (ec) {
-    std::cerr << "Failed to assign file descriptor to stream_descriptor: "
-              << ec.message() << std::endl;
+    LOG_ERROR(Hw) << "Failed to assign file descriptor to stream_descriptor: "
+                  << ec.message();
     close(fd);
     return false;
   }
@@ -232,7 +244,7 @@ void ControlBoard::parseSerialData(void)
     message.pop_back();
   }
 
-  std::cout << __FUNCTION__ << " have msg: " << message << std::endl;
+  LOG_DEBUG(Hw) << __FUNCTION__ << " have msg: " << message;
 
   // Remove processed data from buffer
   serialData.erase(serialData.begin(), newline_pos + 1);
@@ -242,7 +254,7 @@ void ControlBoard::parseSerialData(void)
     std::string value_str = message.substr(5);
     std::uint16_t value = std::stoi(value_str);
 
-    std::cout << __FUNCTION__ << " Temperature: " << value << std::endl;
+    LOG_DEBUG(Hw) << __FUNCTION__ << " Temperature: " << value;
 
     if (temperatureCallback) {
       temperatureCallback(value);
@@ -251,7 +263,7 @@ void ControlBoard::parseSerialData(void)
     std::string value_str = message.substr(5);
     std::uint16_t value = std::stoi(value_str);
 
-    std::cout << __FUNCTION__ << " Distance: " << value << std::endl;
+    LOG_DEBUG(Hw) << __FUNCTION__ << " Distance: " << value;
 
     if (distanceCallback) {
       distanceCallback(value);
@@ -260,7 +272,7 @@ void ControlBoard::parseSerialData(void)
     std::string value_str = message.substr(5);
     std::uint16_t value = std::stoi(value_str);
 
-    std::cout << __FUNCTION__ << " Current consumption: " << value << std::endl;
+    LOG_DEBUG(Hw) << __FUNCTION__ << " Current consumption: " << value;
 
     if (currentCallback) {
       currentCallback(value);
@@ -269,7 +281,7 @@ void ControlBoard::parseSerialData(void)
     std::string value_str = message.substr(5);
     std::uint16_t value = std::stoi(value_str);
 
-    std::cout << __FUNCTION__ << " Battery voltage: " << value << std::endl;
+    LOG_DEBUG(Hw) << __FUNCTION__ << " Battery voltage: " << value;
 
     if (voltageCallback) {
       voltageCallback(value);
@@ -291,7 +303,7 @@ void ControlBoard::parseSerialData(void)
 void ControlBoard::setPWMFreq(std::uint32_t freq)
 {
   if (!enabled) {
-    std::cerr << __FUNCTION__ << ": Not enabled" << std::endl;
+    LOG_ERROR(Hw) << __FUNCTION__ << ": Not enabled";
     return;
   }
 
@@ -302,7 +314,7 @@ void ControlBoard::setPWMFreq(std::uint32_t freq)
 void ControlBoard::stopPWM(std::uint8_t pwm)
 {
   if (!enabled) {
-    std::cerr << __FUNCTION__ << ": Not enabled" << std::endl;
+    LOG_ERROR(Hw) << __FUNCTION__ << ": Not enabled";
     return;
   }
 
@@ -313,12 +325,12 @@ void ControlBoard::stopPWM(std::uint8_t pwm)
 void ControlBoard::setPWMDuty(std::uint8_t pwm, std::uint16_t duty)
 {
   if (!enabled) {
-    std::cerr << __FUNCTION__ << ": Not enabled" << std::endl;
+    LOG_ERROR(Hw) << __FUNCTION__ << ": Not enabled";
     return;
   }
 
   if (duty > 10000) {
-    std::cerr << __FUNCTION__ << ": Duty out of range: " << duty << std::endl;
+    LOG_ERROR(Hw) << __FUNCTION__ << ": Duty out of range: " << duty;
     return;
   }
 
@@ -351,6 +363,12 @@ void ControlBoard::sendPing(void)
 
 void ControlBoard::writeSerialData(const std::string& cmd)
 {
+  // The commands come from the transmitter's strand, the port is used on ours
+  if (!strand.running_in_this_thread()) {
+    asio::post(strand, [this, cmd]() { writeSerialData(cmd); });
+    return;
+  }
+
   if (!serial_port.is_open()) {
     // Try not to write if the serial port is not (yet) open
     return;
@@ -362,9 +380,12 @@ void ControlBoard::writeSerialData(const std::string& cmd)
   asio::write(serial_port, asio::buffer(data), ec);
 
   if (ec) {
-    std::cerr << "Failed to write command to ControlBoard: " << ec.message() << std::endl;
+    LOG_ERROR(Hw) << "Failed to write command to ControlBoard: " << ec.message();
+    metricWriteErrors.add();
     closeSerialDevice();
     openSerialDevice();
+  } else {
+    metricCommands.add();
   }
 }
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "Event.h"
+#include "Metrics.h"
 
 #include <string>
 #include <vector>
@@ -61,6 +62,9 @@ class ControlBoard
   void setGPIO(std::uint16_t gpio, std::uint16_t enable);
   void sendPing(void);
 
+  // The commands above can be called from any thread, the callbacks
+  // run on the strand of the control board
+
   // Callback types
   using DebugCallback = std::function<void(const std::string&)>;
   using ValueCallback = std::function<void(std::uint16_t)>;
@@ -82,6 +86,9 @@ class ControlBoard
   void closeSerialDevice(void);
   void writeSerialData(const std::string& msg);
 
+  // The serial port and the timers are used on this strand only
+  EventLoop::Strand strand;
+
   // Serial port using ASIO
   asio::posix::stream_descriptor serial_port;
 
@@ -99,6 +106,12 @@ class ControlBoard
   ValueCallback distanceCallback;
   ValueCallback currentCallback;
   ValueCallback voltageCallback;
+
+  // Exported metrics
+  Metrics::Counter& metricReadBytes;
+  Metrics::Counter& metricCommands;
+  Metrics::Counter& metricWriteErrors;
+  Metrics::Counter& metricReopens;
 };
 
 /* Emacs indentatation information
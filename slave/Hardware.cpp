@@ -4,8 +4,8 @@
  */
 
 #include "Hardware.h"
+#include "Log.h"
 
-#include <iostream>
 #include <string>
 #include <cstdint>
 
@@ -67,7 +67,7 @@ Hardware::Hardware(const std::string& name)
   for (std::uint32_t i = 0; i < sizeof(hardwareList) / sizeof(hardwareList[0]); ++i) {
     if (hardwareList[i].name == name) {
       hw = i;
-      std::cout << "in " << __FUNCTION__ << ", selected: " << hardwareList[hw].name << std::endl;
+      LOG_INFO(Hw) << "in " << __FUNCTION__ << ", selected: " << hardwareList[hw].name;
       return;
     }
   }
@@ -7,9 +7,9 @@
 #include "Transmitter.h"
 #include "VideoSender.h"
 #include "AudioSender.h"
-#include "Message.h"
+#include "MessageSchema.h"
+#include "Log.h"
 
-#include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <string>
@@ -22,9 +22,19 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+// Video is paced at this percentage of the encoder bitrate by default
+constexpr int SLAVE_PACING_PERCENT_DEFAULT = 150;
+
+// Smaller changes of the congestion controlled bitrate are not worth
+// reconfiguring the encoder for
+constexpr int SLAVE_BITRATE_CHANGE_PERCENT = 5;
+
 Slave::Slave(EventLoop& eventLoop, int, char **):
   eventLoop(eventLoop),
   oldSpeed(0), oldTurn(0), oldDirectionLeft(0), oldDirectionRight(0),
+  pacingPercent(SLAVE_PACING_PERCENT_DEFAULT),
+  congestion(),
+  congestionControl(true),
   running(true)
 {
   // No initialization in constructor - all setup happens in init()
@@ -49,40 +59,40 @@ bool Slave::init(void)
   for (const auto& filename : detectFiles) {
     std::ifstream file(filename);
     if (file.is_open()) {
-      std::cout << "Reading " << filename << std::endl;
+      LOG_INFO(Main) << "Reading " << filename;
       std::string content((std::istreambuf_iterator<char>(file)),
                            std::istreambuf_iterator<char>());
 
       if (content.find("Gumstix Overo") != std::string::npos) {
-        std::cout << "Detected Gumstix Overo" << std::endl;
+        LOG_INFO(Main) << "Detected Gumstix Overo";
         hardwareName = "gumstix_overo";
         break;
       } else if (content.find("BCM2708") != std::string::npos) {
-        std::cout << "Detected Broadcom based Raspberry Pi" << std::endl;
+        LOG_INFO(Main) << "Detected Broadcom based Raspberry Pi";
         hardwareName = "raspberry_pi";
         break;
       } else if (content.find("grouper") != std::string::npos) {
-        std::cout << "Detected Tegra 3 based Nexus 7" << std::endl;
+        LOG_INFO(Main) << "Detected Tegra 3 based Nexus 7";
         hardwareName = "tegra3";
       } else if (content.find("cardhu") != std::string::npos) {
-        std::cout << "Detected Tegra 3 based Cardhu or Ouya" << std::endl;
+        LOG_INFO(Main) << "Detected Tegra 3 based Cardhu or Ouya";
         hardwareName = "tegra3";
         break;
       } else if (content.find("jetson-tk1") != std::string::npos) {
-        std::cout << "Detected Tegra K1 based Jetson TK1" << std::endl;
+        LOG_INFO(Main) << "Detected Tegra K1 based Jetson TK1";
         hardwareName = "tegrak1";
         break;
       } else if (content.find("jetson_tx1") != std::string::npos) {
-        std::cout << "Detected Tegra X1 based Jetson TX1" << std::endl;
+        LOG_INFO(Main) << "Detected Tegra X1 based Jetson TX1";
         hardwareName = "tegrax1";
       } else if (content.find("quill") != std::string::npos) {
-        std::cout << "Detected Tegra X2 based Jetson TX2" << std::endl;
+        LOG_INFO(Main) << "Detected Tegra X2 based Jetson TX2";
         hardwareName = "tegrax2";
       } else if (content.find("Jetson Nano") != std::string::npos) {
-        std::cout << "Detected Jetson Nano" << std::endl;
+        LOG_INFO(Main) << "Detected Jetson Nano";
         hardwareName = "tegra_nano";
       } else if (content.find("GenuineIntel") != std::string::npos) {
-        std::cout << "Detected X86" << std::endl;
+        LOG_INFO(Main) << "Detected X86";
         hardwareName = "generic_x86";
       }
 
@@ -91,11 +101,11 @@ bool Slave::init(void)
   }
 
   if (hardwareName.empty()) {
-    std::cerr << "Failed to detect HW, guessing generic x86" << std::endl;
+    LOG_WARN(Main) << "Failed to detect HW, guessing generic x86";
     hardwareName = "generic_x86";
   }
 
-  std::cout << "Initialising hardware object: " << hardwareName << std::endl;
+  LOG_INFO(Main) << "Initialising hardware object: " << hardwareName;
 
   hardware = std::make_unique<Hardware>(hardwareName);
 
@@ -104,7 +114,7 @@ bool Slave::init(void)
 
   // FIXME: if the init fails, wait for a signal that is has succeeded (or wait it always?)
   if (!cb->init()) {
-    std::cerr << "Failed to initialize ControlBoard" << std::endl;
+    LOG_ERROR(Main) << "Failed to initialize ControlBoard";
     // CHECKME: to return false or not to return false (and do clean up)?
   } else {
     // Assuming PWM frequencies are set to correct values already at built time.
@@ -136,13 +146,86 @@ void Slave::connect(const std::string& host, std::uint16_t port)
     updateConnectionStatus(status);
   });
 
+  // Optional checksum mode, must match the controller
+  const char* envCrc = std::getenv("PLECO_CRC");
+  Crc::Mode crcMode;
+  if (envCrc && Crc::parseMode(envCrc, crcMode)) {
+    transmitter->setCrcMode(crcMode);
+  }
+
+  // Optional coalescing of small messages, value is the window in microseconds
+  const char* envCoalesce = std::getenv("PLECO_COALESCE_US");
+  if (envCoalesce) {
+    transmitter->setCoalescing(true, std::atoi(envCoalesce));
+  }
+
+  // Optional video FEC, value is the number of video messages per parity message
+  const char* envFec = std::getenv("PLECO_VIDEO_FEC");
+  if (envFec) {
+    transmitter->setVideoFec(std::atoi(envFec));
+  }
+
+  // Batched socket I/O is used where supported, PLECO_BATCH_IO=0 disables it
+  const char* envBatchIo = std::getenv("PLECO_BATCH_IO");
+  if (envBatchIo) {
+    transmitter->setBatchedIo(std::atoi(envBatchIo) != 0);
+  }
+
+  // Session on a relay shared by several cars, must match the controller
+  const char* envSession = std::getenv("PLECO_RELAY_SESSION");
+  if (envSession) {
+    transmitter->setRelaySession(static_cast<std::uint32_t>(std::strtoul(envSession, nullptr, 0)));
+  }
+
+  // Bytes let into the socket send buffer ahead of control messages, 0 for no limit
+  const char* envSocketQueue = std::getenv("PLECO_SOCKET_QUEUE");
+  if (envSocketQueue) {
+    transmitter->setSocketQueueLimit(std::strtoul(envSocketQueue, nullptr, 0));
+  }
+
+  // Video pacing rate as a percentage of the encoder bitrate, PLECO_PACING_PERCENT=0 disables it
+  const char* envPacing = std::getenv("PLECO_PACING_PERCENT");
+  if (envPacing) {
+    pacingPercent = std::atoi(envPacing);
+  }
+
+  // Report the pacer queue to the controller
+  if (pacingPercent > 0) {
+    transmitter->setPacerStatsCallback([this](int queueDepth, int delayMs, std::uint32_t drops) {
+      if (drops > 0) {
+        LOG_WARN(Net) << "Pacer dropped " << drops << " late video datagrams";
+      }
+      transmitter->sendPeriodicValue(MessageSubtype::PacerQueue, static_cast<std::uint16_t>(queueDepth));
+      transmitter->sendPeriodicValue(MessageSubtype::PacerDelay, static_cast<std::uint16_t>(delayMs));
+    });
+  }
+
+  // Video bitrate follows the controller's receiver reports, PLECO_CONGESTION=0 disables it
+  const char* envCongestion = std::getenv("PLECO_CONGESTION");
+  if (envCongestion) {
+    congestionControl = std::atoi(envCongestion) != 0;
+  }
+
+  if (congestionControl) {
+    transmitter->setReceiverReportCallback([this](const ReceiverReport& report) {
+      updateCongestion(report);
+    });
+  }
+
+  // Optional capture of every datagram for offline replay
+  const char* envCapture = std::getenv("PLECO_CAPTURE");
+  if (envCapture && *envCapture) {
+    transmitter->startCapture(envCapture);
+  }
+
   transmitter->initSocket();
 
   // Send ping every second (unless other high priority packet are sent)
   transmitter->enableAutoPing(true);
 
-  // Start timer for sending system statistics (wlan signal, cpu load) periodically
-  statsTimer = std::make_shared<Timer>(eventLoop);
+  // Start timer for sending system statistics (wlan signal, cpu load)
+  // periodically. The slave's state is kept on the transmitter's strand.
+  statsTimer = std::make_shared<Timer>(eventLoop, transmitter->getStrand());
   statsTimer->start(1000, [this]() { sendSystemStats(); }, true);
 
   // Create and enable sending video
@@ -152,12 +235,19 @@ void Slave::connect(const std::string& host, std::uint16_t port)
   as = std::make_unique<AudioSender>(hardware.get());
 
   // Set up callbacks for video and audio data
-  vs->setVideoCallback([this](std::vector<std::uint8_t>* video) {
-    transmitter->sendVideo(video);
+  vs->setVideoCallback([this](const std::uint8_t* video, std::size_t size) {
+    transmitter->sendVideo(video, size);
   });
+  updatePacing();
 
-  as->setAudioCallback([this](std::vector<std::uint8_t>* audio) {
-    transmitter->sendAudio(audio);
+  // Optional time stamps in the video frames for measuring the latency
+  const char* envStamp = std::getenv("PLECO_VIDEO_STAMP");
+  if (envStamp) {
+    vs->setFrameStamping(std::atoi(envStamp) != 0);
+  }
+
+  as->setAudioCallback([this](const std::uint8_t* audio, std::size_t size) {
+    transmitter->sendAudio(audio, size);
   });
 
   // Set up control board callbacks
@@ -280,12 +370,17 @@ void Slave::sendSystemStats(void)
       file.close();
     }
   }
+
+  // Current video bitrate, changes with the congestion control
+  if (vs) {
+    transmitter->sendPeriodicValue(MessageSubtype::VideoBitrate, static_cast<std::uint16_t>(vs->getBitrate()));
+  }
 }
 
 void Slave::updateValue(std::uint8_t type, std::uint16_t value)
 {
-  std::cout << "in updateValue, type: " << Message::getSubTypeStr(type)
-            << ", value: " << value << std::endl;
+  LOG_DEBUG(Main) << "in updateValue, type: " << MessageSchema::subTypeStr(type)
+                  << ", value: " << value;
 
   switch (type) {
   case MessageSubtype::EnableLED:
@@ -317,16 +412,16 @@ void Slave::updateValue(std::uint8_t type, std::uint16_t value)
     parseVideoQuality(value);
     break;
   default:
-    std::cerr << "updateValue: Unknown type: " << Message::getSubTypeStr(type) << std::endl;
+    LOG_ERROR(Main) << "updateValue: Unknown type: " << MessageSchema::subTypeStr(type);
   }
 }
 
 void Slave::updateConnectionStatus(int status)
 {
-  std::cout << "in updateConnectionStatus, status: " << status << std::endl;
+  LOG_INFO(Main) << "in updateConnectionStatus, status: " << status;
 
   if (status == CONNECTION_STATUS_LOST) {
-    std::cout << "in updateConnectionStatus, Stop all PWM" << std::endl;
+    LOG_INFO(Main) << "in updateConnectionStatus, Stop all PWM";
 
     // Stop all motors
     for (std::uint8_t i = 1; i <= CB_PWM::PWM8; ++i) {
@@ -345,6 +440,10 @@ void Slave::updateConnectionStatus(int status)
 
     // Stop sending audio
     parseSendAudio(0);
+
+    // Start over with the operator's bitrate
+    congestion.reset();
+    updateVideoRate();
   }
 
   // FIXME: if connection restored (or just ok for the first time), send status to controller?
@@ -378,11 +477,61 @@ void Slave::parseSendVideo(std::uint16_t value)
 void Slave::parseSendAudio(std::uint16_t value)
 {
   as->enableSending(value ? true : false);
+  congestion.setAudioEnabled(value ? true : false);
 }
 
 void Slave::parseVideoQuality(std::uint16_t value)
 {
   vs->setVideoQuality(value);
+
+  // Encoder bitrate is in kilobits per second
+  congestion.setVideoMax(vs->getMaxBitrate() * 1024);
+  updateVideoRate();
+  updatePacing();
+}
+
+void Slave::updateCongestion(const ReceiverReport& report)
+{
+  LOG_DEBUG(Net) << "Receiver report: lost " << static_cast<int>(report.fractionLost)
+                 << "/256, jitter " << report.jitterUs << " us, queue " << report.queueDelayUs
+                 << " us, trend " << report.delayTrendUs << " us/s, " << report.rateBps << " bit/s";
+
+  congestion.update(report, CongestionController::Clock::now());
+  updateVideoRate();
+}
+
+void Slave::updateVideoRate(void)
+{
+  if (!congestionControl || !vs) {
+    return;
+  }
+
+  int current = vs->getBitrate();
+  int target = congestion.getVideoRate() / 1024;
+  if (target == current) {
+    return;
+  }
+
+  // Always reach the operator's bitrate, otherwise skip the small changes
+  if (target != vs->getMaxBitrate() &&
+      std::abs(target - current) * 100 < current * SLAVE_BITRATE_CHANGE_PERCENT) {
+    return;
+  }
+
+  LOG_DEBUG(Video) << "Congestion control changes video bitrate from " << current
+                   << " to " << target << " kbit/s";
+  vs->setBitrate(target);
+  updatePacing();
+}
+
+void Slave::updatePacing(void)
+{
+  if (pacingPercent <= 0) {
+    return;
+  }
+
+  // Encoder bitrate is in kilobits per second
+  transmitter->setPacingRate(vs->getBitrate() * 1024 / 100 * pacingPercent);
 }
 
 void Slave::parseCameraXY(std::uint16_t value)
@@ -402,13 +551,13 @@ void Slave::parseCameraXY(std::uint16_t value)
   // Update servo positions only if value has changed
   if (x != oldx) {
     cb->setPWMDuty(CB_PWM::CAMERA_X, x);
-    std::cout << "in parseCameraXY, Camera X PWM: " << x << std::endl;
+    LOG_DEBUG(Main) << "in parseCameraXY, Camera X PWM: " << x;
     oldx = x;
   }
 
   if (y != oldy) {
     cb->setPWMDuty(CB_PWM::CAMERA_Y, y);
-    std::cout << "in parseCameraXY, Camera Y PWM: " << y << std::endl;
+    LOG_DEBUG(Main) << "in parseCameraXY, Camera Y PWM: " << y;
     oldy = y;
   }
 }
@@ -476,8 +625,8 @@ void Slave::speedTurnTank(std::uint8_t speed_raw, std::uint8_t turn_raw)
     cb->setPWMDuty(CB_PWM::SPEED_LEFT, static_cast<std::uint16_t>(speed_left * 100));
     cb->setPWMDuty(CB_PWM::SPEED_RIGHT, static_cast<std::uint16_t>(speed_right * 100));
 
-    std::cout << "in speedTurnTank, Speed PWM left: " << speed_left
-              << ", right: " << speed_right << std::endl;
+    LOG_DEBUG(Main) << "in speedTurnTank, Speed PWM left: " << speed_left
+                    << ", right: " << speed_right;
 
     oldSpeed = speed;
     oldTurn = turn;
@@ -505,13 +654,13 @@ void Slave::speedTurnAckerman(std::uint8_t speed_raw, std::uint8_t turn_raw)
   if (speed != oldSpeed) {
     cb->setPWMDuty(CB_PWM::SPEED, speed);
 
-    std::cout << "in speedTurnAckerman, Speed PWM: " << speed << std::endl;
+    LOG_DEBUG(Main) << "in speedTurnAckerman, Speed PWM: " << speed;
 
     // Update rear lights if slowing down
     if (speed < oldSpeed || speed < 0) {
       // Start a timer for turning off rear lights
       if (!rearLightTimer) {
-        rearLightTimer = std::make_shared<Timer>(eventLoop);
+        rearLightTimer = std::make_shared<Timer>(eventLoop, transmitter->getStrand());
       }
       rearLightTimer->start(2000, [this]() { turnOffRearLight(); });
 
@@ -522,7 +671,7 @@ void Slave::speedTurnAckerman(std::uint8_t speed_raw, std::uint8_t turn_raw)
 
   if (turn != oldTurn) {
     cb->setPWMDuty(CB_PWM::TURN, turn);
-    std::cout << "in speedTurnAckerman, Turn PWM1: " << turn << std::endl;
+    LOG_DEBUG(Main) << "in speedTurnAckerman, Turn PWM1: " << turn;
 
     if (1) { // Rock Crawler's rear wheels also turn
       // The rear wheels must be turned vice versa compared to front wheels
@@ -530,7 +679,7 @@ void Slave::speedTurnAckerman(std::uint8_t speed_raw, std::uint8_t turn_raw)
       std::uint16_t turn2 = (500 - (turn - 500)) + 500;
 
       cb->setPWMDuty(CB_PWM::TURN2, turn2);
-      std::cout << "in speedTurnAckerman, Turn PWM2: " << turn2 << std::endl;
+      LOG_DEBUG(Main) << "in speedTurnAckerman, Turn PWM2: " << turn2;
     }
     oldTurn = turn;
   }
@@ -12,6 +12,7 @@
 #include "AudioSender.h"
 #include "ControlBoard.h"
 #include "Camera.h"
+#include "CongestionController.h"
 
 #include <string>
 #include <memory>
@@ -47,6 +48,9 @@ class Slave
   void parseCameraXY(std::uint16_t value);
   void parseSpeedTurn(std::uint16_t value);
   void parseVideoQuality(std::uint16_t value);
+  void updatePacing(void);
+  void updateCongestion(const ReceiverReport& report);
+  void updateVideoRate(void);
 
   // Event loop and timer
   EventLoop &eventLoop;
@@ -67,6 +71,9 @@ class Slave
   std::int16_t oldTurn;
   std::uint8_t oldDirectionLeft;
   std::uint8_t oldDirectionRight;
+  int pacingPercent;
+  CongestionController congestion;
+  bool congestionControl;
   bool running;
 };
 
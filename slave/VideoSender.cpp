@@ -4,9 +4,11 @@
  */
 
 #include "VideoSender.h"
+#include "FrameStamp.h"
 #include "Timer.h"
+#include "Log.h"
 
-#include <iostream>
+#include <algorithm>
 #include <string>
 #include <cstdlib>
 #include <memory>
@@ -18,6 +20,7 @@
 
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
 #include <glib.h>
 
 #define ENABLE_OBJECT_DETECTION 0
@@ -36,6 +39,7 @@ static const int video_quality_bitrate[] = {256, 1024, 2048, 8192};
 
 VideoSender::VideoSender(EventLoop& eventLoop, Hardware *hardware):
   eventLoop(eventLoop),
+  strand(eventLoop.makeStrand()),
   pipeline(nullptr),
   encoder(nullptr),
   processStdout(nullptr),
@@ -45,8 +49,14 @@ VideoSender::VideoSender(EventLoop& eventLoop, Hardware *hardware):
   processReady(false),
   videoSource(hardware->getCameraSrc()),
   bitrate(video_quality_bitrate[0]),
+  maxBitrate(video_quality_bitrate[0]),
   quality(0),
-  hardware(hardware)
+  frameStamping(false),
+  hardware(hardware),
+  videoCallback(),
+  metricFrames(Metrics::registry().counter("pleco_video_encoded_frames_total", "Encoded video buffers sent")),
+  metricBytes(Metrics::registry().counter("pleco_video_encoded_bytes_total", "Encoded video bytes sent")),
+  metricBitrate(Metrics::registry().gauge("pleco_video_bitrate_kbps", "Video encoder target bitrate"))
 {
   ODdata[OB_VIDEO_PARAM_A] = OB_VIDEO_A;
   ODdata[OB_VIDEO_PARAM_Z] = OB_VIDEO_Z;
@@ -63,12 +73,12 @@ VideoSender::VideoSender(EventLoop& eventLoop, Hardware *hardware):
 VideoSender::~VideoSender()
 {
   // Clean up
-  std::cout << "Stopping video encoding" << std::endl;
+  LOG_INFO(Video) << "Stopping video encoding";
   if (pipeline) {
     gst_element_set_state(pipeline, GST_STATE_NULL);
   }
 
-  std::cout << "Deleting pipeline" << std::endl;
+  LOG_INFO(Video) << "Deleting pipeline";
   if (pipeline) {
     gst_object_unref(GST_OBJECT(pipeline));
     pipeline = nullptr;
@@ -98,16 +108,16 @@ bool VideoSender::enableSending(bool enable)
 #endif
   GError *error = nullptr;
 
-  std::cout << "In " << __FUNCTION__ << ", Enable: " << (enable ? "true" : "false") << std::endl;
+  LOG_INFO(Video) << "In " << __FUNCTION__ << ", Enable: " << (enable ? "true" : "false");
 
   // Disable video sending
   if (!enable) {
-    std::cout << "Stopping video encoding" << std::endl;
+    LOG_INFO(Video) << "Stopping video encoding";
     if (pipeline) {
       gst_element_set_state(pipeline, GST_STATE_NULL);
     }
 
-    std::cout << "Deleting pipeline" << std::endl;
+    LOG_INFO(Video) << "Deleting pipeline";
     if (pipeline) {
       gst_object_unref(GST_OBJECT(pipeline));
       pipeline = nullptr;
@@ -119,7 +129,7 @@ bool VideoSender::enableSending(bool enable)
       asio::error_code ec;
       asio::write(*processStdin, asio::buffer(ODdata, sizeof(ODdata)), ec);
       if (ec) {
-        std::cerr << "Failed to write to process: " << ec.message() << std::endl;
+        LOG_ERROR(Video) << "Failed to write to process: " << ec.message();
       }
     }
 
@@ -129,18 +139,18 @@ bool VideoSender::enableSending(bool enable)
   if (pipeline) {
     // Do nothing as the pipeline has already been created and is
     // probably running
-    std::cerr << "Pipeline exists already, doing nothing" << std::endl;
+    LOG_WARN(Video) << "Pipeline exists already, doing nothing";
     return true;
   }
 
   // Initialisation. We don't pass command line arguments here
   if (!gst_init_check(NULL, NULL, NULL)) {
-    std::cerr << "Failed to init GST" << std::endl;
+    LOG_ERROR(Video) << "Failed to init GST";
     return false;
   }
 
   if (!hardware) {
-    std::cerr << "No hardware plugin" << std::endl;
+    LOG_ERROR(Video) << "No hardware plugin";
     return false;
   }
 
@@ -197,19 +207,19 @@ bool VideoSender::enableSending(bool enable)
   pipelineString += " ! ";
   pipelineString += "appsink name=ob sync=false max-buffers=1 drop=true";
 #endif
-  std::cout << "Using pipeline: " << pipelineString << std::endl;
+  LOG_INFO(Video) << "Using pipeline: " << pipelineString;
 
   // Create encoding video pipeline
   pipeline = gst_parse_launch(pipelineString.c_str(), &error);
   if (!pipeline) {
-    std::cerr << "Failed to parse pipeline: " << error->message << std::endl;
+    LOG_ERROR(Video) << "Failed to parse pipeline: " << error->message;
     g_error_free(error);
     return false;
   }
 
   encoder = gst_bin_get_by_name(GST_BIN(pipeline), "encoder");
   if (!encoder) {
-    std::cerr << "Failed to get encoder" << std::endl;
+    LOG_ERROR(Video) << "Failed to get encoder";
     return false;
   }
 
@@ -245,7 +255,7 @@ bool VideoSender::enableSending(bool enable)
     GstElement *source;
     source = gst_bin_get_by_name(GST_BIN(pipeline), "source");
     if (!source) {
-      std::cerr << "Failed to get source" << std::endl;
+      LOG_ERROR(Video) << "Failed to get source";
       return false;
     }
 
@@ -275,11 +285,21 @@ bool VideoSender::enableSending(bool enable)
         hardware->getHardwareName() == "tegrax1") {
       g_object_set(G_OBJECT(source), "io-mode", 1, NULL);
     }
+
+    if (frameStamping) {
+      GstPad* pad = gst_element_get_static_pad(source, "src");
+      if (pad) {
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &stampFrameCB, this, NULL);
+        gst_object_unref(pad);
+      } else {
+        LOG_WARN(Video) << "No source pad for frame stamping";
+      }
+    }
   }
 
   sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
   if (!sink) {
-    std::cerr << "Failed to get sink" << std::endl;
+    LOG_ERROR(Video) << "Failed to get sink";
     return false;
   }
 
@@ -294,7 +314,7 @@ bool VideoSender::enableSending(bool enable)
   // Callbacks for the OB process appsink
   ob = gst_bin_get_by_name(GST_BIN(pipeline), "ob");
   if (!ob) {
-    std::cerr << "Failed to get ob appsink" << std::endl;
+    LOG_ERROR(Video) << "Failed to get ob appsink";
     return false;
   }
 
@@ -322,7 +342,7 @@ bool VideoSender::enableSending(bool enable)
  */
 void VideoSender::handleObjectDetectionExit(int exitCode)
 {
-  std::cout << "In " << __FUNCTION__ << ", exitCode: " << exitCode << std::endl;
+  LOG_INFO(Video) << "In " << __FUNCTION__ << ", exitCode: " << exitCode;
 
   // Close streams
   processStdin.reset();
@@ -339,7 +359,7 @@ void VideoSender::processObjectDetectionOutput()
 {
   // Process only if there's a valid stdout descriptor
   if (!processStdout || !processStdout->is_open()) {
-    std::cout << "In " << __FUNCTION__ << ", no processStdout" << std::endl;
+    LOG_DEBUG(Video) << "In " << __FUNCTION__ << ", no processStdout";
     return;
   }
 
@@ -357,11 +377,11 @@ void VideoSender::processObjectDetectionOutput()
         // Check for "OD: ready" message
         if (output.find("OD: ready") != std::string::npos) {
           processReady = true;
-          std::cout << "Object detection process is ready" << std::endl;
+          LOG_INFO(Video) << "Object detection process is ready";
         }
 
         // Log all output
-        std::cout << "OD Process output: " << output << std::endl;
+        LOG_DEBUG(Video) << "OD Process output: " << output;
 
         // Continue reading - restart the async operation with a new buffer
         processObjectDetectionOutput();
@@ -374,10 +394,10 @@ void VideoSender::processObjectDetectionOutput()
  */
 void VideoSender::launchObjectDetection()
 {
-  std::cout << "In " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Video) << "In " << __FUNCTION__;
 
   if (processPid > 0) {
-    std::cerr << __FUNCTION__ << ": Process already exists, closing" << std::endl;
+    LOG_ERROR(Video) << __FUNCTION__ << ": Process already exists, closing";
     kill(processPid, SIGTERM);
     int status;
     waitpid(processPid, &status, 0);
@@ -390,7 +410,7 @@ void VideoSender::launchObjectDetection()
   int stdinPipe[2], stdoutPipe[2], stderrPipe[2];
 
   if (pipe(stdinPipe) < 0 || pipe(stdoutPipe) < 0 || pipe(stderrPipe) < 0) {
-    std::cerr << "Failed to create pipes" << std::endl;
+    LOG_ERROR(Video) << "Failed to create pipes";
     return;
   }
 
@@ -403,7 +423,7 @@ void VideoSender::launchObjectDetection()
   processPid = fork();
 
   if (processPid < 0) {
-    std::cerr << "Failed to fork process" << std::endl;
+    LOG_ERROR(Video) << "Failed to fork process";
     close(stdinPipe[0]);
     close(stdinPipe[1]);
     close(stdoutPipe[0]);
@@ -430,7 +450,7 @@ void VideoSender::launchObjectDetection()
     execl("/bin/sh", "sh", "-c", "./dlscript-dummy.py", nullptr);
 
     // If execl returns, there was an error
-    std::cerr << "Failed to execute process" << std::endl;
+    LOG_ERROR(Video) << "Failed to execute process";
     exit(1);
   }
 
@@ -442,9 +462,9 @@ void VideoSender::launchObjectDetection()
   close(stderrPipe[1]);
 
   // Create ASIO stream descriptors for the pipes
-  processStdin = std::make_unique<asio::posix::stream_descriptor>(eventLoop.context(), stdinPipe[1]);
-  processStdout = std::make_unique<asio::posix::stream_descriptor>(eventLoop.context(), stdoutPipe[0]);
-  processStderr = std::make_unique<asio::posix::stream_descriptor>(eventLoop.context(), stderrPipe[0]);
+  processStdin = std::make_unique<asio::posix::stream_descriptor>(strand, stdinPipe[1]);
+  processStdout = std::make_unique<asio::posix::stream_descriptor>(strand, stdoutPipe[0]);
+  processStderr = std::make_unique<asio::posix::stream_descriptor>(strand, stderrPipe[0]);
 
   // Start reading from stdout
   processObjectDetectionOutput();
@@ -457,8 +477,8 @@ void VideoSender::launchObjectDetection()
     if (result > 0) {
       // Process has exited
       int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
-      // Call the exit handler on the main thread
-      asio::post(eventLoop.context(), [this, exitCode]() {
+      // Call the exit handler on the media strand
+      asio::post(strand, [this, exitCode]() {
         handleObjectDetectionExit(exitCode);
       });
       return true;
@@ -468,7 +488,7 @@ void VideoSender::launchObjectDetection()
   };
 
   // Start a timer to periodically check if child process has exited
-  auto timer = std::make_shared<Timer>(eventLoop);
+  auto timer = std::make_shared<Timer>(eventLoop, strand);
   timer->start(500, [timer, waitForChildExit]() {
     if (!waitForChildExit()) {
       // Child still running, continue monitoring
@@ -479,42 +499,40 @@ void VideoSender::launchObjectDetection()
   });
 }
 
-void VideoSender::emitVideo(std::vector<std::uint8_t> *data)
+void VideoSender::emitVideo(const std::uint8_t* data, std::size_t size)
 {
-  std::cout << "In " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Video) << "In " << __FUNCTION__;
+
+  metricFrames.add();
+  metricBytes.add(size);
 
   if (videoCallback) {
-    videoCallback(data);
-  } else {
-    delete data; // Cleanup if no callback is registered
+    videoCallback(data, size);
   }
 }
 
 GstFlowReturn VideoSender::newBufferCB(GstAppSink *sink, gpointer user_data)
 {
-  std::cout << "In " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Video) << "In " << __FUNCTION__;
 
   VideoSender *vs = static_cast<VideoSender *>(user_data);
 
   // Get new video sample
   GstSample *sample = gst_app_sink_pull_sample(sink);
   if (sample == NULL) {
-    std::cerr << __FUNCTION__ << ": Failed to get new sample" << std::endl;
+    LOG_ERROR(Video) << __FUNCTION__ << ": Failed to get new sample";
     return GST_FLOW_OK;
   }
 
-  // FIXME: zero copy?
   GstBuffer *buffer = gst_sample_get_buffer(sample);
   GstMapInfo map;
-  std::vector<std::uint8_t> *data = nullptr;
 
   if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-    // Copy the data to a vector
-    data = new std::vector<std::uint8_t>(map.data, map.data + map.size);
-    vs->emitVideo(data);
+    // The data is copied only once, into the outgoing message
+    vs->emitVideo(map.data, map.size);
     gst_buffer_unmap(buffer, &map);
   } else {
-    std::cerr << "Error with gst_buffer_map" << std::endl;
+    LOG_ERROR(Video) << "Error with gst_buffer_map";
   }
 
   gst_sample_unref(sample);
@@ -522,31 +540,86 @@ GstFlowReturn VideoSender::newBufferCB(GstAppSink *sink, gpointer user_data)
   return GST_FLOW_OK;
 }
 
+/*
+ * Stamp the captured frame before it is encoded, see FrameStamp.h
+ */
+GstPadProbeReturn VideoSender::stampFrameCB(GstPad* pad, GstPadProbeInfo* info, gpointer)
+{
+  // Only system memory frames with a separate luma plane can be stamped
+  GstCaps* caps = gst_pad_get_current_caps(pad);
+  if (!caps) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstVideoInfo videoInfo;
+  bool valid = gst_video_info_from_caps(&videoInfo, caps) &&
+    gst_caps_features_contains(gst_caps_get_features(caps, 0), GST_CAPS_FEATURE_MEMORY_SYSTEM_MEMORY);
+  gst_caps_unref(caps);
+
+  if (!valid || !GST_VIDEO_INFO_IS_YUV(&videoInfo) || GST_VIDEO_INFO_N_PLANES(&videoInfo) < 2) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  GstBuffer* buffer = gst_buffer_make_writable(GST_PAD_PROBE_INFO_BUFFER(info));
+  GST_PAD_PROBE_INFO_DATA(info) = buffer;
+
+  GstVideoFrame frame;
+  if (!gst_video_frame_map(&frame, &videoInfo, buffer, GST_MAP_WRITE)) {
+    LOG_ERROR(Video) << "Failed to map the frame for stamping";
+    return GST_PAD_PROBE_OK;
+  }
+
+  int width = GST_VIDEO_FRAME_WIDTH(&frame);
+  int height = GST_VIDEO_FRAME_HEIGHT(&frame);
+
+  if (FrameStamp::write(static_cast<std::uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0)),
+                        width, height, GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0), FrameStamp::now())) {
+    // Grey chroma under the stamp, whether planar or interleaved
+    int rows = FrameStamp::rows(width, height);
+    for (int comp = 1; comp < 3; comp++) {
+      std::uint8_t* data = static_cast<std::uint8_t*>(GST_VIDEO_FRAME_COMP_DATA(&frame, comp));
+      int stride = GST_VIDEO_FRAME_COMP_STRIDE(&frame, comp);
+      int pixelStride = GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, comp);
+      int compWidth = GST_VIDEO_FRAME_COMP_WIDTH(&frame, comp);
+      int compRows = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(frame.info.finfo, comp, rows);
+
+      for (int y = 0; y < compRows; y++) {
+        for (int x = 0; x < compWidth; x++) {
+          data[y * stride + x * pixelStride] = 128;
+        }
+      }
+    }
+  }
+
+  gst_video_frame_unmap(&frame);
+  return GST_PAD_PROBE_OK;
+}
+
 /*
  * Write camera frame to Object Detection process
  */
 GstFlowReturn VideoSender::newBufferOBCB(GstAppSink *sink, gpointer user_data)
 {
-  std::cout << "In " << __FUNCTION__ << std::endl;
+  LOG_DEBUG(Video) << "In " << __FUNCTION__;
 
   VideoSender *vs = static_cast<VideoSender *>(user_data);
 
   // Get new video sample
   GstSample *sample = gst_app_sink_pull_sample(sink);
   if (sample == NULL) {
-    std::cerr << __FUNCTION__ << ": Failed to get new sample" << std::endl;
+    LOG_ERROR(Video) << __FUNCTION__ << ": Failed to get new sample";
     return GST_FLOW_OK;
   }
 
   if (!vs->processReady) {
-    std::cout << "ODprocess not ready yet, not sending frame" << std::endl;
+    LOG_DEBUG(Video) << "ODprocess not ready yet, not sending frame";
     gst_sample_unref(sample);
     return GST_FLOW_OK;
   }
 
   GstCaps *caps = gst_sample_get_caps(sample);
   if (caps == NULL) {
-    std::cerr << __FUNCTION__ << ": Failed to get caps of the sample" << std::endl;
+    LOG_ERROR(Video) << __FUNCTION__ << ": Failed to get caps of the sample";
     gst_sample_unref(sample);
     return GST_FLOW_OK;
   }
@@ -576,13 +649,13 @@ GstFlowReturn VideoSender::newBufferOBCB(GstAppSink *sink, gpointer user_data)
       }
 
       if (ec) {
-        std::cerr << "Error writing to process: " << ec.message() << std::endl;
+        LOG_ERROR(Video) << "Error writing to process: " << ec.message();
       }
     }
 
     gst_buffer_unmap(buffer, &map);
   } else {
-    std::cerr << "Error with gst_buffer_map" << std::endl;
+    LOG_ERROR(Video) << "Error with gst_buffer_map";
   }
 
   gst_sample_unref(sample);
@@ -599,17 +672,20 @@ void VideoSender::setVideoSource(int index)
     videoSource = "videotestsrc";
     break;
   default:
-    std::cerr << __FUNCTION__ << ": Unknown video source index: " << index << std::endl;
+    LOG_ERROR(Video) << __FUNCTION__ << ": Unknown video source index: " << index;
   }
 }
 
-void VideoSender::setBitrate(int bitrate)
+void VideoSender::setBitrate(int kbps)
 {
-  std::cout << "In " << __FUNCTION__ << ", bitrate: " << bitrate << std::endl;
+  bitrate = std::min(kbps, maxBitrate);
+  metricBitrate.set(bitrate);
+
+  LOG_DEBUG(Video) << "In " << __FUNCTION__ << ", bitrate: " << bitrate;
 
   if (!encoder) {
     if (pipeline) {
-      std::cerr << "Pipeline found, but no encoder?" << std::endl;
+      LOG_ERROR(Video) << "Pipeline found, but no encoder?";
     }
     return;
   }
@@ -619,7 +695,7 @@ void VideoSender::setBitrate(int bitrate)
     tmpbitrate *= 1024;
   }
 
-  std::cout << "In " << __FUNCTION__ << ", setting bitrate: " << tmpbitrate << std::endl;
+  LOG_DEBUG(Video) << "In " << __FUNCTION__ << ", setting bitrate: " << tmpbitrate;
   if (hardware->getHardwareName() == "tegrak1" ||
       hardware->getHardwareName() == "tegrax1") {
     g_object_set(G_OBJECT(encoder), "target-bitrate", tmpbitrate, NULL);
@@ -628,18 +704,34 @@ void VideoSender::setBitrate(int bitrate)
   }
 }
 
+int VideoSender::getBitrate(void) const
+{
+  return bitrate;
+}
+
+int VideoSender::getMaxBitrate(void) const
+{
+  return maxBitrate;
+}
+
+void VideoSender::setFrameStamping(bool enable)
+{
+  frameStamping = enable;
+}
+
 void VideoSender::setVideoQuality(std::uint16_t q)
 {
   quality = q;
 
   if (quality < sizeof(video_quality_bitrate) / sizeof(video_quality_bitrate[0])) {
-    bitrate = video_quality_bitrate[quality];
+    maxBitrate = video_quality_bitrate[quality];
   } else {
-    std::cerr << __FUNCTION__ << ": Unknown quality: " << quality << std::endl;
-    bitrate = video_quality_bitrate[0];
+    LOG_ERROR(Video) << __FUNCTION__ << ": Unknown quality: " << quality;
+    maxBitrate = video_quality_bitrate[0];
   }
 
-  setBitrate(bitrate);
+  LOG_INFO(Video) << "Video quality " << quality << ", bitrate: " << maxBitrate;
+  setBitrate(maxBitrate);
 }
 
 void VideoSender::setVideoCallback(VideoCallback callback)
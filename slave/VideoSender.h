@@ -7,11 +7,13 @@
 
 #include "Hardware.h"
 #include "Event.h"
+#include "Metrics.h"
 
 #include <vector>
 #include <cstdint>
 #include <functional>
 #include <string>
+#include <atomic>
 #include <memory>
 
 #include <gst/gst.h>
@@ -28,25 +30,39 @@ class VideoSender
   void setVideoSource(int index);
   void setVideoQuality(std::uint16_t quality);
 
+  // Encoder bitrate in kilobits per second, at most the one of the
+  // video quality
+  void setBitrate(int kbps);
+  int getBitrate(void) const;
+  int getMaxBitrate(void) const;
+
+  // Draw a FrameStamp into each captured frame for latency measurements.
+  // Takes effect when the sending is enabled the next time.
+  void setFrameStamping(bool enable);
+
   // Callback type for video data
-  using VideoCallback = std::function<void(std::vector<std::uint8_t>* video)>;
+  using VideoCallback = std::function<void(const std::uint8_t* video, std::size_t size)>;
 
   // Set callback for video data
   void setVideoCallback(VideoCallback callback);
 
  private:
-  void setBitrate(int bitrate);
-  void emitVideo(std::vector<std::uint8_t>* data);
+  void emitVideo(const std::uint8_t* data, std::size_t size);
   void launchObjectDetection();
   void processObjectDetectionOutput();
   void handleObjectDetectionExit(int exitCode);
 
   static GstFlowReturn newBufferCB(GstAppSink* sink, gpointer user_data);
   static GstFlowReturn newBufferOBCB(GstAppSink* sink, gpointer user_data);
+  static GstPadProbeReturn stampFrameCB(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
 
   // The EventLoop for async operations
   EventLoop& eventLoop;
 
+  // The object detection process is served on this strand, away from
+  // the control path
+  EventLoop::Strand strand;
+
   // GStreamer elements
   GstElement* pipeline;
   GstElement* encoder;
@@ -56,7 +72,7 @@ class VideoSender
   std::unique_ptr<asio::posix::stream_descriptor> processStderr;
   std::unique_ptr<asio::posix::stream_descriptor> processStdin;
   int processPid;
-  bool processReady;
+  std::atomic<bool> processReady;   // Set on the strand, read by GStreamer
 
   // Buffer for process data
   std::vector<std::uint8_t> processBuffer;
@@ -65,14 +81,21 @@ class VideoSender
   // Video properties
   std::string videoSource;
   int bitrate;
+  int maxBitrate;
   std::uint16_t quality;
   std::uint8_t index;
+  bool frameStamping;
 
   // Hardware reference
   Hardware* hardware;
 
   // Callback for video data
   VideoCallback videoCallback;
+
+  // Exported metrics
+  Metrics::Counter& metricFrames;
+  Metrics::Counter& metricBytes;
+  Metrics::Gauge& metricBitrate;
 };
 
 /* Emacs indentatation information
@@ -5,6 +5,8 @@
 
 #include "Slave.h"
 #include "Event.h"
+#include "MetricsExporter.h"
+#include "Log.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -16,8 +18,11 @@
 
 int main(int argc, char *argv[])
 {
+  Log::init();
+
   // Create the event loop for async operations
   EventLoop eventLoop;
+  eventLoop.configureFromEnvironment();
 
   // Create the slave object with the event loop
   std::unique_ptr<Slave> slave = std::make_unique<Slave>(eventLoop, argc, argv);
@@ -40,10 +45,18 @@ int main(int argc, char *argv[])
 
   // Initialize the slave
   if (!slave->init()) {
-    std::cerr << "Failed to init slave class. Exiting..." << std::endl;
+    LOG_ERROR(Main) << "Failed to init slave class. Exiting...";
     return 1;
   }
 
+  // Metrics for scraping, the slave runs without them if this fails
+  std::unique_ptr<MetricsExporter> metrics;
+  std::string metricsPath = MetricsExporter::pathFromEnvironment("/tmp/pleco-slave.sock");
+  if (!metricsPath.empty()) {
+    metrics = std::make_unique<MetricsExporter>(eventLoop, metricsPath);
+    metrics->start();
+  }
+
   // Determine relay server address
   std::string relay = "127.0.0.1";
   char* envRelay = std::getenv("PLECO_RELAY_IP");
@@ -61,7 +74,7 @@ int main(int argc, char *argv[])
     auto endpoints = resolver.resolve(relay, "");
 
     if (endpoints.empty()) {
-      std::cerr << "Failed to get IP for " << relay << std::endl;
+      LOG_ERROR(Main) << "Failed to get IP for " << relay;
       return 1;
     }
 
@@ -69,7 +82,7 @@ int main(int argc, char *argv[])
     asio::ip::address addr = endpoints.begin()->endpoint().address();
     slave->connect(addr.to_string(), 8500);
 
-    std::cout << "Connected to relay at " << addr.to_string() << ":8500" << std::endl;
+    LOG_INFO(Main) << "Connected to relay at " << addr.to_string() << ":8500";
 
     // Run the event loop - this will block until the application is done
     eventLoop.run();
@@ -77,7 +90,7 @@ int main(int argc, char *argv[])
     return 0;
   }
   catch (const std::exception& e) {
-    std::cerr << "Error resolving hostname: " << e.what() << std::endl;
+    LOG_ERROR(Main) << "Error resolving hostname: " << e.what();
     return 1;
   }
 }
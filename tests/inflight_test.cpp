@@ -0,0 +1,172 @@
+/*
+ * Copyright 2025-2025 Tuomas Kulve, <tuomas@kulve.fi>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "InFlightTable.h"
+#include "MessageBuilder.h"
+#include "MessageView.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+using Clock = InFlightTable::Clock;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                \
+  do {                                                                  \
+    if (!(condition)) {                                                 \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition "\n"; \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+struct Sent {
+  std::array<std::uint8_t, INFLIGHT_MESSAGE_MAX_LEN> data;
+  std::size_t size;
+
+  MessageView view(void) const { return MessageView(data.data(), size); }
+};
+
+static Sent makeValue(std::uint16_t seq)
+{
+  Sent sent;
+
+  MessageBuilder builder(sent.data.data(), sent.data.size());
+  builder.begin(MessageType::Value, MessageSubtype::SpeedTurn);
+  builder.setSeq(seq);
+  builder.setPayload16(seq);
+  sent.size = builder.finish();
+
+  return sent;
+}
+
+static const std::uint16_t FULL_TYPE = (MessageType::Value << 8) | MessageSubtype::SpeedTurn;
+
+// The resend timer as in Transmitter::resendExpired()
+static void expire(InFlightTable& table, Clock::time_point now)
+{
+  while (InFlightTable::Slot* slot = table.popExpired(now)) {
+    slot->resent = true;
+    slot->resendsQueued++;
+  }
+}
+
+// The ACK as in Transmitter::handleAck()
+static void ack(InFlightTable& table, std::uint16_t seq)
+{
+  InFlightTable::Slot* slot = table.find(FULL_TYPE, seq);
+  if (slot) {
+    table.unschedule(*slot);
+    slot->size = 0;
+  }
+}
+
+// A resend queued for seq 100, then a window of newer messages is sent
+// before it. The late resend must not replace seq 108 in the same slot.
+static void testResendAfterNewerMessage(void)
+{
+  InFlightTable table;
+  Clock::time_point now = Clock::now();
+  Clock::time_point later = now + std::chrono::seconds(1);
+
+  table.store(makeValue(100).view(), now, now);
+  expire(table, now);
+
+  for (std::uint16_t seq = 101; seq <= 100 + INFLIGHT_WINDOW; seq++) {
+    table.store(makeValue(seq).view(), now, later);
+  }
+  table.store(makeValue(100).view(), now, later);
+
+  std::uint16_t newest = 100 + INFLIGHT_WINDOW;
+  CHECK(table.find(FULL_TYPE, newest) != nullptr);
+  CHECK(table.find(FULL_TYPE, 100) == nullptr);
+  CHECK(table.scheduledCount() == INFLIGHT_WINDOW);
+}
+
+// As above, but the newer message is also resent and ACKed before the
+// two queued resends are sent
+static void testResendAfterNewerAckedMessage(void)
+{
+  InFlightTable table;
+  Clock::time_point now = Clock::now();
+  Clock::time_point later = now + std::chrono::seconds(1);
+  std::uint16_t newest = 100 + INFLIGHT_WINDOW;
+
+  table.store(makeValue(100).view(), now, now);
+  expire(table, now);
+
+  for (std::uint16_t seq = 101; seq <= newest; seq++) {
+    table.store(makeValue(seq).view(), now, seq == newest ? now : later);
+  }
+  expire(table, now);
+  ack(table, newest);
+
+  table.store(makeValue(100).view(), now, later);
+  table.store(makeValue(newest).view(), now, later);
+
+  CHECK(table.find(FULL_TYPE, 100) == nullptr);
+  CHECK(table.find(FULL_TYPE, newest) == nullptr);
+  CHECK(table.scheduledCount() == INFLIGHT_WINDOW - 1);
+}
+
+// The ACK comes while the resend is queued
+static void testResendAfterAck(void)
+{
+  InFlightTable table;
+  Clock::time_point now = Clock::now();
+
+  table.store(makeValue(200).view(), now, now);
+  expire(table, now);
+  ack(table, 200);
+  table.store(makeValue(200).view(), now, now);
+
+  CHECK(table.find(FULL_TYPE, 200) == nullptr);
+  CHECK(table.scheduledCount() == 0);
+
+  // The next message in the slot is stored as new
+  InFlightTable::Slot* slot = table.store(makeValue(200 + INFLIGHT_WINDOW).view(), now, now);
+  CHECK(slot != nullptr && !slot->resent);
+  CHECK(table.find(FULL_TYPE, 200 + INFLIGHT_WINDOW) == slot);
+}
+
+// A resend sent before the ACK stays stored and marked as resent
+static void testResend(void)
+{
+  InFlightTable table;
+  Clock::time_point now = Clock::now();
+
+  table.store(makeValue(300).view(), now, now);
+  expire(table, now);
+  InFlightTable::Slot* slot = table.store(makeValue(300).view(), now, now);
+
+  CHECK(slot != nullptr && slot->resent && slot->resendsQueued == 0);
+  CHECK(table.find(FULL_TYPE, 300) == slot);
+  CHECK(table.scheduledCount() == 1);
+}
+
+int main(void)
+{
+  testResendAfterNewerMessage();
+  testResendAfterNewerAckedMessage();
+  testResendAfterAck();
+  testResend();
+
+  if (failures > 0) {
+    std::cerr << failures << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Emacs indentatation information
+   Local Variables:
+   indent-tabs-mode:nil
+   tab-width:2
+   c-basic-offset:2
+   End:
+*/